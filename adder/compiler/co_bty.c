@@ -454,6 +454,17 @@ bool bty_ctx_insert(bty_ctx_t* ctx, srcref_t name, bty_type_t* type) {
     return false;
 }
 
+// like bty_ctx_insert, but replaces the type
+// if the name is already in the context
+bool bty_ctx_set(bty_ctx_t* ctx, srcref_t name, bty_type_t* type) {
+    res_t res = bty_ctx_binsearch(ctx->kvps, 0, (int) ctx->size - 1, name);
+    if( res.found ) {
+        ctx->kvps[res.index].type = type;
+        return true;
+    }
+    return bty_ctx_insert(ctx, name, type);
+}
+
 bty_type_t* bty_ctx_lookup(bty_ctx_t* ctx, srcref_t name) {
     res_t res = bty_ctx_binsearch(ctx->kvps, 0, (int) ctx->size - 1, name);
     if( res.found ) {
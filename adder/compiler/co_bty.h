@@ -91,10 +91,12 @@ char* sprint_bty_type(arena_t* a, bty_type_t* ty);
 
 bty_ctx_t* bty_ctx_create(arena_t* a, trace_t* t, int capacity);
 bool bty_ctx_insert(bty_ctx_t* ctx, srcref_t name, bty_type_t* type);
+bool bty_ctx_set(bty_ctx_t* ctx, srcref_t name, bty_type_t* type);
 bty_type_t* bty_ctx_lookup(bty_ctx_t* ctx, srcref_t name);
 bty_ctx_t* bty_ctx_clone(bty_ctx_t* src);
 
 void bty_ctx_dump(cstr_t str, bty_ctx_t* ctx);
+bty_type_t* bty_extract_type(arena_t* a, trace_t* t, ast_node_t* n);
 bty_type_t* bty_synthesize(bty_ctx_t* c, ast_node_t* n);
 bool bty_typecheck(bty_ctx_t* ctx, ast_node_t* program);
 
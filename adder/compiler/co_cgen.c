@@ -0,0 +1,327 @@
+#include "co_cgen.h"
+#include "sh_asminfo.h"
+#include "sh_utils.h"
+#include "sh_ift.h"
+#include "sh_log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// name of the vm_aot.h macro of each instruction
+#define CGEN_OP(NAME) [OP_##NAME] = #NAME
+
+static const char* cgen_macros[OP_OPCODE_COUNT] = {
+    CGEN_OP(HALT), CGEN_OP(AND), CGEN_OP(OR), CGEN_OP(NOT),
+    CGEN_OP(MUL), CGEN_OP(DIV), CGEN_OP(MOD), CGEN_OP(ADD),
+    CGEN_OP(SUB), CGEN_OP(NEG), CGEN_OP(DUP_1), CGEN_OP(DUP_2),
+    CGEN_OP(ROT_2), CGEN_OP(CMP_EQUAL), CGEN_OP(CMP_NOT_EQUAL),
+    CGEN_OP(CMP_LESS_THAN), CGEN_OP(CMP_MORE_THAN),
+    CGEN_OP(CMP_LESS_THAN_OR_EQUAL), CGEN_OP(CMP_MORE_THAN_OR_EQUAL),
+    CGEN_OP(PUSH_VALUE), CGEN_OP(POP_1), CGEN_OP(POP_2),
+    CGEN_OP(JUMP), CGEN_OP(JUMP_IF_FALSE),
+    [OP_EXIT] = "EXIT_VALUE",
+    CGEN_OP(CALL), CGEN_OP(MAKE_FRAME), CGEN_OP(RETURN_NOTHING),
+    CGEN_OP(RETURN_VALUE), CGEN_OP(STORE_LOCAL), CGEN_OP(LOAD_LOCAL),
+    [OP_PRINT] = NULL,
+    CGEN_OP(MAKE_ARRAY), CGEN_OP(ARRAY_LENGTH), CGEN_OP(MAKE_ITER),
+    CGEN_OP(ITER_NEXT), CGEN_OP(CALL_NATIVE),
+    CGEN_OP(LOAD_LOCAL_PAIR), CGEN_OP(PUSH_VALUE_LOAD_LOCAL),
+    CGEN_OP(ADD_LOCALS_TO_LOCAL), CGEN_OP(INC_LOCAL_BY_CONST),
+    CGEN_OP(JUMP_IF_NOT_EQUAL), CGEN_OP(JUMP_IF_NOT_NOT_EQUAL),
+    CGEN_OP(JUMP_IF_NOT_LESS_THAN), CGEN_OP(JUMP_IF_NOT_MORE_THAN),
+    CGEN_OP(JUMP_IF_NOT_LESS_THAN_OR_EQUAL),
+    CGEN_OP(JUMP_IF_NOT_MORE_THAN_OR_EQUAL),
+    CGEN_OP(ITER_NEXT_STORE_LOCAL),
+    CGEN_OP(R_MOVE), CGEN_OP(R_ADD), CGEN_OP(R_SUB), CGEN_OP(R_MUL),
+    CGEN_OP(R_DIV), CGEN_OP(R_MOD), CGEN_OP(R_NEG), CGEN_OP(R_AND),
+    CGEN_OP(R_OR), CGEN_OP(R_NOT), CGEN_OP(R_CMP_EQUAL),
+    CGEN_OP(R_CMP_NOT_EQUAL), CGEN_OP(R_CMP_LESS_THAN),
+    CGEN_OP(R_CMP_MORE_THAN), CGEN_OP(R_CMP_LESS_THAN_OR_EQUAL),
+    CGEN_OP(R_CMP_MORE_THAN_OR_EQUAL), CGEN_OP(R_JUMP_IF_FALSE),
+    CGEN_OP(R_JUMP_IF_NOT_EQUAL), CGEN_OP(R_JUMP_IF_NOT_NOT_EQUAL),
+    CGEN_OP(R_JUMP_IF_NOT_LESS_THAN), CGEN_OP(R_JUMP_IF_NOT_MORE_THAN),
+    CGEN_OP(R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL),
+    CGEN_OP(R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL),
+    CGEN_OP(IADD), CGEN_OP(ISUB), CGEN_OP(IMUL), CGEN_OP(IDIV),
+    CGEN_OP(IMOD), CGEN_OP(INEG), CGEN_OP(ICMP_EQUAL),
+    CGEN_OP(ICMP_NOT_EQUAL), CGEN_OP(ICMP_LESS_THAN),
+    CGEN_OP(ICMP_MORE_THAN), CGEN_OP(ICMP_LESS_THAN_OR_EQUAL),
+    CGEN_OP(ICMP_MORE_THAN_OR_EQUAL), CGEN_OP(INT_TO_FLOAT),
+    CGEN_OP(IADD_LOCALS_TO_LOCAL), CGEN_OP(IINC_LOCAL_BY_CONST),
+    CGEN_OP(JUMP_IF_NOT_IEQUAL), CGEN_OP(JUMP_IF_NOT_INOT_EQUAL),
+    CGEN_OP(JUMP_IF_NOT_ILESS_THAN), CGEN_OP(JUMP_IF_NOT_IMORE_THAN),
+    CGEN_OP(JUMP_IF_NOT_ILESS_THAN_OR_EQUAL),
+    CGEN_OP(JUMP_IF_NOT_IMORE_THAN_OR_EQUAL),
+    CGEN_OP(R_IADD), CGEN_OP(R_ISUB), CGEN_OP(R_IMUL), CGEN_OP(R_IDIV),
+    CGEN_OP(R_IMOD), CGEN_OP(R_INEG), CGEN_OP(R_ICMP_EQUAL),
+    CGEN_OP(R_ICMP_NOT_EQUAL), CGEN_OP(R_ICMP_LESS_THAN),
+    CGEN_OP(R_ICMP_MORE_THAN), CGEN_OP(R_ICMP_LESS_THAN_OR_EQUAL),
+    CGEN_OP(R_ICMP_MORE_THAN_OR_EQUAL), CGEN_OP(R_JUMP_IF_NOT_IEQUAL),
+    CGEN_OP(R_JUMP_IF_NOT_INOT_EQUAL), CGEN_OP(R_JUMP_IF_NOT_ILESS_THAN),
+    CGEN_OP(R_JUMP_IF_NOT_IMORE_THAN),
+    CGEN_OP(R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL),
+    CGEN_OP(R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL),
+    CGEN_OP(TAIL_CALL), CGEN_OP(MAKE_PACKED_ARRAY)
+};
+
+static const char* cgen_ctype(ift_t type) {
+    switch(type.tags[0]) {
+        case IFT_VOID:  return "void";
+        case IFT_BOOL:  return "bool";
+        case IFT_CHAR:  return "char";
+        case IFT_I32:   return "int32_t";
+        case IFT_F32:   return "float";
+        default:        return "val_t";
+    }
+}
+
+// val_t constructor of the c type, lists are passed as is
+static const char* cgen_into_val(ift_t type) {
+    switch(type.tags[0]) {
+        case IFT_BOOL:  return "val_bool";
+        case IFT_CHAR:  return "val_char";
+        case IFT_I32:   return "val_int";
+        case IFT_F32:   return "val_number";
+        default:        return "";
+    }
+}
+
+// export names are adder identifiers, anything
+// else is replaced to keep the c names valid
+static void cgen_write_name(FILE* out, char* prefix, sstr_t* name) {
+    fprintf(out, "%s_", prefix);
+    int len = sstr_len(name);
+    char* str = sstr_ptr(name);
+    for(int i = 0; i < len; i++) {
+        fputc(isalnum((unsigned char) str[i]) ? str[i] : '_', out);
+    }
+}
+
+// the result is a val_t as for vm_call, the run
+// can fail with an error value (val_number)
+static void cgen_write_signature(FILE* out, char* prefix, ffi_definition_t* def) {
+    fprintf(out, "val_t ");
+    cgen_write_name(out, prefix, &def->name);
+    fprintf(out, "(vm_t* vm, vm_env_t* env");
+    int argc = ift_func_arg_count(def->type);
+    for(int i = 0; i < argc; i++) {
+        ift_t arg = ift_func_get_arg(def->type, i);
+        fprintf(out, ", %s arg%i", cgen_ctype(arg), i);
+    }
+    fprintf(out, ")");
+}
+
+static void cgen_write_ift(FILE* out, ift_t type) {
+    fprintf(out, "(ift_t) { .count = %i, .tags = {", type.count);
+    for(int i = 0; i < type.count; i++) {
+        fprintf(out, "%s'%c'", i > 0 ? ", " : " ", type.tags[i]);
+    }
+    fprintf(out, " } }");
+}
+
+bool program_translate_to_c_header(program_t* program, char* prefix, FILE* out) {
+
+    if( program == NULL || program->inst.size == 0 ) {
+        sh_log_error("cannot translate an empty program to c");
+        return false;
+    }
+
+    fprintf(out, "// translated from adder bytecode, do not edit\n");
+    fprintf(out, "#ifndef ADR_%s_H_\n#define ADR_%s_H_\n\n", prefix, prefix);
+    fprintf(out, "#include <sh_types.h>\n#include <vm_types.h>\n");
+    fprintf(out, "#include <stdbool.h>\n#include <stdint.h>\n\n");
+    fprintf(out, "bool %s_setup(vm_env_t* env, ffi_t* ffi);\n", prefix);
+    for(int i = 0; i < program->exports.count; i++) {
+        cgen_write_signature(out, prefix, &program->exports.def[i]);
+        fprintf(out, ";\n");
+    }
+    fprintf(out, "\n#endif // ADR_%s_H_\n", prefix);
+    return ferror(out) == 0;
+}
+
+bool program_translate_to_c(program_t* program, char* prefix, FILE* out) {
+
+    if( program == NULL || program->inst.size == 0 ) {
+        sh_log_error("cannot translate an empty program to c");
+        return false;
+    }
+
+    uint8_t* instructions = program->inst.buffer;
+    uint32_t size = program->inst.size;
+
+    // instructions that are jumped to (1) or
+    // returned to (2) need a label
+    uint8_t* labels = calloc(size + 1, sizeof(uint8_t));
+    if( labels == NULL ) {
+        sh_log_error("cannot translate program to c, out of memory");
+        return false;
+    }
+    bool has_returns = false;
+
+    for(uint32_t pc = 0; pc < size; ) {
+        vm_op_t opcode = instructions[pc];
+        if( opcode >= OP_OPCODE_COUNT ) {
+            sh_log_error("cannot translate unknown opcode %i at %u", opcode, pc);
+            free(labels);
+            return false;
+        }
+        int argc = (int) get_op_arg_count(opcode);
+        op_argtype_t* argtypes = get_op_arg_types(opcode);
+        for(int i = 0; i < argc; i++) {
+            // call-native takes a host function index, not an address
+            if( argtypes[i] == OP_ARG_ADDRESS && opcode != OP_CALL_NATIVE ) {
+                uint32_t target = READ_U32(instructions, pc + 1 + 4 * i);
+                if( target > size ) {
+                    sh_log_error("cannot translate jump to %u at %u", target, pc);
+                    free(labels);
+                    return false;
+                }
+                labels[target] |= 1;
+            }
+        }
+        pc += 1 + 4 * argc;
+        if( opcode == OP_CALL && pc <= size ) {
+            labels[pc] |= 2;
+        }
+        has_returns |= opcode == OP_RETURN_NOTHING
+                    || opcode == OP_RETURN_VALUE;
+    }
+    for(int i = 0; i < program->exports.count; i++) {
+        labels[program->expaddr[i]] |= 1;
+    }
+
+    fprintf(out, "// translated from adder bytecode, do not edit\n");
+    fprintf(out, "#include <vm_aot.h>\n#include <sh_ffi.h>\n#include <sh_utils.h>\n\n");
+
+    // constants, stored bit for bit through the address
+    fprintf(out, "static val_t %s_consts[] = {\n", prefix);
+    for(uint32_t i = 0; i < program->cons.count; i++) {
+        val_t v = program->cons.buffer[i];
+        fprintf(out, "    { .type = %u, .pack = %u, .count = %u, .u.address = 0x%08xu },\n",
+            (unsigned) v.type, (unsigned) v.pack, (unsigned) v.count, v.u.address);
+    }
+    if( program->cons.count == 0 ) {
+        fprintf(out, "    { 0 }\n");
+    }
+    fprintf(out, "};\n\n");
+
+    // the bytecode and the exports, verified by the setup
+    fprintf(out, "static uint8_t %s_code[] = {", prefix);
+    for(uint32_t i = 0; i < size; i++) {
+        fprintf(out, "%s0x%02x,", i % 16 == 0 ? "\n    " : " ", instructions[i]);
+    }
+    fprintf(out, "\n};\n\n");
+    fprintf(out, "static uint32_t %s_expaddr[] = {", prefix);
+    for(int i = 0; i < program->exports.count; i++) {
+        fprintf(out, "%s%u", i > 0 ? ", " : " ", program->expaddr[i]);
+    }
+    fprintf(out, "%s};\n\n", program->exports.count > 0 ? " " : " 0 ");
+
+    fprintf(out, "static val_t %s_run(vm_t* vm, vm_env_t* env, "
+        "uint32_t entry, int argc, val_t* args) {\n", prefix);
+    fprintf(out, "    AOT_BEGIN(vm, env, %s_consts, argc, args);\n", prefix);
+    fprintf(out, "    switch( entry ) {\n");
+    for(int i = 0; i < program->exports.count; i++) {
+        uint32_t address = program->expaddr[i];
+        bool frame = instructions[address] == OP_MAKE_FRAME;
+        fprintf(out, "        case %u: %sgoto L_%u;\n", address,
+            frame ? "AOT_ENTRY_FRAME(); " : "", address);
+    }
+    fprintf(out, "        default: AOT_EXIT(val_number(-1003));\n");
+    fprintf(out, "    }\n");
+
+    for(uint32_t pc = 0; pc < size; ) {
+        vm_op_t opcode = instructions[pc];
+        int argc = (int) get_op_arg_count(opcode);
+        if( labels[pc] ) {
+            fprintf(out, "L_%u:\n", pc);
+        }
+        const char* macro = cgen_macros[opcode];
+        if( macro == NULL ) {
+            fprintf(out, "    AOT_UNHANDLED(%i);\n", opcode);
+        } else {
+            fprintf(out, "    AOT_%s(", macro);
+            for(int i = 0; i < argc; i++) {
+                uint32_t arg = READ_U32(instructions, pc + 1 + 4 * i);
+                fprintf(out, "%s%u", i > 0 ? ", " : "", arg);
+            }
+            if( opcode == OP_CALL ) {
+                fprintf(out, ", %u", pc + 5);
+            }
+            fprintf(out, ");\n");
+        }
+        pc += 1 + 4 * argc;
+    }
+    if( labels[size] ) {
+        fprintf(out, "L_%u:\n", size);
+    }
+    fprintf(out, "    AOT_HALT();\n");
+
+    if( has_returns ) {
+        fprintf(out, "aot_return:\n");
+        fprintf(out, "    switch( pc ) {\n");
+        for(uint32_t pc = 0; pc <= size; pc++) {
+            if( labels[pc] & 2 ) {
+                fprintf(out, "        case %u: goto L_%u;\n", pc, pc);
+            }
+        }
+        fprintf(out, "        default: AOT_EXIT(val_number(-1003));\n");
+        fprintf(out, "    }\n");
+    }
+    fprintf(out, "}\n\n");
+    free(labels);
+
+    fprintf(out, "bool %s_setup(vm_env_t* env, ffi_t* ffi) {\n", prefix);
+    fprintf(out, "    program_t program = {\n");
+    fprintf(out, "        .inst = { .size = %u, .buffer = %s_code },\n", size, prefix);
+    fprintf(out, "        .cons = { .count = %u, .buffer = %s_consts },\n",
+        program->cons.count, prefix);
+    fprintf(out, "        .expaddr = %s_expaddr\n    };\n", prefix);
+    fprintf(out, "    if( ffi_definition_set_init(&program.imports, %i) == false ) {\n",
+        program->imports.count > 0 ? program->imports.count : 1);
+    fprintf(out, "        return false;\n    }\n");
+    fprintf(out, "    if( ffi_definition_set_init(&program.exports, %i) == false ) {\n",
+        program->exports.count > 0 ? program->exports.count : 1);
+    fprintf(out, "        ffi_definition_set_destroy(&program.imports);\n");
+    fprintf(out, "        return false;\n    }\n");
+    for(int i = 0; i < program->imports.count; i++) {
+        ffi_definition_t* def = &program->imports.def[i];
+        fprintf(out, "    ffi_definition_set_add(&program.imports, sstr(\"%.*s\"), ",
+            sstr_len(&def->name), sstr_ptr(&def->name));
+        cgen_write_ift(out, def->type);
+        fprintf(out, ");\n");
+    }
+    for(int i = 0; i < program->exports.count; i++) {
+        ffi_definition_t* def = &program->exports.def[i];
+        fprintf(out, "    ffi_definition_set_add(&program.exports, sstr(\"%.*s\"), ",
+            sstr_len(&def->name), sstr_ptr(&def->name));
+        cgen_write_ift(out, def->type);
+        fprintf(out, ");\n");
+    }
+    fprintf(out, "    bool ready = vm_env_setup(env, &program, ffi) && aot_env_check(env);\n");
+    fprintf(out, "    ffi_definition_set_destroy(&program.imports);\n");
+    fprintf(out, "    ffi_definition_set_destroy(&program.exports);\n");
+    fprintf(out, "    return ready;\n}\n");
+
+    for(int i = 0; i < program->exports.count; i++) {
+        ffi_definition_t* def = &program->exports.def[i];
+        int argc = ift_func_arg_count(def->type);
+        fprintf(out, "\n");
+        cgen_write_signature(out, prefix, def);
+        fprintf(out, " {\n");
+        if( argc > 0 ) {
+            fprintf(out, "    val_t args[] = {");
+            for(int a = 0; a < argc; a++) {
+                ift_t arg = ift_func_get_arg(def->type, a);
+                fprintf(out, "%s%s(arg%i)", a > 0 ? ", " : " ",
+                    cgen_into_val(arg), a);
+            }
+            fprintf(out, " };\n");
+        }
+        fprintf(out, "    return %s_run(vm, env, %u, %i, %s);\n",
+            prefix, program->expaddr[i], argc, argc > 0 ? "args" : "NULL");
+        fprintf(out, "}\n");
+    }
+
+    return ferror(out) == 0;
+}
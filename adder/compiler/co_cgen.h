@@ -0,0 +1,28 @@
+#ifndef CO_CGEN_H_
+#define CO_CGEN_H_
+
+#include "sh_types.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+// Ahead of time translation of a compiled program to C. The
+// source gets one function per export with typed args (int ->
+// int32_t, float -> float, bool -> bool, char -> char, lists ->
+// val_t arrays on the vm heap) and a setup function that
+// resolves the imports of the program against an ffi_t and
+// verifies its bytecode (which the source keeps for that):
+//
+//   bool <prefix>_setup(vm_env_t* env, ffi_t* ffi);
+//   val_t <prefix>_<export>(vm_t* vm, vm_env_t* env, ...);
+//
+// The exports return a val_t as vm_call does, a failed run
+// returns its error value (a number, e.g. -1006 for a stack
+// overflow) instead of a value of the return type. The setup
+// fails for programs that don't verify. The generated code
+// builds on vm_aot.h and links with the vm library, the header
+// has the declarations for the host.
+
+bool program_translate_to_c(program_t* program, char* prefix, FILE* out);
+bool program_translate_to_c_header(program_t* program, char* prefix, FILE* out);
+
+#endif // CO_CGEN_H_
@@ -1,15 +1,18 @@
 #include "sh_asminfo.h"
+#include "sh_value.h"
 #include "co_utils.h"
 #include "co_compiler.h"
 #include "co_srcmap.h"
 #include "co_trace.h"
 #include "co_bty.h"
+#include "co_fold.h"
+#include "co_ssa.h"
 #include <sh_log.h>
 #include <assert.h>
 
 typedef struct ir_inst_t {
     vm_op_t opcode;
-    uint32_t args[2];
+    uint32_t args[OP_MAX_ARG_COUNT];
 } ir_inst_t;
 
 typedef struct ir_list_t {
@@ -116,6 +119,15 @@ typedef struct compiler_state_t {
     valbuffer_t             consts;
     trace_t*                trace;
     bty_ctx_t*              tyctx;
+    bty_ctx_t*              fnctx;      // tyctx + locals of the current function
+    bty_type_t*             fnret;      // return type of the current function
+    compiler_opts_t         opts;
+    uint32_t                temp_count; // live temporaries (register backend)
+    uint32_t                temp_max;   // temporaries used by the current function
+    compiler_stats_t        stats;
+    ssa_func_t*             ssa;        // the function being built (opt_level 2)
+    ssa_block_t*            ssa_block;  // the block being built
+    bool                    ssa_ok;     // false if the function can't be built
 } compiler_state_t;
 
 #define ABORT_ON_ERROR(STATE) do { if(trace_get_error_count((STATE)->trace) > 0) return; } while(false)
@@ -164,99 +176,118 @@ ir_index_t state_get_funcaddr(compiler_state_t* state, srcref_t name) {
 }
 
 void codegen(ast_node_t* node, compiler_state_t* state);
+void codegen_as(ast_node_t* node, compiler_state_t* state, bty_type_t* expected);
+
+// Static types
+//
+// The type checker doesn't annotate the ast, so the compiler keeps
+// a context with the locals of the function being compiled and asks
+// the type checker for the type of an expression when it needs it.
+// int and char values share the integer representation and compile
+// to the integer instructions, they are converted where a float is
+// expected (int and char are subtypes of float).
+
+void state_add_localvar_type(compiler_state_t* state, ast_node_t* tyannot) {
+    assert(tyannot->type == AST_TYANNOT);
+    if( state->fnctx == NULL ) {
+        return;
+    }
+    bty_type_t* type = bty_extract_type(state->fnctx->arena, state->trace, tyannot);
+    if( type != NULL ) {
+        bty_ctx_set(state->fnctx, tyannot->u.n_tyannot.expr->u.n_varref.name, type);
+    }
+}
+
+// type of an expression in the current function (NULL
+// for nodes that aren't expressions)
+bty_type_t* state_get_expr_type(compiler_state_t* state, ast_node_t* node) {
+    switch(node->type) {
+        case AST_VALUE:
+        case AST_VAR_REF:
+        case AST_BINOP:
+        case AST_UNOP:
+        case AST_FUN_CALL:
+        case AST_ARRAY: {
+            bty_ctx_t* ctx = state->fnctx != NULL ? state->fnctx : state->tyctx;
+            return bty_synthesize(ctx, node);
+        }
+        default:
+            return NULL;
+    }
+}
+
+bool bty_is_integer(bty_type_t* ty) {
+    return ty != NULL && (bty_is_int(ty) || bty_is_char(ty));
+}
+
+bool state_is_int_expr(compiler_state_t* state, ast_node_t* node) {
+    return bty_is_integer(state_get_expr_type(state, node));
+}
+
+// true if node has the integer representation
+// but is used where a float is expected
+bool state_needs_int_to_float(compiler_state_t* state, ast_node_t* node, bty_type_t* expected) {
+    return expected != NULL
+        && bty_is_float(expected)
+        && state_is_int_expr(state, node);
+}
+
+// operand type of a binary operation, both operands are
+// converted to it (NULL for the boolean operations)
+bty_type_t* state_binop_operand_type(compiler_state_t* state, ast_binop_t node) {
+    switch(node.type) {
+        case AST_BIN_AND:
+        case AST_BIN_OR:
+        case AST_BIN_XOR:
+            return NULL;
+        default: break;
+    }
+    if( state_is_int_expr(state, node.left) && state_is_int_expr(state, node.right) ) {
+        return bty_int();
+    }
+    return bty_float();
+}
+
+vm_op_t binop_opcode(ast_binop_type_t type, bool is_int) {
+    switch(type) {
+        case AST_BIN_ADD:       return is_int ? OP_IADD : OP_ADD;
+        case AST_BIN_SUB:       return is_int ? OP_ISUB : OP_SUB;
+        case AST_BIN_MUL:       return is_int ? OP_IMUL : OP_MUL;
+        case AST_BIN_DIV:       return is_int ? OP_IDIV : OP_DIV;
+        case AST_BIN_MOD:       return is_int ? OP_IMOD : OP_MOD;
+        case AST_BIN_AND:       return OP_AND;
+        case AST_BIN_OR:        return OP_OR;
+        case AST_BIN_EQ:        return is_int ? OP_ICMP_EQUAL : OP_CMP_EQUAL;
+        case AST_BIN_NEQ:       return is_int ? OP_ICMP_NOT_EQUAL : OP_CMP_NOT_EQUAL;
+        case AST_BIN_LT:        return is_int ? OP_ICMP_LESS_THAN : OP_CMP_LESS_THAN;
+        case AST_BIN_GT:        return is_int ? OP_ICMP_MORE_THAN : OP_CMP_MORE_THAN;
+        case AST_BIN_LT_EQ:     return is_int ? OP_ICMP_LESS_THAN_OR_EQUAL : OP_CMP_LESS_THAN_OR_EQUAL;
+        case AST_BIN_GT_EQ:     return is_int ? OP_ICMP_MORE_THAN_OR_EQUAL : OP_CMP_MORE_THAN_OR_EQUAL;
+        default:                return OP_OPCODE_COUNT;
+    }
+}
 
 void codegen_binop(ast_binop_t node, compiler_state_t* state) {
     
     ABORT_ON_ERROR(state);
 
-    codegen(node.right, state);
-    codegen(node.left, state);
-    switch(node.type) {
-        case AST_BIN_ADD: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_ADD,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_SUB: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_SUB,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_MUL: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_MUL,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_DIV: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_DIV,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_MOD: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_MOD,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_AND: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_AND,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_OR: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_OR,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_EQ: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_CMP_EQUAL,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_NEQ: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_CMP_NOT_EQUAL,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_LT: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_CMP_LESS_THAN,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_GT: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_CMP_MORE_THAN,
-                .args = { 0 }
-            });
-        } break;
-         case AST_BIN_LT_EQ: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_CMP_LESS_THAN_OR_EQUAL,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BIN_GT_EQ: {
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_CMP_MORE_THAN_OR_EQUAL,
-                .args = { 0 }
-            });
-        } break;
-        default: {
-            trace_msg_t* msg = trace_create_message(state->trace, TM_ERROR, trace_no_ref());            
-            trace_msg_append_costr(msg, "unhandled binary operation: ");
-            char* m = ast_binop_type_as_string(node.type);
-            trace_msg_append(msg, m, strlen(m));
-        } break;
+    bty_type_t* operand_type = state_binop_operand_type(state, node);
+    vm_op_t opcode = binop_opcode(node.type, bty_is_integer(operand_type));
+
+    if( opcode == OP_OPCODE_COUNT ) {
+        trace_msg_t* msg = trace_create_message(state->trace, TM_ERROR, trace_no_ref());            
+        trace_msg_append_costr(msg, "unhandled binary operation: ");
+        char* m = ast_binop_type_as_string(node.type);
+        trace_msg_append(msg, m, strlen(m));
+        return;
     }
+
+    codegen_as(node.right, state, operand_type);
+    codegen_as(node.left, state, operand_type);
+    irl_add(&state->instrs, (ir_inst_t){
+        .opcode = opcode,
+        .args = { 0 }
+    });
 }
 
 void codegen_unop(ast_unop_t node, compiler_state_t* state) {
@@ -268,7 +299,7 @@ void codegen_unop(ast_unop_t node, compiler_state_t* state) {
     switch(node.type) {
         case AST_UN_NEG: {
             irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_NEG,
+                .opcode = state_is_int_expr(state, node.inner) ? OP_INEG : OP_NEG,
                 .args = { 0 }
             });
         } break;
@@ -287,9 +318,7 @@ void codegen_unop(ast_unop_t node, compiler_state_t* state) {
     }
 }
 
-void codegen_value(ast_value_t node, compiler_state_t* state) {
-
-    ABORT_ON_ERROR(state);
+bool state_add_value_const(compiler_state_t* state, ast_value_t node, uint32_t* index) {
 
     vb_result_t append_result = (vb_result_t) { 0 };
 
@@ -312,21 +341,215 @@ void codegen_value(ast_value_t node, compiler_state_t* state) {
             char* typename = ast_value_type_string(node.type);
             trace_msg_append(msg,
                 typename, strlen(typename));
-            return;
+            return false;
         } break;
     }
 
     if( append_result.out_of_memory ) {
         trace_out_of_memory_error(state->trace);
+        return false;
+    }
+
+    *index = append_result.index;
+    return true;
+}
+
+// adds an int or char literal as a float constant
+bool state_add_value_const_as_float(compiler_state_t* state, ast_value_t node, uint32_t* index) {
+    float value = node.type == AST_VALUE_CHAR
+        ? (float) node.u._char
+        : (float) node.u._int;
+    return state_add_value_const(state, (ast_value_t) {
+        .type = AST_VALUE_FLOAT,
+        .u._float = value
+    }, index);
+}
+
+// Literal arrays
+//
+// An array literal with only constant elements (values or such
+// arrays, string literals are arrays of chars) is stored in the
+// constant pool once and pushed like any other constant instead of
+// being built on the heap every time it is evaluated. The vm only
+// reads constant arrays, a host that writes to an array copies it
+// first (heap_array_unshare).
+
+bool ast_is_const_array(ast_array_t node) {
+    for(size_t i = 0; i < node.count; i++) {
+        ast_node_t* elem = node.content[i];
+        if( elem->type == AST_ARRAY ) {
+            if( ast_is_const_array(elem->u.n_array) == false ) {
+                return false;
+            }
+        } else if( elem->type != AST_VALUE ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+val_t ast_value_to_val(ast_value_t node) {
+    switch(node.type) {
+        case AST_VALUE_BOOL:    return val_bool(node.u._bool);
+        case AST_VALUE_FLOAT:   return val_number(node.u._float);
+        case AST_VALUE_INT:     return val_int(node.u._int);
+        case AST_VALUE_CHAR:    return val_char(node.u._char);
+        default:                return val_none();
+    }
+}
+
+// element type of a packed array of elem_type values (VAL_NONE
+// if they aren't packed, see sh_value.h)
+val_type_t bty_pack_type(bty_type_t* elem_type) {
+    if( elem_type == NULL ) {
+        return VAL_NONE;
+    }
+    if( bty_is_char(elem_type) )    return VAL_CHAR;
+    if( bty_is_bool(elem_type) )    return VAL_BOOL;
+    if( bty_is_int(elem_type) )     return VAL_INT;
+    if( bty_is_float(elem_type) )   return VAL_NUMBER;
+    return VAL_NONE;
+}
+
+// the expected element type of an array literal, the
+// synthesized one if nothing is expected
+bty_type_t* state_array_elem_type(compiler_state_t* state, ast_node_t* node, bty_type_t* elem_type) {
+    if( elem_type != NULL ) {
+        return elem_type;
+    }
+    bty_type_t* type = state_get_expr_type(state, node);
+    return type != NULL && bty_is_list(type) ? type->u.con : NULL;
+}
+
+// appends the elements and a reference to them to the constant pool,
+// index is the one of the reference
+bool state_add_array_const(compiler_state_t* state, val_type_t pack, val_t* elems, size_t count, uint32_t* index) {
+    vb_result_t append_result = valbuffer_append_packed(&state->consts, pack, elems, count);
+    if( append_result.out_of_memory ) {
+        trace_out_of_memory_error(state->trace);
+        return false;
+    }
+    *index = append_result.index;
+    return true;
+}
+
+// adds a constant array literal (see ast_is_const_array), elem_type
+// is the expected type of the elements (or NULL)
+bool state_add_literal_array(compiler_state_t* state, ast_array_t node, bty_type_t* elem_type, uint32_t* index) {
+    val_t* elems = (val_t*) malloc(sizeof(val_t) * (node.count + 1));
+    if( elems == NULL ) {
+        trace_out_of_memory_error(state->trace);
+        return false;
+    }
+    bool to_float = elem_type != NULL && bty_is_float(elem_type);
+    bty_type_t* inner_type = elem_type != NULL && bty_is_list(elem_type)
+        ? elem_type->u.con
+        : NULL;
+    bool ok = true;
+    for(size_t i = 0; ok && i < node.count; i++) {
+        ast_node_t* elem = node.content[i];
+        if( elem->type == AST_ARRAY ) {
+            uint32_t inner_index = 0;
+            ok = state_add_literal_array(state, elem->u.n_array, inner_type, &inner_index);
+            elems[i] = state->consts.values[inner_index];
+            continue;
+        }
+        ast_value_t value = elem->u.n_value;
+        if( to_float && (value.type == AST_VALUE_INT || value.type == AST_VALUE_CHAR) ) {
+            elems[i] = val_number(value.type == AST_VALUE_CHAR
+                ? (float) value.u._char
+                : (float) value.u._int);
+        } else {
+            elems[i] = ast_value_to_val(value);
+        }
+    }
+    if( ok ) {
+        ok = state_add_array_const(state, bty_pack_type(elem_type), elems, node.count, index);
+    }
+    free(elems);
+    return ok;
+}
+
+void codegen_value(ast_value_t node, compiler_state_t* state) {
+
+    ABORT_ON_ERROR(state);
+
+    uint32_t const_index = 0;
+    if( state_add_value_const(state, node, &const_index) == false ) {
         return;
     }
     
     irl_add(&state->instrs, (ir_inst_t){
         .opcode = OP_PUSH_VALUE,
-        .args = { append_result.index, 0 }
+        .args = { const_index, 0 }
+    });
+}
+
+// elem_type is the expected type of the elements (or NULL)
+void codegen_array(ast_array_t node, compiler_state_t* state, bty_type_t* elem_type) {
+
+    ABORT_ON_ERROR(state);
+
+    if( ast_is_const_array(node) ) {
+        uint32_t const_index = 0;
+        if( state_add_literal_array(state, node, elem_type, &const_index) ) {
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = OP_PUSH_VALUE,
+                .args = { const_index, 0 }
+            });
+        }
+        return;
+    }
+
+    for(size_t i = 0; i < node.count; i++) {
+        codegen_as(node.content[i], state, elem_type);
+    }
+    vb_result_t app_res = valbuffer_insert_int(&state->consts, (int) node.count);
+    if( app_res.out_of_memory ) {
+        trace_out_of_memory_error(state->trace);
+        return;
+    }
+    irl_add(&state->instrs, (ir_inst_t){
+        .opcode = OP_PUSH_VALUE,
+        .args = { (uint32_t) app_res.index, 0 }
+    });
+    val_type_t pack = bty_pack_type(elem_type);
+    irl_add(&state->instrs, (ir_inst_t){
+        .opcode = pack != VAL_NONE ? OP_MAKE_PACKED_ARRAY : OP_MAKE_ARRAY,
+        .args = { (uint32_t) pack, 0 }
     });
 }
 
+// evaluates node onto the stack as a value of the expected
+// type (NULL if any), integers are converted to floats where
+// a float is expected, constants at compile time.
+void codegen_as(ast_node_t* node, compiler_state_t* state, bty_type_t* expected) {
+
+    ABORT_ON_ERROR(state);
+
+    if( state_needs_int_to_float(state, node, expected) ) {
+        if( node->type == AST_VALUE ) {
+            uint32_t const_index = 0;
+            if( state_add_value_const_as_float(state, node->u.n_value, &const_index) ) {
+                irl_add(&state->instrs, (ir_inst_t){
+                    .opcode = OP_PUSH_VALUE,
+                    .args = { const_index, 0 }
+                });
+            }
+        } else {
+            codegen(node, state);
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = OP_INT_TO_FLOAT,
+                .args = { 0 }
+            });
+        }
+    } else if( node->type == AST_ARRAY && expected != NULL && bty_is_list(expected) ) {
+        codegen_array(node->u.n_array, state, expected->u.con);
+    } else {
+        codegen(node, state);
+    }
+}
+
 ift_t bty_to_ffi_type(bty_type_t* t) {
     if( t == NULL )
         return ift_unknown();
@@ -423,61 +646,415 @@ void add_program_provided_function_definition(srcref_t name, compiler_state_t* s
     }
 }
 
-void codegen_fundecl(ast_fundecl_t node, compiler_state_t* state) {
+// Register backend
+//
+// Expressions are compiled to three-address instructions that
+// name frame slots (or constants) directly. Intermediate results
+// live in temporaries, extra locals after the named locals of the
+// current function. The number of named locals is only known once
+// the function body is done, so temporaries are tagged with
+// REG_TEMP until reg_resolve_temps() assigns their real slots.
+// Anything the register instructions can't express (calls, arrays,
+// iterators, ...) is compiled to stack instructions and the result
+// is stored into a temporary.
+
+#define REG_TEMP 0x40000000u
+#define REG_ANY  0xFFFFFFFFu
+
+bool state_is_register_backend(compiler_state_t* state) {
+    return state->opts.backend == CO_BACKEND_REGISTER;
+}
 
-    ABORT_ON_ERROR(state);
+uint32_t state_alloc_temp(compiler_state_t* state) {
+    uint32_t temp = state->temp_count++;
+    if( state->temp_count > state->temp_max ) {
+        state->temp_max = state->temp_count;
+    }
+    return REG_TEMP | temp;
+}
 
-    srcref_t funcname = node.name;
+vm_op_t reg_binop_opcode(ast_binop_type_t type, bool is_int) {
+    switch(type) {
+        case AST_BIN_ADD:       return is_int ? OP_R_IADD : OP_R_ADD;
+        case AST_BIN_SUB:       return is_int ? OP_R_ISUB : OP_R_SUB;
+        case AST_BIN_MUL:       return is_int ? OP_R_IMUL : OP_R_MUL;
+        case AST_BIN_DIV:       return is_int ? OP_R_IDIV : OP_R_DIV;
+        case AST_BIN_MOD:       return is_int ? OP_R_IMOD : OP_R_MOD;
+        case AST_BIN_AND:       return OP_R_AND;
+        case AST_BIN_OR:        return OP_R_OR;
+        case AST_BIN_EQ:        return is_int ? OP_R_ICMP_EQUAL : OP_R_CMP_EQUAL;
+        case AST_BIN_NEQ:       return is_int ? OP_R_ICMP_NOT_EQUAL : OP_R_CMP_NOT_EQUAL;
+        case AST_BIN_LT:        return is_int ? OP_R_ICMP_LESS_THAN : OP_R_CMP_LESS_THAN;
+        case AST_BIN_GT:        return is_int ? OP_R_ICMP_MORE_THAN : OP_R_CMP_MORE_THAN;
+        case AST_BIN_LT_EQ:     return is_int ? OP_R_ICMP_LESS_THAN_OR_EQUAL : OP_R_CMP_LESS_THAN_OR_EQUAL;
+        case AST_BIN_GT_EQ:     return is_int ? OP_R_ICMP_MORE_THAN_OR_EQUAL : OP_R_CMP_MORE_THAN_OR_EQUAL;
+        default:                return OP_OPCODE_COUNT;
+    }
+}
 
-    assert((srcref_equals_string(funcname, "main") == false || node.exported) && "main function not marked as exported");
+vm_op_t reg_branch_opcode(ast_binop_type_t type, bool is_int) {
+    switch(type) {
+        case AST_BIN_EQ:        return is_int ? OP_R_JUMP_IF_NOT_IEQUAL : OP_R_JUMP_IF_NOT_EQUAL;
+        case AST_BIN_NEQ:       return is_int ? OP_R_JUMP_IF_NOT_INOT_EQUAL : OP_R_JUMP_IF_NOT_NOT_EQUAL;
+        case AST_BIN_LT:        return is_int ? OP_R_JUMP_IF_NOT_ILESS_THAN : OP_R_JUMP_IF_NOT_LESS_THAN;
+        case AST_BIN_GT:        return is_int ? OP_R_JUMP_IF_NOT_IMORE_THAN : OP_R_JUMP_IF_NOT_MORE_THAN;
+        case AST_BIN_LT_EQ:     return is_int ? OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL : OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL;
+        case AST_BIN_GT_EQ:     return is_int ? OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL : OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL;
+        default:                return OP_OPCODE_COUNT;
+    }
+}
 
-    if ( state->localvars.count > 0 ) {
-        trace_msg_t* msg = trace_create_message(state->trace, TM_ERROR, funcname);
-        trace_msg_append_costr(msg,
-            "functions may not be declared "
-            "inside other functions.");
-        return;
+uint32_t reg_move_to(compiler_state_t* state, uint32_t src, uint32_t dst) {
+    if( dst == REG_ANY ) {
+        return src;
+    }
+    if( src != dst ) {
+        irl_add(&state->instrs, (ir_inst_t){
+            .opcode = OP_R_MOVE,
+            .args = { dst, src, 0 }
+        });
     }
+    return dst;
+}
 
-    ir_index_t frame_index = irl_add(&state->instrs, (ir_inst_t){
-        .opcode = OP_MAKE_FRAME,
-        .args = { 0 }
-    });
+// Evaluates node into dst (or a slot/constant of its own
+// choosing if dst is REG_ANY) and returns the operand that
+// holds the result. Temporaries allocated on the way are
+// released, the caller owns the returned temporary.
+uint32_t codegen_reg_operand(ast_node_t* node, compiler_state_t* state, bty_type_t* expected, uint32_t dst);
 
-    bool ok = state_add_funcaddr(state, funcname, frame_index);
+uint32_t codegen_reg_expr(ast_node_t* node, compiler_state_t* state, uint32_t dst) {
 
-    (void)(ok); // unused in release builds
+    if( trace_get_error_count(state->trace) > 0 ) {
+        return 0;
+    }
 
-    assert(ok && "the function already exists");
-    
-    srcmap_clear(&state->localvars);
+    switch(node->type) {
+        case AST_VAR_REF: {
+            ir_index_t var_index = state_get_localvar(state, node->u.n_varref.name);
+            assert(var_index.tag == IRID_VAR && "variable not found");
+            return reg_move_to(state, var_index.idx, dst);
+        }
+        case AST_VALUE: {
+            uint32_t const_index = 0;
+            if( state_add_value_const(state, node->u.n_value, &const_index) == false ) {
+                return 0;
+            }
+            return reg_move_to(state, OP_RK_CONST | const_index, dst);
+        }
+        case AST_BINOP: {
+            bty_type_t* operand_type = state_binop_operand_type(state, node->u.n_binop);
+            vm_op_t opcode = reg_binop_opcode(node->u.n_binop.type, bty_is_integer(operand_type));
+            if( opcode == OP_OPCODE_COUNT ) {
+                trace_msg_t* msg = trace_create_message(state->trace, TM_ERROR, trace_no_ref());
+                trace_msg_append_costr(msg, "unhandled binary operation: ");
+                char* m = ast_binop_type_as_string(node->u.n_binop.type);
+                trace_msg_append(msg, m, strlen(m));
+                return 0;
+            }
+            // same evaluation order as the stack backend
+            uint32_t mark = state->temp_count;
+            uint32_t rhs = codegen_reg_operand(node->u.n_binop.right, state, operand_type, REG_ANY);
+            uint32_t lhs = codegen_reg_operand(node->u.n_binop.left, state, operand_type, REG_ANY);
+            state->temp_count = mark;
+            if( dst == REG_ANY ) {
+                dst = state_alloc_temp(state);
+            }
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = opcode,
+                .args = { dst, lhs, rhs }
+            });
+            return dst;
+        }
+        case AST_UNOP: {
+            vm_op_t opcode = OP_OPCODE_COUNT;
+            switch(node->u.n_unop.type) {
+                case AST_UN_NEG: {
+                    opcode = state_is_int_expr(state, node->u.n_unop.inner)
+                        ? OP_R_INEG
+                        : OP_R_NEG;
+                } break;
+                case AST_UN_NOT: opcode = OP_R_NOT; break;
+                default: {
+                    trace_msg_t* msg = trace_create_message(state->trace, TM_ERROR, trace_no_ref());
+                    trace_msg_append_costr(msg, "unhandled unary operation: ");
+                    char* m = ast_unop_type_as_string(node->u.n_unop.type);
+                    trace_msg_append(msg, m, strlen(m));
+                    return 0;
+                }
+            }
+            uint32_t mark = state->temp_count;
+            uint32_t src = codegen_reg_expr(node->u.n_unop.inner, state, REG_ANY);
+            state->temp_count = mark;
+            if( dst == REG_ANY ) {
+                dst = state_alloc_temp(state);
+            }
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = opcode,
+                .args = { dst, src, 0 }
+            });
+            return dst;
+        }
+        default: {
+            codegen(node, state);
+            if( dst == REG_ANY ) {
+                dst = state_alloc_temp(state);
+            }
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = OP_STORE_LOCAL,
+                .args = { dst, 0 }
+            });
+            return dst;
+        }
+    }
+}
 
-    codegen(node.argspec, state); // in order to "add" arg names
+// codegen_reg_expr for a value of the expected type (NULL if any),
+// integer constants are converted to float constants, other
+// values that need a conversion are evaluated on the stack.
+uint32_t codegen_reg_operand(ast_node_t* node, compiler_state_t* state, bty_type_t* expected, uint32_t dst) {
 
-    uint32_t arg_count = (uint32_t) state->localvars.count;
-    codegen(node.body, state); // adds locals to frame
+    if( trace_get_error_count(state->trace) > 0 ) {
+        return 0;
+    }
 
-    // if the last instruction is not a return statement
-    // we insert a value less return at the end.
-    vm_op_t last_op_code = irl_get_last(&state->instrs)->opcode;
-    if( last_op_code != OP_RETURN_VALUE && last_op_code != OP_RETURN_NOTHING ) {
+    bool to_float = state_needs_int_to_float(state, node, expected);
+
+    if( to_float && node->type == AST_VALUE ) {
+        uint32_t const_index = 0;
+        if( state_add_value_const_as_float(state, node->u.n_value, &const_index) == false ) {
+            return 0;
+        }
+        return reg_move_to(state, OP_RK_CONST | const_index, dst);
+    }
+
+    if( to_float || node->type == AST_ARRAY ) {
+        codegen_as(node, state, expected);
+        if( dst == REG_ANY ) {
+            dst = state_alloc_temp(state);
+        }
         irl_add(&state->instrs, (ir_inst_t){
-            .opcode = OP_RETURN_NOTHING,
-            .args = { 0 }
+            .opcode = OP_STORE_LOCAL,
+            .args = { dst, 0 }
         });
+        return dst;
     }
 
-    uint32_t locals_count = ((uint32_t) state->localvars.count) - arg_count;
-    irl_get(&state->instrs, frame_index)->args[0] = arg_count;
-    irl_get(&state->instrs, frame_index)->args[1] = locals_count;
-    srcmap_clear(&state->localvars);
+    return codegen_reg_expr(node, state, dst);
 }
 
-void codegen_funcall(ast_funcall_t node, compiler_state_t* state) {
-
-    ABORT_ON_ERROR(state);
-
-    codegen(node.args, state);
+bool reg_is_pure_expr(compiler_state_t* state, ast_node_t* node);
+
+bool reg_is_pure_operand(compiler_state_t* state, ast_node_t* node, bty_type_t* expected) {
+    if( node->type != AST_VALUE && state_needs_int_to_float(state, node, expected) ) {
+        return false;
+    }
+    return reg_is_pure_expr(state, node);
+}
+
+// true if node can be evaluated with register
+// instructions only (no stack fallback)
+bool reg_is_pure_expr(compiler_state_t* state, ast_node_t* node) {
+    switch(node->type) {
+        case AST_VAR_REF:
+        case AST_VALUE:
+            return true;
+        case AST_BINOP: {
+            bty_type_t* operand_type = state_binop_operand_type(state, node->u.n_binop);
+            return reg_binop_opcode(node->u.n_binop.type, false) != OP_OPCODE_COUNT
+                && reg_is_pure_operand(state, node->u.n_binop.left, operand_type)
+                && reg_is_pure_operand(state, node->u.n_binop.right, operand_type);
+        }
+        case AST_UNOP:
+            return reg_is_pure_expr(state, node->u.n_unop.inner);
+        default:
+            return false;
+    }
+}
+
+bool reg_is_operation(ast_node_t* node) {
+    return node->type == AST_BINOP || node->type == AST_UNOP;
+}
+
+// Where the value ends up on the stack anyway (call arguments,
+// return values, ...) register instructions only pay off for
+// nested operations without calls in them. A single operation
+// on variables and constants is just as short with the (fused)
+// stack instructions and doesn't need a temporary.
+bool reg_should_push(compiler_state_t* state, ast_node_t* node) {
+    if( reg_is_pure_expr(state, node) == false ) {
+        return false;
+    }
+    if( node->type == AST_BINOP ) {
+        return reg_is_operation(node->u.n_binop.left)
+            || reg_is_operation(node->u.n_binop.right);
+    }
+    if( node->type == AST_UNOP ) {
+        return reg_is_operation(node->u.n_unop.inner);
+    }
+    return false;
+}
+
+// register evaluation of an expression whose value is
+// needed on the stack
+void codegen_reg_push(ast_node_t* node, compiler_state_t* state) {
+    uint32_t mark = state->temp_count;
+    uint32_t operand = codegen_reg_expr(node, state, REG_ANY);
+    state->temp_count = mark;
+    if( OP_RK_IS_CONST(operand) ) {
+        irl_add(&state->instrs, (ir_inst_t){
+            .opcode = OP_PUSH_VALUE,
+            .args = { OP_RK_INDEX(operand), 0 }
+        });
+    } else {
+        irl_add(&state->instrs, (ir_inst_t){
+            .opcode = OP_LOAD_LOCAL,
+            .args = { operand, 0 }
+        });
+    }
+}
+
+// emits a jump (target left as 0) taken when cond is false
+ir_index_t codegen_reg_jump_if_false(ast_node_t* cond, compiler_state_t* state) {
+    uint32_t mark = state->temp_count;
+    ir_index_t index;
+    vm_op_t opcode = OP_OPCODE_COUNT;
+    bty_type_t* operand_type = NULL;
+    if( cond->type == AST_BINOP ) {
+        operand_type = state_binop_operand_type(state, cond->u.n_binop);
+        opcode = reg_branch_opcode(cond->u.n_binop.type, bty_is_integer(operand_type));
+    }
+    if( opcode != OP_OPCODE_COUNT ) {
+        uint32_t rhs = codegen_reg_operand(cond->u.n_binop.right, state, operand_type, REG_ANY);
+        uint32_t lhs = codegen_reg_operand(cond->u.n_binop.left, state, operand_type, REG_ANY);
+        index = irl_add(&state->instrs, (ir_inst_t){
+            .opcode = opcode,
+            .args = { 0, lhs, rhs }
+        });
+    } else {
+        uint32_t operand = codegen_reg_expr(cond, state, REG_ANY);
+        index = irl_add(&state->instrs, (ir_inst_t){
+            .opcode = OP_R_JUMP_IF_FALSE,
+            .args = { 0, operand, 0 }
+        });
+    }
+    state->temp_count = mark;
+    return index;
+}
+
+// gives the temporaries of a finished function the
+// frame slots right after its named locals
+void reg_resolve_temps(compiler_state_t* state, uint32_t start, uint32_t named_count) {
+    ir_list_t* instrs = &state->instrs;
+    for (uint32_t i = start; i < instrs->count; i++) {
+        size_t argcount = get_op_arg_count(instrs->irs[i].opcode);
+        op_argtype_t* types = get_op_arg_types(instrs->irs[i].opcode);
+        for (size_t j = 0; j < argcount; j++) {
+            uint32_t arg = instrs->irs[i].args[j];
+            bool is_slot = types[j] == OP_ARG_LOCAL
+                || (types[j] == OP_ARG_RK && OP_RK_IS_CONST(arg) == false);
+            if( is_slot && (arg & REG_TEMP) ) {
+                instrs->irs[i].args[j] = named_count + (arg & ~REG_TEMP);
+            }
+        }
+    }
+}
+
+bool state_uses_ssa(compiler_state_t* state);
+bool codegen_ssa_function(ast_fundecl_t node, compiler_state_t* state,
+                          ir_index_t frame_index, uint32_t arg_count);
+
+void codegen_fundecl(ast_fundecl_t node, compiler_state_t* state) {
+
+    ABORT_ON_ERROR(state);
+
+    srcref_t funcname = node.name;
+
+    assert((srcref_equals_string(funcname, "main") == false || node.exported) && "main function not marked as exported");
+
+    if ( state->localvars.count > 0 ) {
+        trace_msg_t* msg = trace_create_message(state->trace, TM_ERROR, funcname);
+        trace_msg_append_costr(msg,
+            "functions may not be declared "
+            "inside other functions.");
+        return;
+    }
+
+    ir_index_t frame_index = irl_add(&state->instrs, (ir_inst_t){
+        .opcode = OP_MAKE_FRAME,
+        .args = { 0 }
+    });
+
+    bool ok = state_add_funcaddr(state, funcname, frame_index);
+
+    (void)(ok); // unused in release builds
+
+    assert(ok && "the function already exists");
+    
+    srcmap_clear(&state->localvars);
+
+    bty_type_t* fntype = bty_ctx_lookup(state->tyctx, funcname);
+    assert(fntype != NULL && fntype->tag == BTY_FUNC);
+    state->fnctx = bty_ctx_clone(state->tyctx);
+    state->fnret = fntype->u.fun.ret;
+
+    codegen(node.argspec, state); // in order to "add" arg names
+
+    uint32_t arg_count = (uint32_t) state->localvars.count;
+
+    if( state_uses_ssa(state) ) {
+        if( codegen_ssa_function(node, state, frame_index, arg_count) ) {
+            srcmap_clear(&state->localvars);
+            state->fnctx = NULL;
+            state->fnret = NULL;
+            return;
+        }
+        // not supported by the ssa builder, start over
+        srcmap_clear(&state->localvars);
+        state->fnctx = bty_ctx_clone(state->tyctx);
+        codegen(node.argspec, state);
+    }
+
+    codegen(node.body, state); // adds locals to frame
+
+    // if the last instruction is not a return statement
+    // we insert a value less return at the end.
+    vm_op_t last_op_code = irl_get_last(&state->instrs)->opcode;
+    if( last_op_code != OP_RETURN_VALUE && last_op_code != OP_RETURN_NOTHING
+        && last_op_code != OP_TAIL_CALL ) {
+        irl_add(&state->instrs, (ir_inst_t){
+            .opcode = OP_RETURN_NOTHING,
+            .args = { 0 }
+        });
+    }
+
+    uint32_t named_count = (uint32_t) state->localvars.count;
+    reg_resolve_temps(state, frame_index.idx + 1, named_count);
+
+    uint32_t locals_count = named_count - arg_count + state->temp_max;
+    state->temp_count = 0;
+    state->temp_max = 0;
+
+    irl_get(&state->instrs, frame_index)->args[0] = arg_count;
+    irl_get(&state->instrs, frame_index)->args[1] = locals_count;
+    srcmap_clear(&state->localvars);
+    state->fnctx = NULL;
+    state->fnret = NULL;
+}
+
+void codegen_funcall(ast_funcall_t node, compiler_state_t* state) {
+
+    ABORT_ON_ERROR(state);
+
+    bty_type_t* fntype = bty_ctx_lookup(state->tyctx, node.name);
+    assert(node.args->type == AST_ARGLIST);
+    ast_arglist_t args = node.args->u.n_args;
+    for(size_t i = 0; i < args.count; i++) {
+        bool is_typed = fntype != NULL && fntype->tag == BTY_FUNC
+            && i < (size_t) fntype->u.fun.argc;
+        codegen_as(args.content[i], state,
+            is_typed ? fntype->u.fun.args[i] : NULL);
+    }
 
     ir_index_t ir_index = state_get_funcaddr(state, node.name);
 
@@ -508,14 +1085,40 @@ void codegen_funcall(ast_funcall_t node, compiler_state_t* state) {
     trace_msg_append_costr(msg, "' could not be found.");
 }
 
+void codegen_reg_assignment(ast_assign_t node, compiler_state_t* state) {
+
+    srcref_t varname = ast_try_extract_name(node.left_var);
+
+    if( node.left_var->type == AST_TYANNOT ) {
+        codegen(node.left_var, state); // add var to known locals
+    }
+
+    ir_index_t index = state_get_localvar(state, varname);
+    assert(index.tag == IRID_VAR && "varname not found");
+
+    bty_type_t* vartype = bty_ctx_lookup(state->fnctx, varname);
+
+    uint32_t mark = state->temp_count;
+    codegen_reg_operand(node.right_value, state, vartype, index.idx);
+    state->temp_count = mark;
+}
+
 void codegen_assignment(ast_assign_t node, compiler_state_t* state) {
 
     ABORT_ON_ERROR(state);
 
-    codegen(node.right_value, state);
+    if( state_is_register_backend(state) ) {
+        codegen_reg_assignment(node, state);
+        return;
+    }
 
     srcref_t varname = ast_try_extract_name(node.left_var);
-    
+
+    bty_type_t* vartype = node.left_var->type == AST_TYANNOT
+        ? bty_extract_type(state->fnctx->arena, state->trace, node.left_var)
+        : bty_ctx_lookup(state->fnctx, varname);
+
+    codegen_as(node.right_value, state, vartype);
 
     ast_node_type_t left_node_type = node.left_var->type;
 
@@ -545,7 +1148,20 @@ void codegen_foreach(ast_foreach_t node, compiler_state_t* state) {
     
     ABORT_ON_ERROR(state);
 
-    codegen(node.collection, state);
+    // list literals are built with the loop variable type, the
+    // elements of other int lists are converted one at a time
+    bty_type_t* vartype = bty_extract_type(state->fnctx->arena, state->trace, node.vardecl);
+    bty_type_t* coltype = state_get_expr_type(state, node.collection);
+    bool elem_to_float = node.collection->type != AST_ARRAY
+        && vartype != NULL && bty_is_float(vartype)
+        && coltype != NULL && bty_is_list(coltype)
+        && bty_is_integer(coltype->u.con);
+
+    if( vartype != NULL ) {
+        codegen_as(node.collection, state, bty_list(state->fnctx->arena, vartype));
+    } else {
+        codegen(node.collection, state);
+    }
     irl_add(&state->instrs, (ir_inst_t){
         .opcode = OP_MAKE_ITER,
         .args = { 0 }
@@ -559,6 +1175,12 @@ void codegen_foreach(ast_foreach_t node, compiler_state_t* state) {
     assert(srcref_is_valid(varname));
     ir_index_t varindex = state_get_localvar(state, varname);
     assert(varindex.tag == IRID_VAR && "variable not found");
+    if( elem_to_float ) {
+        irl_add(&state->instrs, (ir_inst_t){
+            .opcode = OP_INT_TO_FLOAT,
+            .args = { 0 }
+        });
+    }
     irl_add(&state->instrs, (ir_inst_t){
         .opcode = OP_STORE_LOCAL,
         .args = { varindex.idx, 0 }
@@ -571,233 +1193,1368 @@ void codegen_foreach(ast_foreach_t node, compiler_state_t* state) {
     irl_get(&state->instrs, loop_start_index)->args[0] = state->instrs.count;
 }
 
-int get_if_chain_length(ast_node_t* current) {
-    int count = 0;
-    while(current != NULL) {
-        if( current->type == AST_IF_CHAIN ) {
-            count ++;
-            current = current->u.n_if.next;
-        } else {
-            break;
+int get_if_chain_length(ast_node_t* current) {
+    int count = 0;
+    while(current != NULL) {
+        if( current->type == AST_IF_CHAIN ) {
+            count ++;
+            current = current->u.n_if.next;
+        } else {
+            break;
+        }
+    }
+    return count;
+}
+
+void codegen_if_chain(ast_node_t* node, compiler_state_t* state) {
+    
+    ABORT_ON_ERROR(state);
+
+    int chain_len = get_if_chain_length(node);
+    ir_index_t exit_indices[chain_len];
+
+    ast_node_t* current = node;
+    int count = 0;
+    ir_index_t if_next_index;
+
+    while( current->type == AST_IF_CHAIN ) {
+
+        // 1. if not cond <jump: next>      (or jump to end if no else or else if)
+        // 2. body                          (always generate)
+        // 3. <jump: end>                   (skip if no trailing else or else if)
+        // 4. next ...                      (go to next if or exit to else or nothing)
+        // N. [else] ... 
+        // N+1. end
+
+        // 1)
+        if( state_is_register_backend(state) ) {
+            if_next_index = codegen_reg_jump_if_false(current->u.n_if.cond, state);
+        } else {
+            codegen(current->u.n_if.cond, state);
+
+            if_next_index = irl_add(
+                &state->instrs,
+                (ir_inst_t){
+                    .opcode = OP_JUMP_IF_FALSE,
+                    .args = { 0 }
+                });
+        }
+
+        // 2)
+        codegen(current->u.n_if.iftrue, state);
+
+        current = current->u.n_if.next;
+
+        // 3)
+        if( current->type == AST_IF_CHAIN || ast_is_valid_else_block(current) ) {
+            // if we're at the last block 
+            // we make sure to not jump 
+            // since we get a corrupt jump 
+            // index (same position).  
+            exit_indices[count++] = irl_add(
+                &state->instrs,
+                (ir_inst_t){
+                    .opcode = OP_JUMP,
+                    .args = { 0 }
+                });
+        }
+
+        // 4)
+        ir_inst_t* instr = irl_get(&state->instrs, if_next_index);
+        instr->args[0] = state->instrs.count;
+    }
+
+    // N)
+    if( ast_is_valid_else_block(current) )
+        codegen(current, state);
+    
+    // N+1) set the exit jump points
+    for(int i = 0; i < count; i++) {
+        irl_get(&state->instrs, exit_indices[i])->args[0] = state->instrs.count;
+    }
+}
+
+// number of values a return statement returns
+uint32_t get_return_size(ast_node_t* result) {
+    uint32_t ret_size = 0;
+    switch (result->type) {
+        case AST_VALUE:
+        case AST_VAR_REF:
+        case AST_ARRAY:
+        case AST_FUN_CALL:
+        case AST_BINOP:
+        case AST_UNOP: {
+            ret_size = 1;
+        } break;
+        case AST_BLOCK: {
+            ret_size = result->u.n_block.count;
+        } break;
+        case AST_IF_CHAIN:
+        case AST_FOREACH:
+        case AST_ASSIGN:
+        case AST_TYANNOT:
+        case AST_FUN_DECL:
+        case AST_FUN_EXDECL:
+        case AST_RETURN:
+        case AST_ARGLIST:
+        case AST_BREAK: {
+            ret_size = 0;
+        } break;
+    }
+    return ret_size;
+}
+
+void codegen_return_stmt(ast_return_t stmt, compiler_state_t* state) {
+    uint32_t ret_size = get_return_size(stmt.result);
+    if( ret_size == 0 ) {
+        irl_add(&state->instrs, (ir_inst_t){
+            .opcode = OP_RETURN_NOTHING,
+            .args = { 0 }
+        });
+    } else { 
+        codegen_as(stmt.result, state, state->fnret);
+        if( stmt.result->type == AST_FUN_CALL && state->fnctx != NULL
+            && irl_get_last(&state->instrs)->opcode == OP_CALL ) {
+            // a call in tail position (nothing is done with the
+            // result but returning it) reuses the frame
+            ir_inst_t* call = irl_get_last(&state->instrs);
+            call->opcode = OP_TAIL_CALL;
+            call->args[1] = (uint32_t) stmt.result->u.n_funcall.args->u.n_args.count;
+            return;
+        }
+        irl_add(&state->instrs, (ir_inst_t){
+            .opcode = OP_RETURN_VALUE,
+            .args = { 0 }
+        });
+    }
+}
+
+void codegen(ast_node_t* node, compiler_state_t* state) {
+
+    ABORT_ON_ERROR(state);
+
+    switch(node->type) {
+        case AST_BINOP: {
+            if( state_is_register_backend(state) && reg_should_push(state, node) ) {
+                codegen_reg_push(node, state);
+            } else {
+                codegen_binop(node->u.n_binop, state);
+            }
+        } break;
+        case AST_UNOP: {
+            if( state_is_register_backend(state) && reg_should_push(state, node) ) {
+                codegen_reg_push(node, state);
+            } else {
+                codegen_unop(node->u.n_unop, state);
+            }
+        } break;
+        case AST_ASSIGN: {
+            codegen_assignment(node->u.n_assign, state);
+        } break;
+        case AST_RETURN: {
+            codegen_return_stmt(node->u.n_return, state);
+        } break;
+        case AST_ARRAY: {
+            codegen_array(node->u.n_array, state,
+                state_array_elem_type(state, node, NULL));
+        } break;
+        case AST_BLOCK: {
+            size_t count = node->u.n_block.count;
+            for(size_t i = 0; i < count; i++) {
+                codegen(node->u.n_block.content[i], state);
+            }
+        } break;
+        case AST_ARGLIST: {
+            size_t count = node->u.n_args.count;
+            for(size_t i = 0; i < count; i++) {
+                codegen(node->u.n_args.content[i], state);
+            }
+        } break;
+        case AST_IF_CHAIN: {
+            codegen_if_chain(node, state);
+        } break;
+        case AST_FOREACH: {
+            codegen_foreach(node->u.n_foreach, state);
+        } break;
+        case AST_FUN_DECL: {
+            codegen_fundecl(node->u.n_fundecl, state);
+            if(node->u.n_fundecl.exported)
+                add_program_provided_function_definition(node->u.n_fundecl.name, state);
+        } break;
+        case AST_FUN_CALL: {
+            codegen_funcall(node->u.n_funcall, state);
+        } break;
+        case AST_FUN_EXDECL: {
+            add_host_provided_function_definition(node->u.n_funexdecl.name, state);
+        } break;
+        case AST_VAR_REF: {
+            ir_index_t var_index = state_get_localvar(state, node->u.n_varref.name);
+            assert(var_index.tag == IRID_VAR && "variable not found");
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = OP_LOAD_LOCAL,
+                .args = { var_index.idx, 0 }
+            });
+        } break;
+        case AST_VALUE: {
+            codegen_value(node->u.n_value, state);
+        } break;
+        case AST_TYANNOT: {
+            if( node->u.n_tyannot.expr->type == AST_VAR_REF ) {
+                ast_node_t* var = node->u.n_tyannot.expr;
+                // just add valiable name to frame local var set.
+                state_add_localvar(state, var->u.n_varref.name);
+                state_add_localvar_type(state, node);
+            } else {
+                // this is a function annotated with its return type
+                ast_node_t* expr = node->u.n_tyannot.expr;
+                (void)(expr); // unused in release builds
+                assert( expr->type == AST_FUN_DECL || expr->type == AST_FUN_EXDECL );
+                codegen(node->u.n_tyannot.expr, state);
+            }
+        } break;
+        case AST_BREAK: {
+            assert(false && "break op is not implemented yet");
+        } break;
+
+    }
+}
+
+// SSA (opt_level 2)
+//
+// With the stack backend each function is built as a mid-level ir
+// in ssa form (co_ssa.h), optimized there and lowered back to stack
+// instructions. The builder mirrors codegen: the same conversions,
+// the same evaluation order and the same local indices for the
+// variables. Functions it can't build (break, returning a block,
+// a variable that may be read before it is written) are compiled
+// by codegen instead.
+
+bool state_uses_ssa(compiler_state_t* state) {
+    return state->opts.opt_level >= 2
+        && state_is_register_backend(state) == false;
+}
+
+ssa_type_t state_ssa_type(bty_type_t* type) {
+    if( type == NULL || bty_is_void(type) ) {
+        return SSA_TY_NONE;
+    }
+    if( bty_is_int(type) )      return SSA_TY_INT;
+    if( bty_is_char(type) )     return SSA_TY_CHAR;
+    if( bty_is_float(type) )    return SSA_TY_FLOAT;
+    if( bty_is_bool(type) )     return SSA_TY_BOOL;
+    return SSA_TY_REF;
+}
+
+ssa_value_t* ssagen(ast_node_t* node, compiler_state_t* state);
+ssa_value_t* ssagen_as(ast_node_t* node, compiler_state_t* state, bty_type_t* expected);
+
+ssa_value_t* ssagen_fail(compiler_state_t* state) {
+    state->ssa_ok = false;
+    return NULL;
+}
+
+// a block without predecessors for the code after a return
+void ssagen_unreachable_block(compiler_state_t* state) {
+    state->ssa_block = ssa_block_create(state->ssa);
+    ssa_seal(state->ssa, state->ssa_block);
+}
+
+void ssagen_jump_if_open(compiler_state_t* state, ssa_block_t* target) {
+    if( state->ssa_block->term == SSA_TERM_NONE ) {
+        ssa_jump(state->ssa, state->ssa_block, target);
+    }
+}
+
+ssa_value_t* ssagen_array(ast_array_t node, compiler_state_t* state, bty_type_t* elem_type) {
+    ssa_value_t** elems = (ssa_value_t**) aalloc(state->ssa->arena,
+        sizeof(ssa_value_t*) * (node.count + 1));
+    for(size_t i = 0; i < node.count; i++) {
+        elems[i] = ssagen_as(node.content[i], state, elem_type);
+        if( elems[i] == NULL ) {
+            return NULL;
+        }
+    }
+    ssa_value_t* array = ssa_emit(state->ssa, state->ssa_block, SSA_ARRAY,
+        SSA_TY_REF, (uint32_t) node.count, elems);
+    array->u.index = (uint32_t) bty_pack_type(elem_type);
+    return array;
+}
+
+// see codegen_as
+ssa_value_t* ssagen_as(ast_node_t* node, compiler_state_t* state, bty_type_t* expected) {
+    if( state->ssa_ok == false ) {
+        return NULL;
+    }
+    if( state_needs_int_to_float(state, node, expected) ) {
+        if( node->type == AST_VALUE ) {
+            ast_value_t value = node->u.n_value;
+            return ssa_const(state->ssa, (ast_value_t) {
+                .type = AST_VALUE_FLOAT,
+                .u._float = value.type == AST_VALUE_CHAR
+                    ? (float) value.u._char
+                    : (float) value.u._int
+            });
+        }
+        ssa_value_t* value = ssagen(node, state);
+        if( value == NULL ) {
+            return NULL;
+        }
+        return ssa_emit(state->ssa, state->ssa_block, SSA_TO_FLOAT, SSA_TY_FLOAT, 1, &value);
+    }
+    if( node->type == AST_ARRAY && expected != NULL && bty_is_list(expected) ) {
+        return ssagen_array(node->u.n_array, state, expected->u.con);
+    }
+    return ssagen(node, state);
+}
+
+ssa_value_t* ssagen_binop(ast_binop_t node, compiler_state_t* state) {
+    bty_type_t* operand_type = state_binop_operand_type(state, node);
+    bool is_int = bty_is_integer(operand_type);
+    if( binop_opcode(node.type, is_int) == OP_OPCODE_COUNT ) {
+        return ssagen_fail(state); // codegen reports it
+    }
+    ssa_value_t* right = ssagen_as(node.right, state, operand_type);
+    ssa_value_t* left = ssagen_as(node.left, state, operand_type);
+    if( right == NULL || left == NULL ) {
+        return NULL;
+    }
+    ssa_type_t optype = operand_type == NULL ? SSA_TY_BOOL
+        : is_int ? SSA_TY_INT : SSA_TY_FLOAT;
+    return ssa_emit_binop(state->ssa, state->ssa_block, node.type, optype, left, right);
+}
+
+ssa_value_t* ssagen_unop(ast_unop_t node, compiler_state_t* state) {
+    ssa_value_t* inner = ssagen(node.inner, state);
+    if( inner == NULL ) {
+        return NULL;
+    }
+    switch(node.type) {
+        case AST_UN_NEG: {
+            ssa_type_t optype = state_is_int_expr(state, node.inner)
+                ? SSA_TY_INT : SSA_TY_FLOAT;
+            return ssa_emit_unop(state->ssa, state->ssa_block, node.type, optype, inner);
+        }
+        case AST_UN_NOT: {
+            return ssa_emit_unop(state->ssa, state->ssa_block, node.type, SSA_TY_BOOL, inner);
+        }
+        default: {
+            return ssagen_fail(state);
+        }
+    }
+}
+
+ssa_value_t* ssagen_funcall(ast_funcall_t node, compiler_state_t* state) {
+    bty_type_t* fntype = bty_ctx_lookup(state->tyctx, node.name);
+    assert(node.args->type == AST_ARGLIST);
+    ast_arglist_t args = node.args->u.n_args;
+    ssa_value_t** values = (ssa_value_t**) aalloc(state->ssa->arena,
+        sizeof(ssa_value_t*) * (args.count + 1));
+    for(size_t i = 0; i < args.count; i++) {
+        bool is_typed = fntype != NULL && fntype->tag == BTY_FUNC
+            && i < (size_t) fntype->u.fun.argc;
+        values[i] = ssagen_as(args.content[i], state,
+            is_typed ? fntype->u.fun.args[i] : NULL);
+        if( values[i] == NULL ) {
+            return NULL;
+        }
+    }
+
+    ssa_type_t type = fntype != NULL && fntype->tag == BTY_FUNC
+        ? state_ssa_type(fntype->u.fun.ret)
+        : SSA_TY_NONE;
+    ssa_kind_t kind = SSA_CALL;
+    uint32_t index = 0;
+
+    ir_index_t ir_index = state_get_funcaddr(state, node.name);
+    int ext_index = ffi_definition_set_index_of(&state->host_supplied,
+        srcref_as_sstr(node.name));
+    if( ir_index.tag == IRID_INS ) {
+        index = ir_index.idx;
+    } else if( ext_index >= 0 ) {
+        kind = SSA_CALL_NATIVE;
+        index = (uint32_t) ext_index;
+    } else {
+        return ssagen_fail(state); // codegen reports it
+    }
+
+    ssa_value_t* call = ssa_emit(state->ssa, state->ssa_block, kind,
+        type, (uint32_t) args.count, values);
+    call->u.index = index;
+    return call;
+}
+
+void ssagen_assignment(ast_assign_t node, compiler_state_t* state) {
+    srcref_t varname = ast_try_extract_name(node.left_var);
+
+    bty_type_t* vartype = node.left_var->type == AST_TYANNOT
+        ? bty_extract_type(state->fnctx->arena, state->trace, node.left_var)
+        : bty_ctx_lookup(state->fnctx, varname);
+
+    ssa_value_t* value = ssagen_as(node.right_value, state, vartype);
+    if( value == NULL ) {
+        return;
+    }
+    if( node.left_var->type == AST_TYANNOT ) {
+        ssagen(node.left_var, state); // add var to known locals
+    }
+    ir_index_t index = state_get_localvar(state, varname);
+    if( index.tag != IRID_VAR ) {
+        ssagen_fail(state);
+        return;
+    }
+    ssa_write_var(state->ssa, state->ssa_block, index.idx, value);
+}
+
+void ssagen_foreach(ast_foreach_t node, compiler_state_t* state) {
+    ssa_func_t* func = state->ssa;
+
+    bty_type_t* vartype = bty_extract_type(state->fnctx->arena, state->trace, node.vardecl);
+    bty_type_t* coltype = state_get_expr_type(state, node.collection);
+    bool elem_to_float = node.collection->type != AST_ARRAY
+        && vartype != NULL && bty_is_float(vartype)
+        && coltype != NULL && bty_is_list(coltype)
+        && bty_is_integer(coltype->u.con);
+
+    ssa_value_t* collection = vartype != NULL
+        ? ssagen_as(node.collection, state, bty_list(state->fnctx->arena, vartype))
+        : ssagen(node.collection, state);
+    if( collection == NULL ) {
+        return;
+    }
+
+    // preheader: iter -> header: next element or exit -> body -> header
+    ssa_emit(func, state->ssa_block, SSA_ITER, SSA_TY_NONE, 1, &collection);
+    ssa_block_t* header = ssa_block_create(func);
+    ssa_jump(func, state->ssa_block, header);
+    ssa_block_t* body = ssa_block_create(func);
+    ssa_block_t* exit = ssa_block_create(func);
+    ssa_iterate(func, header, body, exit);
+    ssa_seal(func, body);
+    ssa_seal(func, exit);
+
+    ssagen(node.vardecl, state); // add varname
+    ir_index_t varindex = state_get_localvar(state, ast_try_extract_name(node.vardecl));
+    if( varindex.tag != IRID_VAR ) {
+        ssagen_fail(state);
+        return;
+    }
+    ssa_value_t* elem = ssa_emit(func, body, SSA_ELEM, elem_to_float
+        ? state_ssa_type(coltype->u.con)
+        : state_ssa_type(vartype), 0, NULL);
+    if( elem_to_float ) {
+        elem = ssa_emit(func, body, SSA_TO_FLOAT, SSA_TY_FLOAT, 1, &elem);
+    }
+    ssa_write_var(func, body, varindex.idx, elem);
+
+    state->ssa_block = body;
+    ssagen(node.during, state);
+    ssagen_jump_if_open(state, header);
+    ssa_seal(func, header);
+
+    ssa_block_move_last(func, exit);
+    state->ssa_block = exit;
+}
+
+void ssagen_if_chain(ast_node_t* node, compiler_state_t* state) {
+    ssa_func_t* func = state->ssa;
+    ssa_block_t* end = ssa_block_create(func);
+    ast_node_t* current = node;
+
+    // every condition gets a block for the false case (empty if
+    // there is no else), so no branch goes directly to the end
+    while( current->type == AST_IF_CHAIN ) {
+        ssa_value_t* cond = ssagen(current->u.n_if.cond, state);
+        if( cond == NULL ) {
+            return;
+        }
+        ssa_block_t* iftrue = ssa_block_create(func);
+        ssa_block_t* next = ssa_block_create(func);
+        ssa_branch(func, state->ssa_block, cond, iftrue, next);
+        ssa_seal(func, iftrue);
+        ssa_seal(func, next);
+
+        state->ssa_block = iftrue;
+        ssagen(current->u.n_if.iftrue, state);
+        ssagen_jump_if_open(state, end);
+
+        ssa_block_move_last(func, next);
+        state->ssa_block = next;
+        current = current->u.n_if.next;
+    }
+
+    if( ast_is_valid_else_block(current) ) {
+        ssagen(current, state);
+    }
+    ssagen_jump_if_open(state, end);
+    ssa_seal(func, end);
+    ssa_block_move_last(func, end);
+    state->ssa_block = end;
+}
+
+void ssagen_return(ast_return_t stmt, compiler_state_t* state) {
+    ssa_value_t* value = NULL;
+    if( get_return_size(stmt.result) > 0 ) {
+        if( stmt.result->type == AST_BLOCK ) {
+            ssagen_fail(state);
+            return;
+        }
+        value = ssagen_as(stmt.result, state, state->fnret);
+        if( value == NULL ) {
+            return;
+        }
+    }
+    ssa_return(state->ssa, state->ssa_block, value);
+    ssagen_unreachable_block(state);
+}
+
+// the value of an expression (NULL for statements or if
+// the function can't be built)
+ssa_value_t* ssagen(ast_node_t* node, compiler_state_t* state) {
+
+    if( state->ssa_ok == false || trace_get_error_count(state->trace) > 0 ) {
+        return ssagen_fail(state);
+    }
+
+    switch(node->type) {
+        case AST_BINOP: {
+            return ssagen_binop(node->u.n_binop, state);
+        }
+        case AST_UNOP: {
+            return ssagen_unop(node->u.n_unop, state);
+        }
+        case AST_ARRAY: {
+            return ssagen_array(node->u.n_array, state,
+                state_array_elem_type(state, node, NULL));
+        }
+        case AST_FUN_CALL: {
+            return ssagen_funcall(node->u.n_funcall, state);
+        }
+        case AST_VALUE: {
+            return ssa_const(state->ssa, node->u.n_value);
+        }
+        case AST_VAR_REF: {
+            ir_index_t var_index = state_get_localvar(state, node->u.n_varref.name);
+            if( var_index.tag != IRID_VAR ) {
+                return ssagen_fail(state);
+            }
+            bty_type_t* type = bty_ctx_lookup(state->fnctx, node->u.n_varref.name);
+            return ssa_read_var(state->ssa, state->ssa_block, var_index.idx, state_ssa_type(type));
+        }
+        case AST_ASSIGN: {
+            ssagen_assignment(node->u.n_assign, state);
+        } break;
+        case AST_RETURN: {
+            ssagen_return(node->u.n_return, state);
+        } break;
+        case AST_BLOCK: {
+            size_t count = node->u.n_block.count;
+            for(size_t i = 0; i < count; i++) {
+                ssagen(node->u.n_block.content[i], state);
+            }
+        } break;
+        case AST_IF_CHAIN: {
+            ssagen_if_chain(node, state);
+        } break;
+        case AST_FOREACH: {
+            ssagen_foreach(node->u.n_foreach, state);
+        } break;
+        case AST_TYANNOT: {
+            if( node->u.n_tyannot.expr->type != AST_VAR_REF ) {
+                return ssagen_fail(state);
+            }
+            state_add_localvar(state, node->u.n_tyannot.expr->u.n_varref.name);
+            state_add_localvar_type(state, node);
+        } break;
+        case AST_ARGLIST:
+        case AST_FUN_DECL:
+        case AST_FUN_EXDECL:
+        case AST_BREAK: {
+            return ssagen_fail(state);
+        }
+    }
+    return NULL;
+}
+
+// Lowering to stack instructions (see ssa_prepare_lowering)
+
+void ssa_lower_operation(ssa_value_t* value, compiler_state_t* state);
+
+// pushes the value
+void ssa_lower_push(ssa_value_t* value, compiler_state_t* state) {
+    if( value->kind == SSA_CONST ) {
+        codegen_value(value->u.constant, state);
+    } else if( value->inlined ) {
+        ssa_lower_operation(value, state);
+    } else {
+        assert(value->slot >= 0 && "value without a slot");
+        irl_add(&state->instrs, (ir_inst_t){
+            .opcode = OP_LOAD_LOCAL,
+            .args = { (uint32_t) value->slot, 0 }
+        });
+    }
+}
+
+void ssa_lower_args(ssa_value_t* value, compiler_state_t* state) {
+    for(uint32_t i = 0; i < value->argc; i++) {
+        ssa_lower_push(value->args[i], state);
+    }
+}
+
+// see state_add_literal_array
+bool ssa_add_literal_array(ssa_value_t* value, compiler_state_t* state, uint32_t* index) {
+    val_t* elems = (val_t*) malloc(sizeof(val_t) * (value->argc + 1));
+    if( elems == NULL ) {
+        trace_out_of_memory_error(state->trace);
+        return false;
+    }
+    bool ok = true;
+    for(uint32_t i = 0; ok && i < value->argc; i++) {
+        ssa_value_t* arg = ssa_resolve(value->args[i]);
+        if( arg->kind == SSA_CONST ) {
+            elems[i] = ast_value_to_val(arg->u.constant);
+        } else {
+            uint32_t inner_index = 0;
+            ok = ssa_add_literal_array(arg, state, &inner_index);
+            elems[i] = state->consts.values[inner_index];
+        }
+    }
+    if( ok ) {
+        ok = state_add_array_const(state, (val_type_t) value->u.index,
+            elems, value->argc, index);
+    }
+    free(elems);
+    return ok;
+}
+
+void ssa_lower_operation(ssa_value_t* value, compiler_state_t* state) {
+    switch(value->kind) {
+        case SSA_BINOP: {
+            ssa_lower_push(value->args[1], state);
+            ssa_lower_push(value->args[0], state);
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = binop_opcode(value->u.binop, value->optype == SSA_TY_INT),
+                .args = { 0 }
+            });
+        } break;
+        case SSA_UNOP: {
+            ssa_lower_push(value->args[0], state);
+            vm_op_t opcode = value->u.unop == AST_UN_NOT ? OP_NOT
+                : value->optype == SSA_TY_INT ? OP_INEG : OP_NEG;
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = opcode,
+                .args = { 0 }
+            });
+        } break;
+        case SSA_TO_FLOAT: {
+            ssa_lower_push(value->args[0], state);
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = OP_INT_TO_FLOAT,
+                .args = { 0 }
+            });
+        } break;
+        case SSA_CALL:
+        case SSA_CALL_NATIVE: {
+            ssa_lower_args(value, state);
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = value->kind == SSA_CALL ? OP_CALL : OP_CALL_NATIVE,
+                .args = { value->u.index, 0 }
+            });
+        } break;
+        case SSA_ARRAY: {
+            uint32_t const_index = 0;
+            if( ssa_is_literal_array(value) ) {
+                if( ssa_add_literal_array(value, state, &const_index) ) {
+                    irl_add(&state->instrs, (ir_inst_t){
+                        .opcode = OP_PUSH_VALUE,
+                        .args = { const_index, 0 }
+                    });
+                }
+                break;
+            }
+            ssa_lower_args(value, state);
+            codegen_value((ast_value_t) {
+                .type = AST_VALUE_INT,
+                .u._int = (int) value->argc
+            }, state);
+            val_type_t pack = (val_type_t) value->u.index;
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = pack != VAL_NONE ? OP_MAKE_PACKED_ARRAY : OP_MAKE_ARRAY,
+                .args = { (uint32_t) pack, 0 }
+            });
+        } break;
+        case SSA_ITER: {
+            ssa_lower_push(value->args[0], state);
+            irl_add(&state->instrs, (ir_inst_t){
+                .opcode = OP_MAKE_ITER,
+                .args = { 0 }
+            });
+        } break;
+        default: {
+            assert(false && "not an operation");
+        } break;
+    }
+}
+
+void ssa_lower_store(compiler_state_t* state, int32_t slot) {
+    irl_add(&state->instrs, (ir_inst_t){
+        .opcode = slot >= 0 ? OP_STORE_LOCAL : OP_POP_1,
+        .args = { slot >= 0 ? (uint32_t) slot : 1, 0 }
+    });
+}
+
+typedef struct ssa_fixup_t {
+    ir_index_t      jump;
+    ssa_block_t*    target;
+} ssa_fixup_t;
+
+void ssa_lower_function(ssa_func_t* func, compiler_state_t* state) {
+    uint32_t* starts = (uint32_t*) aalloc(func->arena, sizeof(uint32_t) * func->block_count);
+    ssa_fixup_t* fixups = (ssa_fixup_t*) aalloc(func->arena,
+        sizeof(ssa_fixup_t) * func->block_count * 2);
+    uint32_t fixup_count = 0;
+
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        ssa_block_t* next = b + 1 < func->block_count ? func->blocks[b + 1] : NULL;
+        starts[b] = state->instrs.count;
+
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            ssa_value_t* value = block->values[i];
+            if( value->inlined ) {
+                continue;
+            }
+            if( value->kind == SSA_ELEM ) {
+                // the element is on the stack
+                ssa_lower_store(state, value->slot);
+                continue;
+            }
+            ssa_lower_operation(value, state);
+            if( value->kind != SSA_ITER && (value->slot >= 0 || value->type != SSA_TY_NONE) ) {
+                ssa_lower_store(state, value->slot);
+            }
+        }
+
+        switch(block->term) {
+            case SSA_TERM_JUMP: {
+                // phi copies: push all, then store in reverse
+                ssa_block_t* succ = block->succs[0];
+                uint32_t index = 0;
+                while( succ->preds[index] != block ) {
+                    index++;
+                }
+                for(uint32_t p = 0; p < succ->phi_count; p++) {
+                    ssa_lower_push(succ->phis[p]->args[index], state);
+                }
+                for(uint32_t p = succ->phi_count; p-- > 0;) {
+                    ssa_lower_store(state, succ->phis[p]->slot);
+                }
+                if( succ != next ) {
+                    fixups[fixup_count++] = (ssa_fixup_t) {
+                        .jump = irl_add(&state->instrs, (ir_inst_t){
+                            .opcode = OP_JUMP,
+                            .args = { 0 }
+                        }),
+                        .target = succ
+                    };
+                }
+            } break;
+            case SSA_TERM_BRANCH:
+            case SSA_TERM_ITER: {
+                if( block->term == SSA_TERM_BRANCH ) {
+                    ssa_lower_push(block->term_value, state);
+                }
+                fixups[fixup_count++] = (ssa_fixup_t) {
+                    .jump = irl_add(&state->instrs, (ir_inst_t){
+                        .opcode = block->term == SSA_TERM_BRANCH ? OP_JUMP_IF_FALSE : OP_ITER_NEXT,
+                        .args = { 0 }
+                    }),
+                    .target = block->succs[1]
+                };
+                if( block->succs[0] != next ) {
+                    fixups[fixup_count++] = (ssa_fixup_t) {
+                        .jump = irl_add(&state->instrs, (ir_inst_t){
+                            .opcode = OP_JUMP,
+                            .args = { 0 }
+                        }),
+                        .target = block->succs[0]
+                    };
+                }
+            } break;
+            case SSA_TERM_RETURN: {
+                ssa_value_t* value = block->term_value;
+                if( value == NULL ) {
+                    irl_add(&state->instrs, (ir_inst_t){
+                        .opcode = OP_RETURN_NOTHING,
+                        .args = { 0 }
+                    });
+                } else if( value->kind == SSA_CALL && value->inlined ) {
+                    // a call in tail position reuses the frame
+                    ssa_lower_args(value, state);
+                    irl_add(&state->instrs, (ir_inst_t){
+                        .opcode = OP_TAIL_CALL,
+                        .args = { value->u.index, value->argc }
+                    });
+                } else {
+                    ssa_lower_push(value, state);
+                    irl_add(&state->instrs, (ir_inst_t){
+                        .opcode = OP_RETURN_VALUE,
+                        .args = { 0 }
+                    });
+                }
+            } break;
+            default: {
+                assert(false && "block without terminator");
+            } break;
+        }
+    }
+
+    for(uint32_t i = 0; i < fixup_count; i++) {
+        irl_get(&state->instrs, fixups[i].jump)->args[0] = starts[fixups[i].target->id];
+    }
+}
+
+// builds the function body (after the frame and the args) through
+// the ssa ir, false (nothing emitted) if it isn't supported
+bool codegen_ssa_function(ast_fundecl_t node, compiler_state_t* state,
+                          ir_index_t frame_index, uint32_t arg_count)
+{
+    arena_t* arena = arena_create(1024 * 64);
+    if( arena == NULL ) {
+        return false;
+    }
+
+    bty_type_t* fntype = bty_ctx_lookup(state->tyctx, node.name);
+    ssa_func_t* func = ssa_func_create(arena, arg_count);
+    ssa_block_t* entry = ssa_block_create(func);
+    ssa_seal(func, entry);
+    for(uint32_t i = 0; i < arg_count; i++) {
+        ssa_type_t type = i < (uint32_t) fntype->u.fun.argc
+            ? state_ssa_type(fntype->u.fun.args[i])
+            : SSA_TY_REF;
+        ssa_write_var(func, entry, i, ssa_param(func, i, type));
+    }
+
+    state->ssa = func;
+    state->ssa_block = entry;
+    state->ssa_ok = true;
+
+    ssagen(node.body, state);
+    if( state->ssa_block->term == SSA_TERM_NONE ) {
+        ssa_return(func, state->ssa_block, NULL);
+    }
+
+    bool ok = state->ssa_ok && trace_get_error_count(state->trace) == 0;
+    if( ok ) {
+        uint32_t eliminated = ssa_optimize(func);
+        ok = ssa_uses_undef(func) == false;
+        if( ok ) {
+            ssa_prepare_lowering(func);
+            ssa_lower_function(func, state);
+            irl_get(&state->instrs, frame_index)->args[0] = arg_count;
+            irl_get(&state->instrs, frame_index)->args[1] = func->slot_count - arg_count;
+            state->stats.ssa_functions++;
+            state->stats.eliminated += eliminated;
+        }
+    }
+
+    state->ssa = NULL;
+    state->ssa_block = NULL;
+    arena_destroy(arena);
+    return ok;
+}
+
+// true if args[0] of the instruction is an
+// instruction index (jump target or function)
+bool ir_has_jump_target(vm_op_t opcode) {
+    switch(opcode) {
+        case OP_CALL:
+        case OP_TAIL_CALL:
+        case OP_ITER_NEXT:
+        case OP_ITER_NEXT_STORE_LOCAL:
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_NOT_EQUAL:
+        case OP_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_JUMP_IF_NOT_LESS_THAN:
+        case OP_JUMP_IF_NOT_MORE_THAN:
+        case OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_IEQUAL:
+        case OP_JUMP_IF_NOT_INOT_EQUAL:
+        case OP_JUMP_IF_NOT_ILESS_THAN:
+        case OP_JUMP_IF_NOT_IMORE_THAN:
+        case OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_FALSE:
+        case OP_R_JUMP_IF_NOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_LESS_THAN:
+        case OP_R_JUMP_IF_NOT_MORE_THAN:
+        case OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_IEQUAL:
+        case OP_R_JUMP_IF_NOT_INOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_ILESS_THAN:
+        case OP_R_JUMP_IF_NOT_IMORE_THAN:
+        case OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Rewrites all instruction indices (jump targets and function
+// addresses) after instructions have been removed or merged.
+// remap[old] gives the new index and must have count + 1
+// entries (old count before the rewrite).
+void irl_remap_indices(compiler_state_t* state, uint32_t* remap) {
+    ir_list_t* instrs = &state->instrs;
+    for (uint32_t i = 0; i < instrs->count; i++) {
+        if( ir_has_jump_target(instrs->irs[i].opcode) ) {
+            instrs->irs[i].args[0] = remap[instrs->irs[i].args[0]];
+        }
+    }
+    srcmap_t* functions = &state->functions;
+    for (size_t i = 0; i < functions->capacity; i++) {
+        if( functions->keys[i].source != NULL ) {
+            functions->values[i].data = remap[functions->values[i].data];
         }
     }
-    return count;
 }
 
-void codegen_if_chain(ast_node_t* node, compiler_state_t* state) {
-    
-    ABORT_ON_ERROR(state);
+// Sets is_target[i] for all instructions that are jumped
+// to or called (is_target must have count + 1 entries).
+void irl_mark_targets(compiler_state_t* state, bool* is_target) {
+    ir_list_t* instrs = &state->instrs;
+    for (uint32_t i = 0; i < instrs->count; i++) {
+        if( ir_has_jump_target(instrs->irs[i].opcode) ) {
+            is_target[instrs->irs[i].args[0]] = true;
+        }
+    }
+    srcmap_t* functions = &state->functions;
+    for (size_t i = 0; i < functions->capacity; i++) {
+        if( functions->keys[i].source != NULL ) {
+            is_target[functions->values[i].data] = true;
+        }
+    }
+}
 
-    int chain_len = get_if_chain_length(node);
-    ir_index_t exit_indices[chain_len];
+// Tries to match a superinstruction at the start of irs,
+// returns the number of instructions it replaces (writing
+// the fused instruction to out) or 1 if nothing matched.
+// The set is based on opcode pair counts measured with
+// VM_PROFILE_OPCODE_PAIRS. Only the first instruction of
+// a sequence may be a jump target.
+uint32_t ir_match_superinstruction(ir_inst_t* irs, uint32_t n, bool* is_target, ir_inst_t* out) {
+
+    #define IR_OP(I) ((I) < n && ((I) == 0 || is_target[(I)] == false) ? irs[(I)].opcode : OP_OPCODE_COUNT)
+
+    // load-local a, load-local b, (i)add, store-local c
+    if( IR_OP(0) == OP_LOAD_LOCAL && IR_OP(1) == OP_LOAD_LOCAL
+        && (IR_OP(2) == OP_ADD || IR_OP(2) == OP_IADD)
+        && IR_OP(3) == OP_STORE_LOCAL ) {
+        *out = (ir_inst_t) {
+            .opcode = IR_OP(2) == OP_IADD
+                ? OP_IADD_LOCALS_TO_LOCAL
+                : OP_ADD_LOCALS_TO_LOCAL,
+            .args = { irs[0].args[0], irs[1].args[0], irs[3].args[0] }
+        };
+        return 4;
+    }
 
-    ast_node_t* current = node;
-    int count = 0;
-    ir_index_t if_next_index;
+    // push-const c, load-local a, (i)add, store-local a
+    if( IR_OP(0) == OP_PUSH_VALUE && IR_OP(1) == OP_LOAD_LOCAL
+        && (IR_OP(2) == OP_ADD || IR_OP(2) == OP_IADD)
+        && IR_OP(3) == OP_STORE_LOCAL
+        && irs[1].args[0] == irs[3].args[0] ) {
+        *out = (ir_inst_t) {
+            .opcode = IR_OP(2) == OP_IADD
+                ? OP_IINC_LOCAL_BY_CONST
+                : OP_INC_LOCAL_BY_CONST,
+            .args = { irs[1].args[0], irs[0].args[0], 0 }
+        };
+        return 4;
+    }
 
-    while( current->type == AST_IF_CHAIN ) {
+    if( IR_OP(1) == OP_JUMP_IF_FALSE ) {
+        vm_op_t fused = OP_OPCODE_COUNT;
+        switch(IR_OP(0)) {
+            case OP_CMP_EQUAL:              fused = OP_JUMP_IF_NOT_EQUAL; break;
+            case OP_CMP_NOT_EQUAL:          fused = OP_JUMP_IF_NOT_NOT_EQUAL; break;
+            case OP_CMP_LESS_THAN:          fused = OP_JUMP_IF_NOT_LESS_THAN; break;
+            case OP_CMP_MORE_THAN:          fused = OP_JUMP_IF_NOT_MORE_THAN; break;
+            case OP_CMP_LESS_THAN_OR_EQUAL: fused = OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL; break;
+            case OP_CMP_MORE_THAN_OR_EQUAL: fused = OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL; break;
+            case OP_ICMP_EQUAL:              fused = OP_JUMP_IF_NOT_IEQUAL; break;
+            case OP_ICMP_NOT_EQUAL:          fused = OP_JUMP_IF_NOT_INOT_EQUAL; break;
+            case OP_ICMP_LESS_THAN:          fused = OP_JUMP_IF_NOT_ILESS_THAN; break;
+            case OP_ICMP_MORE_THAN:          fused = OP_JUMP_IF_NOT_IMORE_THAN; break;
+            case OP_ICMP_LESS_THAN_OR_EQUAL: fused = OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL; break;
+            case OP_ICMP_MORE_THAN_OR_EQUAL: fused = OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL; break;
+            default: break;
+        }
+        if( fused != OP_OPCODE_COUNT ) {
+            *out = (ir_inst_t) {
+                .opcode = fused,
+                .args = { irs[1].args[0], 0, 0 }
+            };
+            return 2;
+        }
+    }
 
-        // 1. if not cond <jump: next>      (or jump to end if no else or else if)
-        // 2. body                          (always generate)
-        // 3. <jump: end>                   (skip if no trailing else or else if)
-        // 4. next ...                      (go to next if or exit to else or nothing)
-        // N. [else] ... 
-        // N+1. end
+    if( IR_OP(0) == OP_ITER_NEXT && IR_OP(1) == OP_STORE_LOCAL ) {
+        *out = (ir_inst_t) {
+            .opcode = OP_ITER_NEXT_STORE_LOCAL,
+            .args = { irs[0].args[0], irs[1].args[0], 0 }
+        };
+        return 2;
+    }
 
-        // 1)
-        codegen(current->u.n_if.cond, state);
+    if( IR_OP(0) == OP_PUSH_VALUE && IR_OP(1) == OP_LOAD_LOCAL ) {
+        *out = (ir_inst_t) {
+            .opcode = OP_PUSH_VALUE_LOAD_LOCAL,
+            .args = { irs[0].args[0], irs[1].args[0], 0 }
+        };
+        return 2;
+    }
 
-        if_next_index = irl_add(
-            &state->instrs,
-            (ir_inst_t){
-                .opcode = OP_JUMP_IF_FALSE,
-                .args = { 0 }
-            });
+    if( IR_OP(0) == OP_LOAD_LOCAL && IR_OP(1) == OP_LOAD_LOCAL ) {
+        *out = (ir_inst_t) {
+            .opcode = OP_LOAD_LOCAL_PAIR,
+            .args = { irs[0].args[0], irs[1].args[0], 0 }
+        };
+        return 2;
+    }
 
-        // 2)
-        codegen(current->u.n_if.iftrue, state);
+    #undef IR_OP
 
-        current = current->u.n_if.next;
+    *out = irs[0];
+    return 1;
+}
 
-        // 3)
-        if( current->type == AST_IF_CHAIN || ast_is_valid_else_block(current) ) {
-            // if we're at the last block 
-            // we make sure to not jump 
-            // since we get a corrupt jump 
-            // index (same position).  
-            exit_indices[count++] = irl_add(
-                &state->instrs,
-                (ir_inst_t){
-                    .opcode = OP_JUMP,
-                    .args = { 0 }
-                });
-        }
+// Replaces hot instruction sequences with superinstructions.
+// Returns the number of instructions removed.
+uint32_t irl_fuse_superinstructions(compiler_state_t* state) {
 
-        // 4)
-        ir_inst_t* instr = irl_get(&state->instrs, if_next_index);
-        instr->args[0] = state->instrs.count;
+    ir_list_t* instrs = &state->instrs;
+    uint32_t count = instrs->count;
+
+    bool* is_target = (bool*) calloc(count + 1, sizeof(bool));
+    uint32_t* remap = (uint32_t*) malloc(sizeof(uint32_t) * (count + 1));
+    if( is_target == NULL || remap == NULL ) {
+        free(is_target);
+        free(remap);
+        return 0;
     }
 
-    // N)
-    if( ast_is_valid_else_block(current) )
-        codegen(current, state);
-    
-    // N+1) set the exit jump points
-    for(int i = 0; i < count; i++) {
-        irl_get(&state->instrs, exit_indices[i])->args[0] = state->instrs.count;
+    irl_mark_targets(state, is_target);
+
+    uint32_t out = 0;
+    uint32_t i = 0;
+    while( i < count ) {
+        ir_inst_t fused;
+        uint32_t span = ir_match_superinstruction(
+            instrs->irs + i, count - i, is_target + i, &fused);
+        for (uint32_t j = 0; j < span; j++) {
+            remap[i + j] = out;
+        }
+        instrs->irs[out++] = fused;
+        i += span;
     }
+    remap[count] = out;
+    instrs->count = out;
+
+    irl_remap_indices(state, remap);
+
+    free(is_target);
+    free(remap);
+    return count - out;
 }
 
-void codegen_return_stmt(ast_return_t stmt, compiler_state_t* state) {
-    uint32_t ret_size = 0;
-    switch (stmt.result->type) {
-        case AST_VALUE:
-        case AST_VAR_REF:
-        case AST_ARRAY:
-        case AST_FUN_CALL:
-        case AST_BINOP:
-        case AST_UNOP: {
-            ret_size = 1;
-        } break;
-        case AST_BLOCK: {
-            ret_size = stmt.result->u.n_block.count;
-        } break;
-        case AST_IF_CHAIN:
-        case AST_FOREACH:
-        case AST_ASSIGN:
-        case AST_TYANNOT:
-        case AST_FUN_DECL:
-        case AST_FUN_EXDECL:
-        case AST_RETURN:
-        case AST_ARGLIST:
-        case AST_BREAK: {
-            ret_size = 0;
-        } break;
+// Constant folding: operations on literals are replaced by
+// their value (co_fold.h computes it the way the vm does).
+
+bool fold_binop(ast_binop_t node, ast_value_t* out) {
+    if( node.left->type != AST_VALUE || node.right->type != AST_VALUE ) {
+        return false;
     }
-    if( ret_size == 0 ) {
-        irl_add(&state->instrs, (ir_inst_t){
-            .opcode = OP_RETURN_NOTHING,
-            .args = { 0 }
-        });
-    } else { 
-        codegen(stmt.result, state);
-        irl_add(&state->instrs, (ir_inst_t){
-            .opcode = OP_RETURN_VALUE,
-            .args = { 0 }
-        });
+    return fold_binop_values(node.type, node.left->u.n_value, node.right->u.n_value, out);
+}
+
+bool fold_unop(ast_unop_t node, ast_value_t* out) {
+    if( node.inner->type != AST_VALUE ) {
+        return false;
     }
+    return fold_unop_value(node.type, node.inner->u.n_value, out);
 }
 
-void codegen(ast_node_t* node, compiler_state_t* state) {
+uint32_t fold_constants(ast_node_t* node);
 
-    ABORT_ON_ERROR(state);
+uint32_t fold_constants_in(ast_node_t** nodes, size_t count) {
+    uint32_t folded = 0;
+    for (size_t i = 0; i < count; i++) {
+        folded += fold_constants(nodes[i]);
+    }
+    return folded;
+}
 
+// folds the constant expressions in the tree (in place),
+// returns the number of folded operations
+uint32_t fold_constants(ast_node_t* node) {
+    if( node == NULL ) {
+        return 0;
+    }
+    uint32_t folded = 0;
+    ast_value_t value;
     switch(node->type) {
         case AST_BINOP: {
-            codegen_binop(node->u.n_binop, state);
-        } break;
-        case AST_UNOP: {
-            codegen_unop(node->u.n_unop, state);
-        } break;
-        case AST_ASSIGN: {
-            codegen_assignment(node->u.n_assign, state);
-        } break;
-        case AST_RETURN: {
-            codegen_return_stmt(node->u.n_return, state);
-        } break;
-        case AST_ARRAY: {
-            size_t count = node->u.n_array.count;
-            for(size_t i = 0; i < count; i++) {
-                codegen(node->u.n_array.content[i], state);
-            }
-            vb_result_t app_res = valbuffer_insert_int(&state->consts, (int)count);
-            if( app_res.out_of_memory ) {
-                trace_out_of_memory_error(state->trace);
-                return;
-            }
-            uint32_t const_index = app_res.index;
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_PUSH_VALUE,
-                .args = { (uint32_t) const_index, 0 }
-            });
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_MAKE_ARRAY,
-                .args = { 0 }
-            });
-        } break;
-        case AST_BLOCK: {
-            size_t count = node->u.n_block.count;
-            for(size_t i = 0; i < count; i++) {
-                codegen(node->u.n_block.content[i], state);
+            folded += fold_constants(node->u.n_binop.left);
+            folded += fold_constants(node->u.n_binop.right);
+            if( fold_binop(node->u.n_binop, &value) ) {
+                node->type = AST_VALUE;
+                node->u.n_value = value;
+                folded ++;
             }
         } break;
-        case AST_ARGLIST: {
-            size_t count = node->u.n_args.count;
-            for(size_t i = 0; i < count; i++) {
-                codegen(node->u.n_args.content[i], state);
+        case AST_UNOP: {
+            folded += fold_constants(node->u.n_unop.inner);
+            if( fold_unop(node->u.n_unop, &value) ) {
+                node->type = AST_VALUE;
+                node->u.n_value = value;
+                folded ++;
             }
         } break;
+        case AST_ARRAY:
+            return fold_constants_in(node->u.n_array.content, node->u.n_array.count);
+        case AST_BLOCK:
+            return fold_constants_in(node->u.n_block.content, node->u.n_block.count);
+        case AST_ARGLIST:
+            return fold_constants_in(node->u.n_args.content, node->u.n_args.count);
         case AST_IF_CHAIN: {
-            codegen_if_chain(node, state);
+            folded += fold_constants(node->u.n_if.cond);
+            folded += fold_constants(node->u.n_if.iftrue);
+            folded += fold_constants(node->u.n_if.next);
         } break;
         case AST_FOREACH: {
-            codegen_foreach(node->u.n_foreach, state);
-        } break;
-        case AST_FUN_DECL: {
-            codegen_fundecl(node->u.n_fundecl, state);
-            if(node->u.n_fundecl.exported)
-                add_program_provided_function_definition(node->u.n_fundecl.name, state);
-        } break;
-        case AST_FUN_CALL: {
-            codegen_funcall(node->u.n_funcall, state);
-        } break;
-        case AST_FUN_EXDECL: {
-            add_host_provided_function_definition(node->u.n_funexdecl.name, state);
-        } break;
-        case AST_VAR_REF: {
-            ir_index_t var_index = state_get_localvar(state, node->u.n_varref.name);
-            assert(var_index.tag == IRID_VAR && "variable not found");
-            irl_add(&state->instrs, (ir_inst_t){
-                .opcode = OP_LOAD_LOCAL,
-                .args = { var_index.idx, 0 }
-            });
+            folded += fold_constants(node->u.n_foreach.collection);
+            folded += fold_constants(node->u.n_foreach.during);
         } break;
-        case AST_VALUE: {
-            codegen_value(node->u.n_value, state);
-        } break;
-        case AST_TYANNOT: {
-            if( node->u.n_tyannot.expr->type == AST_VAR_REF ) {
-                ast_node_t* var = node->u.n_tyannot.expr;
-                // just add valiable name to frame local var set.
-                state_add_localvar(state, var->u.n_varref.name);
+        case AST_ASSIGN:
+            return fold_constants(node->u.n_assign.right_value);
+        case AST_TYANNOT:
+            return fold_constants(node->u.n_tyannot.expr);
+        case AST_FUN_DECL:
+            return fold_constants(node->u.n_fundecl.body);
+        case AST_FUN_CALL:
+            return fold_constants(node->u.n_funcall.args);
+        case AST_RETURN:
+            return fold_constants(node->u.n_return.result);
+        default:
+            break;
+    }
+    return folded;
+}
+
+// true for the jumps that may be redirected (the
+// conditional and unconditional branches)
+bool ir_is_branch(vm_op_t opcode) {
+    switch(opcode) {
+        case OP_CALL:
+        case OP_TAIL_CALL:
+        case OP_ITER_NEXT:
+        case OP_ITER_NEXT_STORE_LOCAL:
+            return false;
+        default:
+            return ir_has_jump_target(opcode);
+    }
+}
+
+// true if execution never continues with the next instruction
+bool ir_is_unconditional(vm_op_t opcode) {
+    switch(opcode) {
+        case OP_JUMP:
+        case OP_RETURN_NOTHING:
+        case OP_RETURN_VALUE:
+        case OP_TAIL_CALL:
+        case OP_EXIT:
+        case OP_HALT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// true if the instruction reads or writes the frame slot
+bool ir_uses_local(ir_inst_t* inst, uint32_t slot) {
+    size_t argcount = get_op_arg_count(inst->opcode);
+    op_argtype_t* types = get_op_arg_types(inst->opcode);
+    for (size_t i = 0; i < argcount; i++) {
+        bool uses = (types[i] == OP_ARG_LOCAL && inst->args[i] == slot)
+            || (types[i] == OP_ARG_RK && OP_RK_IS_CONST(inst->args[i]) == false
+                && OP_RK_INDEX(inst->args[i]) == slot);
+        if( uses ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// number of instructions in the function around index that
+// use the frame slot (functions start with make-frame)
+uint32_t irl_count_local_uses(ir_list_t* instrs, uint32_t index, uint32_t slot) {
+    uint32_t start = index;
+    while( start > 0 && instrs->irs[start].opcode != OP_MAKE_FRAME ) {
+        start --;
+    }
+    uint32_t uses = 0;
+    for (uint32_t i = start; i < instrs->count; i++) {
+        if( i > start && instrs->irs[i].opcode == OP_MAKE_FRAME ) {
+            break;
+        }
+        uses += ir_uses_local(&instrs->irs[i], slot) ? 1 : 0;
+    }
+    return uses;
+}
+
+// the value of a bool constant, false if it is no bool
+bool state_get_bool_const(compiler_state_t* state, uint32_t index, bool* value) {
+    if( index >= state->consts.size || state->consts.values[index].type != VAL_BOOL ) {
+        return false;
+    }
+    *value = val_into_bool(state->consts.values[index]);
+    return true;
+}
+
+// One round of the peephole pass. Jumps to jumps are sent
+// to the final target, then these are removed:
+// - jumps to the next instruction
+// - branches on constants (or they become a jump)
+// - instructions that can't be reached (after a jump or
+//   return that is not a jump target)
+// - pushes that are popped right away
+// - load-local n, store-local n
+// - store-local n, load-local n where the slot isn't used
+//   anywhere else in the function (the value stays on the
+//   stack instead)
+// The second instruction of a removed pair may not be a
+// jump target. Returns the number of instructions removed.
+uint32_t irl_peephole_round(compiler_state_t* state) {
+
+    ir_list_t* instrs = &state->instrs;
+    uint32_t count = instrs->count;
+
+    bool* is_target = (bool*) calloc(count + 1, sizeof(bool));
+    bool* keep = (bool*) malloc(sizeof(bool) * (count + 1));
+    uint32_t* remap = (uint32_t*) malloc(sizeof(uint32_t) * (count + 1));
+    if( is_target == NULL || keep == NULL || remap == NULL ) {
+        free(is_target);
+        free(keep);
+        free(remap);
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        ir_inst_t* inst = &instrs->irs[i];
+        uint32_t hops = 0;
+        while( ir_is_branch(inst->opcode) && inst->args[0] < count
+            && instrs->irs[inst->args[0]].opcode == OP_JUMP
+            && inst->args[0] != instrs->irs[inst->args[0]].args[0]
+            && hops++ < count ) {
+            inst->args[0] = instrs->irs[inst->args[0]].args[0];
+        }
+    }
+
+    irl_mark_targets(state, is_target);
+
+    #define IR_PAIR(OP_A, OP_B) (i + 1 < count && is_target[i + 1] == false \
+        && irs[i].opcode == (OP_A) && irs[i + 1].opcode == (OP_B))
+
+    ir_inst_t* irs = instrs->irs;
+    bool reachable = true;
+    uint32_t i = 0;
+    while( i < count ) {
+        keep[i] = true;
+        reachable |= is_target[i];
+        bool cond = false;
+        if( reachable == false && irs[i].opcode != OP_HALT
+            && irs[i].opcode != OP_MAKE_FRAME ) {
+            keep[i] = false;
+        } else if( irs[i].opcode == OP_JUMP && irs[i].args[0] == i + 1 ) {
+            keep[i] = false;
+        } else if( IR_PAIR(OP_PUSH_VALUE, OP_JUMP_IF_FALSE)
+            && state_get_bool_const(state, irs[i].args[0], &cond) ) {
+            keep[i] = false;
+            if( cond ) {
+                keep[++i] = false;
             } else {
-                // this is a function annotated with its return type
-                ast_node_t* expr = node->u.n_tyannot.expr;
-                (void)(expr); // unused in release builds
-                assert( expr->type == AST_FUN_DECL || expr->type == AST_FUN_EXDECL );
-                codegen(node->u.n_tyannot.expr, state);
+                irs[i + 1].opcode = OP_JUMP;
             }
-        } break;
-        case AST_BREAK: {
-            assert(false && "break op is not implemented yet");
-        } break;
+        } else if( irs[i].opcode == OP_R_JUMP_IF_FALSE && OP_RK_IS_CONST(irs[i].args[1])
+            && state_get_bool_const(state, OP_RK_INDEX(irs[i].args[1]), &cond) ) {
+            if( cond ) {
+                keep[i] = false;
+            } else {
+                irs[i] = (ir_inst_t) { .opcode = OP_JUMP, .args = { irs[i].args[0], 0, 0 } };
+            }
+        } else if( IR_PAIR(OP_PUSH_VALUE, OP_POP_1)
+            || IR_PAIR(OP_LOAD_LOCAL, OP_POP_1)
+            || IR_PAIR(OP_DUP_1, OP_POP_1) ) {
+            keep[i] = false;
+            keep[++i] = false;
+        } else if( (IR_PAIR(OP_LOAD_LOCAL, OP_STORE_LOCAL) || IR_PAIR(OP_STORE_LOCAL, OP_LOAD_LOCAL))
+            && irs[i].args[0] == irs[i + 1].args[0]
+            && (irs[i].opcode == OP_LOAD_LOCAL
+                || irl_count_local_uses(instrs, i, irs[i].args[0]) == 2) ) {
+            keep[i] = false;
+            keep[++i] = false;
+        }
+        if( keep[i] ) {
+            reachable = ir_is_unconditional(irs[i].opcode) == false;
+        }
+        i ++;
+    }
+
+    #undef IR_PAIR
 
+    // the jump to a removed instruction continues with
+    // the next one that is kept
+    uint32_t out = 0;
+    for (i = 0; i < count; i++) {
+        remap[i] = out;
+        if( keep[i] ) {
+            irs[out++] = irs[i];
+        }
+    }
+    remap[count] = out;
+    instrs->count = out;
+
+    irl_remap_indices(state, remap);
+
+    free(is_target);
+    free(keep);
+    free(remap);
+    return count - out;
+}
+
+// Runs the peephole pass until nothing changes, returns
+// the number of instructions removed.
+uint32_t irl_peephole(compiler_state_t* state) {
+    uint32_t removed = 0;
+    uint32_t round = 0;
+    while( (round = irl_peephole_round(state)) > 0 ) {
+        removed += round;
     }
+    return removed;
 }
 
 void recalc_index_to_bytecode_adress(ir_list_t* instrs, uint32_t* idx2addr) {
     for (uint32_t i = 0; i < instrs->count; i++) {
-        switch(instrs->irs[i].opcode) {
-            case OP_CALL:
-            case OP_ITER_NEXT:
-            case OP_JUMP:
-            case OP_JUMP_IF_FALSE: {
-                uint32_t index = instrs->irs[i].args[0];
-                // assert <= max_address
-                assert(idx2addr[index] <= idx2addr[instrs->count]);
-                instrs->irs[i].args[0] = idx2addr[index];
-            } break;
-            default: break;
+        if( ir_has_jump_target(instrs->irs[i].opcode) ) {
+            uint32_t index = instrs->irs[i].args[0];
+            // assert <= max_address
+            assert(idx2addr[index] <= idx2addr[instrs->count]);
+            instrs->irs[i].args[0] = idx2addr[index];
         }
     }
 }
@@ -864,7 +2621,8 @@ program_t write_program(compiler_state_t* state, uint32_t* idx2addr) {
         .inst.size = bytecode.size,
         .exports = state->program_supplied,
         .expaddr = expaddrs,
-        .imports = state->host_supplied
+        .imports = state->host_supplied,
+        .jit = state->opts.jit
     };
 
     u8buffer_destroy(&bytecode);
@@ -872,7 +2630,7 @@ program_t write_program(compiler_state_t* state, uint32_t* idx2addr) {
 }
 
 
-program_t gvm_compile(arena_t* arena, ast_node_t* node, trace_t* trace) {
+program_t gvm_compile(arena_t* arena, ast_node_t* node, trace_t* trace, compiler_opts_t opts) {
 
     program_t program = { 0 };
 
@@ -880,6 +2638,7 @@ program_t gvm_compile(arena_t* arena, ast_node_t* node, trace_t* trace) {
 
     compiler_state_t state = (compiler_state_t) {
         .trace = trace,
+        .opts = opts,
         .tyctx = bty_ctx_create(arena, trace, 16)
     };
 
@@ -887,6 +2646,10 @@ program_t gvm_compile(arena_t* arena, ast_node_t* node, trace_t* trace) {
         return program;
     }
 
+    if( opts.opt_level > 0 ) {
+        state.stats.folded = fold_constants(node);
+    }
+
     if( srcmap_init(&state.functions, 16) == false ) {
         trace_out_of_memory_error(state.trace);
         return program;
@@ -941,6 +2704,18 @@ program_t gvm_compile(arena_t* arena, ast_node_t* node, trace_t* trace) {
         .args = { 0 }
     });
 
+    if( opts.opt_level > 0 && trace_get_error_count(state.trace) == 0 ) {
+        state.stats.removed = irl_peephole(&state);
+    }
+
+    if( CO_SUPERINSTRUCTIONS && trace_get_error_count(state.trace) == 0 ) {
+        state.stats.fused = irl_fuse_superinstructions(&state);
+    }
+
+    if( opts.stats != NULL ) {
+        *opts.stats = state.stats;
+    }
+
     if( trace_get_error_count(state.trace) == 0 ) {
         uint32_t idx2addr_count = state.instrs.count + 1;
         uint32_t idx2addr[idx2addr_count];
@@ -6,6 +6,28 @@
 #include "sh_types.h"
 #include "sh_arena.h"
 
-program_t gvm_compile(arena_t* arena, ast_node_t* node, trace_t* trace);
+typedef enum compiler_backend_t {
+    CO_BACKEND_STACK = 0,   // stack instructions only
+    CO_BACKEND_REGISTER     // register instructions for expressions
+} compiler_backend_t;
+
+// what the optimizer did (see compiler_opts_t.opt_level)
+typedef struct compiler_stats_t {
+    uint32_t folded;    // constant expressions folded into values
+    uint32_t removed;   // instructions removed by the peephole pass
+    uint32_t fused;     // instructions merged into superinstructions
+    uint32_t ssa_functions; // functions compiled through the ssa ir
+    uint32_t eliminated;    // ssa values removed by its passes
+} compiler_stats_t;
+
+typedef struct compiler_opts_t {
+    compiler_backend_t backend;
+    bool               jit;     // run the program as native code (vm_jit.h)
+    int                opt_level; // 0: none, 1: constant folding and peephole pass,
+                                  // 2: also the ssa passes (stack backend)
+    compiler_stats_t*  stats;   // filled in by gvm_compile (may be NULL)
+} compiler_opts_t;
+
+program_t gvm_compile(arena_t* arena, ast_node_t* node, trace_t* trace, compiler_opts_t opts);
 
 #endif // GVM_COMPILER_H_
@@ -0,0 +1,113 @@
+#include "co_fold.h"
+#include <math.h>
+
+#define FOLD_INT_WRAP(A, OP, B) ((int32_t) ((uint32_t) (A) OP (uint32_t) (B)))
+#define FOLD_EPSILON 0.0001f
+
+static bool fold_is_number(ast_value_t value) {
+    return value.type == AST_VALUE_INT || value.type == AST_VALUE_FLOAT;
+}
+
+static float fold_as_float(ast_value_t value) {
+    return value.type == AST_VALUE_INT ? (float) value.u._int : value.u._float;
+}
+
+static ast_value_t fold_int(int32_t value) {
+    return (ast_value_t) { .type = AST_VALUE_INT, .u._int = value };
+}
+
+static ast_value_t fold_float(float value) {
+    return (ast_value_t) { .type = AST_VALUE_FLOAT, .u._float = value };
+}
+
+static ast_value_t fold_bool(bool value) {
+    return (ast_value_t) { .type = AST_VALUE_BOOL, .u._bool = value };
+}
+
+static bool fold_int_binop(ast_binop_type_t type, int32_t a, int32_t b, ast_value_t* out) {
+    switch(type) {
+        case AST_BIN_ADD:   *out = fold_int(FOLD_INT_WRAP(a, +, b)); break;
+        case AST_BIN_SUB:   *out = fold_int(FOLD_INT_WRAP(a, -, b)); break;
+        case AST_BIN_MUL:   *out = fold_int(FOLD_INT_WRAP(a, *, b)); break;
+        case AST_BIN_DIV: {
+            if( b == 0 )
+                return false;
+            *out = fold_int(b == -1 ? FOLD_INT_WRAP(0, -, a) : a / b);
+        } break;
+        case AST_BIN_MOD: {
+            if( b == 0 )
+                return false;
+            *out = fold_int(b == -1 ? 0 : a % b);
+        } break;
+        case AST_BIN_EQ:    *out = fold_bool(a == b); break;
+        case AST_BIN_NEQ:   *out = fold_bool(a != b); break;
+        case AST_BIN_LT:    *out = fold_bool(a < b); break;
+        case AST_BIN_GT:    *out = fold_bool(a > b); break;
+        case AST_BIN_LT_EQ: *out = fold_bool(a <= b); break;
+        case AST_BIN_GT_EQ: *out = fold_bool(a >= b); break;
+        default:            return false;
+    }
+    return true;
+}
+
+static bool fold_float_binop(ast_binop_type_t type, float a, float b, ast_value_t* out) {
+    switch(type) {
+        case AST_BIN_ADD:   *out = fold_float(a + b); break;
+        case AST_BIN_SUB:   *out = fold_float(a - b); break;
+        case AST_BIN_MUL:   *out = fold_float(a * b); break;
+        case AST_BIN_DIV:   *out = fold_float(a / b); break;
+        case AST_BIN_MOD: {
+            // the vm truncates both operands to int
+            bool in_range = fabsf(a) < 2147483520.0f && fabsf(b) < 2147483520.0f;
+            if( in_range == false || (int) b == 0 || (int) b == -1 )
+                return false;
+            *out = fold_float((float) ((int) a % (int) b));
+        } break;
+        case AST_BIN_EQ:    *out = fold_bool(fabsf(a - b) < FOLD_EPSILON); break;
+        case AST_BIN_NEQ:   *out = fold_bool(fabsf(a - b) > FOLD_EPSILON); break;
+        case AST_BIN_LT:    *out = fold_bool(a < b); break;
+        case AST_BIN_GT:    *out = fold_bool(a > b); break;
+        case AST_BIN_LT_EQ: *out = fold_bool(a <= b); break;
+        case AST_BIN_GT_EQ: *out = fold_bool(a >= b); break;
+        default:            return false;
+    }
+    return true;
+}
+
+bool fold_binop_values(ast_binop_type_t type, ast_value_t a, ast_value_t b, ast_value_t* out) {
+    if( a.type == AST_VALUE_BOOL && b.type == AST_VALUE_BOOL ) {
+        switch(type) {
+            case AST_BIN_AND: *out = fold_bool(a.u._bool && b.u._bool); return true;
+            case AST_BIN_OR:  *out = fold_bool(a.u._bool || b.u._bool); return true;
+            default:          return false;
+        }
+    }
+    if( fold_is_number(a) == false || fold_is_number(b) == false ) {
+        return false;
+    }
+    if( a.type == AST_VALUE_INT && b.type == AST_VALUE_INT ) {
+        return fold_int_binop(type, a.u._int, b.u._int, out);
+    }
+    return fold_float_binop(type, fold_as_float(a), fold_as_float(b), out);
+}
+
+bool fold_unop_value(ast_unop_type_t type, ast_value_t a, ast_value_t* out) {
+    switch(type) {
+        case AST_UN_NEG: {
+            if( a.type == AST_VALUE_INT ) {
+                *out = fold_int(FOLD_INT_WRAP(0, -, a.u._int));
+            } else if( a.type == AST_VALUE_FLOAT ) {
+                *out = fold_float(-a.u._float);
+            } else {
+                return false;
+            }
+        } break;
+        case AST_UN_NOT: {
+            if( a.type != AST_VALUE_BOOL )
+                return false;
+            *out = fold_bool(!a.u._bool);
+        } break;
+        default: return false;
+    }
+    return true;
+}
@@ -0,0 +1,17 @@
+#ifndef CO_FOLD_H_
+#define CO_FOLD_H_
+
+#include "co_types.h"
+
+// Evaluates operations on constants at compile time the way the
+// vm does: wrapping 32-bit integer operations, ints are converted
+// to float if the other operand is a float, the float (in)equality
+// uses the vm epsilon and the float modulo truncates to int.
+// Returns false for what can't be folded: integer division by
+// zero (it fails at run time), chars, xor and comparisons of
+// bools.
+
+bool fold_binop_values(ast_binop_type_t type, ast_value_t a, ast_value_t b, ast_value_t* out);
+bool fold_unop_value(ast_unop_type_t type, ast_value_t a, ast_value_t* out);
+
+#endif // CO_FOLD_H_
@@ -362,7 +362,7 @@ void program_source_free(source_code_t* code) {
     code->file_path = NULL;
 }
 
-program_t program_compile(source_code_t* code, bool print_ast) {
+program_t program_compile(source_code_t* code, bool print_ast, compiler_opts_t opts) {
 
     parser_t parser = { 0 };
     trace_t trace = { 0 };
@@ -424,7 +424,7 @@ program_t program_compile(source_code_t* code, bool print_ast) {
         arena_destroy(arena);
     }
 
-    program_t program = gvm_compile(arena, program_node, &trace);
+    program_t program = gvm_compile(arena, program_node, &trace, opts);
     
     if( trace_get_message_count(&trace) > 0 ) {
         define_cstr(str, 2048);
@@ -2,6 +2,7 @@
 #define GVM_PROGRAM_H_
 
 #include "sh_types.h"
+#include "co_compiler.h"
 #include <stdio.h>
 #include <unistd.h>
 #include <time.h>
@@ -22,6 +23,6 @@ source_code_t program_source_from_memory(char* source_code, int length);
 bool program_source_is_valid(source_code_t* code);
 void program_source_free(source_code_t* code);
 
-program_t program_compile(source_code_t* code, bool print_ast);
+program_t program_compile(source_code_t* code, bool print_ast, compiler_opts_t opts);
 
 #endif // GVM_PROGRAM_H_
@@ -0,0 +1,1573 @@
+#include "co_ssa.h"
+#include "co_ast.h"
+#include "co_fold.h"
+#include <assert.h>
+#include <string.h>
+
+#define SSA_NO_RPO UINT32_MAX
+
+// appends ITEM to the arena allocated array ITEMS
+#define SSA_PUSH(FUNC, ITEMS, COUNT, CAPACITY, ITEM) do {                       \
+        if( (COUNT) == (CAPACITY) ) {                                           \
+            (CAPACITY) = (CAPACITY) == 0 ? 4 : (CAPACITY) * 2;                  \
+            (ITEMS) = ssa_grow((FUNC), (ITEMS), (COUNT) * sizeof(*(ITEMS)),     \
+                               (CAPACITY) * sizeof(*(ITEMS)));                  \
+        }                                                                       \
+        (ITEMS)[(COUNT)++] = (ITEM);                                            \
+    } while(false)
+
+static void* ssa_grow(ssa_func_t* func, void* items, size_t used, size_t size) {
+    void* grown = aalloc(func->arena, (ptrdiff_t) size);
+    if( used > 0 ) {
+        memcpy(grown, items, used);
+    }
+    return grown;
+}
+
+// Construction
+
+ssa_func_t* ssa_func_create(arena_t* arena, uint32_t param_count) {
+    ssa_func_t* func = (ssa_func_t*) aalloc(arena, sizeof(ssa_func_t));
+    func->arena = arena;
+    func->param_count = param_count;
+    func->slot_count = param_count;
+    return func;
+}
+
+ssa_block_t* ssa_block_create(ssa_func_t* func) {
+    ssa_block_t* block = (ssa_block_t*) aalloc(func->arena, sizeof(ssa_block_t));
+    block->id = func->block_count;
+    block->rpo = SSA_NO_RPO;
+    SSA_PUSH(func, func->blocks, func->block_count, func->block_capacity, block);
+    return block;
+}
+
+void ssa_block_move_last(ssa_func_t* func, ssa_block_t* block) {
+    uint32_t last = func->block_count - 1;
+    for(uint32_t i = block->id; i < last; i++) {
+        func->blocks[i] = func->blocks[i + 1];
+        func->blocks[i]->id = i;
+    }
+    func->blocks[last] = block;
+    block->id = last;
+}
+
+static ssa_value_t* ssa_value_create(ssa_func_t* func, ssa_kind_t kind, ssa_type_t type, uint32_t argc) {
+    ssa_value_t* value = (ssa_value_t*) aalloc(func->arena, sizeof(ssa_value_t));
+    value->kind = kind;
+    value->type = type;
+    value->id = func->value_count;
+    value->slot = -1;
+    value->argc = argc;
+    if( argc > 0 ) {
+        value->args = (ssa_value_t**) aalloc(func->arena, sizeof(ssa_value_t*) * argc);
+    }
+    SSA_PUSH(func, func->all, func->value_count, func->value_capacity, value);
+    return value;
+}
+
+static void ssa_append(ssa_func_t* func, ssa_block_t* block, ssa_value_t* value) {
+    value->block = block;
+    SSA_PUSH(func, block->values, block->value_count, block->value_capacity, value);
+}
+
+// inserts before the iterator a loop preheader ends with
+static void ssa_append_before_iter(ssa_func_t* func, ssa_block_t* block, ssa_value_t* value) {
+    ssa_append(func, block, value);
+    uint32_t i = block->value_count - 1;
+    if( i > 0 && block->values[i - 1]->kind == SSA_ITER ) {
+        block->values[i] = block->values[i - 1];
+        block->values[i - 1] = value;
+    }
+}
+
+ssa_value_t* ssa_const(ssa_func_t* func, ast_value_t constant) {
+    ssa_type_t type = SSA_TY_NONE;
+    switch(constant.type) {
+        case AST_VALUE_INT:     type = SSA_TY_INT;      break;
+        case AST_VALUE_CHAR:    type = SSA_TY_CHAR;     break;
+        case AST_VALUE_FLOAT:   type = SSA_TY_FLOAT;    break;
+        case AST_VALUE_BOOL:    type = SSA_TY_BOOL;     break;
+        default:                                        break;
+    }
+    ssa_value_t* value = ssa_value_create(func, SSA_CONST, type, 0);
+    value->u.constant = constant;
+    return value;
+}
+
+static ssa_value_t* ssa_const_int(ssa_func_t* func, int32_t n) {
+    return ssa_const(func, (ast_value_t) { .type = AST_VALUE_INT, .u._int = n });
+}
+
+static ssa_value_t* ssa_const_bool(ssa_func_t* func, bool b) {
+    return ssa_const(func, (ast_value_t) { .type = AST_VALUE_BOOL, .u._bool = b });
+}
+
+ssa_value_t* ssa_param(ssa_func_t* func, uint32_t index, ssa_type_t type) {
+    ssa_value_t* value = ssa_value_create(func, SSA_PARAM, type, 0);
+    value->u.index = index;
+    return value;
+}
+
+static ssa_value_t* ssa_undef(ssa_func_t* func, ssa_type_t type) {
+    return ssa_value_create(func, SSA_UNDEF, type, 0);
+}
+
+ssa_value_t* ssa_emit(ssa_func_t* func, ssa_block_t* block, ssa_kind_t kind,
+                      ssa_type_t type, uint32_t argc, ssa_value_t** args)
+{
+    ssa_value_t* value = ssa_value_create(func, kind, type, argc);
+    for(uint32_t i = 0; i < argc; i++) {
+        value->args[i] = args[i];
+    }
+    ssa_append(func, block, value);
+    return value;
+}
+
+static ssa_type_t ssa_binop_result_type(ast_binop_type_t op, ssa_type_t optype) {
+    switch(op) {
+        case AST_BIN_ADD:
+        case AST_BIN_SUB:
+        case AST_BIN_MUL:
+        case AST_BIN_DIV:
+        case AST_BIN_MOD:
+            return optype == SSA_TY_CHAR ? SSA_TY_INT : optype;
+        default:
+            return SSA_TY_BOOL;
+    }
+}
+
+static ssa_value_t* ssa_binop_create(ssa_func_t* func, ast_binop_type_t op,
+                                     ssa_type_t optype, ssa_value_t* left, ssa_value_t* right)
+{
+    ssa_value_t* value = ssa_value_create(func, SSA_BINOP,
+        ssa_binop_result_type(op, optype), 2);
+    value->optype = optype;
+    value->u.binop = op;
+    value->args[0] = left;
+    value->args[1] = right;
+    return value;
+}
+
+ssa_value_t* ssa_emit_binop(ssa_func_t* func, ssa_block_t* block, ast_binop_type_t op,
+                            ssa_type_t optype, ssa_value_t* left, ssa_value_t* right)
+{
+    ssa_value_t* value = ssa_binop_create(func, op, optype, left, right);
+    ssa_append(func, block, value);
+    return value;
+}
+
+ssa_value_t* ssa_emit_unop(ssa_func_t* func, ssa_block_t* block, ast_unop_type_t op,
+                           ssa_type_t optype, ssa_value_t* inner)
+{
+    ssa_type_t type = op == AST_UN_NOT ? SSA_TY_BOOL
+        : optype == SSA_TY_CHAR ? SSA_TY_INT : optype;
+    ssa_value_t* value = ssa_emit(func, block, SSA_UNOP, type, 1, &inner);
+    value->optype = optype;
+    value->u.unop = op;
+    return value;
+}
+
+ssa_value_t* ssa_resolve(ssa_value_t* value) {
+    while( value != NULL && value->replaced != NULL ) {
+        value = value->replaced;
+    }
+    return value;
+}
+
+// Variables (Braun et al.)
+
+void ssa_write_var(ssa_func_t* func, ssa_block_t* block, uint32_t var, ssa_value_t* value) {
+    for(uint32_t i = 0; i < block->def_count; i++) {
+        if( block->defs[i].var == var ) {
+            block->defs[i].value = value;
+            return;
+        }
+    }
+    ssa_def_t def = { .var = var, .value = value };
+    SSA_PUSH(func, block->defs, block->def_count, block->def_capacity, def);
+}
+
+static ssa_value_t* ssa_phi_create(ssa_func_t* func, ssa_block_t* block, ssa_type_t type) {
+    ssa_value_t* phi = ssa_value_create(func, SSA_PHI, type, 0);
+    phi->block = block;
+    SSA_PUSH(func, block->phis, block->phi_count, block->phi_capacity, phi);
+    return phi;
+}
+
+// true if the phi only merges one value (or itself),
+// the value is returned in same (NULL if there is none)
+static bool ssa_phi_is_trivial(ssa_value_t* phi, ssa_value_t** same) {
+    ssa_value_t* found = NULL;
+    for(uint32_t i = 0; i < phi->argc; i++) {
+        ssa_value_t* arg = ssa_resolve(phi->args[i]);
+        if( arg == found || arg == phi ) {
+            continue;
+        }
+        if( found != NULL ) {
+            return false;
+        }
+        found = arg;
+    }
+    *same = found;
+    return true;
+}
+
+static ssa_value_t* ssa_try_remove_trivial_phi(ssa_func_t* func, ssa_value_t* phi) {
+    ssa_value_t* same = NULL;
+    if( ssa_phi_is_trivial(phi, &same) == false ) {
+        return phi;
+    }
+    if( same == NULL ) {
+        same = ssa_undef(func, phi->type);
+    }
+    phi->replaced = same;
+    return same;
+}
+
+static ssa_value_t* ssa_add_phi_operands(ssa_func_t* func, ssa_value_t* phi, uint32_t var) {
+    ssa_block_t* block = phi->block;
+    phi->argc = block->pred_count;
+    phi->args = (ssa_value_t**) aalloc(func->arena, sizeof(ssa_value_t*) * phi->argc);
+    for(uint32_t i = 0; i < block->pred_count; i++) {
+        phi->args[i] = ssa_read_var(func, block->preds[i], var, phi->type);
+    }
+    return ssa_try_remove_trivial_phi(func, phi);
+}
+
+static ssa_value_t* ssa_read_var_recursive(ssa_func_t* func, ssa_block_t* block, uint32_t var, ssa_type_t type) {
+    ssa_value_t* value = NULL;
+    if( block->sealed == false ) {
+        value = ssa_phi_create(func, block, type);
+        ssa_def_t incomplete = { .var = var, .value = value };
+        SSA_PUSH(func, block->incomplete, block->incomplete_count,
+            block->incomplete_capacity, incomplete);
+    } else if( block->pred_count == 0 ) {
+        value = ssa_undef(func, type);
+    } else if( block->pred_count == 1 ) {
+        value = ssa_read_var(func, block->preds[0], var, type);
+    } else {
+        // the phi breaks cycles through loops
+        ssa_value_t* phi = ssa_phi_create(func, block, type);
+        ssa_write_var(func, block, var, phi);
+        value = ssa_add_phi_operands(func, phi, var);
+    }
+    ssa_write_var(func, block, var, value);
+    return value;
+}
+
+ssa_value_t* ssa_read_var(ssa_func_t* func, ssa_block_t* block, uint32_t var, ssa_type_t type) {
+    for(uint32_t i = 0; i < block->def_count; i++) {
+        if( block->defs[i].var == var ) {
+            return ssa_resolve(block->defs[i].value);
+        }
+    }
+    return ssa_read_var_recursive(func, block, var, type);
+}
+
+void ssa_seal(ssa_func_t* func, ssa_block_t* block) {
+    for(uint32_t i = 0; i < block->incomplete_count; i++) {
+        ssa_add_phi_operands(func, block->incomplete[i].value, block->incomplete[i].var);
+    }
+    block->incomplete_count = 0;
+    block->sealed = true;
+}
+
+// Terminators
+
+static void ssa_add_pred(ssa_func_t* func, ssa_block_t* block, ssa_block_t* pred) {
+    assert(block->sealed == false && "predecessor added to a sealed block");
+    SSA_PUSH(func, block->preds, block->pred_count, block->pred_capacity, pred);
+}
+
+void ssa_jump(ssa_func_t* func, ssa_block_t* from, ssa_block_t* to) {
+    from->term = SSA_TERM_JUMP;
+    from->succs[0] = to;
+    ssa_add_pred(func, to, from);
+}
+
+void ssa_branch(ssa_func_t* func, ssa_block_t* from, ssa_value_t* cond,
+                ssa_block_t* iftrue, ssa_block_t* iffalse)
+{
+    from->term = SSA_TERM_BRANCH;
+    from->term_value = cond;
+    from->succs[0] = iftrue;
+    from->succs[1] = iffalse;
+    ssa_add_pred(func, iftrue, from);
+    ssa_add_pred(func, iffalse, from);
+}
+
+void ssa_iterate(ssa_func_t* func, ssa_block_t* from, ssa_block_t* next, ssa_block_t* done) {
+    from->term = SSA_TERM_ITER;
+    from->succs[0] = next;
+    from->succs[1] = done;
+    ssa_add_pred(func, next, from);
+    ssa_add_pred(func, done, from);
+}
+
+void ssa_return(ssa_func_t* func, ssa_block_t* from, ssa_value_t* value) {
+    (void) func;
+    from->term = SSA_TERM_RETURN;
+    from->term_value = value;
+}
+
+// Analysis
+
+static uint32_t ssa_succ_count(ssa_block_t* block) {
+    switch(block->term) {
+        case SSA_TERM_JUMP:     return 1;
+        case SSA_TERM_BRANCH:
+        case SSA_TERM_ITER:     return 2;
+        default:                return 0;
+    }
+}
+
+static uint32_t ssa_pred_index(ssa_block_t* block, ssa_block_t* pred) {
+    for(uint32_t i = 0; i < block->pred_count; i++) {
+        if( block->preds[i] == pred ) {
+            return i;
+        }
+    }
+    assert(false && "not a predecessor");
+    return 0;
+}
+
+bool ssa_may_trap(ssa_value_t* value) {
+    if( value->kind != SSA_BINOP ) {
+        return false;
+    }
+    bool is_float = value->optype == SSA_TY_FLOAT;
+    if( value->u.binop != AST_BIN_MOD && (value->u.binop != AST_BIN_DIV || is_float) ) {
+        return false;
+    }
+    ssa_value_t* divisor = ssa_resolve(value->args[1]);
+    if( divisor->kind != SSA_CONST ) {
+        return true;
+    }
+    if( is_float ) {
+        float b = divisor->u.constant.u._float;
+        return (b < 1.0f && b > -2.0f) || b > 2147483520.0f || b < -2147483520.0f;
+    }
+    return divisor->u.constant.type == AST_VALUE_CHAR
+        ? divisor->u.constant.u._char == 0
+        : divisor->u.constant.u._int == 0;
+}
+
+bool ssa_is_literal_array(ssa_value_t* value) {
+    if( value->kind != SSA_ARRAY ) {
+        return false;
+    }
+    for(uint32_t i = 0; i < value->argc; i++) {
+        ssa_value_t* arg = ssa_resolve(value->args[i]);
+        if( arg->kind != SSA_CONST && ssa_is_literal_array(arg) == false ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// values that have to stay even if the result isn't used
+static bool ssa_has_effect(ssa_value_t* value) {
+    switch(value->kind) {
+        case SSA_CALL:
+        case SSA_CALL_NATIVE:
+        case SSA_ITER:
+        case SSA_ELEM:
+            return true;
+        default:
+            return ssa_may_trap(value);
+    }
+}
+
+// reverse postorder of the reachable blocks (returns their count),
+// sets rpo of the blocks (SSA_NO_RPO if unreachable)
+static uint32_t ssa_order(ssa_func_t* func, ssa_block_t** order) {
+    uint32_t n = func->block_count;
+    bool* visited = (bool*) aalloc(func->arena, sizeof(bool) * n);
+    ssa_block_t** stack = (ssa_block_t**) aalloc(func->arena, sizeof(ssa_block_t*) * n);
+    uint32_t* next = (uint32_t*) aalloc(func->arena, sizeof(uint32_t) * n);
+    ssa_block_t** post = (ssa_block_t**) aalloc(func->arena, sizeof(ssa_block_t*) * n);
+    uint32_t top = 0;
+    uint32_t count = 0;
+
+    for(uint32_t i = 0; i < n; i++) {
+        func->blocks[i]->rpo = SSA_NO_RPO;
+    }
+    stack[top++] = func->blocks[0];
+    visited[0] = true;
+    while( top > 0 ) {
+        ssa_block_t* block = stack[top - 1];
+        if( next[block->id] < ssa_succ_count(block) ) {
+            ssa_block_t* succ = block->succs[next[block->id]++];
+            if( visited[succ->id] == false ) {
+                visited[succ->id] = true;
+                stack[top++] = succ;
+            }
+        } else {
+            post[count++] = block;
+            top--;
+        }
+    }
+    for(uint32_t i = 0; i < count; i++) {
+        order[i] = post[count - 1 - i];
+        order[i]->rpo = i;
+    }
+    return count;
+}
+
+static ssa_block_t* ssa_intersect(ssa_block_t* a, ssa_block_t* b) {
+    while( a != b ) {
+        while( a->rpo > b->rpo ) {
+            a = a->idom;
+        }
+        while( b->rpo > a->rpo ) {
+            b = b->idom;
+        }
+    }
+    return a;
+}
+
+// immediate dominators (Cooper, Harvey and Kennedy)
+static void ssa_compute_dominators(ssa_func_t* func, ssa_block_t** order, uint32_t count) {
+    for(uint32_t i = 0; i < func->block_count; i++) {
+        func->blocks[i]->idom = NULL;
+    }
+    order[0]->idom = order[0];
+    bool changed = true;
+    while( changed ) {
+        changed = false;
+        for(uint32_t i = 1; i < count; i++) {
+            ssa_block_t* block = order[i];
+            ssa_block_t* idom = NULL;
+            for(uint32_t j = 0; j < block->pred_count; j++) {
+                ssa_block_t* pred = block->preds[j];
+                if( pred->idom == NULL ) {
+                    continue;
+                }
+                idom = idom == NULL ? pred : ssa_intersect(pred, idom);
+            }
+            if( block->idom != idom ) {
+                block->idom = idom;
+                changed = true;
+            }
+        }
+    }
+}
+
+static bool ssa_dominates(ssa_block_t* a, ssa_block_t* b) {
+    while( b != a ) {
+        if( b->idom == b || b->idom == NULL ) {
+            return false;
+        }
+        b = b->idom;
+    }
+    return true;
+}
+
+static void ssa_remove_pred(ssa_block_t* block, ssa_block_t* pred) {
+    uint32_t i = 0;
+    while( i < block->pred_count ) {
+        if( block->preds[i] != pred ) {
+            i++;
+            continue;
+        }
+        for(uint32_t j = i + 1; j < block->pred_count; j++) {
+            block->preds[j - 1] = block->preds[j];
+        }
+        block->pred_count--;
+        for(uint32_t p = 0; p < block->phi_count; p++) {
+            ssa_value_t* phi = block->phis[p];
+            for(uint32_t j = i + 1; j < phi->argc; j++) {
+                phi->args[j - 1] = phi->args[j];
+            }
+            phi->argc--;
+        }
+    }
+}
+
+static uint32_t ssa_remove_unreachable(ssa_func_t* func) {
+    ssa_block_t** order = (ssa_block_t**) aalloc(func->arena,
+        sizeof(ssa_block_t*) * func->block_count);
+    uint32_t count = ssa_order(func, order);
+    if( count == func->block_count ) {
+        return 0;
+    }
+    for(uint32_t i = 0; i < func->block_count; i++) {
+        ssa_block_t* block = func->blocks[i];
+        if( block->rpo != SSA_NO_RPO ) {
+            continue;
+        }
+        for(uint32_t s = 0; s < ssa_succ_count(block); s++) {
+            ssa_remove_pred(block->succs[s], block);
+        }
+    }
+    uint32_t kept = 0;
+    for(uint32_t i = 0; i < func->block_count; i++) {
+        ssa_block_t* block = func->blocks[i];
+        if( block->rpo != SSA_NO_RPO ) {
+            block->id = kept;
+            func->blocks[kept++] = block;
+        }
+    }
+    uint32_t removed = func->block_count - kept;
+    func->block_count = kept;
+    return removed;
+}
+
+// points the args at the replacing values and drops
+// the replaced values from the blocks
+static void ssa_update(ssa_func_t* func) {
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        uint32_t kept = 0;
+        for(uint32_t i = 0; i < block->phi_count; i++) {
+            ssa_value_t* phi = block->phis[i];
+            if( phi->replaced == NULL ) {
+                block->phis[kept++] = phi;
+            }
+        }
+        block->phi_count = kept;
+        kept = 0;
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            ssa_value_t* value = block->values[i];
+            if( value->replaced == NULL ) {
+                block->values[kept++] = value;
+            }
+        }
+        block->value_count = kept;
+    }
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        for(uint32_t i = 0; i < block->phi_count; i++) {
+            ssa_value_t* phi = block->phis[i];
+            for(uint32_t a = 0; a < phi->argc; a++) {
+                phi->args[a] = ssa_resolve(phi->args[a]);
+            }
+        }
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            ssa_value_t* value = block->values[i];
+            for(uint32_t a = 0; a < value->argc; a++) {
+                value->args[a] = ssa_resolve(value->args[a]);
+            }
+        }
+        block->term_value = ssa_resolve(block->term_value);
+    }
+}
+
+static uint32_t ssa_live_value_count(ssa_func_t* func) {
+    uint32_t count = 0;
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        count += func->blocks[b]->phi_count + func->blocks[b]->value_count;
+    }
+    return count;
+}
+
+bool ssa_uses_undef(ssa_func_t* func) {
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        for(uint32_t i = 0; i < block->phi_count; i++) {
+            for(uint32_t a = 0; a < block->phis[i]->argc; a++) {
+                if( ssa_resolve(block->phis[i]->args[a])->kind == SSA_UNDEF ) {
+                    return true;
+                }
+            }
+        }
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            for(uint32_t a = 0; a < block->values[i]->argc; a++) {
+                if( ssa_resolve(block->values[i]->args[a])->kind == SSA_UNDEF ) {
+                    return true;
+                }
+            }
+        }
+        ssa_value_t* term_value = ssa_resolve(block->term_value);
+        if( term_value != NULL && term_value->kind == SSA_UNDEF ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Loops
+
+typedef struct ssa_loop_t {
+    ssa_block_t*    header;
+    ssa_block_t*    preheader;  // the only predecessor outside of the loop
+    ssa_block_t*    latch;      // the block that jumps back
+    bool*           body;       // by block id, includes the header
+} ssa_loop_t;
+
+// the natural loops with a preheader and a single back edge,
+// inner loops come first
+static uint32_t ssa_find_loops(ssa_func_t* func, ssa_loop_t** loops_out) {
+    uint32_t n = func->block_count;
+    ssa_block_t** order = (ssa_block_t**) aalloc(func->arena, sizeof(ssa_block_t*) * n);
+    uint32_t count = ssa_order(func, order);
+    ssa_compute_dominators(func, order, count);
+
+    ssa_loop_t* loops = (ssa_loop_t*) aalloc(func->arena, sizeof(ssa_loop_t) * n);
+    ssa_block_t** work = (ssa_block_t**) aalloc(func->arena, sizeof(ssa_block_t*) * n);
+    uint32_t loop_count = 0;
+
+    // headers in reverse postorder: inner loops are found last
+    for(uint32_t i = 0; i < count; i++) {
+        ssa_block_t* header = order[i];
+        if( header->pred_count != 2 ) {
+            continue;
+        }
+        ssa_block_t* latch = NULL;
+        ssa_block_t* preheader = NULL;
+        for(uint32_t p = 0; p < 2; p++) {
+            if( ssa_dominates(header, header->preds[p]) ) {
+                latch = header->preds[p];
+            } else {
+                preheader = header->preds[p];
+            }
+        }
+        if( latch == NULL || preheader == NULL || preheader->term != SSA_TERM_JUMP ) {
+            continue;
+        }
+        bool* body = (bool*) aalloc(func->arena, sizeof(bool) * n);
+        uint32_t top = 0;
+        body[header->id] = true;
+        work[top++] = latch;
+        while( top > 0 ) {
+            ssa_block_t* block = work[--top];
+            if( body[block->id] ) {
+                continue;
+            }
+            body[block->id] = true;
+            for(uint32_t p = 0; p < block->pred_count; p++) {
+                work[top++] = block->preds[p];
+            }
+        }
+        loops[loop_count++] = (ssa_loop_t) {
+            .header = header,
+            .preheader = preheader,
+            .latch = latch,
+            .body = body
+        };
+    }
+    for(uint32_t i = 0; i < loop_count / 2; i++) {
+        ssa_loop_t tmp = loops[i];
+        loops[i] = loops[loop_count - 1 - i];
+        loops[loop_count - 1 - i] = tmp;
+    }
+    *loops_out = loops;
+    return loop_count;
+}
+
+// Passes
+
+uint32_t ssa_propagate_copies(ssa_func_t* func) {
+    uint32_t removed = 0;
+    bool changed = true;
+    while( changed ) {
+        changed = false;
+        for(uint32_t b = 0; b < func->block_count; b++) {
+            ssa_block_t* block = func->blocks[b];
+            for(uint32_t i = 0; i < block->phi_count; i++) {
+                ssa_value_t* phi = block->phis[i];
+                ssa_value_t* same = NULL;
+                if( phi->replaced == NULL && ssa_phi_is_trivial(phi, &same) && same != NULL ) {
+                    phi->replaced = same;
+                    removed++;
+                    changed = true;
+                }
+            }
+        }
+    }
+    ssa_update(func);
+    return removed;
+}
+
+static bool ssa_is_int(ssa_value_t* value, int32_t n) {
+    return value->kind == SSA_CONST
+        && value->u.constant.type == AST_VALUE_INT
+        && value->u.constant.u._int == n;
+}
+
+static bool ssa_is_int_const(ssa_value_t* value) {
+    return value->kind == SSA_CONST
+        && value->u.constant.type == AST_VALUE_INT;
+}
+
+static bool ssa_is_float(ssa_value_t* value, float f) {
+    return value->kind == SSA_CONST
+        && value->u.constant.type == AST_VALUE_FLOAT
+        && value->u.constant.u._float == f;
+}
+
+static bool ssa_is_bool(ssa_value_t* value, bool b) {
+    return value->kind == SSA_CONST
+        && value->u.constant.type == AST_VALUE_BOOL
+        && value->u.constant.u._bool == b;
+}
+
+// x * 2 => x + x
+static ssa_value_t* ssa_rewrite_as_add(ssa_value_t* value, ssa_value_t* operand) {
+    value->u.binop = AST_BIN_ADD;
+    value->args[0] = operand;
+    value->args[1] = operand;
+    return value;
+}
+
+// the value that replaces a binary operation (NULL if none),
+// the result is value itself if it was rewritten in place
+static ssa_value_t* ssa_simplified_binop(ssa_func_t* func, ssa_value_t* value) {
+    ssa_value_t* left = value->args[0];
+    ssa_value_t* right = value->args[1];
+    ast_value_t folded;
+    if( left->kind == SSA_CONST && right->kind == SSA_CONST
+        && fold_binop_values(value->u.binop, left->u.constant, right->u.constant, &folded) ) {
+        return ssa_const(func, folded);
+    }
+    if( value->optype == SSA_TY_INT ) {
+        switch(value->u.binop) {
+            case AST_BIN_ADD: {
+                if( ssa_is_int(right, 0) ) return left;
+                if( ssa_is_int(left, 0) ) return right;
+            } break;
+            case AST_BIN_SUB: {
+                if( ssa_is_int(right, 0) ) return left;
+            } break;
+            case AST_BIN_MUL: {
+                if( ssa_is_int(right, 1) ) return left;
+                if( ssa_is_int(left, 1) ) return right;
+                if( ssa_is_int(right, 0) || ssa_is_int(left, 0) ) return ssa_const_int(func, 0);
+                if( ssa_is_int(right, 2) ) return ssa_rewrite_as_add(value, left);
+                if( ssa_is_int(left, 2) ) return ssa_rewrite_as_add(value, right);
+            } break;
+            case AST_BIN_DIV: {
+                if( ssa_is_int(right, 1) ) return left;
+            } break;
+            default: break;
+        }
+    } else if( value->optype == SSA_TY_FLOAT && value->u.binop == AST_BIN_MUL ) {
+        if( ssa_is_float(right, 1.0f) ) return left;
+        if( ssa_is_float(left, 1.0f) ) return right;
+        if( ssa_is_float(right, 2.0f) ) return ssa_rewrite_as_add(value, left);
+        if( ssa_is_float(left, 2.0f) ) return ssa_rewrite_as_add(value, right);
+    } else if( value->u.binop == AST_BIN_AND ) {
+        if( ssa_is_bool(right, true) ) return left;
+        if( ssa_is_bool(left, true) ) return right;
+        if( ssa_is_bool(right, false) || ssa_is_bool(left, false) ) return ssa_const_bool(func, false);
+    } else if( value->u.binop == AST_BIN_OR ) {
+        if( ssa_is_bool(right, false) ) return left;
+        if( ssa_is_bool(left, false) ) return right;
+        if( ssa_is_bool(right, true) || ssa_is_bool(left, true) ) return ssa_const_bool(func, true);
+    }
+    return NULL;
+}
+
+static ssa_value_t* ssa_simplified(ssa_func_t* func, ssa_value_t* value) {
+    ast_value_t folded;
+    switch(value->kind) {
+        case SSA_BINOP: {
+            // an operand only replaces a result of the same
+            // type (char + 0 is an int)
+            ssa_value_t* replacement = ssa_simplified_binop(func, value);
+            if( replacement != NULL && replacement->type != value->type ) {
+                return NULL;
+            }
+            return replacement;
+        }
+        case SSA_UNOP: {
+            ssa_value_t* inner = value->args[0];
+            if( inner->kind == SSA_CONST
+                && fold_unop_value(value->u.unop, inner->u.constant, &folded) ) {
+                return ssa_const(func, folded);
+            }
+            // not not x, - - x (chars become ints when negated)
+            if( inner->kind == SSA_UNOP && inner->u.unop == value->u.unop
+                && inner->args[0]->type == value->type ) {
+                return inner->args[0];
+            }
+        } break;
+        case SSA_TO_FLOAT: {
+            ssa_value_t* inner = value->args[0];
+            if( inner->kind == SSA_CONST ) {
+                ast_value_t c = inner->u.constant;
+                return ssa_const(func, (ast_value_t) {
+                    .type = AST_VALUE_FLOAT,
+                    .u._float = c.type == AST_VALUE_CHAR ? (float) c.u._char : (float) c.u._int
+                });
+            }
+        } break;
+        default: break;
+    }
+    return NULL;
+}
+
+uint32_t ssa_simplify(ssa_func_t* func) {
+    uint32_t simplified = 0;
+    ssa_block_t** order = (ssa_block_t**) aalloc(func->arena,
+        sizeof(ssa_block_t*) * func->block_count);
+    uint32_t count = ssa_order(func, order);
+
+    // the operands are simplified first (except for phis)
+    for(uint32_t b = 0; b < count; b++) {
+        ssa_block_t* block = order[b];
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            ssa_value_t* value = block->values[i];
+            for(uint32_t a = 0; a < value->argc; a++) {
+                value->args[a] = ssa_resolve(value->args[a]);
+            }
+            ssa_value_t* replacement = ssa_simplified(func, value);
+            if( replacement == NULL ) {
+                continue;
+            }
+            if( replacement != value ) {
+                value->replaced = replacement;
+            }
+            simplified++;
+        }
+        ssa_value_t* cond = ssa_resolve(block->term_value);
+        if( block->term == SSA_TERM_BRANCH && cond->kind == SSA_CONST ) {
+            bool taken = cond->u.constant.u._bool;
+            ssa_remove_pred(block->succs[taken ? 1 : 0], block);
+            block->succs[0] = block->succs[taken ? 0 : 1];
+            block->succs[1] = NULL;
+            block->term = SSA_TERM_JUMP;
+            block->term_value = NULL;
+            simplified++;
+        }
+    }
+    ssa_update(func);
+    ssa_remove_unreachable(func);
+    return simplified;
+}
+
+static bool ssa_same_value(ssa_value_t* a, ssa_value_t* b) {
+    if( a == b ) {
+        return true;
+    }
+    if( a->kind != SSA_CONST || b->kind != SSA_CONST
+        || a->u.constant.type != b->u.constant.type ) {
+        return false;
+    }
+    switch(a->u.constant.type) {
+        case AST_VALUE_INT:     return a->u.constant.u._int == b->u.constant.u._int;
+        case AST_VALUE_CHAR:    return a->u.constant.u._char == b->u.constant.u._char;
+        case AST_VALUE_BOOL:    return a->u.constant.u._bool == b->u.constant.u._bool;
+        case AST_VALUE_FLOAT:   return a->u.constant.u._float == b->u.constant.u._float;
+        default:                return false;
+    }
+}
+
+static bool ssa_is_commutative(ast_binop_type_t op) {
+    switch(op) {
+        case AST_BIN_ADD:
+        case AST_BIN_MUL:
+        case AST_BIN_EQ:
+        case AST_BIN_NEQ:
+        case AST_BIN_AND:
+        case AST_BIN_OR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool ssa_same_operation(ssa_value_t* a, ssa_value_t* b) {
+    if( a->kind != b->kind || a->type != b->type || a->optype != b->optype ) {
+        return false;
+    }
+    switch(a->kind) {
+        case SSA_BINOP: {
+            if( a->u.binop != b->u.binop ) {
+                return false;
+            }
+            if( ssa_same_value(a->args[0], b->args[0]) && ssa_same_value(a->args[1], b->args[1]) ) {
+                return true;
+            }
+            return ssa_is_commutative(a->u.binop)
+                && ssa_same_value(a->args[0], b->args[1])
+                && ssa_same_value(a->args[1], b->args[0]);
+        }
+        case SSA_UNOP: {
+            return a->u.unop == b->u.unop && ssa_same_value(a->args[0], b->args[0]);
+        }
+        case SSA_TO_FLOAT: {
+            return ssa_same_value(a->args[0], b->args[0]);
+        }
+        default:
+            return false;
+    }
+}
+
+static bool ssa_is_pure_operation(ssa_value_t* value) {
+    return value->kind == SSA_BINOP
+        || value->kind == SSA_UNOP
+        || value->kind == SSA_TO_FLOAT;
+}
+
+uint32_t ssa_eliminate_common(ssa_func_t* func) {
+    uint32_t removed = 0;
+    ssa_block_t** order = (ssa_block_t**) aalloc(func->arena,
+        sizeof(ssa_block_t*) * func->block_count);
+    uint32_t count = ssa_order(func, order);
+    ssa_compute_dominators(func, order, count);
+
+    // an operation is replaced by an earlier one in a dominating
+    // block (a trapping one has trapped there already)
+    ssa_value_t** seen = (ssa_value_t**) aalloc(func->arena,
+        sizeof(ssa_value_t*) * func->value_count);
+    uint32_t seen_count = 0;
+    for(uint32_t b = 0; b < count; b++) {
+        ssa_block_t* block = order[b];
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            ssa_value_t* value = block->values[i];
+            if( ssa_is_pure_operation(value) == false ) {
+                continue;
+            }
+            for(uint32_t a = 0; a < value->argc; a++) {
+                value->args[a] = ssa_resolve(value->args[a]);
+            }
+            for(uint32_t j = 0; j < seen_count; j++) {
+                if( ssa_same_operation(seen[j], value) && ssa_dominates(seen[j]->block, block) ) {
+                    value->replaced = seen[j];
+                    removed++;
+                    break;
+                }
+            }
+            if( value->replaced == NULL ) {
+                seen[seen_count++] = value;
+            }
+        }
+    }
+    ssa_update(func);
+    return removed;
+}
+
+static bool ssa_is_invariant(ssa_value_t* value, ssa_loop_t* loop) {
+    if( ssa_is_pure_operation(value) == false || ssa_may_trap(value) ) {
+        return false;
+    }
+    for(uint32_t a = 0; a < value->argc; a++) {
+        ssa_block_t* block = ssa_resolve(value->args[a])->block;
+        if( block != NULL && loop->body[block->id] ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t ssa_hoist_invariants(ssa_func_t* func) {
+    uint32_t hoisted = 0;
+    ssa_loop_t* loops = NULL;
+    uint32_t loop_count = ssa_find_loops(func, &loops);
+
+    // inner loops first, the values moved to the preheader
+    // of an inner loop can move on to the outer preheader
+    for(uint32_t l = 0; l < loop_count; l++) {
+        ssa_loop_t* loop = &loops[l];
+        bool changed = true;
+        while( changed ) {
+            changed = false;
+            for(uint32_t b = 0; b < func->block_count; b++) {
+                ssa_block_t* block = func->blocks[b];
+                if( loop->body[block->id] == false ) {
+                    continue;
+                }
+                uint32_t kept = 0;
+                for(uint32_t i = 0; i < block->value_count; i++) {
+                    ssa_value_t* value = block->values[i];
+                    if( ssa_is_invariant(value, loop) ) {
+                        ssa_append_before_iter(func, loop->preheader, value);
+                        hoisted++;
+                        changed = true;
+                    } else {
+                        block->values[kept++] = value;
+                    }
+                }
+                block->value_count = kept;
+            }
+        }
+    }
+    return hoisted;
+}
+
+// step of phi = phi(init, phi + step)
+static bool ssa_induction_step(ssa_value_t* phi, ssa_value_t* next, int32_t* step) {
+    if( next->kind != SSA_BINOP || next->optype != SSA_TY_INT ) {
+        return false;
+    }
+    ssa_value_t* left = ssa_resolve(next->args[0]);
+    ssa_value_t* right = ssa_resolve(next->args[1]);
+    if( next->u.binop == AST_BIN_ADD ) {
+        if( left == phi && ssa_is_int_const(right) ) {
+            *step = right->u.constant.u._int;
+            return true;
+        }
+        if( right == phi && ssa_is_int_const(left) ) {
+            *step = left->u.constant.u._int;
+            return true;
+        }
+    } else if( next->u.binop == AST_BIN_SUB ) {
+        if( left == phi && ssa_is_int_const(right) ) {
+            *step = (int32_t) (0u - (uint32_t) right->u.constant.u._int);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t ssa_reduce_strength(ssa_func_t* func) {
+    uint32_t reduced = 0;
+    ssa_loop_t* loops = NULL;
+    uint32_t loop_count = ssa_find_loops(func, &loops);
+
+    // phi * k, where phi = phi(init, phi + step), becomes the
+    // new induction variable q = phi(init * k, q + step * k)
+    for(uint32_t l = 0; l < loop_count; l++) {
+        ssa_loop_t* loop = &loops[l];
+        ssa_block_t* header = loop->header;
+        uint32_t init_index = ssa_pred_index(header, loop->preheader);
+        uint32_t next_index = ssa_pred_index(header, loop->latch);
+        uint32_t phi_count = header->phi_count;
+        for(uint32_t p = 0; p < phi_count; p++) {
+            ssa_value_t* phi = header->phis[p];
+            int32_t step = 0;
+            if( phi->type != SSA_TY_INT
+                || ssa_induction_step(phi, ssa_resolve(phi->args[next_index]), &step) == false ) {
+                continue;
+            }
+            for(uint32_t b = 0; b < func->block_count; b++) {
+                ssa_block_t* block = func->blocks[b];
+                if( loop->body[block->id] == false ) {
+                    continue;
+                }
+                for(uint32_t i = 0; i < block->value_count; i++) {
+                    ssa_value_t* value = block->values[i];
+                    if( value->replaced != NULL || value->kind != SSA_BINOP
+                        || value->optype != SSA_TY_INT || value->u.binop != AST_BIN_MUL ) {
+                        continue;
+                    }
+                    ssa_value_t* left = ssa_resolve(value->args[0]);
+                    ssa_value_t* right = ssa_resolve(value->args[1]);
+                    ssa_value_t* factor = left == phi ? right : right == phi ? left : NULL;
+                    if( factor == NULL || ssa_is_int_const(factor) == false ) {
+                        continue;
+                    }
+                    uint32_t k = (uint32_t) factor->u.constant.u._int;
+                    ssa_value_t* init = ssa_binop_create(func, AST_BIN_MUL, SSA_TY_INT,
+                        phi->args[init_index], factor);
+                    ssa_append_before_iter(func, loop->preheader, init);
+                    ssa_value_t* q = ssa_phi_create(func, header, SSA_TY_INT);
+                    ssa_value_t* next = ssa_binop_create(func, AST_BIN_ADD, SSA_TY_INT, q,
+                        ssa_const_int(func, (int32_t) ((uint32_t) step * k)));
+                    ssa_append(func, loop->latch, next);
+                    q->argc = header->pred_count;
+                    q->args = (ssa_value_t**) aalloc(func->arena, sizeof(ssa_value_t*) * q->argc);
+                    q->args[init_index] = init;
+                    q->args[next_index] = next;
+                    value->replaced = q;
+                    reduced++;
+                }
+            }
+        }
+    }
+    ssa_update(func);
+    return reduced;
+}
+
+uint32_t ssa_eliminate_dead_code(ssa_func_t* func) {
+    bool* live = (bool*) aalloc(func->arena, sizeof(bool) * func->value_count);
+    ssa_value_t** work = (ssa_value_t**) aalloc(func->arena,
+        sizeof(ssa_value_t*) * func->value_count);
+    uint32_t top = 0;
+
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            ssa_value_t* value = block->values[i];
+            if( ssa_has_effect(value) ) {
+                live[value->id] = true;
+                work[top++] = value;
+            }
+        }
+        ssa_value_t* term_value = block->term_value;
+        if( term_value != NULL && live[term_value->id] == false ) {
+            live[term_value->id] = true;
+            work[top++] = term_value;
+        }
+    }
+    while( top > 0 ) {
+        ssa_value_t* value = work[--top];
+        for(uint32_t a = 0; a < value->argc; a++) {
+            ssa_value_t* arg = value->args[a];
+            if( live[arg->id] == false ) {
+                live[arg->id] = true;
+                work[top++] = arg;
+            }
+        }
+    }
+
+    uint32_t removed = 0;
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        uint32_t kept = 0;
+        for(uint32_t i = 0; i < block->phi_count; i++) {
+            if( live[block->phis[i]->id] ) {
+                block->phis[kept++] = block->phis[i];
+            }
+        }
+        removed += block->phi_count - kept;
+        block->phi_count = kept;
+        kept = 0;
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            if( live[block->values[i]->id] ) {
+                block->values[kept++] = block->values[i];
+            }
+        }
+        removed += block->value_count - kept;
+        block->value_count = kept;
+    }
+    return removed;
+}
+
+uint32_t ssa_optimize(ssa_func_t* func) {
+    ssa_remove_unreachable(func);
+    ssa_update(func);
+    uint32_t before = ssa_live_value_count(func);
+    ssa_propagate_copies(func);
+    ssa_simplify(func);
+    ssa_propagate_copies(func);
+    ssa_eliminate_common(func);
+    ssa_hoist_invariants(func);
+    ssa_reduce_strength(func);
+    ssa_simplify(func);
+    ssa_propagate_copies(func);
+    ssa_eliminate_common(func);
+    ssa_eliminate_dead_code(func);
+    uint32_t after = ssa_live_value_count(func);
+    return before > after ? before - after : 0;
+}
+
+// Lowering
+
+static void ssa_note_use(ssa_value_t* value, ssa_value_t* user, ssa_block_t* block, uint32_t pos) {
+    value->uses++;
+    value->user = user;
+    value->user_block = block;
+    value->user_pos = pos;
+}
+
+static bool ssa_can_inline(ssa_value_t* value) {
+    switch(value->kind) {
+        case SSA_BINOP:
+        case SSA_UNOP:
+        case SSA_TO_FLOAT:
+        case SSA_CALL:
+        case SSA_CALL_NATIVE:
+        case SSA_ARRAY:
+            return value->uses == 1
+                && value->user_block == value->block
+                && value->type != SSA_TY_NONE;
+        default:
+            return false;
+    }
+}
+
+// calls and trapping operations keep their order
+static bool ssa_is_ordered(ssa_value_t* value) {
+    return value->kind == SSA_CALL
+        || value->kind == SSA_CALL_NATIVE
+        || ssa_may_trap(value);
+}
+
+// the instruction an inlined value is evaluated in: a value in the
+// block, a phi (copy at the end) or NULL for the terminator
+static ssa_value_t* ssa_inline_root(ssa_value_t* value, uint32_t* pos) {
+    while( true ) {
+        ssa_value_t* user = value->user;
+        if( user == NULL || user->kind == SSA_PHI ) {
+            *pos = value->user_pos;
+            return user;
+        }
+        if( user->inlined == false ) {
+            *pos = user->pos;
+            return user;
+        }
+        value = user;
+    }
+}
+
+static bool ssa_needs_slot(ssa_value_t* value) {
+    switch(value->kind) {
+        case SSA_PARAM:
+        case SSA_PHI:
+            return true;
+        case SSA_CONST:
+        case SSA_UNDEF:
+        case SSA_ITER:
+            return false;
+        default:
+            return value->inlined == false && value->uses > 0
+                && value->type != SSA_TY_NONE;
+    }
+}
+
+typedef struct ssa_liveness_t {
+    uint32_t    words;      // per set
+    uint32_t*   use;        // read before written in the block
+    uint32_t*   def;
+    uint32_t*   in;
+    uint32_t*   out;
+    uint32_t*   start;      // interval of each value
+    uint32_t*   end;
+} ssa_liveness_t;
+
+#define SSA_SET(SET, LV, B)       ((SET) + (size_t) (B) * (LV)->words)
+#define SSA_SET_HAS(S, I)         (((S)[(I) / 32] >> ((I) % 32)) & 1u)
+#define SSA_SET_ADD(S, I)         ((S)[(I) / 32] |= 1u << ((I) % 32))
+
+static void ssa_extend(ssa_liveness_t* lv, ssa_value_t* value, uint32_t pos) {
+    if( pos < lv->start[value->id] ) {
+        lv->start[value->id] = pos;
+    }
+    if( pos > lv->end[value->id] ) {
+        lv->end[value->id] = pos;
+    }
+}
+
+// the slots read when the tree of value is evaluated at pos
+static void ssa_read_tree(ssa_liveness_t* lv, ssa_block_t* block, ssa_value_t* value, uint32_t pos) {
+    for(uint32_t a = 0; a < value->argc; a++) {
+        ssa_value_t* arg = value->args[a];
+        if( arg->inlined ) {
+            ssa_read_tree(lv, block, arg, pos);
+        } else if( ssa_needs_slot(arg) ) {
+            uint32_t* def = SSA_SET(lv->def, lv, block->id);
+            if( SSA_SET_HAS(def, arg->id) == false ) {
+                SSA_SET_ADD(SSA_SET(lv->use, lv, block->id), arg->id);
+            }
+            ssa_extend(lv, arg, pos);
+        }
+    }
+}
+
+static void ssa_read_value(ssa_liveness_t* lv, ssa_block_t* block, ssa_value_t* value, uint32_t pos) {
+    if( value->inlined ) {
+        ssa_read_tree(lv, block, value, pos);
+    } else if( ssa_needs_slot(value) ) {
+        uint32_t* def = SSA_SET(lv->def, lv, block->id);
+        if( SSA_SET_HAS(def, value->id) == false ) {
+            SSA_SET_ADD(SSA_SET(lv->use, lv, block->id), value->id);
+        }
+        ssa_extend(lv, value, pos);
+    }
+}
+
+static void ssa_compute_liveness(ssa_func_t* func, ssa_liveness_t* lv) {
+    uint32_t words = (func->value_count + 31) / 32;
+    size_t set_size = sizeof(uint32_t) * words * func->block_count;
+    lv->words = words;
+    lv->use = (uint32_t*) aalloc(func->arena, (ptrdiff_t) set_size);
+    lv->def = (uint32_t*) aalloc(func->arena, (ptrdiff_t) set_size);
+    lv->in = (uint32_t*) aalloc(func->arena, (ptrdiff_t) set_size);
+    lv->out = (uint32_t*) aalloc(func->arena, (ptrdiff_t) set_size);
+    lv->start = (uint32_t*) aalloc(func->arena, sizeof(uint32_t) * func->value_count);
+    lv->end = (uint32_t*) aalloc(func->arena, sizeof(uint32_t) * func->value_count);
+    for(uint32_t i = 0; i < func->value_count; i++) {
+        lv->start[i] = UINT32_MAX;
+    }
+
+    // local reads and writes
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        uint32_t* def = SSA_SET(lv->def, lv, b);
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            ssa_value_t* value = block->values[i];
+            if( value->inlined ) {
+                continue;
+            }
+            ssa_read_tree(lv, block, value, value->pos);
+            if( ssa_needs_slot(value) ) {
+                SSA_SET_ADD(def, value->id);
+                ssa_extend(lv, value, value->pos);
+            }
+        }
+        if( block->term_value != NULL ) {
+            ssa_read_value(lv, block, block->term_value, block->end);
+        }
+        // phi copies: all args are read before the phis are written
+        for(uint32_t s = 0; s < ssa_succ_count(block); s++) {
+            ssa_block_t* succ = block->succs[s];
+            uint32_t index = ssa_pred_index(succ, block);
+            for(uint32_t p = 0; p < succ->phi_count; p++) {
+                ssa_read_value(lv, block, succ->phis[p]->args[index], block->end);
+            }
+        }
+        for(uint32_t s = 0; s < ssa_succ_count(block); s++) {
+            ssa_block_t* succ = block->succs[s];
+            for(uint32_t p = 0; p < succ->phi_count; p++) {
+                SSA_SET_ADD(def, succ->phis[p]->id);
+                ssa_extend(lv, succ->phis[p], block->end);
+            }
+        }
+    }
+
+    // in = use | (out - def), out = in of the successors
+    bool changed = true;
+    while( changed ) {
+        changed = false;
+        for(uint32_t b = func->block_count; b-- > 0;) {
+            ssa_block_t* block = func->blocks[b];
+            uint32_t* in = SSA_SET(lv->in, lv, b);
+            uint32_t* out = SSA_SET(lv->out, lv, b);
+            uint32_t* use = SSA_SET(lv->use, lv, b);
+            uint32_t* def = SSA_SET(lv->def, lv, b);
+            for(uint32_t w = 0; w < words; w++) {
+                uint32_t o = 0;
+                for(uint32_t s = 0; s < ssa_succ_count(block); s++) {
+                    o |= SSA_SET(lv->in, lv, block->succs[s]->id)[w];
+                }
+                uint32_t i = use[w] | (o & ~def[w]);
+                if( o != out[w] || i != in[w] ) {
+                    out[w] = o;
+                    in[w] = i;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        uint32_t* in = SSA_SET(lv->in, lv, b);
+        uint32_t* out = SSA_SET(lv->out, lv, b);
+        for(uint32_t i = 0; i < func->value_count; i++) {
+            if( SSA_SET_HAS(in, i) ) {
+                ssa_extend(lv, func->all[i], block->start);
+            }
+            if( SSA_SET_HAS(out, i) ) {
+                ssa_extend(lv, func->all[i], block->end);
+            }
+        }
+    }
+}
+
+// linear scan over the live intervals, params keep their slots
+static void ssa_assign_slots(ssa_func_t* func, ssa_liveness_t* lv) {
+    ssa_value_t** sorted = (ssa_value_t**) aalloc(func->arena,
+        sizeof(ssa_value_t*) * func->value_count);
+    uint32_t* busy_until = (uint32_t*) aalloc(func->arena,
+        sizeof(uint32_t) * (func->value_count + func->param_count));
+    uint32_t count = 0;
+    uint32_t slot_count = func->param_count;
+
+    for(uint32_t i = 0; i < func->value_count; i++) {
+        ssa_value_t* value = func->all[i];
+        if( value->kind == SSA_PARAM ) {
+            value->slot = (int32_t) value->u.index;
+            busy_until[value->slot] = lv->end[value->id];
+        } else if( lv->start[value->id] != UINT32_MAX ) {
+            // insertion by start
+            uint32_t j = count++;
+            while( j > 0 && lv->start[sorted[j - 1]->id] > lv->start[value->id] ) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = value;
+        }
+    }
+    for(uint32_t i = 0; i < count; i++) {
+        ssa_value_t* value = sorted[i];
+        uint32_t slot = 0;
+        while( slot < slot_count && busy_until[slot] >= lv->start[value->id] ) {
+            slot++;
+        }
+        if( slot == slot_count ) {
+            slot_count++;
+        }
+        value->slot = (int32_t) slot;
+        busy_until[slot] = lv->end[value->id];
+    }
+    func->slot_count = slot_count;
+}
+
+void ssa_prepare_lowering(ssa_func_t* func) {
+    ssa_update(func);
+
+    for(uint32_t i = 0; i < func->value_count; i++) {
+        ssa_value_t* value = func->all[i];
+        value->uses = 0;
+        value->user = NULL;
+        value->user_block = NULL;
+        value->inlined = false;
+        value->slot = -1;
+    }
+
+    // positions and uses
+    uint32_t pos = 0;
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        block->start = pos;
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            block->values[i]->pos = pos++;
+        }
+        block->end = pos++;
+    }
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            ssa_value_t* value = block->values[i];
+            for(uint32_t a = 0; a < value->argc; a++) {
+                ssa_note_use(value->args[a], value, block, value->pos);
+            }
+        }
+        if( block->term_value != NULL ) {
+            ssa_note_use(block->term_value, NULL, block, block->end);
+        }
+        for(uint32_t s = 0; s < ssa_succ_count(block); s++) {
+            ssa_block_t* succ = block->succs[s];
+            uint32_t index = ssa_pred_index(succ, block);
+            for(uint32_t p = 0; p < succ->phi_count; p++) {
+                ssa_note_use(succ->phis[p]->args[index], succ->phis[p], block, block->end);
+            }
+        }
+    }
+
+    // values used once in their block are evaluated where they
+    // are used, unless a call or trapping operation would be
+    // evaluated in a different order
+    for(uint32_t i = 0; i < func->value_count; i++) {
+        func->all[i]->inlined = ssa_can_inline(func->all[i]);
+    }
+    bool changed = true;
+    while( changed ) {
+        changed = false;
+        for(uint32_t b = 0; b < func->block_count; b++) {
+            ssa_block_t* block = func->blocks[b];
+            for(uint32_t i = 0; i < block->value_count; i++) {
+                ssa_value_t* value = block->values[i];
+                if( value->inlined == false || ssa_is_ordered(value) == false ) {
+                    continue;
+                }
+                uint32_t root_pos = 0;
+                ssa_value_t* root = ssa_inline_root(value, &root_pos);
+                for(uint32_t j = i + 1; j < block->value_count && block->values[j]->pos < root_pos; j++) {
+                    ssa_value_t* other = block->values[j];
+                    if( ssa_is_ordered(other) == false ) {
+                        continue;
+                    }
+                    uint32_t other_pos = 0;
+                    if( other->inlined == false || ssa_inline_root(other, &other_pos) != root ) {
+                        value->inlined = false;
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    ssa_liveness_t lv = { 0 };
+    ssa_compute_liveness(func, &lv);
+    for(uint32_t i = 0; i < func->value_count; i++) {
+        ssa_value_t* value = func->all[i];
+        if( value->kind == SSA_PARAM ) {
+            ssa_extend(&lv, value, 0);
+        }
+    }
+    ssa_assign_slots(func, &lv);
+}
+
+// Dump
+
+static const char* ssa_type_name(ssa_type_t type) {
+    switch(type) {
+        case SSA_TY_INT:    return "i";
+        case SSA_TY_CHAR:   return "c";
+        case SSA_TY_FLOAT:  return "f";
+        case SSA_TY_BOOL:   return "b";
+        case SSA_TY_REF:    return "r";
+        default:            return "-";
+    }
+}
+
+static void ssa_dump_operand(cstr_t str, ssa_value_t* value) {
+    value = ssa_resolve(value);
+    switch(value->kind) {
+        case SSA_CONST: {
+            ast_dump_value(str, value->u.constant);
+        } break;
+        case SSA_PARAM: {
+            cstr_append_fmt(str, "arg%u", value->u.index);
+        } break;
+        case SSA_UNDEF: {
+            cstr_append_fmt(str, "undef");
+        } break;
+        default: {
+            cstr_append_fmt(str, "v%u", value->id);
+        } break;
+    }
+}
+
+static void ssa_dump_value(cstr_t str, ssa_value_t* value) {
+    cstr_append_fmt(str, "  v%u.%s = ", value->id, ssa_type_name(value->type));
+    switch(value->kind) {
+        case SSA_PHI:           cstr_append_fmt(str, "phi"); break;
+        case SSA_BINOP:         cstr_append_fmt(str, "%s", ast_binop_type_as_string(value->u.binop)); break;
+        case SSA_UNOP:          cstr_append_fmt(str, "%s", ast_unop_type_as_string(value->u.unop)); break;
+        case SSA_TO_FLOAT:      cstr_append_fmt(str, "to-float"); break;
+        case SSA_CALL:          cstr_append_fmt(str, "call @%u", value->u.index); break;
+        case SSA_CALL_NATIVE:   cstr_append_fmt(str, "call-native %u", value->u.index); break;
+        case SSA_ARRAY:         cstr_append_fmt(str, "array"); break;
+        case SSA_ITER:          cstr_append_fmt(str, "iter"); break;
+        case SSA_ELEM:          cstr_append_fmt(str, "elem"); break;
+        default:                cstr_append_fmt(str, "?"); break;
+    }
+    for(uint32_t a = 0; a < value->argc; a++) {
+        cstr_append_fmt(str, " ");
+        ssa_dump_operand(str, value->args[a]);
+    }
+    if( value->slot >= 0 ) {
+        cstr_append_fmt(str, "  [%i]", value->slot);
+    } else if( value->inlined ) {
+        cstr_append_fmt(str, "  [inlined]");
+    }
+    cstr_append_fmt(str, "\n");
+}
+
+void ssa_dump(cstr_t str, ssa_func_t* func) {
+    for(uint32_t b = 0; b < func->block_count; b++) {
+        ssa_block_t* block = func->blocks[b];
+        cstr_append_fmt(str, "b%u:", block->id);
+        for(uint32_t p = 0; p < block->pred_count; p++) {
+            cstr_append_fmt(str, " <- b%u", block->preds[p]->id);
+        }
+        cstr_append_fmt(str, "\n");
+        for(uint32_t i = 0; i < block->phi_count; i++) {
+            ssa_dump_value(str, block->phis[i]);
+        }
+        for(uint32_t i = 0; i < block->value_count; i++) {
+            ssa_dump_value(str, block->values[i]);
+        }
+        switch(block->term) {
+            case SSA_TERM_JUMP: {
+                cstr_append_fmt(str, "  jump b%u\n", block->succs[0]->id);
+            } break;
+            case SSA_TERM_BRANCH: {
+                cstr_append_fmt(str, "  branch ");
+                ssa_dump_operand(str, block->term_value);
+                cstr_append_fmt(str, " b%u b%u\n", block->succs[0]->id, block->succs[1]->id);
+            } break;
+            case SSA_TERM_ITER: {
+                cstr_append_fmt(str, "  iter b%u b%u\n", block->succs[0]->id, block->succs[1]->id);
+            } break;
+            case SSA_TERM_RETURN: {
+                cstr_append_fmt(str, "  return");
+                if( block->term_value != NULL ) {
+                    cstr_append_fmt(str, " ");
+                    ssa_dump_operand(str, block->term_value);
+                }
+                cstr_append_fmt(str, "\n");
+            } break;
+            default: {
+                cstr_append_fmt(str, "  (no terminator)\n");
+            } break;
+        }
+    }
+}
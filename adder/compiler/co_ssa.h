@@ -0,0 +1,178 @@
+#ifndef CO_SSA_H_
+#define CO_SSA_H_
+
+#include "co_types.h"
+#include "sh_arena.h"
+#include "sh_utils.h"
+
+// Mid-level ir of a function in ssa form (used by the compiler at
+// opt_level 2). The compiler builds it from the checked ast with
+// ssa_read_var / ssa_write_var (Braun et al., simple and efficient
+// construction of ssa form), the variables are the local indices.
+// Every value has a static type, the operations are the ones of the
+// vm stack instructions. After ssa_optimize, ssa_prepare_lowering
+// decides which values are evaluated as expression trees on the
+// stack and gives the others a local slot.
+//
+// Blocks are kept in creation (layout) order, the compiler emits
+// them in that order. The compiler never adds an edge from a block
+// with several successors to a block with several predecessors, the
+// phi copies are emitted at the end of the predecessor.
+
+typedef enum ssa_kind_t {
+    SSA_CONST = 0,
+    SSA_PARAM,          // u.index: arg index
+    SSA_UNDEF,          // read of a variable that was never written
+    SSA_PHI,            // args: one value per predecessor
+    SSA_BINOP,          // args: left, right
+    SSA_UNOP,
+    SSA_TO_FLOAT,       // int or char to float
+    SSA_CALL,           // u.index: ir index of the function
+    SSA_CALL_NATIVE,    // u.index: host function index
+    SSA_ARRAY,          // args: the elements, u.index: val_type_t of a packed array
+    SSA_ITER,           // makes the iterator of the loop (stays on the stack)
+    SSA_ELEM            // the current element, first value of a loop body
+} ssa_kind_t;
+
+typedef enum ssa_type_t {
+    SSA_TY_NONE = 0,    // no value (void call)
+    SSA_TY_INT,
+    SSA_TY_CHAR,        // same representation as int
+    SSA_TY_FLOAT,
+    SSA_TY_BOOL,
+    SSA_TY_REF          // strings, lists and other heap values
+} ssa_type_t;
+
+typedef struct ssa_block_t ssa_block_t;
+typedef struct ssa_value_t ssa_value_t;
+
+typedef struct ssa_def_t {
+    uint32_t        var;
+    ssa_value_t*    value;
+} ssa_def_t;
+
+typedef struct ssa_value_t {
+    ssa_kind_t      kind;
+    ssa_type_t      type;       // type of the result
+    ssa_type_t      optype;     // operand type of binops and unops
+    uint32_t        id;
+    union {
+        ast_value_t         constant;
+        ast_binop_type_t    binop;
+        ast_unop_type_t     unop;
+        uint32_t            index;
+    } u;
+    uint32_t        argc;
+    ssa_value_t**   args;
+    ssa_block_t*    block;      // NULL for constants, params and undef
+    ssa_value_t*    replaced;   // the value that replaces this one
+    // lowering (ssa_prepare_lowering)
+    uint32_t        uses;
+    ssa_value_t*    user;       // the user if there is only one
+    ssa_block_t*    user_block; // block of that use
+    uint32_t        pos;        // position in the function
+    uint32_t        user_pos;
+    bool            inlined;    // evaluated where it is used
+    int32_t         slot;       // local slot (-1: none)
+} ssa_value_t;
+
+typedef enum ssa_term_t {
+    SSA_TERM_NONE = 0,
+    SSA_TERM_JUMP,      // succs[0]
+    SSA_TERM_BRANCH,    // value: condition, succs[0] if true, succs[1] if false
+    SSA_TERM_ITER,      // succs[0] next element, succs[1] done
+    SSA_TERM_RETURN     // value: NULL for none
+} ssa_term_t;
+
+typedef struct ssa_block_t {
+    uint32_t        id;
+    ssa_value_t**   phis;
+    uint32_t        phi_count;
+    uint32_t        phi_capacity;
+    ssa_value_t**   values;
+    uint32_t        value_count;
+    uint32_t        value_capacity;
+    ssa_block_t**   preds;
+    uint32_t        pred_count;
+    uint32_t        pred_capacity;
+    ssa_term_t      term;
+    ssa_value_t*    term_value;
+    ssa_block_t*    succs[2];
+    bool            sealed;
+    // construction
+    ssa_def_t*      defs;       // current value of the variables
+    uint32_t        def_count;
+    uint32_t        def_capacity;
+    ssa_def_t*      incomplete; // phis of an unsealed block
+    uint32_t        incomplete_count;
+    uint32_t        incomplete_capacity;
+    // analysis
+    ssa_block_t*    idom;
+    uint32_t        rpo;
+    uint32_t        start;      // position of the first value
+    uint32_t        end;        // position of the terminator
+} ssa_block_t;
+
+typedef struct ssa_func_t {
+    arena_t*        arena;
+    ssa_block_t**   blocks;     // layout order, blocks[0] is the entry
+    uint32_t        block_count;
+    uint32_t        block_capacity;
+    ssa_value_t**   all;        // every value created (id order)
+    uint32_t        value_count;
+    uint32_t        value_capacity;
+    uint32_t        param_count;
+    uint32_t        slot_count; // params included
+} ssa_func_t;
+
+ssa_func_t*     ssa_func_create(arena_t* arena, uint32_t param_count);
+ssa_block_t*    ssa_block_create(ssa_func_t* func);
+// moves the block to the end of the layout
+void            ssa_block_move_last(ssa_func_t* func, ssa_block_t* block);
+
+ssa_value_t*    ssa_const(ssa_func_t* func, ast_value_t value);
+ssa_value_t*    ssa_param(ssa_func_t* func, uint32_t index, ssa_type_t type);
+// appends an operation to the block, args are copied
+ssa_value_t*    ssa_emit(ssa_func_t* func, ssa_block_t* block, ssa_kind_t kind,
+                         ssa_type_t type, uint32_t argc, ssa_value_t** args);
+ssa_value_t*    ssa_emit_binop(ssa_func_t* func, ssa_block_t* block, ast_binop_type_t op,
+                               ssa_type_t optype, ssa_value_t* left, ssa_value_t* right);
+ssa_value_t*    ssa_emit_unop(ssa_func_t* func, ssa_block_t* block, ast_unop_type_t op,
+                              ssa_type_t optype, ssa_value_t* inner);
+
+void            ssa_write_var(ssa_func_t* func, ssa_block_t* block, uint32_t var, ssa_value_t* value);
+ssa_value_t*    ssa_read_var(ssa_func_t* func, ssa_block_t* block, uint32_t var, ssa_type_t type);
+// no predecessors are added to a sealed block
+void            ssa_seal(ssa_func_t* func, ssa_block_t* block);
+
+void            ssa_jump(ssa_func_t* func, ssa_block_t* from, ssa_block_t* to);
+void            ssa_branch(ssa_func_t* func, ssa_block_t* from, ssa_value_t* cond,
+                           ssa_block_t* iftrue, ssa_block_t* iffalse);
+void            ssa_iterate(ssa_func_t* func, ssa_block_t* from, ssa_block_t* next, ssa_block_t* done);
+void            ssa_return(ssa_func_t* func, ssa_block_t* from, ssa_value_t* value);
+
+ssa_value_t*    ssa_resolve(ssa_value_t* value);
+
+// the passes return the number of values they removed or replaced
+uint32_t        ssa_propagate_copies(ssa_func_t* func);
+uint32_t        ssa_simplify(ssa_func_t* func);
+uint32_t        ssa_eliminate_common(ssa_func_t* func);
+uint32_t        ssa_hoist_invariants(ssa_func_t* func);
+uint32_t        ssa_reduce_strength(ssa_func_t* func);
+uint32_t        ssa_eliminate_dead_code(ssa_func_t* func);
+uint32_t        ssa_optimize(ssa_func_t* func);
+
+// true if an undefined value is used (the variable
+// might be read before it is written)
+bool            ssa_uses_undef(ssa_func_t* func);
+// the operation can fail at run time (integer division and
+// modulo by a value that isn't a nonzero constant, the float
+// modulo truncates the divisor to int)
+bool            ssa_may_trap(ssa_value_t* value);
+// an array of constants (or of such arrays), the
+// compiler stores it in the constant pool
+bool            ssa_is_literal_array(ssa_value_t* value);
+void            ssa_prepare_lowering(ssa_func_t* func);
+void            ssa_dump(cstr_t str, ssa_func_t* func);
+
+#endif // CO_SSA_H_
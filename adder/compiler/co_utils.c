@@ -114,25 +114,22 @@ void valbuffer_destroy(valbuffer_t* buffer) {
 }
 
 bool val_compare(val_t a, val_t b) {
-    if( a.type != b.type )
+    // the slots of packed arrays hold raw bytes, all
+    // of the header is compared
+    if( a.type != b.type || a.pack != b.pack || a.count != b.count )
         return false;
     switch( a.type ) {
         case VAL_NONE:
             return true;
         case VAL_ARRAY:
-            return (a.u.array.address == b.u.array.address)
-                && (a.u.array.length == b.u.array.length);
+        case VAL_ITER:
+            return (a.u.address == b.u.address)
+                && (a.count == b.count);
         case VAL_BOOL:
             return a.u.boolean == b.u.boolean;
+        case VAL_INT:
         case VAL_CHAR:
-            return a.u.character == b.u.character;
-        case VAL_FRAME:
-            return (a.u.frame.num_args == b.u.frame.num_args)
-                && (a.u.frame.num_locals == b.u.frame.num_locals)
-                && (a.u.frame.return_pc == b.u.frame.return_pc);
-        case VAL_ITER:
-            return (a.u.iter.current == b.u.iter.current)
-                && (a.u.iter.remaining == b.u.iter.remaining);
+            return a.u.integer == b.u.integer;
         case VAL_IVEC2:
             return (a.u.ivec.x == b.u.ivec.x)
                 && (a.u.ivec.y == b.u.ivec.y);
@@ -174,7 +171,7 @@ vb_result_t valbuffer_insert(valbuffer_t* buffer, val_t value) {
 }
 
 vb_result_t valbuffer_insert_int(valbuffer_t* buffer, int value) {
-    return valbuffer_insert(buffer, val_number(value));
+    return valbuffer_insert(buffer, val_int(value));
 }
 
 vb_result_t valbuffer_insert_float(valbuffer_t* buffer, float value) {
@@ -218,6 +215,47 @@ vb_result_t valbuffer_append_array(valbuffer_t* buffer, val_t* sequence, size_t
     };
 }
 
+vb_result_t valbuffer_append_packed(valbuffer_t* buffer, val_type_t pack, val_t* sequence, size_t sequence_length) {
+
+    if( pack_width(pack) == 0 ) {
+        return valbuffer_append_array(buffer, sequence, sequence_length);
+    }
+
+    array_t array = {
+        .address = MEM_MK_CONST_ADDR(buffer->size),
+        .length = (int) sequence_length,
+        .pack = pack
+    };
+    uint32_t start_index = buffer->size;
+    int slot_count = array_slot_count(array);
+    for(int i = 0; i < slot_count; i++) {
+        if(valbuffer_append(buffer, (val_t) { 0 }) == false) {
+            return (vb_result_t) {
+                .out_of_memory = true,
+                .index = 0
+            };
+        }
+    }
+
+    uint8_t* bytes = pack_bytes(buffer->values + start_index, array);
+    int width = pack_width(pack);
+    for(size_t i = 0; i < sequence_length; i++) {
+        pack_store(bytes + i * width, pack, sequence[i]);
+    }
+
+    if( valbuffer_append(buffer, val_array(array)) == false ) {
+        return (vb_result_t) {
+            .out_of_memory = true,
+            .index = 0
+        };
+    }
+
+    return (vb_result_t) {
+        .out_of_memory = false,
+        .index = buffer->size - 1
+    };
+}
+
 size_t string_count_until(char* text, char stopchar) {
     size_t len = strlen(text);
     for(size_t i = 0; i < len; i++) {
@@ -48,6 +48,9 @@ vb_result_t valbuffer_insert_float(valbuffer_t* buffer, float value);
 vb_result_t valbuffer_insert_char(valbuffer_t* buffer, char value);
 vb_result_t valbuffer_insert_bool(valbuffer_t* buffer, bool value);
 vb_result_t valbuffer_append_array(valbuffer_t* buffer, val_t* values, size_t count);
+// like valbuffer_append_array, the elements are packed (sh_value.h)
+// if pack is a packable type
+vb_result_t valbuffer_append_packed(valbuffer_t* buffer, val_type_t pack, val_t* values, size_t count);
 
 size_t string_count_until(char* text, char stopchar);
 size_t valbuffer_sequence_from_qouted_string(char* text, val_t* result, size_t result_capacity);
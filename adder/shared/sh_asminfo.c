@@ -3,46 +3,121 @@
 #include <assert.h>
 
 static op_info_t opinfo[OP_OPCODE_COUNT] = {
-    { "halt",               0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "and",                0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "or",                 0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "not",                0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "mul",                0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "div",                0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "mod",                0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "add",                0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "sub",                0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "neg",                0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "dup-1",              0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "dup-2",              0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "rot-2",              0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "cmp(==)",            0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "cmp(!=)",            0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "cmp(<)",             0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "cmp(>)",             0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "cmp(<=)",            0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "cmp(>=)",            0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "push-const",         1, { OP_ARG_CONSTANT, OP_ARG_NONE  }     },
-    { "pop-1",              0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "pop-2",              0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "jump",               1, { OP_ARG_ADDRESS, OP_ARG_NONE  }      },
-    { "jump-if-false",      1, { OP_ARG_ADDRESS, OP_ARG_NONE  }      },
-    { "exit",               1, { OP_ARG_NUMERIC, OP_ARG_NONE  }      },
-    { "call",               1, { OP_ARG_ADDRESS, OP_ARG_NONE  }      },
-    { "make-frame",         2, { OP_ARG_NUMERIC, OP_ARG_NUMERIC }    },
-    { "return-nothing",     0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "return-value",       0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "store-local",        1, { OP_ARG_NUMERIC, OP_ARG_NONE  }      },
-    { "load-local",         1, { OP_ARG_NUMERIC, OP_ARG_NONE  }      },
-    { "print",              0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "make-array",         0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "array-length",       0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "make-iter",          0, { OP_ARG_NONE, OP_ARG_NONE }          },
-    { "iter-next",          1, { OP_ARG_ADDRESS, OP_ARG_NONE  }      },
-    { "call-native",        1, { OP_ARG_ADDRESS, OP_ARG_NONE  }      }
+    { "halt",                  0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "and",                   0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "or",                    0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "not",                   0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "mul",                   0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "div",                   0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "mod",                   0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "add",                   0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "sub",                   0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "neg",                   0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "dup-1",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "dup-2",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "rot-2",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "cmp(==)",               0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "cmp(!=)",               0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "cmp(<)",                0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "cmp(>)",                0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "cmp(<=)",               0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "cmp(>=)",               0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "push-const",            1, { OP_ARG_CONSTANT, OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "pop-1",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "pop-2",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump",                  1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-false",         1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "exit",                  1, { OP_ARG_NUMERIC,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "call",                  1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "make-frame",            2, { OP_ARG_NUMERIC,  OP_ARG_NUMERIC,  OP_ARG_NONE     }  },
+    { "return-nothing",        0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "return-value",          0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "store-local",           1, { OP_ARG_LOCAL,    OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "load-local",            1, { OP_ARG_LOCAL,    OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "print",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "make-array",            0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "array-length",          0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "make-iter",             0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "iter-next",             1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "call-native",           1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "load-local-pair",       2, { OP_ARG_LOCAL,    OP_ARG_LOCAL,    OP_ARG_NONE     }  },
+    { "push-const-load-local", 2, { OP_ARG_CONSTANT, OP_ARG_LOCAL,    OP_ARG_NONE     }  },
+    { "add-locals-to-local",   3, { OP_ARG_LOCAL,    OP_ARG_LOCAL,    OP_ARG_LOCAL    }  },
+    { "inc-local-by-const",    2, { OP_ARG_LOCAL,    OP_ARG_CONSTANT, OP_ARG_NONE     }  },
+    { "jump-if-not(==)",       1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-not(!=)",       1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-not(<)",        1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-not(>)",        1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-not(<=)",       1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-not(>=)",       1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "iter-next-store",       2, { OP_ARG_ADDRESS,  OP_ARG_LOCAL,    OP_ARG_NONE     }  },
+    { "r-move",                2, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_NONE     }  },
+    { "r-add",                 3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-sub",                 3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-mul",                 3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-div",                 3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-mod",                 3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-neg",                 2, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_NONE     }  },
+    { "r-and",                 3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-or",                  3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-not",                 2, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_NONE     }  },
+    { "r-cmp(==)",             3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-cmp(!=)",             3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-cmp(<)",              3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-cmp(>)",              3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-cmp(<=)",             3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-cmp(>=)",             3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-false",       2, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_NONE     }  },
+    { "r-jump-if-not(==)",     3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not(!=)",     3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not(<)",      3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not(>)",      3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not(<=)",     3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not(>=)",     3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "iadd",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "isub",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "imul",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "idiv",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "imod",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "ineg",                 0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "icmp(==)",             0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "icmp(!=)",             0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "icmp(<)",              0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "icmp(>)",              0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "icmp(<=)",             0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "icmp(>=)",             0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "int-to-float",         0, { OP_ARG_NONE,     OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "iadd-locals-to-local", 3, { OP_ARG_LOCAL,    OP_ARG_LOCAL,    OP_ARG_LOCAL    }  },
+    { "iinc-local-by-const",  2, { OP_ARG_LOCAL,    OP_ARG_CONSTANT, OP_ARG_NONE     }  },
+    { "jump-if-not-i(==)",    1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-not-i(!=)",    1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-not-i(<)",     1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-not-i(>)",     1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-not-i(<=)",    1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "jump-if-not-i(>=)",    1, { OP_ARG_ADDRESS,  OP_ARG_NONE,     OP_ARG_NONE     }  },
+    { "r-iadd",               3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-isub",               3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-imul",               3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-idiv",               3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-imod",               3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-ineg",               2, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_NONE     }  },
+    { "r-icmp(==)",           3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-icmp(!=)",           3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-icmp(<)",            3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-icmp(>)",            3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-icmp(<=)",           3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-icmp(>=)",           3, { OP_ARG_LOCAL,    OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not-i(==)",  3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not-i(!=)",  3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not-i(<)",   3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not-i(>)",   3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not-i(<=)",  3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "r-jump-if-not-i(>=)",  3, { OP_ARG_ADDRESS,  OP_ARG_RK,       OP_ARG_RK       }  },
+    { "tail-call",            2, { OP_ARG_ADDRESS,  OP_ARG_NUMERIC,  OP_ARG_NONE     }  },
+    { "make-packed-array",    1, { OP_ARG_NUMERIC,  OP_ARG_NONE,     OP_ARG_NONE     }  }
 };
 
-#define _OP_CODE_COUNT_VALIDATION 37
+#define _OP_CODE_COUNT_VALIDATION 112
 
 char* get_op_name(vm_op_t op_code) {
     assert(_OP_CODE_COUNT_VALIDATION == OP_OPCODE_COUNT);
@@ -3,15 +3,23 @@
 
 #include "sh_types.h"
 
-#define OP_MAX_ARG_COUNT 2
+#define OP_MAX_ARG_COUNT 3
 
 typedef enum op_argtype_t {
     OP_ARG_NONE,
     OP_ARG_CONSTANT, // a reference to a constant
     OP_ARG_ADDRESS,  // an adress of an instruction (label)
-    OP_ARG_NUMERIC   // a numeric parameter
+    OP_ARG_NUMERIC,  // a numeric parameter
+    OP_ARG_LOCAL,    // a frame slot (local/arg index)
+    OP_ARG_RK        // a frame slot or a constant (OP_RK_CONST)
 } op_argtype_t;
 
+// register instruction operands refer to a constant
+// instead of a frame slot when the top bit is set
+#define OP_RK_CONST          0x80000000u
+#define OP_RK_IS_CONST(ARG)  (((ARG) & OP_RK_CONST) != 0)
+#define OP_RK_INDEX(ARG)     ((ARG) & ~OP_RK_CONST)
+
 typedef struct op_info_t {
     char*        op_name;
     size_t       op_arg_count;
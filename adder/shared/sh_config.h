@@ -4,11 +4,71 @@
 #define VM_TRACE_LOG_LEVEL         0
 #define GRID_INITIAL_HEIGHT         8
 #define GRID_INITIAL_WIDTH          6
-#define VM_RUNTIME_VALIDATION      1
+#ifndef VM_RUNTIME_VALIDATION
+# define VM_RUNTIME_VALIDATION     1
+#endif
+
+// labels-as-values (computed goto) dispatch in vm_execute,
+// build with -DVM_THREADED_DISPATCH=0 to force the portable
+// switch based dispatch loop.
+#ifndef VM_THREADED_DISPATCH
+# if defined(__GNUC__) || defined(__clang__)
+#  define VM_THREADED_DISPATCH     1
+# else
+#  define VM_THREADED_DISPATCH     0
+# endif
+#endif
+
+// count executed opcode pairs (previous, current) in vm_execute,
+// dumped with vm_profile_dump(). Used to pick superinstructions.
+#ifndef VM_PROFILE_OPCODE_PAIRS
+# define VM_PROFILE_OPCODE_PAIRS   0
+#endif
+
+// let the compiler replace common instruction
+// sequences with fused superinstructions
+#ifndef CO_SUPERINSTRUCTIONS
+# define CO_SUPERINSTRUCTIONS      1
+#endif
+
+// x86-64 template jit for programs compiled with
+// compiler_opts_t.jit, build with -DVM_JIT=0 to leave it out.
+#ifndef VM_JIT
+# if defined(__x86_64__) && !defined(_WIN32) && (defined(__GNUC__) || defined(__clang__))
+#  define VM_JIT                   1
+# else
+#  define VM_JIT                   0
+# endif
+#endif
+
+// append the jit compiled functions to /tmp/perf-<pid>.map
+// so that perf can symbolize them
+#ifndef VM_JIT_PERF_MAP
+# define VM_JIT_PERF_MAP           1
+#endif
 
 #define VM_ENV_NFUNC_TABLE_SIZE    128
 
+// instructions a vm may execute per vm_execute / vm_resume
+// call before it is suspended (see vm_set_cycle_budget)
+#ifndef VM_DEFAULT_CYCLE_BUDGET
+# define VM_DEFAULT_CYCLE_BUDGET   1000000
+#endif
+
 #define VM_DEFAULT_STRLEN 128
 
+// free chunks the heap keeps per size class (1, 2, 4 .. 64
+// values), the pools are rebuilt by each collection
+#ifndef VM_HEAP_POOL_CAPACITY
+# define VM_HEAP_POOL_CAPACITY     256
+#endif
+
+// arrays the incremental marker (vm_set_gc_budget) can have
+// queued for scanning, a cycle that needs more falls back to
+// a stop-the-world collection
+#ifndef VM_HEAP_GREY_CAPACITY
+# define VM_HEAP_GREY_CAPACITY     256
+#endif
+
 
 #endif
@@ -3,9 +3,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdatomic.h>
 
+// the print function may be replaced while other
+// threads are logging
 typedef struct sh_log_data_t {
-    sh_logprintfn_t print;
+    _Atomic(sh_logprintfn_t) print;
 } sh_log_data_t;
 
 static sh_log_data_t logobj = { .print = NULL };
@@ -21,7 +24,7 @@ const char* sh_log_preabmle(sh_log_tag_t tag) {
 }
 
 void sh_log_init(sh_logprintfn_t printfn) {
-    logobj.print = printfn;
+    atomic_store(&logobj.print, printfn);
 }
 
 void print_wrapper(sh_log_tag_t tag, char* fmt, va_list args) {
@@ -46,8 +49,9 @@ void print_wrapper(sh_log_tag_t tag, char* fmt, va_list args) {
     buf[++last] = '\n';
     buf[++last] = '\0';
 
-    if( logobj.print != NULL )
-        logobj.print(tag, buf, args);
+    sh_logprintfn_t print = atomic_load(&logobj.print);
+    if( print != NULL )
+        print(tag, buf, args);
     else
         vprintf(buf, args);
 }
@@ -19,6 +19,18 @@ void sprint_value(cstr_t str, val_t* memory, val_t val) {
             return;
         }
         int length = array.length;
+        if( array.pack != VAL_NONE ) {
+            uint8_t* bytes = pack_bytes(buffer, array);
+            int width = pack_width(array.pack);
+            bool is_string = array.pack == VAL_CHAR;
+            cstr_append_fmt(str, is_string ? "" : "[ ");
+            for(int i = 0; i < length; i++) {
+                sprint_value(str, memory, pack_load(bytes + i * width, array.pack));
+                cstr_append_fmt(str, is_string ? "" : " ");
+            }
+            cstr_append_fmt(str, is_string ? "" : "]");
+            return;
+        }
         bool is_list = buffer[0].type != VAL_CHAR;
         if(is_list) {
             cstr_append_fmt(str, "[ ");
@@ -38,6 +50,9 @@ void sprint_value(cstr_t str, val_t* memory, val_t val) {
         case VAL_NUMBER:
             cstr_append_fmt(str, "%f", val_into_number(val));
             break;
+        case VAL_INT:
+            cstr_append_fmt(str, "%d", val_into_int(val));
+            break;
         case VAL_CHAR:
             cstr_append_fmt(str, "%c", val_into_char(val));
             break;
@@ -52,13 +67,6 @@ void sprint_value(cstr_t str, val_t* memory, val_t val) {
             iter_t v = val_into_iter(val);
             cstr_append_fmt(str, "{curr:0x%08X, rem:%i}", v.current, v.remaining);
         } break;
-        case VAL_FRAME: {
-            frame_t frame = val_into_frame(val);
-            cstr_append_fmt(str, "<pc: %i, nargs: %i, nlocals: %i>",
-                frame.return_pc,
-                frame.num_args,
-                frame.num_locals);
-        } break;
         case VAL_ARRAY: {
             array_t a = val_into_array(val);
             cstr_append_fmt(str, "[addr: 0x%08X, len: %d]",
@@ -97,12 +105,20 @@ void program_disassemble(program_t* program) {
         }
         char* name = get_op_name(opcode);
         op_argtype_t* argtypes = get_op_arg_types(opcode);
-        cstr_append_fmt(str, "#%5i| %-16s", current_byte, name);
+        cstr_append_fmt(str, "#%5i| %-22s", current_byte, name);
         current_byte ++;
         for (int i = 0; i < arg_count; i++) {
-            int val = (int) READ_U32(instructions, current_byte);
-            cstr_append_fmt(str, " %-9i", val);
+            uint32_t arg = READ_U32(instructions, current_byte);
+            int val = (int) arg;
             current_byte += 4;
+            if( argtypes[i] == OP_ARG_RK && OP_RK_IS_CONST(arg) ) {
+                val = (int) OP_RK_INDEX(arg);
+                cstr_append_fmt(str, " k%-8i (", val);
+                sprint_value(str, consts, consts[val]);
+                cstr_append_fmt(str, ")");
+                continue;
+            }
+            cstr_append_fmt(str, " %-9i", val);
             if( argtypes[i] == OP_ARG_CONSTANT ) {
                 cstr_append_fmt(str, " (");
                 sprint_value(str, consts, consts[val]);
@@ -18,11 +18,11 @@ typedef struct arena_t {
 typedef enum val_type_t {
     VAL_NONE,
     VAL_NUMBER,
+    VAL_INT,
     VAL_IVEC2,
     VAL_BOOL,
     VAL_CHAR,
     VAL_ARRAY,
-    VAL_FRAME,
     VAL_ITER,
     VAL_TYPE_COUNT
 } val_type_t;
@@ -37,29 +37,34 @@ typedef struct ivec2_t {
 typedef struct array_t {
     val_addr_t address; // the address of the first value
     int length;         // the length of the array
+    val_type_t pack;    // element type of a packed array (sh_value.h)
 } array_t;
 
-typedef struct frame_t {
-    int return_pc;      // the instruction to resume 
-    uint8_t num_args;   // the number of args 
-    uint8_t num_locals; // the number of locals 
-} frame_t;
-
 typedef struct iter_t {
-    val_addr_t current; // the address of the current value
+    val_addr_t current; // the address of the current value (the
+                        // end of the array if it is packed)
     int remaining;      // the number of iterations remaining 
+    val_type_t pack;
 } iter_t;
 
+// the largest array length / iteration count
+// that fits in a value (see val_t.count)
+#define VAL_MAX_COUNT 0xFFFFFF
+
+// 8 bytes, arrays and iterators keep their length
+// (or remaining iterations) next to the type tag and
+// their address in the payload, use the val_* and
+// val_into_* functions (sh_value.h) to (un)pack them.
 typedef struct val_t {
-    val_type_t type;
+    uint32_t type  : 5;  // val_type_t
+    uint32_t pack  : 3;  // element type of packed arrays / iterators
+    uint32_t count : 24; // array length / remaining iterations
     union {
         float       number;
+        int32_t     integer;    // int and char values
         bool        boolean;
-        char        character;
         ivec2_t     ivec;
-        array_t     array;
-        frame_t     frame;
-        iter_t      iter;
+        val_addr_t  address;
     } u;
 } val_t;
 
@@ -101,6 +106,87 @@ typedef enum vm_op_t {
     OP_MAKE_ITER,
     OP_ITER_NEXT,
     OP_CALL_NATIVE,
+    // superinstructions (selected by the compiler)
+    OP_LOAD_LOCAL_PAIR,
+    OP_PUSH_VALUE_LOAD_LOCAL,
+    OP_ADD_LOCALS_TO_LOCAL,
+    OP_INC_LOCAL_BY_CONST,
+    OP_JUMP_IF_NOT_EQUAL,
+    OP_JUMP_IF_NOT_NOT_EQUAL,
+    OP_JUMP_IF_NOT_LESS_THAN,
+    OP_JUMP_IF_NOT_MORE_THAN,
+    OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL,
+    OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL,
+    OP_ITER_NEXT_STORE_LOCAL,
+    // register instructions (operands are frame slots
+    // or constants, see OP_RK_CONST in sh_asminfo.h)
+    OP_R_MOVE,
+    OP_R_ADD,
+    OP_R_SUB,
+    OP_R_MUL,
+    OP_R_DIV,
+    OP_R_MOD,
+    OP_R_NEG,
+    OP_R_AND,
+    OP_R_OR,
+    OP_R_NOT,
+    OP_R_CMP_EQUAL,
+    OP_R_CMP_NOT_EQUAL,
+    OP_R_CMP_LESS_THAN,
+    OP_R_CMP_MORE_THAN,
+    OP_R_CMP_LESS_THAN_OR_EQUAL,
+    OP_R_CMP_MORE_THAN_OR_EQUAL,
+    OP_R_JUMP_IF_FALSE,
+    OP_R_JUMP_IF_NOT_EQUAL,
+    OP_R_JUMP_IF_NOT_NOT_EQUAL,
+    OP_R_JUMP_IF_NOT_LESS_THAN,
+    OP_R_JUMP_IF_NOT_MORE_THAN,
+    OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL,
+    OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL,
+    // integer instructions (int and char operands)
+    OP_IADD,
+    OP_ISUB,
+    OP_IMUL,
+    OP_IDIV,
+    OP_IMOD,
+    OP_INEG,
+    OP_ICMP_EQUAL,
+    OP_ICMP_NOT_EQUAL,
+    OP_ICMP_LESS_THAN,
+    OP_ICMP_MORE_THAN,
+    OP_ICMP_LESS_THAN_OR_EQUAL,
+    OP_ICMP_MORE_THAN_OR_EQUAL,
+    OP_INT_TO_FLOAT,
+    OP_IADD_LOCALS_TO_LOCAL,
+    OP_IINC_LOCAL_BY_CONST,
+    OP_JUMP_IF_NOT_IEQUAL,
+    OP_JUMP_IF_NOT_INOT_EQUAL,
+    OP_JUMP_IF_NOT_ILESS_THAN,
+    OP_JUMP_IF_NOT_IMORE_THAN,
+    OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL,
+    OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL,
+    OP_R_IADD,
+    OP_R_ISUB,
+    OP_R_IMUL,
+    OP_R_IDIV,
+    OP_R_IMOD,
+    OP_R_INEG,
+    OP_R_ICMP_EQUAL,
+    OP_R_ICMP_NOT_EQUAL,
+    OP_R_ICMP_LESS_THAN,
+    OP_R_ICMP_MORE_THAN,
+    OP_R_ICMP_LESS_THAN_OR_EQUAL,
+    OP_R_ICMP_MORE_THAN_OR_EQUAL,
+    OP_R_JUMP_IF_NOT_IEQUAL,
+    OP_R_JUMP_IF_NOT_INOT_EQUAL,
+    OP_R_JUMP_IF_NOT_ILESS_THAN,
+    OP_R_JUMP_IF_NOT_IMORE_THAN,
+    OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL,
+    OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL,
+    // calls in tail position (reuse the frame)
+    OP_TAIL_CALL,
+    // arrays of chars, bools, ints or floats (packed)
+    OP_MAKE_PACKED_ARRAY,
     OP_OPCODE_COUNT
 } vm_op_t;
 
@@ -140,10 +226,13 @@ typedef struct ffi_hndl_meta_t {
 
 typedef void  (*ffi_actcall_t)(ffi_hndl_meta_t, int, val_t*);
 typedef val_t (*ffi_funcall_t)(ffi_hndl_meta_t, int, val_t*);
+typedef void  (*ffi_typedcall_t)(void); // cast to / from the typed signature
 
 typedef enum ffi_handle_tag_t {
     FFI_HNDL_HOST_ACTION,
-    FFI_HNDL_HOST_FUNCTION
+    FFI_HNDL_HOST_FUNCTION,
+    FFI_HNDL_HOST_ASYNC,    // suspends the vm until vm_complete
+    FFI_HNDL_HOST_TYPED     // c function with the import's signature (vm_native.h)
 } ffi_handle_tag_t;
 
 typedef struct ffi_handle_t {
@@ -152,6 +241,8 @@ typedef struct ffi_handle_t {
     union {
         ffi_actcall_t host_action;   // defined by user
         ffi_funcall_t host_function; // defined by user
+        ffi_actcall_t host_async;    // defined by user (starts the call)
+        ffi_typedcall_t host_typed;  // defined by user
     } u;
 } ffi_handle_t;
 
@@ -197,6 +288,7 @@ typedef struct program_t {
     ffi_definition_set_t imports;   // required by program
     ffi_definition_set_t exports;   // supplied by program
     uint32_t*            expaddr;   // entry point addrs
+    bool                 jit;       // run as native code (vm_jit.h)
 } program_t;
 
 #endif // GVM_SHARED_TYPES_H_
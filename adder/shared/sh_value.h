@@ -4,6 +4,7 @@
 #include "sh_types.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 
 // MEMORY
@@ -39,6 +40,13 @@ inline static val_t val_number(float value) {
     };
 }
 
+inline static val_t val_int(int32_t value) {
+    return (val_t) {
+        .type = VAL_INT,
+        .u.integer = value
+    };
+}
+
 inline static val_t val_ivec2(ivec2_t value) {
     return (val_t) {
         .type = VAL_IVEC2,
@@ -66,49 +74,33 @@ inline static val_t val_bool(bool value) {
 inline static val_t val_char(char value) {
     return (val_t) {
         .type = VAL_CHAR,
-        .u.character = value
+        .u.integer = value
     };
 }
 
 inline static val_t val_array(array_t value) {
     return (val_t) {
         .type = VAL_ARRAY,
-        .u.array = value
+        .pack = value.pack,
+        .count = value.length,
+        .u.address = value.address
     };
 }
 
 inline static val_t val_array_from_args(val_addr_t addr, int length) {
     return (val_t) {
         .type = VAL_ARRAY,
-        .u.array = (array_t) {
-            .address = addr,
-            .length = length
-        }
-    };
-}
-
-inline static val_t val_frame(frame_t value) {
-    return (val_t) {
-        .type = VAL_FRAME,
-        .u.frame = value
-    };
-}
-
-inline static val_t val_frame_from_args(int return_pc, uint8_t num_args, uint8_t num_locals) {
-    return (val_t) {
-        .type = VAL_FRAME,
-        .u.frame = (frame_t) {
-            .num_args = num_args,
-            .num_locals = num_locals,
-            .return_pc = return_pc
-        }
+        .count = length,
+        .u.address = addr
     };
 }
 
 inline static val_t val_iter(iter_t value) {
     return (val_t) {
         .type = VAL_ITER,
-        .u.iter = value
+        .pack = value.pack,
+        .count = value.remaining,
+        .u.address = value.current
     };
 }
 
@@ -116,6 +108,10 @@ inline static float val_into_number(val_t value) {
     return value.u.number;
 }
 
+inline static int32_t val_into_int(val_t value) {
+    return value.u.integer;
+}
+
 inline static ivec2_t val_into_ivec2(val_t value) {
     return value.u.ivec;
 }
@@ -125,19 +121,124 @@ inline static bool val_into_bool(val_t value) {
 }
 
 inline static char val_into_char(val_t value) {
-    return value.u.character;
+    return (char) value.u.integer;
 }
 
 inline static array_t val_into_array(val_t value) {
-    return value.u.array;
+    return (array_t) {
+        .address = value.u.address,
+        .length = value.count,
+        .pack = value.pack
+    };
+}
+
+inline static iter_t val_into_iter(val_t value) {
+    return (iter_t) {
+        .current = value.u.address,
+        .remaining = value.count,
+        .pack = value.pack
+    };
 }
 
-inline static frame_t val_into_frame(val_t value) {
-    return value.u.frame;
+// PACKED ARRAYS
+//
+// The elements of an array of chars or bools (a byte each) or of
+// ints or floats (4 bytes each) can be packed into the value slots
+// of the array instead of taking up a slot each, array_t.pack is
+// their type (VAL_NONE for an array of values). The elements fill
+// the end of the slots, the first slot is padded at the front: an
+// iterator over a packed array keeps the end address and finds the
+// current element from the remaining count.
+
+// bytes per element (0 if the type can't be packed)
+inline static int pack_width(val_type_t pack) {
+    switch(pack) {
+        case VAL_CHAR:
+        case VAL_BOOL:      return 1;
+        case VAL_INT:
+        case VAL_NUMBER:    return 4;
+        default:            return 0;
+    }
+}
+
+// the number of value slots the array takes up
+inline static int array_slot_count(array_t array) {
+    int width = pack_width(array.pack);
+    if( width == 0 ) {
+        return array.length;
+    }
+    return (array.length * width + (int) sizeof(val_t) - 1) / (int) sizeof(val_t);
+}
+
+// the first element of a packed array, slots are its values
+inline static uint8_t* pack_bytes(val_t* slots, array_t array) {
+    return (uint8_t*) (slots + array_slot_count(array))
+        - array.length * pack_width(array.pack);
+}
+
+inline static val_t pack_load(const uint8_t* at, val_type_t pack) {
+    switch(pack) {
+        case VAL_CHAR:  return val_char((char) *at);
+        case VAL_BOOL:  return val_bool(*at != 0);
+        case VAL_INT: {
+            int32_t value;
+            memcpy(&value, at, sizeof(value));
+            return val_int(value);
+        }
+        case VAL_NUMBER: {
+            float value;
+            memcpy(&value, at, sizeof(value));
+            return val_number(value);
+        }
+        default:        return val_none();
+    }
+}
+
+// ints (and chars) are converted where floats are packed
+inline static void pack_store(uint8_t* at, val_type_t pack, val_t value) {
+    switch(pack) {
+        case VAL_CHAR: {
+            *at = (uint8_t) value.u.integer;
+        } break;
+        case VAL_BOOL: {
+            *at = value.u.boolean ? 1 : 0;
+        } break;
+        case VAL_INT: {
+            memcpy(at, &value.u.integer, sizeof(int32_t));
+        } break;
+        case VAL_NUMBER: {
+            float number = value.type == VAL_NUMBER
+                ? value.u.number
+                : (float) value.u.integer;
+            memcpy(at, &number, sizeof(float));
+        } break;
+        default: break;
+    }
+}
+
+inline static iter_t array_iter(array_t array) {
+    return (iter_t) {
+        .current = array.pack == VAL_NONE
+            ? array.address
+            : array.address + (val_addr_t) array_slot_count(array),
+        .remaining = array.length,
+        .pack = array.pack
+    };
 }
 
-inline static iter_t val_into_iter(val_t value) {
-    return value.u.iter;
+// the current element of an iterator that isn't done, at is the
+// memory at iter->current, the iterator is advanced
+inline static val_t iter_next_value(iter_t* iter, val_t* at) {
+    val_t value;
+    if( iter->pack == VAL_NONE ) {
+        value = *at;
+        iter->current += 1;
+    } else {
+        int width = pack_width(iter->pack);
+        value = pack_load((uint8_t*) at - iter->remaining * width, iter->pack);
+    }
+    iter->remaining -= 1;
+    return value;
 }
 
 #endif // VM_VALUE_H_
@@ -7,7 +7,10 @@
 #include "sh_program.h"
 #include "vm_env.h"
 #include "vm_heap.h"
+#include "vm_jit.h"
 #include "vm_validate.h"
+#include "vm_value_tools.h"
+#include "vm_verify.h"
 #include <sh_log.h>
 
 #include <stdarg.h>
@@ -51,13 +54,7 @@ void sprint_stack(val_t* stack, int stack_size) {
 #endif
 
 val_t* gvm_addr_lookup(void* user, val_addr_t addr) {
-    vm_t* VM = (vm_t*) user;
-    int offset = MEM_ADDR_TO_INDEX(addr);
-    if( ADDR_IS_CONST(addr) ) {
-        return VM->run.constants + offset;
-    } else {
-        return VM->mem.membase + offset;
-    }
+    return addr_get_ptr((vm_t*) user, addr);
 }
 
 void vm_sprint_val(cstr_t str, vm_t* vm, val_t val) {
@@ -88,29 +85,91 @@ bool vm_create(vm_t* vm, int memory_size) {
         return false;
     }
 
-    // size: one bit per val_t
-    uint64_t* gc_marks = (uint64_t*) malloc(CALC_GC_MARK_U64_COUNT(dyn_size) * sizeof(uint64_t));
+    // size: one bit per val_t and the summary
+    uint64_t* gc_marks = (uint64_t*) malloc(HEAP_MARK_REGION_U64_COUNT(dyn_size) * sizeof(uint64_t));
     if( gc_marks == NULL ) {
         sh_log_error("could'nt allocate GC mark region.\n");
         free(mem);
         return false;
     }
-    memset(gc_marks, 0, CALC_GC_MARK_U64_COUNT(dyn_size) * sizeof(uint64_t));
+    memset(gc_marks, 0, HEAP_MARK_REGION_U64_COUNT(dyn_size) * sizeof(uint64_t));
     
+    uint32_t* pools = (uint32_t*) malloc(HEAP_POOL_CLASSES * VM_HEAP_POOL_CAPACITY * sizeof(uint32_t));
+    if( pools == NULL ) {
+        sh_log_error("could'nt allocate heap pools.\n");
+        free(mem);
+        free(gc_marks);
+        return false;
+    }
+
+    // the values an incremental marking cycle has reached
+    // and the arrays it has yet to scan
+    uint64_t* gc_live = (uint64_t*) malloc(CALC_GC_MARK_U64_COUNT(dyn_size) * sizeof(uint64_t));
+    val_t* grey = (val_t*) malloc(VM_HEAP_GREY_CAPACITY * sizeof(val_t));
+    if( gc_live == NULL || grey == NULL ) {
+        sh_log_error("could'nt allocate the incremental marker.\n");
+        free(mem);
+        free(gc_marks);
+        free(pools);
+        free(gc_live);
+        free(grey);
+        return false;
+    }
+
+    // call frames are kept on their own stack, allowing
+    // calls to nest as deep as there are stack values
+    vm_frame_t* frames = (vm_frame_t*) malloc(stack_size * sizeof(vm_frame_t));
+    if( frames == NULL ) {
+        sh_log_error("could'nt allocate VM call-frame stack.\n");
+        free(mem);
+        free(gc_marks);
+        free(pools);
+        free(gc_live);
+        free(grey);
+        return false;
+    }
+
     vm->mem.membase = mem;
     vm->mem.memsize = memory_size;
     
     vm->mem.stack.values = vm->mem.membase;
     vm->mem.stack.size = stack_size;
     vm->mem.stack.top = -1;
+    vm->mem.stack.base = 0;
+
+    vm->mem.frames.frames = frames;
+    vm->mem.frames.size = stack_size;
+    vm->mem.frames.top = -1;
 
     // heap & GC
     vm->mem.heap.values = vm->mem.membase + stack_size;
     vm->mem.heap.size = dyn_size;
     vm->mem.heap.gc_marks = gc_marks;
+    vm->mem.heap.gc_full = gc_marks + CALC_GC_MARK_U64_COUNT(dyn_size);
+    vm->mem.heap.cursor = 0;
+    vm->mem.heap.compactions = 0;
+    vm->mem.heap.pools = pools;
+    for(int i = 0; i < HEAP_POOL_CLASSES; i++) {
+        vm->mem.heap.pool_counts[i] = 0;
+    }
+    for(int i = 0; i < 2; i++) {
+        vm->mem.heap.roots[i] = NULL;
+        vm->mem.heap.rootcounts[i] = 0;
+    }
+    vm->mem.heap.gc_budget = 0;
+    vm->mem.heap.gc_marking = false;
+    vm->mem.heap.gc_live = gc_live;
+    vm->mem.heap.grey = grey;
+    vm->mem.heap.grey_count = 0;
+    vm->mem.heap.grey_overflow = false;
+    vm->mem.heap.allocated = 0;
+    vm->mem.heap.gc_trigger = dyn_size / 2;
+    vm->mem.heap.gc_stats = (vm_gc_stats_t) { 0 };
+    vm->mem.heap.dirty_first = 0;
+    vm->mem.heap.dirty_last = CALC_GC_MARK_U64_COUNT(dyn_size) - 1;
 
     // assigend on execution
-    vm->run = (vm_runtime_t) { 0 };
+    vm->run = (vm_runtime_t) { .budget = VM_DEFAULT_CYCLE_BUDGET };
 
     VALIDATION_INIT(vm);
 
@@ -124,52 +183,229 @@ void vm_destroy(vm_t* vm) {
         
     VALIDATION_DESTROY(vm);
     free(vm->mem.membase);
+    free(vm->mem.frames.frames);
     free(vm->mem.heap.gc_marks);
+    free(vm->mem.heap.pools);
+    free(vm->mem.heap.gc_live);
+    free(vm->mem.heap.grey);
     memset(vm, 0, sizeof(vm_t));
 }
 
-inline static void ffi_invoke(ffi_handle_t* hndl, int arg_count, vm_t* vm) {
-    switch(hndl->tag) {
-        case FFI_HNDL_HOST_ACTION: {
-            hndl->u.host_action(
-                (ffi_hndl_meta_t) {
-                    .local = hndl->local,
-                    .vm = vm
-                },
-                arg_count,
-                vm->mem.stack.values + vm->mem.stack.top + 1 - arg_count);
-            vm->mem.stack.top -= arg_count;
-        } break;
-        case FFI_HNDL_HOST_FUNCTION: {
-            val_t ret = hndl->u.host_function(
-                (ffi_hndl_meta_t) {
-                    .local = hndl->local,
-                    .vm = vm
-                },
-                arg_count,
-                vm->mem.stack.values + vm->mem.stack.top + 1 - arg_count);
-            vm->mem.stack.top -= arg_count;
-            vm->mem.stack.values[++vm->mem.stack.top] = ret;
-        } break;
-        default: {
-            assert(false && "Not implemented");
+#if VM_PROFILE_OPCODE_PAIRS > 0
+
+// the extra row holds the first opcode of each run. The
+// table is shared by all vms, profile single threaded runs.
+static uint64_t opcode_pairs[OP_OPCODE_COUNT + 1][OP_OPCODE_COUNT];
+
+# define PROFILE_PAIR(PREV, OP) opcode_pairs[(PREV)][(OP)]++
+
+void vm_profile_reset(void) {
+    memset(opcode_pairs, 0, sizeof(opcode_pairs));
+}
+
+void vm_profile_dump(int max_pairs) {
+    uint64_t total = 0;
+    for(int i = 0; i < OP_OPCODE_COUNT; i++) {
+        for(int j = 0; j < OP_OPCODE_COUNT; j++) {
+            total += opcode_pairs[i][j];
         }
     }
+    if( total == 0 ) {
+        sh_log_info("opcode pairs: nothing recorded\n");
+        return;
+    }
+    sh_log_info("opcode pairs: %llu total\n", (unsigned long long) total);
+    // repeated selection of the largest remaining
+    // count, good enough for a 37x37 table.
+    uint64_t printed = UINT64_MAX;
+    int pi = -1, pj = -1;
+    for(int n = 0; n < max_pairs; n++) {
+        uint64_t best = 0;
+        int bi = -1, bj = -1;
+        for(int i = 0; i < OP_OPCODE_COUNT; i++) {
+            for(int j = 0; j < OP_OPCODE_COUNT; j++) {
+                uint64_t c = opcode_pairs[i][j];
+                bool after_printed = c < printed
+                    || (c == printed && (i > pi || (i == pi && j > pj)));
+                if( after_printed && c > best ) {
+                    best = c; bi = i; bj = j;
+                }
+            }
+        }
+        if( bi < 0 ) {
+            break;
+        }
+        sh_log("  %6.2f%%  %-16s %s\n",
+            (100.0 * best) / total,
+            get_op_name(bi),
+            get_op_name(bj));
+        printed = best; pi = bi; pj = bj;
+    }
 }
 
+#else
+
+# define PROFILE_PAIR(PREV, OP)
+
+void vm_profile_reset(void) { }
+void vm_profile_dump(int max_pairs) { (void)(max_pairs); }
+
+#endif
+
 void vm_select_entry_point(vm_t* vm, program_t* program, uint32_t address) {
     assert( program->inst.size >= address );
     if( program->inst.buffer[address] == OP_MAKE_FRAME ) {
-        // push negative number as return address
-        vm->mem.stack.values[++vm->mem.stack.top] = val_number(-1.0f);
+        // negative return address, leave the vm on return
+        vm->mem.frames.frames[++vm->mem.frames.top] = (vm_frame_t) {
+            .return_pc = -1,
+            .base = vm->mem.stack.top + 1
+        };
     }
     // jump to label / function
     vm->run.pc = address;
 }
 
+// The instruction handlers below are written once and
+// compiled either as a direct-threaded interpreter (each
+// handler ends with its own indirect jump to the next
+// handler) or as a portable switch inside a loop.
+//
+// pc, top, base and frame are kept in locals while executing
+// and are written back to the vm (VM_SAVE_STATE) whenever code
+// outside of the loop needs to see them (ffi, gc, validation).
+
+#define VM_SAVE_STATE() do {                \
+        vm_run->pc = pc;                    \
+        vm_mem->stack.top = top;            \
+        vm_mem->stack.base = base;          \
+        vm_mem->frames.top = frame;         \
+    } while(false)
+
+#define VM_LOAD_STATE() do {                \
+        pc = vm_run->pc;                    \
+        top = vm_mem->stack.top;            \
+        base = vm_mem->stack.base;          \
+        frame = vm_mem->frames.top;         \
+    } while(false)
+
+#define VM_FETCH() do {                                 \
+        if( (cycles_remaining--) == 0 ) {               \
+            goto vm_out_of_cycles;                      \
+        }                                               \
+        PROFILE_PAIR(opcode, instructions[pc]);         \
+        opcode = instructions[pc++];                    \
+        TRACE_OP(opcode);                               \
+        VM_VALIDATE_PRE(opcode);                        \
+    } while(false)
+
+#define VM_POST() do {                                  \
+        TRACE_NL();                                     \
+        VM_VALIDATE_POST(opcode);                       \
+        TRACE_PRINT_STACK(stack, top);                  \
+    } while(false)
+
+#if VM_THREADED_DISPATCH
+# define VM_CASE(OP)    L_##OP
+# define VM_DEFAULT     L_DEFAULT
+# define VM_NEXT()      { VM_POST(); VM_FETCH(); goto *dispatch_table[opcode]; }
+#else
+# define VM_CASE(OP)    case OP
+# define VM_DEFAULT     default
+# define VM_NEXT()      { VM_POST(); } break
+#endif
+
+#define VM_EXIT(VAL) do {                               \
+        VM_SAVE_STATE();                                \
+        vm_run->cycles = cycles_budget - cycles_remaining; \
+        return (VAL);                                   \
+    } while(false)
+
+// register instruction operands
+#define VM_REG(ARG) stack[base + (ARG)]
+#define VM_RK(ARG) (OP_RK_IS_CONST(ARG) ? consts[OP_RK_INDEX(ARG)] : VM_REG(ARG))
+
+// dst = rk(a) <op> rk(b), with a and b unpacked by INTO
+#define VM_REG_BINARY_OP(TYPE, INTO, RESULT) {                  \
+        uint32_t dst = READ_U32(instructions, pc);              \
+        uint32_t ra = READ_U32(instructions, pc + 4);           \
+        uint32_t rb = READ_U32(instructions, pc + 8);           \
+        TRACE_INT_ARG(dst);                                     \
+        TRACE_INT_ARG(ra);                                      \
+        TRACE_INT_ARG(rb);                                      \
+        TYPE a = INTO(VM_RK(ra));                               \
+        TYPE b = INTO(VM_RK(rb));                               \
+        VM_REG(dst) = (RESULT);                                 \
+        pc += 12;                                               \
+    }
+
+// jump to target unless rk(a) <cmp> rk(b)
+#define VM_REG_JUMP_UNLESS(TYPE, INTO, COND) {                  \
+        uint32_t target = READ_U32(instructions, pc);           \
+        uint32_t ra = READ_U32(instructions, pc + 4);           \
+        uint32_t rb = READ_U32(instructions, pc + 8);           \
+        TRACE_INT_ARG(target);                                  \
+        TRACE_INT_ARG(ra);                                      \
+        TRACE_INT_ARG(rb);                                      \
+        TYPE a = INTO(VM_RK(ra));                               \
+        TYPE b = INTO(VM_RK(rb));                               \
+        if( (COND) == false ) {                                 \
+            pc = target;                                        \
+        } else {                                                \
+            pc += 12;                                           \
+        }                                                       \
+    }
+
+// integer instructions, a is the top of the stack and b the
+// value below it (same operand order as the float instructions)
+#define VM_INT_BINARY_OP(RESULT) {                              \
+        int32_t a = val_into_int(stack[top--]);                 \
+        int32_t b = val_into_int(stack[top--]);                 \
+        stack[++top] = (RESULT);                                \
+    }
+
+#define VM_INT_JUMP_UNLESS(COND) {                              \
+        TRACE_INT_ARG(READ_U32(instructions, pc));              \
+        int32_t a = val_into_int(stack[top--]);                 \
+        int32_t b = val_into_int(stack[top--]);                 \
+        if( (COND) == false ) {                                 \
+            pc = READ_U32(instructions, pc);                    \
+        } else {                                                \
+            pc += 4;                                            \
+        }                                                       \
+    }
+
+// int arithmetic wraps around like the two's complement
+// hardware it runs on, the operations are done on unsigned
+// values to keep the overflow defined
+#define INT_WRAP(A, OP, B) ((int32_t) ((uint32_t) (A) OP (uint32_t) (B)))
+
+static inline int32_t int_div(int32_t a, int32_t b) {
+    // INT32_MIN / -1 overflows, wrap it like the other ops
+    return (b == -1) ? INT_WRAP(0, -, a) : a / b;
+}
+
+static inline int32_t int_mod(int32_t a, int32_t b) {
+    return (b == -1) ? 0 : a % b;
+}
+
+#define VM_EXIT_DIV_BY_ZERO() do {                              \
+        sh_log_error("\ninteger division by zero\n");           \
+        VM_EXIT(val_number(-1007));                             \
+    } while(false)
+
+#if VM_THREADED_DISPATCH
+// labels as values and computed gotos are gnu extensions
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+static val_t vm_dispatch(vm_t* vm, vm_env_t* env, program_t* program, uint32_t budget);
+static val_t vm_continue(vm_t* vm, vm_env_t* env, program_t* program);
+
 val_t vm_execute(vm_t* vm, vm_env_t* env, entry_point_t* ep, program_t* program) {
 
     assert(sizeof(float) == 4);
+    assert(sizeof(val_t) == 8);
 
     assert(program != NULL);
 
@@ -178,389 +414,274 @@ val_t vm_execute(vm_t* vm, vm_env_t* env, entry_point_t* ep, program_t* program)
         return val_number(-1099);
     }
     
-    val_t* stack = vm->mem.stack.values;
-    val_t* consts = program->cons.buffer;
-    uint8_t* instructions = program->inst.buffer;
-
     vm_runtime_t* vm_run = &vm->run;
-    vm_run->constants = consts;
-    vm_run->instructions = instructions;
+    vm_run->constants = program->cons.buffer;
+    vm_run->instructions = program->inst.buffer;
     vm_run->pc = 0;
+    vm_run->cycles = 0;
+
+    // runs from verified exports skip the validation
+    vm_run->checked = vm_verify_entry(env->verified, vm,
+        ep->address, ep->argcount, ep->argvals) == false;
+    vm_run->extent = env->verified != NULL ? env->verified->frame_extent : 0;
 
     vm_mem_t* vm_mem = &vm->mem;
     memset(vm_mem->stack.values, 0, sizeof(val_t) * vm_mem->stack.size);
 
     // push initial args (if any)
-    vm_mem->stack.frame = -1;
+    vm_mem->stack.base = 0;
     vm_mem->stack.top = -1;
+    vm_mem->frames.top = -1;
 
     for(int i = 0; i < ep->argcount; i++) {
-        stack[++vm_mem->stack.top] = ep->argvals[i];
-    }
-    
-    uint32_t cycles_remaining = (uint32_t) 1000000;
-    if (program->inst.size == 0) {
-        cycles_remaining = 0;
+        vm_mem->stack.values[++vm_mem->stack.top] = ep->argvals[i];
     }
 
     assert(ep->address >= 0);
     vm_select_entry_point(vm, program, ep->address);
 
-    while ( (cycles_remaining--) != 0 ) {
-
-        vm_op_t opcode = instructions[vm_run->pc++];
-
-        TRACE_OP(opcode);
-
-        VALIDATE_PRE(vm, opcode);
-
-        assert(OP_OPCODE_COUNT == 37 && "Opcode count changed.");
-
-        switch (opcode) {
-            case OP_PUSH_VALUE: {
-                uint32_t const_index = READ_U32(instructions, vm_run->pc);
-                TRACE_INT_ARG(const_index);
-                stack[++vm_mem->stack.top] = consts[const_index];
-                vm_run->pc += 4;
-            } break;
-            case OP_POP_1: {
-                vm_mem->stack.top -= 1;
-            } break;
-            case OP_POP_2: {
-                vm_mem->stack.top -= 2;
-            } break;
-            case OP_ADD: {
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_number(a + b);
-            } break;
-            case OP_SUB: {
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_number(a - b);
-            } break;
-            case OP_MUL: {
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_number(a * b);
-            } break;
-            case OP_DIV: {
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_number(a / b);
-            } break;
-            case OP_MOD: {
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_number((int) a % (int) b);
-            } break;
-            case OP_NEG: {
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_number(-a);
-            } break;
-            case OP_CMP_LESS_THAN: {
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_bool( a < b );
-            } break;
-            case OP_CMP_LESS_THAN_OR_EQUAL: {
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_bool( a <= b );
-            } break;
-            case OP_CMP_MORE_THAN: {
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_bool( a > b );
-            } break;
-            case OP_CMP_MORE_THAN_OR_EQUAL: {
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_bool( a >= b );
-            } break;
-            case OP_CMP_EQUAL: {
-                // todo: other types than numbers
-                const float epsilon = 0.0001f;
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_bool( fabs(a - b) < epsilon );
-            } break;
-            case OP_CMP_NOT_EQUAL: {
-                // todo: other types than numbers
-                const float epsilon = 0.0001f;
-                float a = val_into_number(stack[vm_mem->stack.top--]);
-                float b = val_into_number(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_bool( fabs(a - b) > epsilon );
-            } break;
-            case OP_AND: {
-                bool a = val_into_bool(stack[vm_mem->stack.top--]);
-                bool b = val_into_bool(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_bool( a && b );
-            } break;
-            case OP_OR: {
-                bool a = val_into_bool(stack[vm_mem->stack.top--]);
-                bool b = val_into_bool(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_bool( a || b );
-            } break;
-            case OP_NOT: {
-                bool a = val_into_bool(stack[vm_mem->stack.top--]);
-                stack[++vm_mem->stack.top] = val_bool( !a );
-            } break;
-            case OP_DUP_1: {
-                val_t a = stack[vm_mem->stack.top];
-                stack[++vm_mem->stack.top] = a;
-            } break;
-            case OP_DUP_2: {
-                val_t a = stack[vm_mem->stack.top - 1];
-                val_t b = stack[vm_mem->stack.top];
-                stack[++vm_mem->stack.top] = a;
-                stack[++vm_mem->stack.top] = b;
-            } break;
-            case OP_ROT_2: {
-                val_t a = stack[vm_mem->stack.top - 1];
-                val_t b = stack[vm_mem->stack.top];
-                stack[vm_mem->stack.top - 1] = b;
-                stack[vm_mem->stack.top]     = a;
-            } break;
-            case OP_JUMP: {
-                vm_run->pc = READ_U32(instructions, vm_run->pc);
-                TRACE_INT_ARG(vm_run->pc);
-            } break;
-            case OP_JUMP_IF_FALSE: {
-                TRACE_INT_ARG(READ_U32(instructions, vm_run->pc));
-                if( val_into_bool(stack[vm_mem->stack.top--]) == false ) {
-                    vm_run->pc = READ_U32(instructions, vm_run->pc);
-                } else {
-                    vm_run->pc += 4;
-                }
-            } break;
-            case OP_HALT:{
-                TRACE_NL();
-                return val_number(-1002);
-            } break;
-            case OP_EXIT: {
-                TRACE_NL();
-                uint32_t return_value = READ_U32(instructions, vm_run->pc);
-                TRACE_INT_ARG(return_value);
-                return val_number(return_value);
-            } break;
-            case OP_CALL: {
-                // push the return address
-                stack[++vm_mem->stack.top] = val_number(vm_run->pc + 4);
-                // jump to label / function
-                vm_run->pc = READ_U32(instructions, vm_run->pc);
-                TRACE_INT_ARG(vm_run->pc);
-            } break;
-            case OP_MAKE_FRAME: {
-
-                uint32_t nargs = READ_U32(instructions, vm_run->pc);
-                TRACE_INT_ARG(nargs);
-                vm_run->pc += 4;
-
-                uint32_t nlocals = READ_U32(instructions, vm_run->pc);
-                TRACE_INT_ARG(nlocals);
-                vm_run->pc += 4;
-
-                // stack top should now be the return address
-                // Note: if the return address is negative we exit the vm
-                //       returning the top of stack element.
-                float call_site = val_into_number(stack[vm_mem->stack.top--]);
-                frame_t frame = (frame_t) {
-                    .return_pc = (int) call_site,
-                    .num_args = nargs,
-                    .num_locals = nlocals
-                };
-
-                // move args to after the frame
-                int frame_start = vm_mem->stack.top - nargs + 1;
-                for(int i = nargs; i > 0; i--) {
-                    // stack[i+N] = stack[i+N-1]
-                    stack[frame_start + i] = stack[frame_start + i - 1];
-                }
+    return vm_continue(vm, env, program);
+}
 
-                // insert frame before locals
-                stack[frame_start] = val_frame(frame);
-                vm_mem->stack.frame = frame_start;
+vm_call_t vm_call_prepare(vm_t* vm, vm_env_t* env, entry_point_t* ep, program_t* program) {
+    assert(program != NULL);
+    assert(ep->address >= 0 && (uint32_t) ep->address < program->inst.size);
+    return (vm_call_t) {
+        .vm = vm,
+        .env = env,
+        .program = program,
+        .address = ep->address,
+        .argcount = ep->argcount,
+        .verified = env->verified,
+        .index = vm_verify_find(env->verified, vm, ep->address, ep->argcount)
+    };
+}
 
-                // OBS: ZERO INIT MIGHT NOT BE NEEDED!!
-                // init locals (not needed)
-                uint32_t locals_idx = frame_start + 1 + nargs;
-                for(uint32_t i = 0; i < nlocals; i++) {
-                    stack[locals_idx + i] = (val_t) { 0 };
-                }
+// sets up the vm for prepared calls, returns the index of
+// the verified export (-1: not verified)
+static int vm_call_begin(vm_call_t* call) {
+    vm_t* vm = call->vm;
+    vm_env_t* env = call->env;
+    program_t* program = call->program;
 
-                // make room for the locals on the stack
-                vm_mem->stack.top += nlocals + 1;
+    vm_runtime_t* vm_run = &vm->run;
+    vm_run->constants = program->cons.buffer;
+    vm_run->instructions = program->inst.buffer;
+    vm_run->extent = env->verified != NULL ? env->verified->frame_extent : 0;
+
+    if( call->verified != env->verified ) {
+        // the env was set up again (reloaded) since the call
+        // was prepared, the export is looked up once more
+        call->verified = env->verified;
+        call->index = vm_verify_find(env->verified, vm, call->address, call->argcount);
+    }
+    return call->index;
+}
 
-            } break;
-            case OP_RETURN_NOTHING: {
+static val_t vm_call_run(vm_call_t* call, int index, val_t* args) {
 
-                frame_t frame;
-                if( vm_mem->stack.frame >= 0 ) {
-                    frame = val_into_frame(stack[vm_mem->stack.frame]);
-                } else {
-                    frame.return_pc = -1;
-                }
+    vm_t* vm = call->vm;
+    vm_env_t* env = call->env;
+    int argc = call->argcount;
 
-                // Note: if the return address is negative we exit the vm.
-                if( frame.return_pc < 0 ) {
-                    // below the return value in the stack
-                    // we may have a frame + locals etc
-                    // so to ensure the frame is poped
-                    // we reset the stack top pointer
-                    vm_mem->stack.top = 0;
-                    return val_none();
-                }
+    vm_runtime_t* vm_run = &vm->run;
+    vm_run->pc = 0;
+    vm_run->cycles = 0;
+    vm_run->checked = index < 0
+        || vm_verify_args(env->verified, vm, index, argc, args) == false;
 
-                // update pc to resume at call site
-                vm->run.pc = frame.return_pc;
-
-                // hop down to parent call frame - 1
-                vm_mem->stack.top = vm_mem->stack.frame - 1;
-
-                // find index of previous frame
-                // this way of updating current frame may turn out
-                // to be too slow.
-                vm_mem->stack.frame = -1;
-                for(int i = vm_mem->stack.top; i >= 0; i--) {
-                    if( stack[i].type == VAL_FRAME ) {
-                        vm_mem->stack.frame = i;
-                        break;
-                    }
-                }
-            } break;
-            case OP_RETURN_VALUE: {
-
-                frame_t frame;
-                if( vm_mem->stack.frame >= 0 ) {
-                    frame = val_into_frame(stack[vm_mem->stack.frame]);
-                } else {
-                    frame.return_pc = -1;
-                }
+    // verified code never reads a stack value before writing
+    // it (make-frame clears the locals), so only the region of
+    // the entry frame is cleared instead of the whole stack
+    vm_mem_t* vm_mem = &vm->mem;
+    int nclear = vm_run->checked ? vm_mem->stack.size : argc + vm_run->extent;
+    memset(vm_mem->stack.values, 0, sizeof(val_t) * nclear);
+    if( argc > 0 ) {
+        memcpy(vm_mem->stack.values, args, sizeof(val_t) * argc);
+    }
 
-                if( frame.return_pc < 0 ) {
-                    // Note: if the return address is negative we exit the vm
-                    //       returning the top of stack element. 
-                    val_t rval = val_none();
-                    if( vm_mem->stack.top >= 0 ) {
-                        rval = stack[vm_mem->stack.top];
-                        // below the return value in the stack
-                        // we may have a frame + locals etc
-                        // so to ensure the frame is poped
-                        // we reset the stack top pointer
-                        vm_mem->stack.top = 0;
-                    }
-
-                    return rval;
-                }
+    vm_mem->stack.base = 0;
+    vm_mem->stack.top = argc - 1;
+    vm_mem->frames.top = -1;
 
-                int body_start = vm_mem->stack.frame + frame.num_locals + frame.num_args;
-                int invoked_top = vm_mem->stack.top;
-                // copy possible return value
-                val_t ret_val = stack[invoked_top];
-                // hop down to parent call frame - 1
-                vm_mem->stack.top = vm_mem->stack.frame - 1;
-                // update pc to resume at call site
-                vm->run.pc = frame.return_pc; 
-                // check if we have a return value
-                if(invoked_top > body_start) {
-                    // push return value
-                    stack[++vm_mem->stack.top] = ret_val;
-                }
+    vm_select_entry_point(vm, call->program, call->address);
 
-                // find index of previous frame
-                // this way of updating current frame may turn out
-                // to be too slow.
-                vm_mem->stack.frame = -1;
-                for(int i = vm_mem->stack.top; i >= 0; i--) {
-                    if( stack[i].type == VAL_FRAME ) {
-                        vm_mem->stack.frame = i;
-                        break;
-                    }
-                }
+    return vm_continue(vm, env, call->program);
+}
 
-            } break;
-            case OP_STORE_LOCAL: {
-                uint32_t local_idx = READ_U32(instructions, vm_run->pc);
-                TRACE_INT_ARG(local_idx);
-                stack[vm_mem->stack.frame + 1 + local_idx] = stack[vm_mem->stack.top--];
-                vm_run->pc += 4;
-            } break;
-            case OP_LOAD_LOCAL: {
-                uint32_t local_idx = READ_U32(instructions, vm_run->pc);
-                TRACE_INT_ARG(local_idx);
-                stack[++vm_mem->stack.top] = stack[vm_mem->stack.frame + 1 + local_idx];
-                vm_run->pc += 4;
-            } break;
-            case OP_MAKE_ARRAY: {
-                // pop array size
-                val_t size = stack[vm_mem->stack.top--];
-                uint32_t count = val_into_number(size);
-                // allocate array
-                array_t array = heap_array_alloc(vm, count);
-                if( ADDR_IS_NULL(array.address) ) {
-                    sh_log_error("\nheap alloc failed\n");
-                    return val_number(-1005);
-                }
-                // copy all data to the array
-                val_t* source_ptr = &stack[vm_mem->stack.top + 1 - count];
-                heap_array_copy_to(vm, source_ptr, count, array);
-                // remove the data from the stack
-                vm_mem->stack.top -= count; 
-                stack[++vm_mem->stack.top] = val_array(array);
-            } break;
-            case OP_ARRAY_LENGTH: {
-                val_t array_val = stack[vm_mem->stack.top--];
-                array_t array = val_into_array(array_val);
-                stack[++vm_mem->stack.top] = val_number(array.length);
-            } break;
-            case OP_MAKE_ITER: {
-                val_t array_val = stack[vm_mem->stack.top--];
-                array_t array = val_into_array(array_val);
-                iter_t iter = (iter_t) {
-                    .current = array.address,
-                    .remaining = array.length
-                };
-                stack[++vm_mem->stack.top] = val_iter(iter);
-            } break;
-            case OP_ITER_NEXT: {
-                uint32_t exit_pc = READ_U32(instructions, vm_run->pc);
-                TRACE_INT_ARG(exit_pc);
-                val_t iter_val = stack[vm_mem->stack.top];
-                iter_t iter = val_into_iter(iter_val);
-                if( iter.remaining == 0 ) {
-                    vm_mem->stack.top --;
-                    vm_run->pc = exit_pc;
-                } else {
-                    uint32_t mem_index = MEM_ADDR_TO_INDEX(iter.current);
-                    val_t value = vm_mem->membase[mem_index];
-                    iter.remaining -= 1;
-                    iter.current = MEM_MK_PROGR_ADDR(mem_index + 1);
-                    stack[vm_mem->stack.top] = val_iter(iter);
-                    stack[++vm_mem->stack.top] = value;
-                    vm_run->pc += 4;
-                }
-            } break;
-            case OP_CALL_NATIVE: {
-                uint32_t findex = READ_U32(instructions, vm_run->pc);
-                TRACE_INT_ARG(findex);
-                ffi_handle_t* handle = &env->handles[findex];
-                int arg_count = env->argcounts[findex];
-                ffi_invoke(handle, arg_count, vm);
-                vm_run->pc += 4;
-            } break;
-            default: {
-                char* op_str = get_op_name(opcode);
-                sh_log_error("\nunhandled operatioin %i (%s)\n", opcode, op_str);
-                return val_number(-1003);
-            } break;
+val_t vm_call(vm_call_t* call, val_t* args) {
+    if( vm_env_is_ready(call->env) == false ) {
+        sh_log_error("incomplete vm env, cannot start execution");
+        return val_number(-1099);
+    }
+    int index = vm_call_begin(call);
+    return vm_call_run(call, index, args);
+}
+
+int vm_call_batch(vm_call_t* call, val_t* args, int count, val_t* results, bool reset_heap) {
+
+    if( vm_env_is_ready(call->env) == false ) {
+        sh_log_error("incomplete vm env, cannot start execution");
+        return 0;
+    }
+
+    // the args of the items are kept alive by the GC, and so
+    // are the results unless the heap is reset
+    vm_heap_t* heap = &call->vm->mem.heap;
+    int argc = call->argcount;
+    heap->roots[0] = args;
+    heap->rootcounts[0] = args != NULL ? count * argc : 0;
+    heap->roots[1] = results;
+
+    vm_heap_reset_t reset = {0};
+    if( reset_heap && heap_reset_save(call->vm, &reset) == false ) {
+        sh_log_error("could'nt allocate heap snapshot.\n");
+        heap->roots[0] = heap->roots[1] = NULL;
+        heap->rootcounts[0] = 0;
+        return 0;
+    }
+
+    int index = vm_call_begin(call);
+    int done = 0;
+    while( done < count ) {
+        val_t* item = args != NULL ? args + done * argc : NULL;
+        results[done] = vm_call_run(call, index, item);
+        if( call->vm->run.suspended || call->vm->run.waiting != 0 ) {
+            // out of budget or waiting on an async host
+            // call, the host can continue the item
+            break;
         }
+        if( reset_heap ) {
+            heap_reset_restore(call->vm, &reset);
+        }
+        done++;
+        heap->rootcounts[1] = reset_heap ? 0 : done;
+    }
 
-        TRACE_NL();
-        VALIDATE_POST(vm, opcode);
-        TRACE_PRINT_STACK(vm_mem->stack.values, vm_mem->stack.top);
+    heap->roots[0] = heap->roots[1] = NULL;
+    heap->rootcounts[0] = heap->rootcounts[1] = 0;
+    heap_reset_free(&reset);
+    return done;
+}
+
+void vm_set_cycle_budget(vm_t* vm, uint32_t budget) {
+    vm->run.budget = budget > 0 ? budget : VM_DEFAULT_CYCLE_BUDGET;
+}
+
+void vm_set_gc_budget(vm_t* vm, uint32_t budget) {
+    vm->mem.heap.gc_budget = budget;
+    if( budget == 0 ) {
+        // a cycle in progress is dropped, the marks of
+        // the allocations are all that counts
+        vm->mem.heap.gc_marking = false;
     }
+}
+
+vm_gc_stats_t vm_gc_stats(vm_t* vm) {
+    return vm->mem.heap.gc_stats;
+}
 
-    return val_number(-1004);
+void vm_gc_stats_reset(vm_t* vm) {
+    vm->mem.heap.gc_stats = (vm_gc_stats_t) { 0 };
 }
 
+bool vm_is_suspended(vm_t* vm) {
+    return vm->run.suspended;
+}
+
+val_t vm_resume(vm_t* vm) {
+    if( vm->run.waiting != 0 ) {
+        sh_log_error("the execution waits for an async call (vm_complete)");
+        return val_number(-1008);
+    }
+    if( vm->run.suspended == false ) {
+        sh_log_error("no suspended execution to resume");
+        return val_number(-1008);
+    }
+    if( vm_env_is_ready(vm->run.env) == false ) {
+        sh_log_error("incomplete vm env, cannot resume execution");
+        return val_number(-1099);
+    }
+    return vm_continue(vm, vm->run.env, vm->run.program);
+}
+
+bool vm_is_waiting(vm_t* vm) {
+    return vm->run.waiting != 0;
+}
+
+uint32_t vm_wait_token(vm_t* vm) {
+    return vm->run.waiting;
+}
+
+val_t vm_complete(vm_t* vm, uint32_t token, val_t result) {
+    if( vm->run.waiting == 0 || vm->run.waiting != token ) {
+        sh_log_error("no async call with token %u to complete", token);
+        return val_number(-1008);
+    }
+    if( vm_env_is_ready(vm->run.env) == false ) {
+        sh_log_error("incomplete vm env, cannot complete the async call");
+        return val_number(-1099);
+    }
+    if( vm->run.awaits_value ) {
+        vm->mem.stack.values[++vm->mem.stack.top] = result;
+    }
+    return vm_continue(vm, vm->run.env, vm->run.program);
+}
+
+// Runs jit compiled code, stepping through the instructions
+// it bails out on with the interpreter.
+static val_t vm_run_native(vm_t* vm, vm_env_t* env, program_t* program) {
+    uint32_t budget = vm->run.budget;
+    uint32_t remaining = budget;
+    val_t result = val_none();
+    while( true ) {
+        vm_jit_enter(env->jit, vm, &remaining);
+        if( remaining == 0 ) {
+            vm->run.cycles = budget;
+            vm->run.suspended = true;
+            vm->run.env = env;
+            vm->run.program = program;
+            return val_number(-1004);
+        }
+        result = vm_dispatch(vm, env, program, 1);
+        remaining -= vm->run.cycles;
+        if( vm->run.suspended == false ) {
+            break;
+        }
+    }
+    vm->run.cycles = budget - remaining;
+    return result;
+}
+
+static val_t vm_continue(vm_t* vm, vm_env_t* env, program_t* program) {
+    vm->run.waiting = 0;
+    if( env->jit != NULL ) {
+        return vm_run_native(vm, env, program);
+    }
+    return vm_dispatch(vm, env, program, vm->run.budget);
+}
+
+#if VM_RUNTIME_VALIDATION > 0
+# define VM_DISPATCH_FN         vm_dispatch_checked
+# define VM_DISPATCH_CHECKED    1
+# include "vm_dispatch.h"
+#endif
+
+// programs that passed the load-time verifier (vm_verify.h)
+// run without validation
+#define VM_DISPATCH_FN          vm_dispatch_unchecked
+#define VM_DISPATCH_CHECKED     0
+#include "vm_dispatch.h"
+
+static val_t vm_dispatch(vm_t* vm, vm_env_t* env, program_t* program, uint32_t budget) {
+#if VM_RUNTIME_VALIDATION > 0
+    if( vm->run.checked ) {
+        return vm_dispatch_checked(vm, env, program, budget);
+    }
+#endif
+    return vm_dispatch_unchecked(vm, env, program, budget);
+}
+
+#if VM_THREADED_DISPATCH
+# pragma GCC diagnostic pop
+#endif
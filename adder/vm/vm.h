@@ -8,6 +8,59 @@ bool vm_create(vm_t* vm, int memory_size);
 val_t vm_execute(vm_t* vm, vm_env_t* env, entry_point_t* ep, program_t* program);
 void vm_destroy(vm_t* vm);
 
+// prepared calls, for hosts that call the same entry point
+// over and over. vm_call only writes the args and clears the
+// part of the stack the entry frame of a verified program
+// (vm_verify.h) can touch, vm_execute clears the whole stack.
+// The verified export is resolved once by vm_call_prepare, each
+// call then only checks the types of its args.
+vm_call_t vm_call_prepare(vm_t* vm, vm_env_t* env, entry_point_t* ep, program_t* program);
+val_t vm_call(vm_call_t* call, val_t* args);
+
+// runs a prepared call once per item: args holds count tuples
+// of the call's argcount values, results gets one value per
+// item. With reset_heap the heap is restored to its state at
+// the start of the batch after each item (array results are
+// then not valid). Returns the number of
+// completed items. A run out of budget (or waiting on an async
+// host function) stops the batch and can be continued with
+// vm_resume (vm_complete).
+int vm_call_batch(vm_call_t* call, val_t* args, int count, val_t* results, bool reset_heap);
+
+// instruction budget per vm_execute / vm_resume call. A run
+// that exhausts it is suspended (returns -1004) and keeps its
+// stack, frames and pc so that vm_resume can continue it.
+void vm_set_cycle_budget(vm_t* vm, uint32_t budget);
+bool vm_is_suspended(vm_t* vm);
+val_t vm_resume(vm_t* vm);
+
+// garbage collection. By default the heap is collected when an
+// allocation finds no room (stop-the-world). With a budget > 0 it
+// is marked incrementally: a cycle starts once half of the free
+// values are allocated and each allocation scans up to budget
+// values. Hosts that store arrays into arrays while a cycle runs
+// use array_set (or heap_write_barrier). vm_gc_stats holds a
+// histogram of the pauses since vm_create or the last reset.
+void vm_set_gc_budget(vm_t* vm, uint32_t budget);
+vm_gc_stats_t vm_gc_stats(vm_t* vm);
+void vm_gc_stats_reset(vm_t* vm);
+
+// async host functions (FFI_HNDL_HOST_ASYNC) are called with
+// their args and suspend the run at the call, vm_execute, vm_call
+// and vm_resume then return -1009. The host keeps the vm and the
+// token of the call (vm_wait_token) and later calls vm_complete
+// with the result (ignored by void imports), which continues the
+// run after the call. vm_complete must not be called from within
+// the async host function.
+bool     vm_is_waiting(vm_t* vm);
+uint32_t vm_wait_token(vm_t* vm);
+val_t    vm_complete(vm_t* vm, uint32_t token, val_t result);
+
+// opcode pair profile (no-ops unless built
+// with VM_PROFILE_OPCODE_PAIRS)
+void vm_profile_reset(void);
+void vm_profile_dump(int max_pairs);
+
 void vm_sprint_val(cstr_t str, vm_t* vm, val_t val);
 int  vm_get_string(vm_t* vm, val_t val, char* dest, int dest_len);
 
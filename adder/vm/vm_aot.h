@@ -0,0 +1,520 @@
+#ifndef VM_AOT_H_
+#define VM_AOT_H_
+
+// Runtime support for C code translated from adder programs
+// ahead of time (co_cgen.h, adrrun -c). Every instruction is
+// turned into one AOT_* macro with the same semantics as its
+// handler in vm.c and jumps become gotos to the labels of
+// their targets. Values still live on the stack of the vm,
+// so arrays, the gc and host functions work as they do for
+// the interpreter.
+//
+// There is no instruction budget, translated code always
+// runs to completion. Like the interpreter without validation
+// it relies on the verifier (vm_verify.h): the setup fails for
+// programs that don't verify and calls check the stack for room
+// for the largest frame (frame_extent).
+
+#include "vm.h"
+#include "vm_env.h"
+#include "vm_heap.h"
+#include "vm_value_tools.h"
+#include "vm_verify.h"
+#include "sh_types.h"
+#include "sh_value.h"
+#include "sh_asminfo.h"
+#include "sh_log.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// declares the state of a translated function and pushes
+// the args, same setup as vm_execute
+#define AOT_BEGIN(VM, ENV, CONSTS, ARGC, ARGS)                  \
+    vm_t* aot_vm = (VM);                                        \
+    vm_env_t* aot_env = (ENV);                                  \
+    val_t* consts = (CONSTS);                                   \
+    val_t* stack = aot_vm->mem.stack.values;                    \
+    vm_frame_t* frames = aot_vm->mem.frames.frames;             \
+    uint32_t pc = 0;                                            \
+    int top = -1;                                               \
+    int base = 0;                                               \
+    int frame = -1;                                             \
+    int extent = 0;                                             \
+    (void) consts; (void) frames; (void) pc; (void) extent;     \
+    if( vm_env_is_ready(aot_env) == false                       \
+        || aot_env->verified == NULL ) {                        \
+        sh_log_error("incomplete vm env, cannot start execution"); \
+        return val_number(-1099);                               \
+    }                                                           \
+    extent = aot_env->verified->frame_extent;                   \
+    if( (ARGC) + extent >= aot_vm->mem.stack.size ) {           \
+        sh_log_error("\ncall stack overflow\n");                \
+        return val_number(-1006);                               \
+    }                                                           \
+    aot_vm->run.constants = consts;                             \
+    aot_vm->run.instructions = NULL;                            \
+    aot_vm->run.cycles = 0;                                     \
+    aot_vm->run.suspended = false;                              \
+    memset(stack, 0, sizeof(val_t) * aot_vm->mem.stack.size);   \
+    for(int i = 0; i < (ARGC); i++) {                           \
+        stack[++top] = (ARGS)[i];                               \
+    }
+
+#define AOT_SAVE_STATE() do {                                   \
+        aot_vm->run.pc = pc;                                    \
+        aot_vm->mem.stack.top = top;                            \
+        aot_vm->mem.stack.base = base;                          \
+        aot_vm->mem.frames.top = frame;                         \
+    } while(false)
+
+#define AOT_LOAD_STATE() do {                                   \
+        top = aot_vm->mem.stack.top;                            \
+        base = aot_vm->mem.stack.base;                          \
+        frame = aot_vm->mem.frames.top;                         \
+    } while(false)
+
+#define AOT_EXIT(VAL) do {                                      \
+        AOT_SAVE_STATE();                                       \
+        return (VAL);                                           \
+    } while(false)
+
+// the frame vm_select_entry_point pushes for
+// entry points that start with a make-frame
+#define AOT_ENTRY_FRAME() do {                                  \
+        frames[++frame] = (vm_frame_t) {                        \
+            .return_pc = -1,                                    \
+            .base = top + 1                                     \
+        };                                                      \
+    } while(false)
+
+#define AOT_UNHANDLED(OP) do {                                  \
+        sh_log_error("\nunhandled operatioin %i (%s)\n",        \
+            (OP), get_op_name(OP));                             \
+        AOT_EXIT(val_number(-1003));                            \
+    } while(false)
+
+#define AOT_EXIT_DIV_BY_ZERO() do {                             \
+        sh_log_error("\ninteger division by zero\n");           \
+        AOT_EXIT(val_number(-1007));                            \
+    } while(false)
+
+#define AOT_INT_WRAP(A, OP, B) ((int32_t) ((uint32_t) (A) OP (uint32_t) (B)))
+
+static inline int32_t aot_int_div(int32_t a, int32_t b) {
+    return (b == -1) ? AOT_INT_WRAP(0, -, a) : a / b;
+}
+
+static inline int32_t aot_int_mod(int32_t a, int32_t b) {
+    return (b == -1) ? 0 : a % b;
+}
+
+static inline void aot_call_native(vm_t* vm, vm_env_t* env, uint32_t findex) {
+    vm_native_t* native = &env->natives[findex];
+    native->call(vm, native);
+}
+
+// translated code runs without validation and can't
+// wait for async host functions
+static inline bool aot_env_check(vm_env_t* env) {
+    if( env->verified == NULL ) {
+        sh_log_error("translated code needs a program that verifies");
+        vm_env_destroy(env);
+        return false;
+    }
+    for(int i = 0; i < env->count; i++) {
+        if( env->natives[i].handle.tag == FFI_HNDL_HOST_ASYNC ) {
+            sh_log_error("async host functions are not supported by translated code");
+            vm_env_destroy(env);
+            return false;
+        }
+    }
+    return true;
+}
+
+// operand helpers
+
+#define AOT_REG(ARG) stack[base + (ARG)]
+#define AOT_RK(ARG) (OP_RK_IS_CONST((uint32_t) (ARG))          \
+    ? consts[OP_RK_INDEX((uint32_t) (ARG))]                     \
+    : AOT_REG(ARG))
+
+#define AOT_STACK_BINARY(TYPE, INTO, RESULT) do {               \
+        TYPE a = INTO(stack[top--]);                            \
+        TYPE b = INTO(stack[top--]);                            \
+        stack[++top] = (RESULT);                                \
+    } while(false)
+
+#define AOT_STACK_JUMP_UNLESS(TYPE, INTO, COND, T) do {         \
+        TYPE a = INTO(stack[top--]);                            \
+        TYPE b = INTO(stack[top--]);                            \
+        if( (COND) == false ) {                                 \
+            goto L_##T;                                         \
+        }                                                       \
+    } while(false)
+
+#define AOT_REG_BINARY(TYPE, INTO, RESULT, D, A, B) do {        \
+        TYPE a = INTO(AOT_RK(A));                               \
+        TYPE b = INTO(AOT_RK(B));                               \
+        AOT_REG(D) = (RESULT);                                  \
+    } while(false)
+
+#define AOT_REG_JUMP_UNLESS(TYPE, INTO, COND, T, A, B) do {     \
+        TYPE a = INTO(AOT_RK(A));                               \
+        TYPE b = INTO(AOT_RK(B));                               \
+        if( (COND) == false ) {                                 \
+            goto L_##T;                                         \
+        }                                                       \
+    } while(false)
+
+#define AOT_EPSILON 0.0001f
+
+// stack instructions
+
+#define AOT_PUSH_VALUE(C)           stack[++top] = consts[C]
+#define AOT_POP_1()                 top -= 1
+#define AOT_POP_2()                 top -= 2
+#define AOT_ADD()   AOT_STACK_BINARY(float, val_into_number, val_number(a + b))
+#define AOT_SUB()   AOT_STACK_BINARY(float, val_into_number, val_number(a - b))
+#define AOT_MUL()   AOT_STACK_BINARY(float, val_into_number, val_number(a * b))
+#define AOT_DIV()   AOT_STACK_BINARY(float, val_into_number, val_number(a / b))
+#define AOT_MOD()   AOT_STACK_BINARY(float, val_into_number, val_number((int) a % (int) b))
+#define AOT_NEG()                   stack[top] = val_number(-val_into_number(stack[top]))
+#define AOT_CMP_LESS_THAN()             AOT_STACK_BINARY(float, val_into_number, val_bool(a < b))
+#define AOT_CMP_LESS_THAN_OR_EQUAL()    AOT_STACK_BINARY(float, val_into_number, val_bool(a <= b))
+#define AOT_CMP_MORE_THAN()             AOT_STACK_BINARY(float, val_into_number, val_bool(a > b))
+#define AOT_CMP_MORE_THAN_OR_EQUAL()    AOT_STACK_BINARY(float, val_into_number, val_bool(a >= b))
+#define AOT_CMP_EQUAL()     AOT_STACK_BINARY(float, val_into_number, val_bool(fabs(a - b) < AOT_EPSILON))
+#define AOT_CMP_NOT_EQUAL() AOT_STACK_BINARY(float, val_into_number, val_bool(fabs(a - b) > AOT_EPSILON))
+#define AOT_AND()   AOT_STACK_BINARY(bool, val_into_bool, val_bool(a && b))
+#define AOT_OR()    AOT_STACK_BINARY(bool, val_into_bool, val_bool(a || b))
+#define AOT_NOT()                   stack[top] = val_bool(!val_into_bool(stack[top]))
+
+#define AOT_DUP_1() do {                                        \
+        val_t a = stack[top];                                   \
+        stack[++top] = a;                                       \
+    } while(false)
+
+#define AOT_DUP_2() do {                                        \
+        val_t a = stack[top - 1];                               \
+        val_t b = stack[top];                                   \
+        stack[++top] = a;                                       \
+        stack[++top] = b;                                       \
+    } while(false)
+
+#define AOT_ROT_2() do {                                        \
+        val_t a = stack[top - 1];                               \
+        stack[top - 1] = stack[top];                            \
+        stack[top] = a;                                         \
+    } while(false)
+
+#define AOT_JUMP(T)                 goto L_##T
+
+#define AOT_JUMP_IF_FALSE(T) do {                               \
+        if( val_into_bool(stack[top--]) == false ) {            \
+            goto L_##T;                                         \
+        }                                                       \
+    } while(false)
+
+#define AOT_HALT()                  AOT_EXIT(val_number(-1002))
+#define AOT_EXIT_VALUE(N)           AOT_EXIT(val_number(N))
+
+// R is the pc of the instruction after the call, the
+// translated code has a return site label for it. The stack
+// check leaves room for the frame of any function
+#define AOT_CALL(T, R) do {                                     \
+        if( frame + 1 >= aot_vm->mem.frames.size                \
+            || top + extent >= aot_vm->mem.stack.size ) {       \
+            sh_log_error("\ncall stack overflow\n");            \
+            AOT_EXIT(val_number(-1006));                        \
+        }                                                       \
+        frames[++frame] = (vm_frame_t) {                        \
+            .return_pc = (R),                                   \
+            .base = top + 1                                     \
+        };                                                      \
+        goto L_##T;                                             \
+    } while(false)
+
+// reuses the frame, the args replace its args and locals
+#define AOT_TAIL_CALL(T, NARGS) do {                            \
+        val_t* args = &stack[top - (NARGS) + 1];                \
+        for(int i = 0; i < (NARGS); i++) {                      \
+            stack[base + i] = args[i];                          \
+        }                                                       \
+        top = base + (NARGS) - 1;                               \
+        frames[frame].num_args = (NARGS);                       \
+        frames[frame].num_locals = 0;                           \
+        if( top + extent >= aot_vm->mem.stack.size ) {          \
+            sh_log_error("\ncall stack overflow\n");            \
+            AOT_EXIT(val_number(-1006));                        \
+        }                                                       \
+        goto L_##T;                                             \
+    } while(false)
+
+#define AOT_MAKE_FRAME(NARGS, NLOCALS) do {                     \
+        vm_frame_t* current = &frames[frame];                   \
+        current->base = top - (NARGS) + 1;                      \
+        current->num_args = (NARGS);                            \
+        current->num_locals = (NLOCALS);                        \
+        base = current->base;                                   \
+        if( top + (NLOCALS) >= aot_vm->mem.stack.size ) {       \
+            sh_log_error("\ncall stack overflow\n");            \
+            AOT_EXIT(val_number(-1006));                        \
+        }                                                       \
+        for(int i = 0; i < (NLOCALS); i++) {                    \
+            stack[++top] = (val_t) { 0 };                       \
+        }                                                       \
+    } while(false)
+
+// returns to the caller through the aot_return label, the
+// translated code dispatches on pc from there
+#define AOT_RETURN_NOTHING() do {                               \
+        if( frame < 0 || frames[frame].return_pc < 0 ) {        \
+            top = -1;                                           \
+            frame = -1;                                         \
+            base = 0;                                           \
+            AOT_EXIT(val_none());                               \
+        }                                                       \
+        pc = frames[frame].return_pc;                           \
+        top = base - 1;                                         \
+        frame --;                                               \
+        base = frame >= 0 ? frames[frame].base : 0;             \
+        goto aot_return;                                        \
+    } while(false)
+
+#define AOT_RETURN_VALUE() do {                                 \
+        if( frame < 0 || frames[frame].return_pc < 0 ) {        \
+            val_t rval = top >= 0 ? stack[top] : val_none();    \
+            top = -1;                                           \
+            frame = -1;                                         \
+            base = 0;                                           \
+            AOT_EXIT(rval);                                     \
+        }                                                       \
+        vm_frame_t current = frames[frame];                     \
+        int body_end = base + current.num_args + current.num_locals; \
+        int invoked_top = top;                                  \
+        val_t ret_val = stack[invoked_top];                     \
+        top = base - 1;                                         \
+        pc = current.return_pc;                                 \
+        if( invoked_top >= body_end ) {                         \
+            stack[++top] = ret_val;                             \
+        }                                                       \
+        frame --;                                               \
+        base = frame >= 0 ? frames[frame].base : 0;             \
+        goto aot_return;                                        \
+    } while(false)
+
+#define AOT_STORE_LOCAL(I)          stack[base + (I)] = stack[top--]
+#define AOT_LOAD_LOCAL(I)           stack[++top] = stack[base + (I)]
+
+#define AOT_MAKE_ARRAY() do {                                   \
+        uint32_t count = val_into_int(stack[top--]);            \
+        AOT_SAVE_STATE();                                       \
+        array_t array = heap_array_make(aot_vm, VAL_NONE,       \
+            &stack[top + 1 - count], count);                    \
+        if( ADDR_IS_NULL(array.address) ) {                     \
+            sh_log_error("\nheap alloc failed\n");              \
+            AOT_EXIT(val_number(-1005));                        \
+        }                                                       \
+        top -= count;                                           \
+        stack[++top] = val_array(array);                        \
+    } while(false)
+
+#define AOT_MAKE_PACKED_ARRAY(PACK) do {                        \
+        uint32_t count = val_into_int(stack[top--]);            \
+        AOT_SAVE_STATE();                                       \
+        array_t array = heap_array_make(aot_vm, (PACK),         \
+            &stack[top + 1 - count], count);                    \
+        if( ADDR_IS_NULL(array.address) ) {                     \
+            sh_log_error("\nheap alloc failed\n");              \
+            AOT_EXIT(val_number(-1005));                        \
+        }                                                       \
+        top -= count;                                           \
+        stack[++top] = val_array(array);                        \
+    } while(false)
+
+#define AOT_ARRAY_LENGTH()                                      \
+    stack[top] = val_int(val_into_array(stack[top]).length)
+
+#define AOT_MAKE_ITER()                                         \
+    stack[top] = val_iter(array_iter(val_into_array(stack[top])))
+
+#define AOT_ITER_NEXT(T) do {                                   \
+        iter_t iter = val_into_iter(stack[top]);                \
+        if( iter.remaining == 0 ) {                             \
+            top --;                                             \
+            goto L_##T;                                         \
+        }                                                       \
+        val_t value = iter_next_value(&iter,                    \
+            addr_get_ptr(aot_vm, iter.current));                \
+        stack[top] = val_iter(iter);                            \
+        stack[++top] = value;                                   \
+    } while(false)
+
+#define AOT_CALL_NATIVE(F) do {                                 \
+        AOT_SAVE_STATE();                                       \
+        aot_call_native(aot_vm, aot_env, (F));                  \
+        AOT_LOAD_STATE();                                       \
+    } while(false)
+
+// superinstructions
+
+#define AOT_LOAD_LOCAL_PAIR(A, B) do {                          \
+        stack[++top] = stack[base + (A)];                       \
+        stack[++top] = stack[base + (B)];                       \
+    } while(false)
+
+#define AOT_PUSH_VALUE_LOAD_LOCAL(C, I) do {                    \
+        stack[++top] = consts[C];                               \
+        stack[++top] = stack[base + (I)];                       \
+    } while(false)
+
+#define AOT_ADD_LOCALS_TO_LOCAL(A, B, D) do {                   \
+        float a = val_into_number(stack[base + (B)]);           \
+        float b = val_into_number(stack[base + (A)]);           \
+        stack[base + (D)] = val_number(a + b);                  \
+    } while(false)
+
+#define AOT_INC_LOCAL_BY_CONST(I, C) do {                       \
+        float a = val_into_number(stack[base + (I)]);           \
+        float b = val_into_number(consts[C]);                   \
+        stack[base + (I)] = val_number(a + b);                  \
+    } while(false)
+
+#define AOT_JUMP_IF_NOT_EQUAL(T)    AOT_STACK_JUMP_UNLESS(float, val_into_number, fabs(a - b) < AOT_EPSILON, T)
+#define AOT_JUMP_IF_NOT_NOT_EQUAL(T) AOT_STACK_JUMP_UNLESS(float, val_into_number, fabs(a - b) > AOT_EPSILON, T)
+#define AOT_JUMP_IF_NOT_LESS_THAN(T) AOT_STACK_JUMP_UNLESS(float, val_into_number, a < b, T)
+#define AOT_JUMP_IF_NOT_MORE_THAN(T) AOT_STACK_JUMP_UNLESS(float, val_into_number, a > b, T)
+#define AOT_JUMP_IF_NOT_LESS_THAN_OR_EQUAL(T) AOT_STACK_JUMP_UNLESS(float, val_into_number, a <= b, T)
+#define AOT_JUMP_IF_NOT_MORE_THAN_OR_EQUAL(T) AOT_STACK_JUMP_UNLESS(float, val_into_number, a >= b, T)
+
+#define AOT_ITER_NEXT_STORE_LOCAL(T, I) do {                    \
+        iter_t iter = val_into_iter(stack[top]);                \
+        if( iter.remaining == 0 ) {                             \
+            top --;                                             \
+            goto L_##T;                                         \
+        }                                                       \
+        stack[base + (I)] = iter_next_value(&iter,              \
+            addr_get_ptr(aot_vm, iter.current));                \
+        stack[top] = val_iter(iter);                            \
+    } while(false)
+
+// register instructions
+
+#define AOT_R_MOVE(D, S)            AOT_REG(D) = AOT_RK(S)
+#define AOT_R_ADD(D, A, B)  AOT_REG_BINARY(float, val_into_number, val_number(a + b), D, A, B)
+#define AOT_R_SUB(D, A, B)  AOT_REG_BINARY(float, val_into_number, val_number(a - b), D, A, B)
+#define AOT_R_MUL(D, A, B)  AOT_REG_BINARY(float, val_into_number, val_number(a * b), D, A, B)
+#define AOT_R_DIV(D, A, B)  AOT_REG_BINARY(float, val_into_number, val_number(a / b), D, A, B)
+#define AOT_R_MOD(D, A, B)  AOT_REG_BINARY(float, val_into_number, val_number((int) a % (int) b), D, A, B)
+#define AOT_R_NEG(D, S)             AOT_REG(D) = val_number(-val_into_number(AOT_RK(S)))
+#define AOT_R_AND(D, A, B)  AOT_REG_BINARY(bool, val_into_bool, val_bool(a && b), D, A, B)
+#define AOT_R_OR(D, A, B)   AOT_REG_BINARY(bool, val_into_bool, val_bool(a || b), D, A, B)
+#define AOT_R_NOT(D, S)             AOT_REG(D) = val_bool(!val_into_bool(AOT_RK(S)))
+#define AOT_R_CMP_EQUAL(D, A, B)     AOT_REG_BINARY(float, val_into_number, val_bool(fabs(a - b) < AOT_EPSILON), D, A, B)
+#define AOT_R_CMP_NOT_EQUAL(D, A, B) AOT_REG_BINARY(float, val_into_number, val_bool(fabs(a - b) > AOT_EPSILON), D, A, B)
+#define AOT_R_CMP_LESS_THAN(D, A, B) AOT_REG_BINARY(float, val_into_number, val_bool(a < b), D, A, B)
+#define AOT_R_CMP_MORE_THAN(D, A, B) AOT_REG_BINARY(float, val_into_number, val_bool(a > b), D, A, B)
+#define AOT_R_CMP_LESS_THAN_OR_EQUAL(D, A, B) AOT_REG_BINARY(float, val_into_number, val_bool(a <= b), D, A, B)
+#define AOT_R_CMP_MORE_THAN_OR_EQUAL(D, A, B) AOT_REG_BINARY(float, val_into_number, val_bool(a >= b), D, A, B)
+
+#define AOT_R_JUMP_IF_FALSE(T, S) do {                          \
+        if( val_into_bool(AOT_RK(S)) == false ) {               \
+            goto L_##T;                                         \
+        }                                                       \
+    } while(false)
+
+#define AOT_R_JUMP_IF_NOT_EQUAL(T, A, B)     AOT_REG_JUMP_UNLESS(float, val_into_number, fabs(a - b) < AOT_EPSILON, T, A, B)
+#define AOT_R_JUMP_IF_NOT_NOT_EQUAL(T, A, B) AOT_REG_JUMP_UNLESS(float, val_into_number, fabs(a - b) > AOT_EPSILON, T, A, B)
+#define AOT_R_JUMP_IF_NOT_LESS_THAN(T, A, B) AOT_REG_JUMP_UNLESS(float, val_into_number, a < b, T, A, B)
+#define AOT_R_JUMP_IF_NOT_MORE_THAN(T, A, B) AOT_REG_JUMP_UNLESS(float, val_into_number, a > b, T, A, B)
+#define AOT_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL(T, A, B) AOT_REG_JUMP_UNLESS(float, val_into_number, a <= b, T, A, B)
+#define AOT_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL(T, A, B) AOT_REG_JUMP_UNLESS(float, val_into_number, a >= b, T, A, B)
+
+// integer instructions
+
+#define AOT_IADD()  AOT_STACK_BINARY(int32_t, val_into_int, val_int(AOT_INT_WRAP(a, +, b)))
+#define AOT_ISUB()  AOT_STACK_BINARY(int32_t, val_into_int, val_int(AOT_INT_WRAP(a, -, b)))
+#define AOT_IMUL()  AOT_STACK_BINARY(int32_t, val_into_int, val_int(AOT_INT_WRAP(a, *, b)))
+
+#define AOT_IDIV() do {                                         \
+        int32_t a = val_into_int(stack[top--]);                 \
+        int32_t b = val_into_int(stack[top--]);                 \
+        if( b == 0 ) {                                          \
+            AOT_EXIT_DIV_BY_ZERO();                             \
+        }                                                       \
+        stack[++top] = val_int(aot_int_div(a, b));              \
+    } while(false)
+
+#define AOT_IMOD() do {                                         \
+        int32_t a = val_into_int(stack[top--]);                 \
+        int32_t b = val_into_int(stack[top--]);                 \
+        if( b == 0 ) {                                          \
+            AOT_EXIT_DIV_BY_ZERO();                             \
+        }                                                       \
+        stack[++top] = val_int(aot_int_mod(a, b));              \
+    } while(false)
+
+#define AOT_INEG()  stack[top] = val_int(AOT_INT_WRAP(0, -, val_into_int(stack[top])))
+#define AOT_ICMP_EQUAL()        AOT_STACK_BINARY(int32_t, val_into_int, val_bool(a == b))
+#define AOT_ICMP_NOT_EQUAL()    AOT_STACK_BINARY(int32_t, val_into_int, val_bool(a != b))
+#define AOT_ICMP_LESS_THAN()    AOT_STACK_BINARY(int32_t, val_into_int, val_bool(a < b))
+#define AOT_ICMP_MORE_THAN()    AOT_STACK_BINARY(int32_t, val_into_int, val_bool(a > b))
+#define AOT_ICMP_LESS_THAN_OR_EQUAL() AOT_STACK_BINARY(int32_t, val_into_int, val_bool(a <= b))
+#define AOT_ICMP_MORE_THAN_OR_EQUAL() AOT_STACK_BINARY(int32_t, val_into_int, val_bool(a >= b))
+#define AOT_INT_TO_FLOAT()  stack[top] = val_number((float) val_into_int(stack[top]))
+
+#define AOT_IADD_LOCALS_TO_LOCAL(A, B, D) do {                  \
+        int32_t a = val_into_int(stack[base + (B)]);            \
+        int32_t b = val_into_int(stack[base + (A)]);            \
+        stack[base + (D)] = val_int(AOT_INT_WRAP(a, +, b));     \
+    } while(false)
+
+#define AOT_IINC_LOCAL_BY_CONST(I, C) do {                      \
+        int32_t a = val_into_int(stack[base + (I)]);            \
+        int32_t b = val_into_int(consts[C]);                    \
+        stack[base + (I)] = val_int(AOT_INT_WRAP(a, +, b));     \
+    } while(false)
+
+#define AOT_JUMP_IF_NOT_IEQUAL(T)     AOT_STACK_JUMP_UNLESS(int32_t, val_into_int, a == b, T)
+#define AOT_JUMP_IF_NOT_INOT_EQUAL(T) AOT_STACK_JUMP_UNLESS(int32_t, val_into_int, a != b, T)
+#define AOT_JUMP_IF_NOT_ILESS_THAN(T) AOT_STACK_JUMP_UNLESS(int32_t, val_into_int, a < b, T)
+#define AOT_JUMP_IF_NOT_IMORE_THAN(T) AOT_STACK_JUMP_UNLESS(int32_t, val_into_int, a > b, T)
+#define AOT_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL(T) AOT_STACK_JUMP_UNLESS(int32_t, val_into_int, a <= b, T)
+#define AOT_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL(T) AOT_STACK_JUMP_UNLESS(int32_t, val_into_int, a >= b, T)
+
+#define AOT_R_IADD(D, A, B) AOT_REG_BINARY(int32_t, val_into_int, val_int(AOT_INT_WRAP(a, +, b)), D, A, B)
+#define AOT_R_ISUB(D, A, B) AOT_REG_BINARY(int32_t, val_into_int, val_int(AOT_INT_WRAP(a, -, b)), D, A, B)
+#define AOT_R_IMUL(D, A, B) AOT_REG_BINARY(int32_t, val_into_int, val_int(AOT_INT_WRAP(a, *, b)), D, A, B)
+
+#define AOT_R_IDIV(D, A, B) do {                                \
+        if( val_into_int(AOT_RK(B)) == 0 ) {                    \
+            AOT_EXIT_DIV_BY_ZERO();                             \
+        }                                                       \
+        AOT_REG_BINARY(int32_t, val_into_int, val_int(aot_int_div(a, b)), D, A, B); \
+    } while(false)
+
+#define AOT_R_IMOD(D, A, B) do {                                \
+        if( val_into_int(AOT_RK(B)) == 0 ) {                    \
+            AOT_EXIT_DIV_BY_ZERO();                             \
+        }                                                       \
+        AOT_REG_BINARY(int32_t, val_into_int, val_int(aot_int_mod(a, b)), D, A, B); \
+    } while(false)
+
+#define AOT_R_INEG(D, S)    AOT_REG(D) = val_int(AOT_INT_WRAP(0, -, val_into_int(AOT_RK(S))))
+#define AOT_R_ICMP_EQUAL(D, A, B)     AOT_REG_BINARY(int32_t, val_into_int, val_bool(a == b), D, A, B)
+#define AOT_R_ICMP_NOT_EQUAL(D, A, B) AOT_REG_BINARY(int32_t, val_into_int, val_bool(a != b), D, A, B)
+#define AOT_R_ICMP_LESS_THAN(D, A, B) AOT_REG_BINARY(int32_t, val_into_int, val_bool(a < b), D, A, B)
+#define AOT_R_ICMP_MORE_THAN(D, A, B) AOT_REG_BINARY(int32_t, val_into_int, val_bool(a > b), D, A, B)
+#define AOT_R_ICMP_LESS_THAN_OR_EQUAL(D, A, B) AOT_REG_BINARY(int32_t, val_into_int, val_bool(a <= b), D, A, B)
+#define AOT_R_ICMP_MORE_THAN_OR_EQUAL(D, A, B) AOT_REG_BINARY(int32_t, val_into_int, val_bool(a >= b), D, A, B)
+
+#define AOT_R_JUMP_IF_NOT_IEQUAL(T, A, B)     AOT_REG_JUMP_UNLESS(int32_t, val_into_int, a == b, T, A, B)
+#define AOT_R_JUMP_IF_NOT_INOT_EQUAL(T, A, B) AOT_REG_JUMP_UNLESS(int32_t, val_into_int, a != b, T, A, B)
+#define AOT_R_JUMP_IF_NOT_ILESS_THAN(T, A, B) AOT_REG_JUMP_UNLESS(int32_t, val_into_int, a < b, T, A, B)
+#define AOT_R_JUMP_IF_NOT_IMORE_THAN(T, A, B) AOT_REG_JUMP_UNLESS(int32_t, val_into_int, a > b, T, A, B)
+#define AOT_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL(T, A, B) AOT_REG_JUMP_UNLESS(int32_t, val_into_int, a <= b, T, A, B)
+#define AOT_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL(T, A, B) AOT_REG_JUMP_UNLESS(int32_t, val_into_int, a >= b, T, A, B)
+
+#endif // VM_AOT_H_
@@ -0,0 +1,906 @@
+// The interpreter loop, included by vm.c once per variant:
+//
+//   VM_DISPATCH_FN       the name of the function
+//   VM_DISPATCH_CHECKED  1: validate each instruction (vm_validate.h)
+//
+// Runs the program from the pc, stack and frames currently
+// stored in the vm until it exits or the budget runs out.
+
+#if VM_DISPATCH_CHECKED
+# define VM_VALIDATE_PRE(OP) do {           \
+        VM_SAVE_STATE();                    \
+        VALIDATE_PRE(vm, OP);               \
+    } while(false)
+# define VM_VALIDATE_POST(OP) do {          \
+        VM_SAVE_STATE();                    \
+        VALIDATE_POST(vm, OP);              \
+    } while(false)
+#else
+# define VM_VALIDATE_PRE(OP)
+# define VM_VALIDATE_POST(OP)
+#endif
+
+static val_t VM_DISPATCH_FN(vm_t* vm, vm_env_t* env, program_t* program, uint32_t budget) {
+
+    val_t* stack = vm->mem.stack.values;
+    vm_frame_t* frames = vm->mem.frames.frames;
+    val_t* consts = program->cons.buffer;
+    uint8_t* instructions = program->inst.buffer;
+
+    vm_runtime_t* vm_run = &vm->run;
+    vm_mem_t* vm_mem = &vm->mem;
+
+    uint32_t cycles_budget = budget;
+    if (program->inst.size == 0) {
+        cycles_budget = 0;
+    }
+    uint32_t cycles_remaining = cycles_budget;
+
+    vm_run->suspended = false;
+    vm_run->env = env;
+    vm_run->program = program;
+
+    assert(OP_OPCODE_COUNT == 112 && "Opcode count changed.");
+
+#if VM_THREADED_DISPATCH
+    // one entry per byte value, an opcode past the known ones
+    // (unverified programs without validation) ends up at the
+    // default handler instead of jumping through memory past
+    // the table
+# pragma GCC diagnostic push
+# pragma GCC diagnostic ignored "-Woverride-init"
+    static void* dispatch_table[256] = {
+        [0 ... 255]                 = &&L_DEFAULT,
+        [OP_HALT]                   = &&L_OP_HALT,
+        [OP_AND]                    = &&L_OP_AND,
+        [OP_OR]                     = &&L_OP_OR,
+        [OP_NOT]                    = &&L_OP_NOT,
+        [OP_MUL]                    = &&L_OP_MUL,
+        [OP_DIV]                    = &&L_OP_DIV,
+        [OP_MOD]                    = &&L_OP_MOD,
+        [OP_ADD]                    = &&L_OP_ADD,
+        [OP_SUB]                    = &&L_OP_SUB,
+        [OP_NEG]                    = &&L_OP_NEG,
+        [OP_DUP_1]                  = &&L_OP_DUP_1,
+        [OP_DUP_2]                  = &&L_OP_DUP_2,
+        [OP_ROT_2]                  = &&L_OP_ROT_2,
+        [OP_CMP_EQUAL]              = &&L_OP_CMP_EQUAL,
+        [OP_CMP_NOT_EQUAL]          = &&L_OP_CMP_NOT_EQUAL,
+        [OP_CMP_LESS_THAN]          = &&L_OP_CMP_LESS_THAN,
+        [OP_CMP_MORE_THAN]          = &&L_OP_CMP_MORE_THAN,
+        [OP_CMP_LESS_THAN_OR_EQUAL] = &&L_OP_CMP_LESS_THAN_OR_EQUAL,
+        [OP_CMP_MORE_THAN_OR_EQUAL] = &&L_OP_CMP_MORE_THAN_OR_EQUAL,
+        [OP_PUSH_VALUE]             = &&L_OP_PUSH_VALUE,
+        [OP_POP_1]                  = &&L_OP_POP_1,
+        [OP_POP_2]                  = &&L_OP_POP_2,
+        [OP_JUMP]                   = &&L_OP_JUMP,
+        [OP_JUMP_IF_FALSE]          = &&L_OP_JUMP_IF_FALSE,
+        [OP_EXIT]                   = &&L_OP_EXIT,
+        [OP_CALL]                   = &&L_OP_CALL,
+        [OP_MAKE_FRAME]             = &&L_OP_MAKE_FRAME,
+        [OP_RETURN_NOTHING]         = &&L_OP_RETURN_NOTHING,
+        [OP_RETURN_VALUE]           = &&L_OP_RETURN_VALUE,
+        [OP_STORE_LOCAL]            = &&L_OP_STORE_LOCAL,
+        [OP_LOAD_LOCAL]             = &&L_OP_LOAD_LOCAL,
+        [OP_PRINT]                  = &&L_DEFAULT,
+        [OP_MAKE_ARRAY]             = &&L_OP_MAKE_ARRAY,
+        [OP_ARRAY_LENGTH]           = &&L_OP_ARRAY_LENGTH,
+        [OP_MAKE_ITER]              = &&L_OP_MAKE_ITER,
+        [OP_ITER_NEXT]              = &&L_OP_ITER_NEXT,
+        [OP_CALL_NATIVE]            = &&L_OP_CALL_NATIVE,
+        [OP_LOAD_LOCAL_PAIR]        = &&L_OP_LOAD_LOCAL_PAIR,
+        [OP_PUSH_VALUE_LOAD_LOCAL]  = &&L_OP_PUSH_VALUE_LOAD_LOCAL,
+        [OP_ADD_LOCALS_TO_LOCAL]    = &&L_OP_ADD_LOCALS_TO_LOCAL,
+        [OP_INC_LOCAL_BY_CONST]     = &&L_OP_INC_LOCAL_BY_CONST,
+        [OP_JUMP_IF_NOT_EQUAL]      = &&L_OP_JUMP_IF_NOT_EQUAL,
+        [OP_JUMP_IF_NOT_NOT_EQUAL]  = &&L_OP_JUMP_IF_NOT_NOT_EQUAL,
+        [OP_JUMP_IF_NOT_LESS_THAN]  = &&L_OP_JUMP_IF_NOT_LESS_THAN,
+        [OP_JUMP_IF_NOT_MORE_THAN]  = &&L_OP_JUMP_IF_NOT_MORE_THAN,
+        [OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL] = &&L_OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL,
+        [OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL] = &&L_OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL,
+        [OP_ITER_NEXT_STORE_LOCAL]  = &&L_OP_ITER_NEXT_STORE_LOCAL,
+        [OP_R_MOVE]                 = &&L_OP_R_MOVE,
+        [OP_R_ADD]                  = &&L_OP_R_ADD,
+        [OP_R_SUB]                  = &&L_OP_R_SUB,
+        [OP_R_MUL]                  = &&L_OP_R_MUL,
+        [OP_R_DIV]                  = &&L_OP_R_DIV,
+        [OP_R_MOD]                  = &&L_OP_R_MOD,
+        [OP_R_NEG]                  = &&L_OP_R_NEG,
+        [OP_R_AND]                  = &&L_OP_R_AND,
+        [OP_R_OR]                   = &&L_OP_R_OR,
+        [OP_R_NOT]                  = &&L_OP_R_NOT,
+        [OP_R_CMP_EQUAL]            = &&L_OP_R_CMP_EQUAL,
+        [OP_R_CMP_NOT_EQUAL]        = &&L_OP_R_CMP_NOT_EQUAL,
+        [OP_R_CMP_LESS_THAN]        = &&L_OP_R_CMP_LESS_THAN,
+        [OP_R_CMP_MORE_THAN]        = &&L_OP_R_CMP_MORE_THAN,
+        [OP_R_CMP_LESS_THAN_OR_EQUAL] = &&L_OP_R_CMP_LESS_THAN_OR_EQUAL,
+        [OP_R_CMP_MORE_THAN_OR_EQUAL] = &&L_OP_R_CMP_MORE_THAN_OR_EQUAL,
+        [OP_R_JUMP_IF_FALSE]        = &&L_OP_R_JUMP_IF_FALSE,
+        [OP_R_JUMP_IF_NOT_EQUAL]    = &&L_OP_R_JUMP_IF_NOT_EQUAL,
+        [OP_R_JUMP_IF_NOT_NOT_EQUAL] = &&L_OP_R_JUMP_IF_NOT_NOT_EQUAL,
+        [OP_R_JUMP_IF_NOT_LESS_THAN] = &&L_OP_R_JUMP_IF_NOT_LESS_THAN,
+        [OP_R_JUMP_IF_NOT_MORE_THAN] = &&L_OP_R_JUMP_IF_NOT_MORE_THAN,
+        [OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL] = &&L_OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL,
+        [OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL] = &&L_OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL,
+        [OP_IADD]                   = &&L_OP_IADD,
+        [OP_ISUB]                   = &&L_OP_ISUB,
+        [OP_IMUL]                   = &&L_OP_IMUL,
+        [OP_IDIV]                   = &&L_OP_IDIV,
+        [OP_IMOD]                   = &&L_OP_IMOD,
+        [OP_INEG]                   = &&L_OP_INEG,
+        [OP_ICMP_EQUAL]             = &&L_OP_ICMP_EQUAL,
+        [OP_ICMP_NOT_EQUAL]         = &&L_OP_ICMP_NOT_EQUAL,
+        [OP_ICMP_LESS_THAN]         = &&L_OP_ICMP_LESS_THAN,
+        [OP_ICMP_MORE_THAN]         = &&L_OP_ICMP_MORE_THAN,
+        [OP_ICMP_LESS_THAN_OR_EQUAL] = &&L_OP_ICMP_LESS_THAN_OR_EQUAL,
+        [OP_ICMP_MORE_THAN_OR_EQUAL] = &&L_OP_ICMP_MORE_THAN_OR_EQUAL,
+        [OP_INT_TO_FLOAT]           = &&L_OP_INT_TO_FLOAT,
+        [OP_IADD_LOCALS_TO_LOCAL]   = &&L_OP_IADD_LOCALS_TO_LOCAL,
+        [OP_IINC_LOCAL_BY_CONST]    = &&L_OP_IINC_LOCAL_BY_CONST,
+        [OP_JUMP_IF_NOT_IEQUAL]     = &&L_OP_JUMP_IF_NOT_IEQUAL,
+        [OP_JUMP_IF_NOT_INOT_EQUAL] = &&L_OP_JUMP_IF_NOT_INOT_EQUAL,
+        [OP_JUMP_IF_NOT_ILESS_THAN] = &&L_OP_JUMP_IF_NOT_ILESS_THAN,
+        [OP_JUMP_IF_NOT_IMORE_THAN] = &&L_OP_JUMP_IF_NOT_IMORE_THAN,
+        [OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL] = &&L_OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL,
+        [OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL] = &&L_OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL,
+        [OP_R_IADD]                 = &&L_OP_R_IADD,
+        [OP_R_ISUB]                 = &&L_OP_R_ISUB,
+        [OP_R_IMUL]                 = &&L_OP_R_IMUL,
+        [OP_R_IDIV]                 = &&L_OP_R_IDIV,
+        [OP_R_IMOD]                 = &&L_OP_R_IMOD,
+        [OP_R_INEG]                 = &&L_OP_R_INEG,
+        [OP_R_ICMP_EQUAL]           = &&L_OP_R_ICMP_EQUAL,
+        [OP_R_ICMP_NOT_EQUAL]       = &&L_OP_R_ICMP_NOT_EQUAL,
+        [OP_R_ICMP_LESS_THAN]       = &&L_OP_R_ICMP_LESS_THAN,
+        [OP_R_ICMP_MORE_THAN]       = &&L_OP_R_ICMP_MORE_THAN,
+        [OP_R_ICMP_LESS_THAN_OR_EQUAL] = &&L_OP_R_ICMP_LESS_THAN_OR_EQUAL,
+        [OP_R_ICMP_MORE_THAN_OR_EQUAL] = &&L_OP_R_ICMP_MORE_THAN_OR_EQUAL,
+        [OP_R_JUMP_IF_NOT_IEQUAL]   = &&L_OP_R_JUMP_IF_NOT_IEQUAL,
+        [OP_R_JUMP_IF_NOT_INOT_EQUAL] = &&L_OP_R_JUMP_IF_NOT_INOT_EQUAL,
+        [OP_R_JUMP_IF_NOT_ILESS_THAN] = &&L_OP_R_JUMP_IF_NOT_ILESS_THAN,
+        [OP_R_JUMP_IF_NOT_IMORE_THAN] = &&L_OP_R_JUMP_IF_NOT_IMORE_THAN,
+        [OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL] = &&L_OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL,
+        [OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL] = &&L_OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL,
+        [OP_TAIL_CALL]              = &&L_OP_TAIL_CALL,
+        [OP_MAKE_PACKED_ARRAY]      = &&L_OP_MAKE_PACKED_ARRAY
+    };
+# pragma GCC diagnostic pop
+#endif
+
+    uint32_t pc;
+    int top;
+    int base;
+    int frame;
+    vm_op_t opcode = OP_OPCODE_COUNT;
+
+    VM_LOAD_STATE();
+
+#if VM_THREADED_DISPATCH
+    VM_FETCH();
+    goto *dispatch_table[opcode];
+    {
+#else
+    while ( true ) {
+        VM_FETCH();
+        switch (opcode) {
+#endif
+            VM_CASE(OP_PUSH_VALUE): {
+                uint32_t const_index = READ_U32(instructions, pc);
+                TRACE_INT_ARG(const_index);
+                stack[++top] = consts[const_index];
+                pc += 4;
+            } VM_NEXT();
+            VM_CASE(OP_POP_1): {
+                top -= 1;
+            } VM_NEXT();
+            VM_CASE(OP_POP_2): {
+                top -= 2;
+            } VM_NEXT();
+            VM_CASE(OP_ADD): {
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_number(a + b);
+            } VM_NEXT();
+            VM_CASE(OP_SUB): {
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_number(a - b);
+            } VM_NEXT();
+            VM_CASE(OP_MUL): {
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_number(a * b);
+            } VM_NEXT();
+            VM_CASE(OP_DIV): {
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_number(a / b);
+            } VM_NEXT();
+            VM_CASE(OP_MOD): {
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_number((int) a % (int) b);
+            } VM_NEXT();
+            VM_CASE(OP_NEG): {
+                float a = val_into_number(stack[top--]);
+                stack[++top] = val_number(-a);
+            } VM_NEXT();
+            VM_CASE(OP_CMP_LESS_THAN): {
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_bool( a < b );
+            } VM_NEXT();
+            VM_CASE(OP_CMP_LESS_THAN_OR_EQUAL): {
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_bool( a <= b );
+            } VM_NEXT();
+            VM_CASE(OP_CMP_MORE_THAN): {
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_bool( a > b );
+            } VM_NEXT();
+            VM_CASE(OP_CMP_MORE_THAN_OR_EQUAL): {
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_bool( a >= b );
+            } VM_NEXT();
+            VM_CASE(OP_CMP_EQUAL): {
+                // todo: other types than numbers
+                const float epsilon = 0.0001f;
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_bool( fabs(a - b) < epsilon );
+            } VM_NEXT();
+            VM_CASE(OP_CMP_NOT_EQUAL): {
+                // todo: other types than numbers
+                const float epsilon = 0.0001f;
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                stack[++top] = val_bool( fabs(a - b) > epsilon );
+            } VM_NEXT();
+            VM_CASE(OP_AND): {
+                bool a = val_into_bool(stack[top--]);
+                bool b = val_into_bool(stack[top--]);
+                stack[++top] = val_bool( a && b );
+            } VM_NEXT();
+            VM_CASE(OP_OR): {
+                bool a = val_into_bool(stack[top--]);
+                bool b = val_into_bool(stack[top--]);
+                stack[++top] = val_bool( a || b );
+            } VM_NEXT();
+            VM_CASE(OP_NOT): {
+                bool a = val_into_bool(stack[top--]);
+                stack[++top] = val_bool( !a );
+            } VM_NEXT();
+            VM_CASE(OP_DUP_1): {
+                val_t a = stack[top];
+                stack[++top] = a;
+            } VM_NEXT();
+            VM_CASE(OP_DUP_2): {
+                val_t a = stack[top - 1];
+                val_t b = stack[top];
+                stack[++top] = a;
+                stack[++top] = b;
+            } VM_NEXT();
+            VM_CASE(OP_ROT_2): {
+                val_t a = stack[top - 1];
+                val_t b = stack[top];
+                stack[top - 1] = b;
+                stack[top]     = a;
+            } VM_NEXT();
+            VM_CASE(OP_JUMP): {
+                pc = READ_U32(instructions, pc);
+                TRACE_INT_ARG(pc);
+            } VM_NEXT();
+            VM_CASE(OP_JUMP_IF_FALSE): {
+                TRACE_INT_ARG(READ_U32(instructions, pc));
+                if( val_into_bool(stack[top--]) == false ) {
+                    pc = READ_U32(instructions, pc);
+                } else {
+                    pc += 4;
+                }
+            } VM_NEXT();
+            VM_CASE(OP_HALT): {
+                TRACE_NL();
+                VM_EXIT(val_number(-1002));
+            }
+            VM_CASE(OP_EXIT): {
+                TRACE_NL();
+                uint32_t return_value = READ_U32(instructions, pc);
+                TRACE_INT_ARG(return_value);
+                VM_EXIT(val_number(return_value));
+            }
+            VM_CASE(OP_CALL): {
+                // the stack check leaves room for the frame of
+                // any verified function (vm_verify.h)
+                if( frame + 1 >= vm_mem->frames.size
+                    || top + vm_run->extent >= vm_mem->stack.size ) {
+                    sh_log_error("\ncall stack overflow\n");
+                    VM_EXIT(val_number(-1006));
+                }
+                // push a frame with the return address, the
+                // rest of it is filled in by OP_MAKE_FRAME
+                frames[++frame] = (vm_frame_t) {
+                    .return_pc = pc + 4,
+                    .base = top + 1
+                };
+                // jump to label / function
+                pc = READ_U32(instructions, pc);
+                TRACE_INT_ARG(pc);
+            } VM_NEXT();
+            VM_CASE(OP_TAIL_CALL): {
+                uint32_t target = READ_U32(instructions, pc);
+                uint32_t nargs = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(target);
+                TRACE_INT_ARG(nargs);
+                // the frame is reused: the args replace the args
+                // and locals of the caller, the return address is
+                // kept and OP_MAKE_FRAME sets up the rest
+                val_t* args = &stack[top - nargs + 1];
+                for(uint32_t i = 0; i < nargs; i++) {
+                    stack[base + i] = args[i];
+                }
+                top = base + nargs - 1;
+                frames[frame].num_args = nargs;
+                frames[frame].num_locals = 0;
+                if( top + vm_run->extent >= vm_mem->stack.size ) {
+                    sh_log_error("\ncall stack overflow\n");
+                    VM_EXIT(val_number(-1006));
+                }
+                pc = target;
+            } VM_NEXT();
+            VM_CASE(OP_MAKE_FRAME): {
+
+                uint32_t nargs = READ_U32(instructions, pc);
+                TRACE_INT_ARG(nargs);
+                pc += 4;
+
+                uint32_t nlocals = READ_U32(instructions, pc);
+                TRACE_INT_ARG(nlocals);
+                pc += 4;
+
+                // the args are already in place on top
+                // of the stack, followed by the locals
+                vm_frame_t* current = &frames[frame];
+                current->base = top - nargs + 1;
+                current->num_args = nargs;
+                current->num_locals = nlocals;
+                base = current->base;
+
+                // OBS: ZERO INIT MIGHT NOT BE NEEDED!!
+                // init locals (not needed)
+                for(uint32_t i = 0; i < nlocals; i++) {
+                    stack[++top] = (val_t) { 0 };
+                }
+
+            } VM_NEXT();
+            VM_CASE(OP_RETURN_NOTHING): {
+
+                // Note: if the return address is negative we exit the vm.
+                if( frame < 0 || frames[frame].return_pc < 0 ) {
+                    // drop the args and locals of
+                    // the entry point frame
+                    top = -1;
+                    frame = -1;
+                    base = 0;
+                    VM_EXIT(val_none());
+                }
+
+                // update pc to resume at call site
+                pc = frames[frame].return_pc;
+
+                // drop args and locals
+                top = base - 1;
+
+                // back to the parent frame
+                frame --;
+                base = frame >= 0 ? frames[frame].base : 0;
+            } VM_NEXT();
+            VM_CASE(OP_RETURN_VALUE): {
+
+                if( frame < 0 || frames[frame].return_pc < 0 ) {
+                    // Note: if the return address is negative we exit the vm
+                    //       returning the top of stack element. 
+                    val_t rval = val_none();
+                    if( top >= 0 ) {
+                        rval = stack[top];
+                    }
+                    // drop the args and locals of
+                    // the entry point frame
+                    top = -1;
+                    frame = -1;
+                    base = 0;
+                    VM_EXIT(rval);
+                }
+
+                vm_frame_t current = frames[frame];
+                int body_end = base + current.num_args + current.num_locals;
+                int invoked_top = top;
+                // copy possible return value
+                val_t ret_val = stack[invoked_top];
+                // drop args and locals
+                top = base - 1;
+                // update pc to resume at call site
+                pc = current.return_pc; 
+                // check if we have a return value
+                if(invoked_top >= body_end) {
+                    // push return value
+                    stack[++top] = ret_val;
+                }
+
+                // back to the parent frame
+                frame --;
+                base = frame >= 0 ? frames[frame].base : 0;
+
+            } VM_NEXT();
+            VM_CASE(OP_STORE_LOCAL): {
+                uint32_t local_idx = READ_U32(instructions, pc);
+                TRACE_INT_ARG(local_idx);
+                stack[base + local_idx] = stack[top--];
+                pc += 4;
+            } VM_NEXT();
+            VM_CASE(OP_LOAD_LOCAL): {
+                uint32_t local_idx = READ_U32(instructions, pc);
+                TRACE_INT_ARG(local_idx);
+                stack[++top] = stack[base + local_idx];
+                pc += 4;
+            } VM_NEXT();
+            VM_CASE(OP_MAKE_ARRAY): {
+                // pop array size
+                val_t size = stack[top--];
+                uint32_t count = val_into_int(size);
+                // allocate array (may run the gc, which
+                // needs to see the current stack top)
+                VM_SAVE_STATE();
+                val_t* source_ptr = &stack[top + 1 - count];
+                array_t array = heap_array_make(vm, VAL_NONE, source_ptr, count);
+                if( ADDR_IS_NULL(array.address) ) {
+                    sh_log_error("\nheap alloc failed\n");
+                    VM_EXIT(val_number(-1005));
+                }
+                // remove the data from the stack
+                top -= count; 
+                stack[++top] = val_array(array);
+            } VM_NEXT();
+            VM_CASE(OP_MAKE_PACKED_ARRAY): {
+                // like make-array, the arg is the element type
+                val_type_t pack = (val_type_t) READ_U32(instructions, pc);
+                TRACE_INT_ARG(pack);
+                pc += 4;
+                uint32_t count = val_into_int(stack[top--]);
+                VM_SAVE_STATE();
+                array_t array = heap_array_make(vm, pack, &stack[top + 1 - count], count);
+                if( ADDR_IS_NULL(array.address) ) {
+                    sh_log_error("\nheap alloc failed\n");
+                    VM_EXIT(val_number(-1005));
+                }
+                top -= count;
+                stack[++top] = val_array(array);
+            } VM_NEXT();
+            VM_CASE(OP_ARRAY_LENGTH): {
+                val_t array_val = stack[top--];
+                array_t array = val_into_array(array_val);
+                stack[++top] = val_int(array.length);
+            } VM_NEXT();
+            VM_CASE(OP_MAKE_ITER): {
+                val_t array_val = stack[top--];
+                stack[++top] = val_iter(array_iter(val_into_array(array_val)));
+            } VM_NEXT();
+            VM_CASE(OP_ITER_NEXT): {
+                uint32_t exit_pc = READ_U32(instructions, pc);
+                TRACE_INT_ARG(exit_pc);
+                val_t iter_val = stack[top];
+                iter_t iter = val_into_iter(iter_val);
+                if( iter.remaining == 0 ) {
+                    top --;
+                    pc = exit_pc;
+                } else {
+                    val_t value = iter_next_value(&iter, addr_get_ptr(vm, iter.current));
+                    stack[top] = val_iter(iter);
+                    stack[++top] = value;
+                    pc += 4;
+                }
+            } VM_NEXT();
+            VM_CASE(OP_CALL_NATIVE): {
+                uint32_t findex = READ_U32(instructions, pc);
+                TRACE_INT_ARG(findex);
+                vm_native_t* native = &env->natives[findex];
+                pc += 4;
+                VM_SAVE_STATE();
+                native->call(vm, native);
+                VM_LOAD_STATE();
+                if( vm_run->waiting != 0 ) {
+                    // async host call (vm_complete)
+                    VM_EXIT(val_number(-1009));
+                }
+            } VM_NEXT();
+            VM_CASE(OP_LOAD_LOCAL_PAIR): {
+                uint32_t local_a = READ_U32(instructions, pc);
+                uint32_t local_b = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(local_a);
+                TRACE_INT_ARG(local_b);
+                stack[++top] = stack[base + local_a];
+                stack[++top] = stack[base + local_b];
+                pc += 8;
+            } VM_NEXT();
+            VM_CASE(OP_PUSH_VALUE_LOAD_LOCAL): {
+                uint32_t const_index = READ_U32(instructions, pc);
+                uint32_t local_idx = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(const_index);
+                TRACE_INT_ARG(local_idx);
+                stack[++top] = consts[const_index];
+                stack[++top] = stack[base + local_idx];
+                pc += 8;
+            } VM_NEXT();
+            VM_CASE(OP_ADD_LOCALS_TO_LOCAL): {
+                // load a, load b, add, store dest
+                uint32_t local_a = READ_U32(instructions, pc);
+                uint32_t local_b = READ_U32(instructions, pc + 4);
+                uint32_t local_dest = READ_U32(instructions, pc + 8);
+                TRACE_INT_ARG(local_a);
+                TRACE_INT_ARG(local_b);
+                TRACE_INT_ARG(local_dest);
+                float a = val_into_number(stack[base + local_b]);
+                float b = val_into_number(stack[base + local_a]);
+                stack[base + local_dest] = val_number(a + b);
+                pc += 12;
+            } VM_NEXT();
+            VM_CASE(OP_INC_LOCAL_BY_CONST): {
+                // push const, load local, add, store local
+                uint32_t local_idx = READ_U32(instructions, pc);
+                uint32_t const_index = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(local_idx);
+                TRACE_INT_ARG(const_index);
+                float a = val_into_number(stack[base + local_idx]);
+                float b = val_into_number(consts[const_index]);
+                stack[base + local_idx] = val_number(a + b);
+                pc += 8;
+            } VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_EQUAL): {
+                const float epsilon = 0.0001f;
+                TRACE_INT_ARG(READ_U32(instructions, pc));
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                if( (fabs(a - b) < epsilon) == false ) {
+                    pc = READ_U32(instructions, pc);
+                } else {
+                    pc += 4;
+                }
+            } VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_NOT_EQUAL): {
+                const float epsilon = 0.0001f;
+                TRACE_INT_ARG(READ_U32(instructions, pc));
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                if( (fabs(a - b) > epsilon) == false ) {
+                    pc = READ_U32(instructions, pc);
+                } else {
+                    pc += 4;
+                }
+            } VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_LESS_THAN): {
+                TRACE_INT_ARG(READ_U32(instructions, pc));
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                if( (a < b) == false ) {
+                    pc = READ_U32(instructions, pc);
+                } else {
+                    pc += 4;
+                }
+            } VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_MORE_THAN): {
+                TRACE_INT_ARG(READ_U32(instructions, pc));
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                if( (a > b) == false ) {
+                    pc = READ_U32(instructions, pc);
+                } else {
+                    pc += 4;
+                }
+            } VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL): {
+                TRACE_INT_ARG(READ_U32(instructions, pc));
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                if( (a <= b) == false ) {
+                    pc = READ_U32(instructions, pc);
+                } else {
+                    pc += 4;
+                }
+            } VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL): {
+                TRACE_INT_ARG(READ_U32(instructions, pc));
+                float a = val_into_number(stack[top--]);
+                float b = val_into_number(stack[top--]);
+                if( (a >= b) == false ) {
+                    pc = READ_U32(instructions, pc);
+                } else {
+                    pc += 4;
+                }
+            } VM_NEXT();
+            VM_CASE(OP_ITER_NEXT_STORE_LOCAL): {
+                // iter-next followed by store-local
+                uint32_t exit_pc = READ_U32(instructions, pc);
+                uint32_t local_idx = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(exit_pc);
+                TRACE_INT_ARG(local_idx);
+                iter_t iter = val_into_iter(stack[top]);
+                if( iter.remaining == 0 ) {
+                    top --;
+                    pc = exit_pc;
+                } else {
+                    stack[base + local_idx] = iter_next_value(&iter, addr_get_ptr(vm, iter.current));
+                    stack[top] = val_iter(iter);
+                    pc += 8;
+                }
+            } VM_NEXT();
+            VM_CASE(OP_R_MOVE): {
+                uint32_t dst = READ_U32(instructions, pc);
+                uint32_t src = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(dst);
+                TRACE_INT_ARG(src);
+                VM_REG(dst) = VM_RK(src);
+                pc += 8;
+            } VM_NEXT();
+            VM_CASE(OP_R_ADD):
+                VM_REG_BINARY_OP(float, val_into_number, val_number(a + b))
+                VM_NEXT();
+            VM_CASE(OP_R_SUB):
+                VM_REG_BINARY_OP(float, val_into_number, val_number(a - b))
+                VM_NEXT();
+            VM_CASE(OP_R_MUL):
+                VM_REG_BINARY_OP(float, val_into_number, val_number(a * b))
+                VM_NEXT();
+            VM_CASE(OP_R_DIV):
+                VM_REG_BINARY_OP(float, val_into_number, val_number(a / b))
+                VM_NEXT();
+            VM_CASE(OP_R_MOD):
+                VM_REG_BINARY_OP(float, val_into_number, val_number((int) a % (int) b))
+                VM_NEXT();
+            VM_CASE(OP_R_NEG): {
+                uint32_t dst = READ_U32(instructions, pc);
+                uint32_t src = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(dst);
+                TRACE_INT_ARG(src);
+                VM_REG(dst) = val_number(-val_into_number(VM_RK(src)));
+                pc += 8;
+            } VM_NEXT();
+            VM_CASE(OP_R_AND):
+                VM_REG_BINARY_OP(bool, val_into_bool, val_bool(a && b))
+                VM_NEXT();
+            VM_CASE(OP_R_OR):
+                VM_REG_BINARY_OP(bool, val_into_bool, val_bool(a || b))
+                VM_NEXT();
+            VM_CASE(OP_R_NOT): {
+                uint32_t dst = READ_U32(instructions, pc);
+                uint32_t src = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(dst);
+                TRACE_INT_ARG(src);
+                VM_REG(dst) = val_bool(!val_into_bool(VM_RK(src)));
+                pc += 8;
+            } VM_NEXT();
+            VM_CASE(OP_R_CMP_EQUAL):
+                VM_REG_BINARY_OP(float, val_into_number, val_bool(fabs(a - b) < 0.0001f))
+                VM_NEXT();
+            VM_CASE(OP_R_CMP_NOT_EQUAL):
+                VM_REG_BINARY_OP(float, val_into_number, val_bool(fabs(a - b) > 0.0001f))
+                VM_NEXT();
+            VM_CASE(OP_R_CMP_LESS_THAN):
+                VM_REG_BINARY_OP(float, val_into_number, val_bool(a < b))
+                VM_NEXT();
+            VM_CASE(OP_R_CMP_MORE_THAN):
+                VM_REG_BINARY_OP(float, val_into_number, val_bool(a > b))
+                VM_NEXT();
+            VM_CASE(OP_R_CMP_LESS_THAN_OR_EQUAL):
+                VM_REG_BINARY_OP(float, val_into_number, val_bool(a <= b))
+                VM_NEXT();
+            VM_CASE(OP_R_CMP_MORE_THAN_OR_EQUAL):
+                VM_REG_BINARY_OP(float, val_into_number, val_bool(a >= b))
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_FALSE): {
+                uint32_t target = READ_U32(instructions, pc);
+                uint32_t src = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(target);
+                TRACE_INT_ARG(src);
+                if( val_into_bool(VM_RK(src)) == false ) {
+                    pc = target;
+                } else {
+                    pc += 8;
+                }
+            } VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_EQUAL):
+                VM_REG_JUMP_UNLESS(float, val_into_number, fabs(a - b) < 0.0001f)
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_NOT_EQUAL):
+                VM_REG_JUMP_UNLESS(float, val_into_number, fabs(a - b) > 0.0001f)
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_LESS_THAN):
+                VM_REG_JUMP_UNLESS(float, val_into_number, a < b)
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_MORE_THAN):
+                VM_REG_JUMP_UNLESS(float, val_into_number, a > b)
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL):
+                VM_REG_JUMP_UNLESS(float, val_into_number, a <= b)
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL):
+                VM_REG_JUMP_UNLESS(float, val_into_number, a >= b)
+                VM_NEXT();
+            VM_CASE(OP_IADD):
+                VM_INT_BINARY_OP(val_int(INT_WRAP(a, +, b)))
+                VM_NEXT();
+            VM_CASE(OP_ISUB):
+                VM_INT_BINARY_OP(val_int(INT_WRAP(a, -, b)))
+                VM_NEXT();
+            VM_CASE(OP_IMUL):
+                VM_INT_BINARY_OP(val_int(INT_WRAP(a, *, b)))
+                VM_NEXT();
+            VM_CASE(OP_IDIV): {
+                int32_t a = val_into_int(stack[top--]);
+                int32_t b = val_into_int(stack[top--]);
+                if( b == 0 ) {
+                    VM_EXIT_DIV_BY_ZERO();
+                }
+                stack[++top] = val_int(int_div(a, b));
+            } VM_NEXT();
+            VM_CASE(OP_IMOD): {
+                int32_t a = val_into_int(stack[top--]);
+                int32_t b = val_into_int(stack[top--]);
+                if( b == 0 ) {
+                    VM_EXIT_DIV_BY_ZERO();
+                }
+                stack[++top] = val_int(int_mod(a, b));
+            } VM_NEXT();
+            VM_CASE(OP_INEG): {
+                int32_t a = val_into_int(stack[top]);
+                stack[top] = val_int(INT_WRAP(0, -, a));
+            } VM_NEXT();
+            VM_CASE(OP_ICMP_EQUAL):
+                VM_INT_BINARY_OP(val_bool(a == b))
+                VM_NEXT();
+            VM_CASE(OP_ICMP_NOT_EQUAL):
+                VM_INT_BINARY_OP(val_bool(a != b))
+                VM_NEXT();
+            VM_CASE(OP_ICMP_LESS_THAN):
+                VM_INT_BINARY_OP(val_bool(a < b))
+                VM_NEXT();
+            VM_CASE(OP_ICMP_MORE_THAN):
+                VM_INT_BINARY_OP(val_bool(a > b))
+                VM_NEXT();
+            VM_CASE(OP_ICMP_LESS_THAN_OR_EQUAL):
+                VM_INT_BINARY_OP(val_bool(a <= b))
+                VM_NEXT();
+            VM_CASE(OP_ICMP_MORE_THAN_OR_EQUAL):
+                VM_INT_BINARY_OP(val_bool(a >= b))
+                VM_NEXT();
+            VM_CASE(OP_INT_TO_FLOAT): {
+                stack[top] = val_number((float) val_into_int(stack[top]));
+            } VM_NEXT();
+            VM_CASE(OP_IADD_LOCALS_TO_LOCAL): {
+                uint32_t local_a = READ_U32(instructions, pc);
+                uint32_t local_b = READ_U32(instructions, pc + 4);
+                uint32_t local_dest = READ_U32(instructions, pc + 8);
+                TRACE_INT_ARG(local_a);
+                TRACE_INT_ARG(local_b);
+                TRACE_INT_ARG(local_dest);
+                int32_t a = val_into_int(stack[base + local_b]);
+                int32_t b = val_into_int(stack[base + local_a]);
+                stack[base + local_dest] = val_int(INT_WRAP(a, +, b));
+                pc += 12;
+            } VM_NEXT();
+            VM_CASE(OP_IINC_LOCAL_BY_CONST): {
+                uint32_t local_idx = READ_U32(instructions, pc);
+                uint32_t const_index = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(local_idx);
+                TRACE_INT_ARG(const_index);
+                int32_t a = val_into_int(stack[base + local_idx]);
+                int32_t b = val_into_int(consts[const_index]);
+                stack[base + local_idx] = val_int(INT_WRAP(a, +, b));
+                pc += 8;
+            } VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_IEQUAL):
+                VM_INT_JUMP_UNLESS(a == b)
+                VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_INOT_EQUAL):
+                VM_INT_JUMP_UNLESS(a != b)
+                VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_ILESS_THAN):
+                VM_INT_JUMP_UNLESS(a < b)
+                VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_IMORE_THAN):
+                VM_INT_JUMP_UNLESS(a > b)
+                VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL):
+                VM_INT_JUMP_UNLESS(a <= b)
+                VM_NEXT();
+            VM_CASE(OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL):
+                VM_INT_JUMP_UNLESS(a >= b)
+                VM_NEXT();
+            VM_CASE(OP_R_IADD):
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_int(INT_WRAP(a, +, b)))
+                VM_NEXT();
+            VM_CASE(OP_R_ISUB):
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_int(INT_WRAP(a, -, b)))
+                VM_NEXT();
+            VM_CASE(OP_R_IMUL):
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_int(INT_WRAP(a, *, b)))
+                VM_NEXT();
+            VM_CASE(OP_R_IDIV):
+                if( val_into_int(VM_RK(READ_U32(instructions, pc + 8))) == 0 ) {
+                    VM_EXIT_DIV_BY_ZERO();
+                }
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_int(int_div(a, b)))
+                VM_NEXT();
+            VM_CASE(OP_R_IMOD):
+                if( val_into_int(VM_RK(READ_U32(instructions, pc + 8))) == 0 ) {
+                    VM_EXIT_DIV_BY_ZERO();
+                }
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_int(int_mod(a, b)))
+                VM_NEXT();
+            VM_CASE(OP_R_INEG): {
+                uint32_t dst = READ_U32(instructions, pc);
+                uint32_t src = READ_U32(instructions, pc + 4);
+                TRACE_INT_ARG(dst);
+                TRACE_INT_ARG(src);
+                VM_REG(dst) = val_int(INT_WRAP(0, -, val_into_int(VM_RK(src))));
+                pc += 8;
+            } VM_NEXT();
+            VM_CASE(OP_R_ICMP_EQUAL):
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_bool(a == b))
+                VM_NEXT();
+            VM_CASE(OP_R_ICMP_NOT_EQUAL):
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_bool(a != b))
+                VM_NEXT();
+            VM_CASE(OP_R_ICMP_LESS_THAN):
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_bool(a < b))
+                VM_NEXT();
+            VM_CASE(OP_R_ICMP_MORE_THAN):
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_bool(a > b))
+                VM_NEXT();
+            VM_CASE(OP_R_ICMP_LESS_THAN_OR_EQUAL):
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_bool(a <= b))
+                VM_NEXT();
+            VM_CASE(OP_R_ICMP_MORE_THAN_OR_EQUAL):
+                VM_REG_BINARY_OP(int32_t, val_into_int, val_bool(a >= b))
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_IEQUAL):
+                VM_REG_JUMP_UNLESS(int32_t, val_into_int, a == b)
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_INOT_EQUAL):
+                VM_REG_JUMP_UNLESS(int32_t, val_into_int, a != b)
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_ILESS_THAN):
+                VM_REG_JUMP_UNLESS(int32_t, val_into_int, a < b)
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_IMORE_THAN):
+                VM_REG_JUMP_UNLESS(int32_t, val_into_int, a > b)
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL):
+                VM_REG_JUMP_UNLESS(int32_t, val_into_int, a <= b)
+                VM_NEXT();
+            VM_CASE(OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL):
+                VM_REG_JUMP_UNLESS(int32_t, val_into_int, a >= b)
+                VM_NEXT();
+            VM_DEFAULT: {
+                char* op_str = opcode < OP_OPCODE_COUNT ? get_op_name(opcode) : "unknown";
+                sh_log_error("\nunhandled operatioin %i (%s)\n", opcode, op_str);
+                VM_EXIT(val_number(-1003));
+            }
+        }
+#if VM_THREADED_DISPATCH == 0
+    }
+#endif
+
+vm_out_of_cycles:
+    // keep the state around, the run may continue with vm_resume
+    VM_SAVE_STATE();
+    vm_run->cycles = cycles_budget;
+    vm_run->suspended = cycles_budget > 0;
+    return val_number(-1004);
+}
+
+#undef VM_VALIDATE_PRE
+#undef VM_VALIDATE_POST
+#undef VM_DISPATCH_FN
+#undef VM_DISPATCH_CHECKED
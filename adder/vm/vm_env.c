@@ -1,4 +1,7 @@
 #include "vm_env.h"
+#include "vm_jit.h"
+#include "vm_verify.h"
+#include "vm_native.h"
 #include "sh_log.h"
 #include "sh_program.h"
 #include "sh_ift.h"
@@ -10,15 +13,20 @@ void vm_env_init(vm_env_t* env) {
 }
 
 void vm_env_destroy(vm_env_t* env) {
-    if( env->argcounts != NULL ) {
-        free(env->argcounts);
-        env->argcounts = NULL;
+    if( env->natives != NULL ) {
+        free(env->natives);
+        env->natives = NULL;
     }
-    if( env->handles != NULL ) {
-        free(env->handles);
-        env->handles = NULL;
+    if( env->jit != NULL ) {
+        vm_jit_destroy(env->jit);
+        env->jit = NULL;
+    }
+    if( env->verified != NULL ) {
+        vm_verify_destroy(env->verified);
+        env->verified = NULL;
     }
     env->count = 0;
+    env->isready = false;
 }
 
 void vm_env_reset(vm_env_t* env) {
@@ -37,9 +45,12 @@ bool vm_env_setup(vm_env_t* env, program_t* program, ffi_t* ffi) {
     if( ffi == NULL ) {
         if( program->imports.count == 0 ) {
             env->count = 0;
-            env->argcounts = NULL;
-            env->handles = NULL;
+            env->natives = NULL;
             env->isready = true;
+            env->verified = vm_verify_program(program);
+            if( program->jit ) {
+                env->jit = vm_jit_compile(program, env);
+            }
             return true;
         } else {
             sh_log_error("program expects %d imports "
@@ -83,34 +94,42 @@ bool vm_env_setup(vm_env_t* env, program_t* program, ffi_t* ffi) {
         return false;
     }
 
-    ffi_handle_t* mapping = (ffi_handle_t*) malloc( sizeof(ffi_handle_t) * program->imports.count );
-    int* argc = (int*) malloc( sizeof(int) * program->imports.count );
-
-    if( mapping == NULL || argc == NULL ) {
-
-        if( mapping != NULL )
-            free(mapping);
-
-        if( argc != NULL )
-            free(argc);
+    vm_native_t* natives = (vm_native_t*) malloc( sizeof(vm_native_t) * program->imports.count );
 
+    if( natives == NULL ) {
         sh_log_error("failed to allocate memory, out of memory?");
-        
         return false;
     }
 
+    // each import is bound to a trampoline for its handle type
+    // and arity, call-native only calls it
     for(int i = 0; i < program->imports.count; i++) {
         ffi_definition_t def = program->imports.def[i];
         int supp_index = ffi_native_exports_index_of(&ffi->supplied, def.name);
         assert( supp_index >= 0 );
-        mapping[i] = ffi->supplied.handle[supp_index];
-        argc[i] = ift_func_arg_count(ffi->supplied.def[supp_index].type);
+        if( vm_native_bind(&natives[i],
+                ffi->supplied.handle[supp_index],
+                ffi->supplied.def[supp_index].type) == false ) {
+            sh_log_error("'%.*s' could not be bound.",
+                sstr_len(&def.name), sstr_ptr(&def.name));
+            missing ++;
+        }
+    }
+
+    if( missing > 0 ) {
+        free(natives);
+        return false;
     }
 
     env->count = program->imports.count;
-    env->argcounts = argc;
-    env->handles = mapping;
+    env->natives = natives;
     env->isready = true;
+    env->verified = vm_verify_program(program);
+
+    // the native code calls the host functions directly
+    if( program->jit ) {
+        env->jit = vm_jit_compile(program, env);
+    }
 
     return true;
 }
@@ -7,21 +7,117 @@
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <time.h>
 #include <sh_log.h>
 
 #define _MAX(A,B) ((A) > (B) ? (A) : (B))
 #define _MIN(A,B) ((A) < (B) ? (A) : (B))
 
-inline static void put_mark(uint64_t* marks, int heap_index) {
-    uint64_t mask_index = HEAP_TO_PAGE_INDEX(heap_index);
-    uint64_t mask_bit = HEAP_TO_BIT_INDEX(heap_index);
-    marks[mask_index] |= (1UL << mask_bit);
+// The heap is managed with one mark bit per value (gc_marks), the
+// GC sets the bits of the values it can reach and allocation sets
+// the bits of the values it hands out. The summary (gc_full) has one
+// bit per mark word that is fully used, the searches skip those 64
+// words at a time. Searches start at the word after the previous
+// allocation (next fit, heap.cursor) and wrap around, a collection
+// starts them from the front again.
+//
+// Small chunks (less than a word) are found with a word-parallel run
+// search and never cross a word, larger ones start at an empty word.
+//
+// Before searching, chunks of up to a word are taken from the size
+// class pools: stacks of free chunks of 1, 2, 4 .. 64 values that
+// each collection rebuilds from the free runs of the marks. A pool
+// entry is checked against the marks when it is taken (the search
+// may have handed out its values since), the rest of a chunk that
+// is larger than needed goes back to the smaller pools.
+//
+// If an allocation still fails after a collection although there are
+// enough free values, the heap is compacted: the live values slide to
+// the front (in address order) and the references to them are
+// rewritten. Array values the host keeps outside of the stack and the
+// roots don't survive that, they are read again after an allocation.
+//
+// With a gc budget (vm_set_gc_budget) the heap is also marked
+// incrementally, see INCREMENTAL MARKING below.
+
+#define WORD_BITS ((int) (sizeof(uint64_t) * CHAR_BIT))
+
+// number of mark words that cover values of the heap
+inline static int heap_word_count(vm_t* vm) {
+    return (vm->mem.heap.size + WORD_BITS - 1) / WORD_BITS;
+}
+
+// used bits of a mark word, values past the heap are used
+inline static uint64_t heap_word_used(vm_t* vm, int word) {
+    uint64_t used = vm->mem.heap.gc_marks[word];
+    int valid = vm->mem.heap.size - word * WORD_BITS;
+    if( valid < WORD_BITS ) {
+        used |= ~MK_CHUNK_MASK(valid);
+    }
+    return used;
+}
+
+static void heap_pool_rebuild(vm_t* vm);
+
+// marks count values from heap_index on as used
+static void heap_mark_range(vm_t* vm, int heap_index, int count) {
+    uint64_t* marks = vm->mem.heap.gc_marks;
+    uint64_t* full = vm->mem.heap.gc_full;
+    if( count > 0 ) {
+        vm_heap_t* heap = &vm->mem.heap;
+        heap->dirty_first = _MIN(heap->dirty_first, (int) HEAP_TO_PAGE_INDEX(heap_index));
+        heap->dirty_last = _MAX(heap->dirty_last, (int) HEAP_TO_PAGE_INDEX(heap_index + count - 1));
+    }
+    while( count > 0 ) {
+        int word = HEAP_TO_PAGE_INDEX(heap_index);
+        int bit = HEAP_TO_BIT_INDEX(heap_index);
+        int n = _MIN(count, WORD_BITS - bit);
+        uint64_t mask = n == WORD_BITS ? ~0UL : MK_CHUNK_MASK(n) << bit;
+        marks[word] |= mask;
+        if( marks[word] == ~0UL ) {
+            full[HEAP_TO_PAGE_INDEX(word)] |= 1UL << HEAP_TO_BIT_INDEX(word);
+        }
+        heap_index += n;
+        count -= n;
+    }
+}
+
+// all mark words may have changed
+inline static void heap_mark_all_dirty(vm_t* vm) {
+    vm->mem.heap.dirty_first = 0;
+    vm->mem.heap.dirty_last = CALC_GC_MARK_U64_COUNT(vm->mem.heap.size) - 1;
 }
 
 void heap_clear(vm_t* vm) {
-    uint64_t* gc_marks = vm->mem.heap.gc_marks;
-    int heapsize = vm->mem.heap.size;
-    memset(gc_marks, 0, CALC_GC_MARK_U64_COUNT(heapsize) * sizeof(uint64_t));
+    memset(vm->mem.heap.gc_marks, 0,
+        HEAP_MARK_REGION_U64_COUNT(vm->mem.heap.size) * sizeof(uint64_t));
+    heap_mark_all_dirty(vm);
+    vm->mem.heap.cursor = 0;
+    vm->mem.heap.gc_marking = false;
+    for(int i = 0; i < HEAP_POOL_CLASSES; i++) {
+        vm->mem.heap.pool_counts[i] = 0;
+    }
+}
+
+void heap_gc_mark_used(vm_t* vm, val_t* checkmem, int val_count);
+
+// an iterator keeps the values it has yet to visit alive (the
+// array itself may not be referenced anymore)
+static void heap_gc_mark_iter(vm_t* vm, iter_t iter) {
+    val_addr_t virt_addr_heap = MEM_MK_PROGR_ADDR(vm->mem.stack.size);
+    if( iter.current < virt_addr_heap || iter.remaining <= 0 ) {
+        return;
+    }
+    int heap_index = (int) iter.current - (int) virt_addr_heap;
+    if( iter.pack == VAL_NONE ) {
+        heap_mark_range(vm, heap_index, iter.remaining);
+        heap_gc_mark_used(vm, vm->mem.heap.values + heap_index, iter.remaining);
+        return;
+    }
+    // the slots in front of the end that hold the remaining elements
+    array_t rest = { .length = iter.remaining, .pack = iter.pack };
+    int slots = array_slot_count(rest);
+    heap_mark_range(vm, heap_index - slots, slots);
 }
 
 void heap_gc_mark_used(vm_t* vm, val_t* checkmem, int val_count) {
@@ -29,6 +125,10 @@ void heap_gc_mark_used(vm_t* vm, val_t* checkmem, int val_count) {
     // mark all references
     for(int i = 0; i < val_count; i++) {
         val_t value = checkmem[i];
+        if( value.type == VAL_ITER ) {
+            heap_gc_mark_iter(vm, val_into_iter(value));
+            continue;
+        }
         if( value.type != VAL_ARRAY ) {
             continue;
         }
@@ -40,21 +140,31 @@ void heap_gc_mark_used(vm_t* vm, val_t* checkmem, int val_count) {
             continue;
         }
         int heap_start = (int) array.address - (int) virt_addr_heap;
-        for(int j = 0; j < array.length; j++) {
-            put_mark(vm->mem.heap.gc_marks, heap_start + j);
+        heap_mark_range(vm, heap_start, array_slot_count(array));
+        if( array.pack != VAL_NONE ) {
+            continue; // no references in packed arrays
         }
         // call recursively (arrays inside array)
         heap_gc_mark_used(vm,
-            vm->mem.heap.values + heap_start + 1,
-            array.length - 1);
+            vm->mem.heap.values + heap_start,
+            array.length);
     }
 }
 
 void heap_gc_collect(vm_t* vm) {
+    vm->mem.heap.gc_stats.collections++;
+    vm->mem.heap.allocated = 0;
     // clear all usage bits 
-    memset(vm->mem.heap.gc_marks, 0, CALC_GC_MARK_U64_COUNT(vm->mem.heap.size) * sizeof(uint64_t));
+    heap_clear(vm);
     // mark all references from the stack
     heap_gc_mark_used(vm, vm->mem.stack.values, vm->mem.stack.top + 1);
+    // and from values held by the host
+    for(int i = 0; i < 2; i++) {
+        heap_gc_mark_used(vm, vm->mem.heap.roots[i], vm->mem.heap.rootcounts[i]);
+    }
+    // sweep the free runs into the pools
+    heap_pool_rebuild(vm);
+    vm->mem.heap.gc_trigger = (vm->mem.heap.size - heap_get_used(vm) / (int) sizeof(val_t)) / 2;
 }
 
 void heap_print_usage(vm_t* vm) {
@@ -76,47 +186,90 @@ void heap_print_usage(vm_t* vm) {
 int heap_get_used(vm_t* vm) {
     int used = 0;
     int pages = CALC_GC_MARK_U64_COUNT(vm->mem.heap.size);
-    int num_bits = sizeof(uint64_t) * CHAR_BIT;
     for(int i = 0; i < pages; i++) {
-        for(int j = 0; j < num_bits; j++) {
-            uint64_t marks = vm->mem.heap.gc_marks[i];
-            if(((1UL << j) & marks) > 0) {
-                used += 8;
-            }
-        }
+        used += __builtin_popcountll(vm->mem.heap.gc_marks[i]) * 8;
     }
     return used;
 }
 
-int heap_find_small_chunk(vm_t* vm, int value_count) {
-    int num_bits_per_page = sizeof(uint64_t) * CHAR_BIT;
-    int num_pages = CALC_GC_MARK_U64_COUNT(vm->mem.heap.size);
-    int num_bits = num_bits_per_page - value_count;
-    uint64_t chunk_mask = MK_CHUNK_MASK(value_count);
-    for(int page_index = 0; page_index < num_pages; page_index++) {
-        uint64_t page = vm->mem.heap.gc_marks[page_index];
-        for(int bit = 0; bit < num_bits; bit++) {
-            if( (page & (chunk_mask << bit)) == 0 ){
-                return (num_bits_per_page * page_index) + bit;
-            }
+// the first word from word on (up to end) that isn't full
+static int heap_next_open_word(vm_t* vm, int word, int end) {
+    if( word >= end ) {
+        return end;
+    }
+    uint64_t* full = vm->mem.heap.gc_full;
+    int index = HEAP_TO_PAGE_INDEX(word);
+    uint64_t open = ~full[index] & (~0UL << HEAP_TO_BIT_INDEX(word));
+    while( open == 0 ) {
+        index++;
+        if( index * WORD_BITS >= end ) {
+            return end;
         }
+        open = ~full[index];
+    }
+    return _MIN(index * WORD_BITS + __builtin_ctzll(open), end);
+}
+
+// the first bit of a run of value_count free bits (-1 if none),
+// the runs of free bits are doubled until they are long enough
+inline static int heap_word_find_run(uint64_t used, int value_count) {
+    uint64_t starts = ~used;
+    int length = 1;
+    while( length < value_count && starts != 0 ) {
+        int step = _MIN(length, value_count - length);
+        starts &= starts >> step;
+        length += step;
+    }
+    return starts != 0 ? __builtin_ctzll(starts) : -1;
+}
+
+// searches the words from begin to end
+static int heap_find_small_run(vm_t* vm, int value_count, int begin, int end) {
+    int word = heap_next_open_word(vm, begin, end);
+    while( word < end ) {
+        int bit = heap_word_find_run(heap_word_used(vm, word), value_count);
+        if( bit >= 0 ) {
+            return word * WORD_BITS + bit;
+        }
+        word = heap_next_open_word(vm, word + 1, end);
     }
     return -1;
 }
 
-int heap_count_empty_pages(vm_t* vm, int page_index, int num_pages) {
-    if( page_index >= num_pages ) {
-        return -1;
+int heap_find_small_chunk(vm_t* vm, int value_count) {
+    int words = heap_word_count(vm);
+    int cursor = vm->mem.heap.cursor;
+    int addr = heap_find_small_run(vm, value_count, cursor, words);
+    if( addr < 0 ) {
+        addr = heap_find_small_run(vm, value_count, 0, _MIN(cursor, words));
     }
-    int count = 0;
-    while (page_index < num_pages) {
-        if( vm->mem.heap.gc_marks[page_index++] == 0 ) {
-            count ++;
-        } else {
-            return count;
+    return addr;
+}
+
+// searches for runs of empty words starting from begin to end
+static int heap_find_large_run(vm_t* vm, int value_count, int begin, int end) {
+    int words = heap_word_count(vm);
+    int num_req_words = value_count / WORD_BITS;
+    int num_trailing = value_count % WORD_BITS;
+    int word = heap_next_open_word(vm, begin, end);
+    while( word < end ) {
+        int run = 0;
+        while( run < num_req_words
+            && word + run < words
+            && heap_word_used(vm, word + run) == 0 ) {
+            run++;
         }
+        if( run == num_req_words ) {
+            bool fits = num_trailing == 0
+                || (word + run < words
+                    && (heap_word_used(vm, word + run) & MK_CHUNK_MASK(num_trailing)) == 0);
+            if( fits ) {
+                return word * WORD_BITS;
+            }
+        }
+        word = heap_next_open_word(vm, word + run + 1, end);
     }
-    return count;
+    return -1;
 }
 
 int heap_find_large_chunk(vm_t* vm, int value_count) {
@@ -125,35 +278,81 @@ int heap_find_large_chunk(vm_t* vm, int value_count) {
         return -1;
     }
 
-    int num_bits_per_page = sizeof(uint64_t) * CHAR_BIT;
-    int num_pages_total = CALC_GC_MARK_U64_COUNT(vm->mem.heap.size);
-    int num_req_pages = CALC_GC_MARK_U64_COUNT(value_count) - 1;
-    int num_trailing = value_count - (num_req_pages * num_bits_per_page);
-    int max_check_page_count = num_pages_total - num_req_pages;
-
-    int page_index = 0;
-    while( page_index < max_check_page_count ) {
-        int num_free = heap_count_empty_pages(vm, page_index, num_pages_total);
-        if( num_free > num_req_pages ) {
-            // just return the page_index
-            return page_index * num_bits_per_page;
-        } else if( num_free == num_req_pages ) {
-            // check if trailing values fits in the next
-            uint64_t chunk_mask = MK_CHUNK_MASK(num_trailing);
-            // CHECK: page_index + num_free + 1?
-            // if so, return the start-of-page-sequence value index
-            uint64_t page = vm->mem.heap.gc_marks[page_index + num_free + 1];
-            if( (page & chunk_mask) == 0 ) {
-                return page_index * num_bits_per_page;
-            }
-        } else if( num_free < 0 ) {
-            // we are out of pages (fail)
-            return -1;
+    int words = heap_word_count(vm);
+    int cursor = vm->mem.heap.cursor;
+    int addr = heap_find_large_run(vm, value_count, cursor, words);
+    if( addr < 0 ) {
+        addr = heap_find_large_run(vm, value_count, 0, _MIN(cursor, words));
+    }
+    return addr;
+}
+
+// the pool of chunks of 2^size_class values
+inline static uint32_t* heap_pool(vm_t* vm, int size_class) {
+    return vm->mem.heap.pools + size_class * VM_HEAP_POOL_CAPACITY;
+}
+
+// splits the free values from heap_index to end into chunks that are
+// aligned to their size and adds them to the pools (if there is room)
+static void heap_pool_add_run(vm_t* vm, int heap_index, int end) {
+    while( heap_index < end ) {
+        int bit = HEAP_TO_BIT_INDEX(heap_index);
+        int align = bit == 0 ? WORD_BITS : (bit & -bit);
+        int size_class = 31 - __builtin_clz((unsigned) _MIN(align, end - heap_index));
+        int* count = &vm->mem.heap.pool_counts[size_class];
+        if( *count < VM_HEAP_POOL_CAPACITY ) {
+            heap_pool(vm, size_class)[(*count)++] = (uint32_t) heap_index;
         }
-        // else, continue looking
-        page_index += _MAX(num_free, 1);
+        heap_index += 1 << size_class;
     }
+}
 
+// refills the pools with the free runs of the marks, the chunks
+// at the lowest addresses are on top
+static void heap_pool_rebuild(vm_t* vm) {
+    int words = heap_word_count(vm);
+    int word = heap_next_open_word(vm, 0, words);
+    while( word < words ) {
+        uint64_t used = heap_word_used(vm, word);
+        while( used != ~0UL ) {
+            int start = __builtin_ctzll(~used);
+            uint64_t rest = used >> start;
+            int length = rest == 0 ? WORD_BITS - start : __builtin_ctzll(rest);
+            heap_pool_add_run(vm, word * WORD_BITS + start, word * WORD_BITS + start + length);
+            used |= length == WORD_BITS ? ~0UL : MK_CHUNK_MASK(length) << start;
+        }
+        word = heap_next_open_word(vm, word + 1, words);
+    }
+    for(int i = 0; i < HEAP_POOL_CLASSES; i++) {
+        uint32_t* pool = heap_pool(vm, i);
+        int count = vm->mem.heap.pool_counts[i];
+        for(int j = 0; j < count / 2; j++) {
+            uint32_t tmp = pool[j];
+            pool[j] = pool[count - 1 - j];
+            pool[count - 1 - j] = tmp;
+        }
+    }
+}
+
+// takes a chunk of value_count (up to a word) values from the
+// pools (-1 if they have none)
+static int heap_pool_take(vm_t* vm, int value_count) {
+    int size_class = value_count == 1 ? 0 : 32 - __builtin_clz((unsigned) value_count - 1);
+    for(; size_class < HEAP_POOL_CLASSES; size_class++) {
+        uint32_t* pool = heap_pool(vm, size_class);
+        int* count = &vm->mem.heap.pool_counts[size_class];
+        int size = 1 << size_class;
+        while( *count > 0 ) {
+            int heap_index = (int) pool[--(*count)];
+            uint64_t mask = size == WORD_BITS
+                ? ~0UL
+                : MK_CHUNK_MASK(size) << HEAP_TO_BIT_INDEX(heap_index);
+            if( (vm->mem.heap.gc_marks[HEAP_TO_PAGE_INDEX(heap_index)] & mask) == 0 ) {
+                heap_pool_add_run(vm, heap_index + value_count, heap_index + size);
+                return heap_index;
+            }
+        }
+    }
     return -1;
 }
 
@@ -166,54 +365,474 @@ int heap_find_free_chunk(vm_t* vm, int val_count) {
     }
 }
 
-array_t heap_array_alloc(vm_t* vm, int val_count) {
+// a chunk from the pools or else from the search (which
+// moves the cursor past it)
+static int heap_take_chunk(vm_t* vm, int val_count) {
+    int addr = val_count <= WORD_BITS ? heap_pool_take(vm, val_count) : -1;
+    if( addr < 0 ) {
+        addr = heap_find_free_chunk(vm, val_count);
+        if( addr >= 0 ) {
+            vm->mem.heap.cursor = HEAP_TO_PAGE_INDEX(addr + val_count);
+        }
+    }
+    return addr;
+}
 
-    int addr = heap_find_free_chunk(vm, val_count);
-    int end_addr = addr + val_count;
+// COMPACTION
+//
+// The new index of a live value is the number of marked values in
+// front of it, counted per mark word (ranks) and within its word with
+// a popcount. All references are rewritten before anything moves: the
+// values of the stack and the roots, and the boxed arrays they reach
+// (each slot once, arrays and iterators may share them).
+
+typedef struct heap_compact_t {
+    vm_t*       vm;
+    int*        ranks;      // marked values in front of each mark word
+    uint64_t*   visited;    // slots that have been rewritten
+    val_addr_t  heap_addr;  // address of the first heap value
+} heap_compact_t;
+
+static val_addr_t heap_compact_forward(heap_compact_t* compact, val_addr_t address) {
+    if( address < compact->heap_addr ) {
+        return address; // constant or stack
+    }
+    int heap_index = (int) (address - compact->heap_addr);
+    int word = HEAP_TO_PAGE_INDEX(heap_index);
+    uint64_t front = compact->vm->mem.heap.gc_marks[word]
+        & MK_CHUNK_MASK(HEAP_TO_BIT_INDEX(heap_index));
+    return compact->heap_addr
+        + (val_addr_t) (compact->ranks[word] + __builtin_popcountll(front));
+}
+
+static void heap_compact_rewrite(heap_compact_t* compact, val_t* values, int count);
+
+// rewrites the count slots from heap_index on that weren't yet
+static void heap_compact_rewrite_slots(heap_compact_t* compact, int heap_index, int count) {
+    uint64_t* visited = compact->visited;
+    for(int i = heap_index; i < heap_index + count; i++) {
+        uint64_t bit = 1UL << HEAP_TO_BIT_INDEX(i);
+        if( visited[HEAP_TO_PAGE_INDEX(i)] & bit ) {
+            continue;
+        }
+        visited[HEAP_TO_PAGE_INDEX(i)] |= bit;
+        heap_compact_rewrite(compact, compact->vm->mem.heap.values + i, 1);
+    }
+}
+
+// the referenced values are rewritten (at their current
+// address) before the reference itself
+static void heap_compact_rewrite(heap_compact_t* compact, val_t* values, int count) {
+    for(int i = 0; i < count; i++) {
+        val_t* value = values + i;
+        if( value->type != VAL_ARRAY && value->type != VAL_ITER ) {
+            continue;
+        }
+        if( value->u.address < compact->heap_addr ) {
+            continue;
+        }
+        if( value->pack == VAL_NONE ) {
+            // the array or the values the iterator has yet to visit
+            heap_compact_rewrite_slots(compact,
+                (int) (value->u.address - compact->heap_addr), value->count);
+        }
+        value->u.address = heap_compact_forward(compact, value->u.address);
+    }
+}
+
+// moves the marked values to the front of the heap, returns
+// the number of values moved
+static int heap_compact_slide(vm_t* vm) {
+    int words = heap_word_count(vm);
+    val_t* values = vm->mem.heap.values;
+    int to = 0;
+    for(int word = 0; word < words; word++) {
+        uint64_t used = vm->mem.heap.gc_marks[word];
+        while( used != 0 ) {
+            int start = __builtin_ctzll(used);
+            uint64_t rest = ~(used >> start);
+            int length = rest == 0 ? WORD_BITS - start : __builtin_ctzll(rest);
+            memmove(values + to, values + word * WORD_BITS + start, length * sizeof(val_t));
+            to += length;
+            used &= length == WORD_BITS ? 0UL : ~(MK_CHUNK_MASK(length) << start);
+        }
+    }
+    return to;
+}
+
+// slides the live values of a collected heap together, returns the
+// index of the first free value (-1 if there was no memory to do so)
+static int heap_compact(vm_t* vm) {
+    int mark_words = CALC_GC_MARK_U64_COUNT(vm->mem.heap.size);
+    int* ranks = (int*) malloc(mark_words * sizeof(int));
+    uint64_t* visited = (uint64_t*) calloc(mark_words, sizeof(uint64_t));
+    if( ranks == NULL || visited == NULL ) {
+        free(ranks);
+        free(visited);
+        return -1;
+    }
+    int live = 0;
+    for(int i = 0; i < mark_words; i++) {
+        ranks[i] = live;
+        live += __builtin_popcountll(vm->mem.heap.gc_marks[i]);
+    }
+
+    heap_compact_t compact = {
+        .vm = vm,
+        .ranks = ranks,
+        .visited = visited,
+        .heap_addr = MEM_MK_PROGR_ADDR(vm->mem.stack.size)
+    };
+    heap_compact_rewrite(&compact, vm->mem.stack.values, vm->mem.stack.top + 1);
+    for(int i = 0; i < 2; i++) {
+        heap_compact_rewrite(&compact, vm->mem.heap.roots[i], vm->mem.heap.rootcounts[i]);
+    }
+    free(ranks);
+    free(visited);
+
+    int moved = heap_compact_slide(vm);
+    assert(moved == live);
+    heap_clear(vm);
+    heap_mark_range(vm, 0, moved);
+    heap_pool_rebuild(vm);
+    vm->mem.heap.cursor = HEAP_TO_PAGE_INDEX(moved);
+    vm->mem.heap.compactions++;
+    return moved;
+}
+
+// INCREMENTAL MARKING
+//
+// A cycle marks the values it reaches in gc_live instead of the
+// marks, which keep telling the allocator what is in use. Arrays
+// are shaded (grey) by setting their bits in gc_live and queueing
+// them, and scanned (black) a budget of values per allocation.
+// Values allocated during the cycle are black, so are the arrays
+// whose references are copied in by make-array or array_set: the
+// barrier (heap_write_barrier) shades the stored references. The
+// stack isn't barriered, the roots are shaded again at the end of
+// the cycle. Then the reached values replace the marks.
+
+// pauses are timed in microseconds
+static uint64_t heap_clock_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000u + (uint64_t) ts.tv_nsec / 1000u;
+}
+
+static void heap_gc_pause(vm_t* vm, uint64_t start) {
+    vm_gc_stats_t* stats = &vm->mem.heap.gc_stats;
+    uint64_t us = heap_clock_us() - start;
+    int bucket = us == 0 ? 0 : 64 - __builtin_clzll(us);
+    stats->pauses[_MIN(bucket, HEAP_PAUSE_BUCKETS - 1)]++;
+    stats->total_pause_us += us;
+    if( us > stats->max_pause_us ) {
+        stats->max_pause_us = (uint32_t) _MIN(us, UINT32_MAX);
+    }
+}
+
+// sets count bits from heap_index on (no summary)
+static void heap_set_range(uint64_t* bits, int heap_index, int count) {
+    while( count > 0 ) {
+        int bit = HEAP_TO_BIT_INDEX(heap_index);
+        int n = _MIN(count, WORD_BITS - bit);
+        bits[HEAP_TO_PAGE_INDEX(heap_index)] |= n == WORD_BITS ? ~0UL : MK_CHUNK_MASK(n) << bit;
+        heap_index += n;
+        count -= n;
+    }
+}
+
+void heap_gc_shade(vm_t* vm, val_t value) {
+    if( value.type != VAL_ARRAY && value.type != VAL_ITER ) {
+        return;
+    }
+    val_addr_t virt_addr_heap = MEM_MK_PROGR_ADDR(vm->mem.stack.size);
+    if( value.u.address < virt_addr_heap || value.count == 0 ) {
+        return;
+    }
+    vm_heap_t* heap = &vm->mem.heap;
+    int heap_index = (int) (value.u.address - virt_addr_heap);
+    int count = value.count;
+    if( value.pack != VAL_NONE ) {
+        array_t slots = { .length = value.count, .pack = value.pack };
+        count = array_slot_count(slots);
+        if( value.type == VAL_ITER ) {
+            heap_index -= count; // the iterator keeps the end
+        }
+    }
+    // the values of an iterator are part of an array, if
+    // either was shaded first the other one is skipped
+    uint64_t bit = 1UL << HEAP_TO_BIT_INDEX(heap_index);
+    if( heap->gc_live[HEAP_TO_PAGE_INDEX(heap_index)] & bit ) {
+        return;
+    }
+    heap_set_range(heap->gc_live, heap_index, count);
+    if( value.pack != VAL_NONE ) {
+        return; // no references in packed arrays
+    }
+    if( heap->grey_count == VM_HEAP_GREY_CAPACITY ) {
+        heap->grey_overflow = true;
+        return;
+    }
+    heap->grey[heap->grey_count++] = val_array_from_args(value.u.address, count);
+}
+
+static void heap_gc_shade_roots(vm_t* vm) {
+    for(int i = 0; i <= vm->mem.stack.top; i++) {
+        heap_gc_shade(vm, vm->mem.stack.values[i]);
+    }
+    for(int i = 0; i < 2; i++) {
+        for(int j = 0; j < vm->mem.heap.rootcounts[i]; j++) {
+            heap_gc_shade(vm, vm->mem.heap.roots[i][j]);
+        }
+    }
+}
+
+// scans up to budget values of the queued arrays,
+// returns the budget that is left
+static int heap_gc_drain(vm_t* vm, int budget) {
+    vm_heap_t* heap = &vm->mem.heap;
+    val_addr_t virt_addr_heap = MEM_MK_PROGR_ADDR(vm->mem.stack.size);
+    while( heap->grey_count > 0 && budget > 0 ) {
+        // the scanned part is taken off first, shading may queue
+        val_t* grey = &heap->grey[heap->grey_count - 1];
+        int n = _MIN((int) grey->count, budget);
+        val_t* values = heap->values + (grey->u.address - virt_addr_heap);
+        grey->u.address += (val_addr_t) n;
+        grey->count -= n;
+        if( grey->count == 0 ) {
+            heap->grey_count--;
+        }
+        for(int i = 0; i < n; i++) {
+            heap_gc_shade(vm, values[i]);
+        }
+        budget -= n;
+    }
+    return budget;
+}
+
+static void heap_gc_begin(vm_t* vm) {
+    vm_heap_t* heap = &vm->mem.heap;
+    memset(heap->gc_live, 0, CALC_GC_MARK_U64_COUNT(heap->size) * sizeof(uint64_t));
+    heap->grey_count = 0;
+    heap->grey_overflow = false;
+    heap->gc_marking = true;
+    heap_gc_shade_roots(vm);
+}
+
+static void heap_gc_finish(vm_t* vm) {
+    vm_heap_t* heap = &vm->mem.heap;
+    heap_gc_shade_roots(vm);
+    heap_gc_drain(vm, INT_MAX);
+    if( heap->grey_overflow ) {
+        // some arrays were never scanned
+        heap_gc_collect(vm);
+        return;
+    }
+    heap->gc_marking = false;
+    int mark_words = CALC_GC_MARK_U64_COUNT(heap->size);
+    memcpy(heap->gc_marks, heap->gc_live, mark_words * sizeof(uint64_t));
+    heap_mark_all_dirty(vm);
+    uint64_t* full = heap->gc_full;
+    memset(full, 0, CALC_GC_FULL_U64_COUNT(heap->size) * sizeof(uint64_t));
+    for(int i = 0; i < mark_words; i++) {
+        if( heap->gc_marks[i] == ~0UL ) {
+            full[HEAP_TO_PAGE_INDEX(i)] |= 1UL << HEAP_TO_BIT_INDEX(i);
+        }
+    }
+    for(int i = 0; i < HEAP_POOL_CLASSES; i++) {
+        heap->pool_counts[i] = 0;
+    }
+    heap_pool_rebuild(vm);
+    heap->gc_stats.cycles++;
+    heap->allocated = 0;
+    heap->gc_trigger = (heap->size - heap_get_used(vm) / (int) sizeof(val_t)) / 2;
+}
+
+// the marking work of one allocation
+static void heap_gc_step(vm_t* vm) {
+    vm_heap_t* heap = &vm->mem.heap;
+    if( heap->gc_marking == false && heap->allocated < heap->gc_trigger ) {
+        return;
+    }
+    uint64_t start = heap_clock_us();
+    if( heap->gc_marking == false ) {
+        heap_gc_begin(vm);
+    } else if( heap_gc_drain(vm, (int) heap->gc_budget) > 0 || heap->grey_count == 0 ) {
+        heap_gc_finish(vm);
+    }
+    heap_gc_pause(vm, start);
+}
+
+// HEAP RESET (vm_call_batch)
+//
+// The items of a batch only add marks (allocations and collections
+// that find the values of the saved state), restoring the mark words
+// between the first and the last one set since the save is enough.
+// Values moved by a compaction no longer match the saved marks, the
+// garbage of the item is collected instead and the state saved again.
+
+bool heap_reset_save(vm_t* vm, vm_heap_reset_t* reset) {
+    vm_heap_t* heap = &vm->mem.heap;
+    int words = HEAP_MARK_REGION_U64_COUNT(heap->size);
+    if( reset->marks == NULL ) {
+        reset->marks = (uint64_t*) malloc(words * sizeof(uint64_t));
+        if( reset->marks == NULL ) {
+            return false;
+        }
+    }
+    if( heap->gc_marking || (heap->gc_budget > 0 && heap->allocated >= heap->gc_trigger) ) {
+        // else every item would start the cycle again
+        heap_gc_collect(vm);
+    }
+    heap->gc_marking = false;
+    memcpy(reset->marks, heap->gc_marks, words * sizeof(uint64_t));
+    reset->cursor = heap->cursor;
+    reset->allocated = heap->allocated;
+    reset->gc_trigger = heap->gc_trigger;
+    reset->compactions = heap->compactions;
+    heap->dirty_first = CALC_GC_MARK_U64_COUNT(heap->size);
+    heap->dirty_last = -1;
+    return true;
+}
+
+void heap_reset_restore(vm_t* vm, vm_heap_reset_t* reset) {
+    vm_heap_t* heap = &vm->mem.heap;
+    if( heap->compactions != reset->compactions ) {
+        vm->mem.stack.top = -1;
+        heap_gc_collect(vm);
+        heap_reset_save(vm, reset);
+        return;
+    }
+    int first = heap->dirty_first;
+    int last = heap->dirty_last;
+    if( first <= last ) {
+        memcpy(heap->gc_marks + first, reset->marks + first,
+            (last - first + 1) * sizeof(uint64_t));
+        // the summary bits of those words
+        uint64_t* full = reset->marks + CALC_GC_MARK_U64_COUNT(heap->size);
+        int full_first = HEAP_TO_PAGE_INDEX(first);
+        int full_last = HEAP_TO_PAGE_INDEX(last);
+        memcpy(heap->gc_full + full_first, full + full_first,
+            (full_last - full_first + 1) * sizeof(uint64_t));
+    }
+    heap->dirty_first = CALC_GC_MARK_U64_COUNT(heap->size);
+    heap->dirty_last = -1;
+    heap->cursor = reset->cursor;
+    // a cycle started by the item has marked its values live
+    heap->gc_marking = false;
+    heap->allocated = reset->allocated;
+    heap->gc_trigger = reset->gc_trigger;
+}
+
+void heap_reset_free(vm_heap_reset_t* reset) {
+    free(reset->marks);
+    reset->marks = NULL;
+}
+
+// allocates val_count values (-1 if there is no room), they are
+// zeroed unless the caller writes all of them
+static int heap_alloc_values(vm_t* vm, int val_count, bool zero) {
+
+    if( val_count == 0 ) {
+        return 0; // takes up no values
+    }
+
+    if( vm->mem.heap.gc_budget > 0 ) {
+        heap_gc_step(vm);
+    }
+
+    int addr = heap_take_chunk(vm, val_count);
 
     // run GC if we are out of memory
-    if( addr < 0 || end_addr >= vm->mem.heap.size ) {
+    if( addr < 0 ) {
+        uint64_t start = heap_clock_us();
         heap_gc_collect(vm);
-        addr = heap_find_free_chunk(vm, val_count);
-        end_addr = addr + val_count;
+        addr = heap_take_chunk(vm, val_count);
+        // the free values are there but scattered, move them together
+        if( addr < 0 && vm->mem.heap.size - heap_get_used(vm) / (int) sizeof(val_t) >= val_count ) {
+            addr = heap_compact(vm);
+            if( addr >= 0 ) {
+                vm->mem.heap.cursor = HEAP_TO_PAGE_INDEX(addr + val_count);
+            }
+        }
+        heap_gc_pause(vm, start);
     }
 
     // if GC did not free up enough memory we fail
-    if( addr < 0 || end_addr >= vm->mem.heap.size ) {
+    if( addr < 0 ) {
         sh_log_error("VM heap: not enough free memory.\n");
-        return (array_t) { 0 }; // null address makes this invalid
+        return -1;
     }
 
-    // mark whole pages
-    int num_bits_per_page = sizeof(uint64_t) * CHAR_BIT;
-    int num_pages = CALC_GC_MARK_U64_COUNT(val_count) - 1;
-    int page = HEAP_TO_PAGE_INDEX(addr);
-    for(int page_index = page; page_index < num_pages; page_index++) {
-        assert(vm->mem.heap.gc_marks[page_index] == 0UL);
-        vm->mem.heap.gc_marks[page_index] = 0xFFFFFFFFFFFFFFFFUL;
-    }
-
-    // mark sub-page bits
-    int trail_addr = addr + (num_pages * num_bits_per_page);
-    int trail_page = page + num_pages;
-    int trail_bits = val_count - (num_pages * num_bits_per_page);
-    int shift = HEAP_TO_BIT_INDEX(trail_addr);
-    uint64_t chunk_mask = MK_CHUNK_MASK(trail_bits);
-    // assert that we are not overwriting previous data
-    assert((vm->mem.heap.gc_marks[trail_page] & (chunk_mask << shift)) == 0);
-    vm->mem.heap.gc_marks[trail_page] |= (chunk_mask << shift);
+    heap_mark_range(vm, addr, val_count);
+    vm->mem.heap.allocated += val_count;
+    if( vm->mem.heap.gc_marking ) {
+        heap_set_range(vm->mem.heap.gc_live, addr, val_count);
+    }
 
     // set all values
-    for(int i = 0; i < val_count; i++) {
-        vm->mem.heap.values[addr + i] = (val_t){ 0 };
+    if( zero ) {
+        memset(vm->mem.heap.values + addr, 0, val_count * sizeof(val_t));
     }
 
-    return (array_t) {
-        MEM_MK_PROGR_ADDR(vm->mem.stack.size + addr),
-        val_count
+    return addr;
+}
+
+array_t heap_array_alloc(vm_t* vm, int val_count) {
+    return heap_packed_alloc(vm, VAL_NONE, val_count);
+}
+
+static array_t heap_alloc_array(vm_t* vm, val_type_t pack, int length, bool zero) {
+
+    if( length > VAL_MAX_COUNT ) {
+        sh_log_error("VM heap: array length %i is too large.\n", length);
+        return (array_t) { 0 }; // null address makes this invalid
+    }
+
+    array_t array = (array_t) {
+        .address = 0,
+        .length = length,
+        .pack = pack_width(pack) > 0 ? pack : VAL_NONE
     };
+    int addr = heap_alloc_values(vm, array_slot_count(array), zero);
+    if( addr < 0 ) {
+        return (array_t) { 0 }; // null address makes this invalid
+    }
+    array.address = MEM_MK_PROGR_ADDR(vm->mem.stack.size + addr);
+    return array;
+}
+
+// pack is the element type (VAL_NONE: not packed, see sh_value.h)
+array_t heap_packed_alloc(vm_t* vm, val_type_t pack, int length) {
+    return heap_alloc_array(vm, pack, length, true);
+}
+
+// an array of the length values at src (make-array), the values
+// are written once: the array isn't zeroed first
+array_t heap_array_make(vm_t* vm, val_type_t pack, val_t* src, int length) {
+    array_t array = heap_alloc_array(vm, pack, length, false);
+    if( ADDR_IS_NULL(array.address) ) {
+        return array;
+    }
+    if( array.pack != VAL_NONE && length > 0 ) {
+        // the padding in front of the packed elements
+        vm->mem.membase[MEM_ADDR_TO_INDEX(array.address)] = (val_t) { 0 };
+    }
+    heap_array_copy_to(vm, src, length, array);
+    return array;
+}
+
+// a packed array of chars
+array_t heap_string_alloc(vm_t* vm, const char* str, int length) {
+    array_t array = heap_packed_alloc(vm, VAL_CHAR, length);
+    if( ADDR_IS_NULL(array.address) == false ) {
+        memcpy(pack_bytes(vm->mem.membase + MEM_ADDR_TO_INDEX(array.address), array),
+            str, length);
+    }
+    return array;
 }
 
+// the values are packed if dest is a packed array
 int heap_array_copy_to(vm_t* vm, val_t* src, int length, array_t dest) {
     int dest_index = MEM_ADDR_TO_INDEX(dest.address);
     val_t* dest_ptr = vm->mem.membase + dest_index;
@@ -221,9 +840,36 @@ int heap_array_copy_to(vm_t* vm, val_t* src, int length, array_t dest) {
     int copy_length = ( dest_length < length )
         ? dest_length
         : length;
+    if( dest.pack != VAL_NONE ) {
+        int width = pack_width(dest.pack);
+        uint8_t* bytes = pack_bytes(dest_ptr, dest);
+        for(int i = 0; i < copy_length; i++) {
+            pack_store(bytes + i * width, dest.pack, src[i]);
+        }
+        return copy_length;
+    }
     for(int i = 0; i < copy_length; i++) {
+        heap_write_barrier(vm, src[i]);
         dest_ptr[i] = src[i];
     }
     return copy_length;
 }
 
+
+// constant arrays (literals) are shared by every run of the
+// program, a host that writes to an array it got from the vm
+// writes to the copy returned here (the array itself if it is
+// on the heap, an invalid array if the allocation fails)
+array_t heap_array_unshare(vm_t* vm, array_t array) {
+    if( ADDR_IS_CONST(array.address) == false ) {
+        return array;
+    }
+    array_t copy = heap_packed_alloc(vm, array.pack, array.length);
+    if( ADDR_IS_NULL(copy.address) ) {
+        return copy;
+    }
+    const val_t* src = vm->run.constants + MEM_ADDR_TO_INDEX(array.address);
+    memcpy(vm->mem.membase + MEM_ADDR_TO_INDEX(copy.address), src,
+        sizeof(val_t) * array_slot_count(array));
+    return copy;
+}
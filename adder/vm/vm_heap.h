@@ -10,12 +10,47 @@
 #define HEAP_TO_BIT_INDEX(HI) ((HI) % (sizeof(uint64_t) * CHAR_BIT))
 #define MK_CHUNK_MASK(N) (~(0xFFFFFFFFFFFFFFFFUL << N))
 #define CALC_GC_MARK_U64_COUNT(VAL_COUNT) (1 + ((VAL_COUNT) / (sizeof(uint64_t) * CHAR_BIT)))
+// the marks are followed by their summary (one bit per mark word)
+#define CALC_GC_FULL_U64_COUNT(VAL_COUNT) CALC_GC_MARK_U64_COUNT(CALC_GC_MARK_U64_COUNT(VAL_COUNT))
+#define HEAP_MARK_REGION_U64_COUNT(VAL_COUNT) \
+    (CALC_GC_MARK_U64_COUNT(VAL_COUNT) + CALC_GC_FULL_U64_COUNT(VAL_COUNT))
 
 void heap_gc_collect(vm_t* vm);
 void heap_print_usage(vm_t* vm);
 array_t heap_array_alloc(vm_t* vm, int val_count);
+array_t heap_packed_alloc(vm_t* vm, val_type_t pack, int length);
+array_t heap_string_alloc(vm_t* vm, const char* str, int length);
+array_t heap_array_make(vm_t* vm, val_type_t pack, val_t* src, int length);
 int heap_array_copy_to(vm_t* vm, val_t* src, int length, array_t dest);
+array_t heap_array_unshare(vm_t* vm, array_t array);
 void heap_clear(vm_t* vm);
 int heap_get_used(vm_t* vm);
 
+// the state vm_call_batch resets the heap to after each item,
+// restoring copies back only the mark words set since it was
+// saved. A cycle that is due is collected before saving, one
+// that starts during an item is dropped.
+typedef struct vm_heap_reset_t {
+    uint64_t*   marks;      // copy of the marks and their summary
+    int         cursor;
+    int         allocated;
+    int         gc_trigger;
+    int         compactions;
+} vm_heap_reset_t;
+
+bool heap_reset_save(vm_t* vm, vm_heap_reset_t* reset);
+void heap_reset_restore(vm_t* vm, vm_heap_reset_t* reset);
+void heap_reset_free(vm_heap_reset_t* reset);
+
+// while an incremental cycle marks (vm_set_gc_budget) a reference
+// stored into a heap array has to be shaded, the array may have
+// been scanned already
+void heap_gc_shade(vm_t* vm, val_t value);
+
+inline static void heap_write_barrier(vm_t* vm, val_t value) {
+    if( vm->mem.heap.gc_marking ) {
+        heap_gc_shade(vm, value);
+    }
+}
+
 #endif // VM_HEAP_H_
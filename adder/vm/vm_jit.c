@@ -0,0 +1,1239 @@
+#include "vm_jit.h"
+#include "sh_config.h"
+
+#if VM_JIT
+
+#include "sh_asminfo.h"
+#include "sh_value.h"
+#include "sh_utils.h"
+#include "sh_log.h"
+#include "vm_value_tools.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define JIT_NO_CODE 0xFFFFFFFFu
+
+struct vm_jit_t {
+    uint8_t*  code;       // executable memory (mmap)
+    size_t    size;       // size of the mapping
+    uint32_t* offsets;    // bytecode address -> code offset
+    uint32_t  inst_size;  // bytecode size (offsets has one more)
+};
+
+// the native code is entered through its prologue (at offset 0)
+// which loads the vm state and jumps to target
+typedef void (*jit_entry_t)(vm_t* vm, void* target, uint32_t* cycles);
+
+// x86-64 registers
+enum {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// condition codes (jcc / setcc)
+enum {
+    CC_B  = 0x2, CC_AE = 0x3, CC_E  = 0x4, CC_NE = 0x5,
+    CC_A  = 0x7, CC_L  = 0xC, CC_GE = 0xD, CC_LE = 0xE,
+    CC_G  = 0xF
+};
+
+// the vm state lives in callee saved registers while native
+// code runs, so calls to c helpers don't need to save anything
+#define R_VM     RBX    // vm_t*
+#define R_CYC    RBP    // remaining cycles (32 bit)
+#define R_STACK  R12    // &stack[0]
+#define R_TOP    R14    // &stack[top]
+#define R_BASE   R15    // &stack[base]
+
+#define OFF_VALUES   ((int32_t) offsetof(vm_t, mem.stack.values))
+#define OFF_TOP      ((int32_t) offsetof(vm_t, mem.stack.top))
+#define OFF_BASE     ((int32_t) offsetof(vm_t, mem.stack.base))
+#define OFF_PC       ((int32_t) offsetof(vm_t, run.pc))
+
+#define SLOT(N)      ((int32_t) (N) * (int32_t) sizeof(val_t))
+#define PAYLOAD      ((int32_t) offsetof(val_t, u))
+
+// rel32 to patch with the code offset of a bytecode address
+typedef struct jit_fixup_t {
+    uint32_t at;
+    uint32_t pc;
+} jit_fixup_t;
+
+typedef struct jit_emit_t {
+    uint8_t*     buf;
+    uint32_t     size;
+    uint32_t     capacity;
+    jit_fixup_t* fixups;      // jumps to bytecode addresses
+    uint32_t     nfixups;
+    jit_fixup_t* stubs;       // out of cycles exits
+    uint32_t     nstubs;
+    uint32_t     fixcap;
+    uint32_t     exit_at;     // offset of the epilogue
+    bool         failed;      // out of memory
+} jit_emit_t;
+
+// a value operand, either a stack/frame slot or a constant
+typedef struct jit_opnd_t {
+    bool     isimm;
+    uint64_t imm;       // the whole constant value
+    int      base;      // slot address register
+    int32_t  disp;      // slot offset
+} jit_opnd_t;
+
+/* --- emitter --- */
+
+static void emit_u8(jit_emit_t* e, uint8_t b) {
+    if( e->size >= e->capacity ) {
+        uint32_t capacity = e->capacity * 2;
+        uint8_t* buf = (uint8_t*) realloc(e->buf, capacity);
+        if( buf == NULL ) {
+            e->failed = true;
+            e->size = 0;
+            return;
+        }
+        e->buf = buf;
+        e->capacity = capacity;
+    }
+    e->buf[e->size++] = b;
+}
+
+static void emit_u32(jit_emit_t* e, uint32_t v) {
+    for(int i = 0; i < 4; i++) {
+        emit_u8(e, (uint8_t) ((v >> (8*i)) & 0xFF));
+    }
+}
+
+static void emit_u64(jit_emit_t* e, uint64_t v) {
+    emit_u32(e, (uint32_t) v);
+    emit_u32(e, (uint32_t) (v >> 32));
+}
+
+static void patch_rel32(jit_emit_t* e, uint32_t at, uint32_t target) {
+    if( e->failed ) {
+        return;
+    }
+    uint32_t rel = target - (at + 4);
+    for(int i = 0; i < 4; i++) {
+        e->buf[at + i] = (uint8_t) ((rel >> (8*i)) & 0xFF);
+    }
+}
+
+static void emit_prefix(jit_emit_t* e, uint8_t prefix, bool w, int reg, int rm, uint16_t opcode) {
+    if( prefix != 0 ) {
+        emit_u8(e, prefix);
+    }
+    uint8_t rex = 0x40 | (w ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((rm & 8) ? 0x01 : 0);
+    if( rex != 0x40 ) {
+        emit_u8(e, rex);
+    }
+    if( opcode > 0xFF ) {
+        emit_u8(e, (uint8_t) (opcode >> 8));
+    }
+    emit_u8(e, (uint8_t) (opcode & 0xFF));
+}
+
+// <opcode> reg, [base + disp]
+static void emit_mem(jit_emit_t* e, uint8_t prefix, bool w, uint16_t opcode, int reg, int base, int32_t disp) {
+    emit_prefix(e, prefix, w, reg, base, opcode);
+    bool disp8 = disp >= -128 && disp <= 127;
+    emit_u8(e, (uint8_t) (((disp8 ? 1 : 2) << 6) | ((reg & 7) << 3) | (base & 7)));
+    if( (base & 7) == RSP ) {
+        emit_u8(e, 0x24); // sib, no index (rsp / r12 base)
+    }
+    if( disp8 ) {
+        emit_u8(e, (uint8_t) (int8_t) disp);
+    } else {
+        emit_u32(e, (uint32_t) disp);
+    }
+}
+
+// <opcode> reg, rm (register direct)
+static void emit_rr(jit_emit_t* e, uint8_t prefix, bool w, uint16_t opcode, int reg, int rm) {
+    emit_prefix(e, prefix, w, reg, rm, opcode);
+    emit_u8(e, (uint8_t) (0xC0 | ((reg & 7) << 3) | (rm & 7)));
+}
+
+static void emit_load64(jit_emit_t* e, int dst, int base, int32_t disp) {
+    emit_mem(e, 0, true, 0x8B, dst, base, disp);
+}
+
+static void emit_store64(jit_emit_t* e, int base, int32_t disp, int src) {
+    emit_mem(e, 0, true, 0x89, src, base, disp);
+}
+
+static void emit_load32(jit_emit_t* e, int dst, int base, int32_t disp) {
+    emit_mem(e, 0, false, 0x8B, dst, base, disp);
+}
+
+static void emit_store32(jit_emit_t* e, int base, int32_t disp, int src) {
+    emit_mem(e, 0, false, 0x89, src, base, disp);
+}
+
+static void emit_store_imm32(jit_emit_t* e, int base, int32_t disp, uint32_t imm) {
+    emit_mem(e, 0, false, 0xC7, 0, base, disp);
+    emit_u32(e, imm);
+}
+
+static void emit_mov_imm32(jit_emit_t* e, int dst, uint32_t imm) {
+    if( dst & 8 ) {
+        emit_u8(e, 0x41);
+    }
+    emit_u8(e, (uint8_t) (0xB8 + (dst & 7)));
+    emit_u32(e, imm);
+}
+
+static void emit_mov_imm64(jit_emit_t* e, int dst, uint64_t imm) {
+    emit_u8(e, (uint8_t) (0x48 | ((dst & 8) ? 0x01 : 0)));
+    emit_u8(e, (uint8_t) (0xB8 + (dst & 7)));
+    emit_u64(e, imm);
+}
+
+static void emit_mov_rr64(jit_emit_t* e, int dst, int src) {
+    emit_rr(e, 0, true, 0x89, src, dst);
+}
+
+// add / sub a (64 bit) register and an immediate
+static void emit_add_imm64(jit_emit_t* e, int reg, int32_t imm) {
+    if( imm >= -128 && imm <= 127 ) {
+        emit_rr(e, 0, true, 0x83, 0, reg);
+        emit_u8(e, (uint8_t) (int8_t) imm);
+    } else {
+        emit_rr(e, 0, true, 0x81, 0, reg);
+        emit_u32(e, (uint32_t) imm);
+    }
+}
+
+static void emit_push(jit_emit_t* e, int reg) {
+    if( reg & 8 ) {
+        emit_u8(e, 0x41);
+    }
+    emit_u8(e, (uint8_t) (0x50 + (reg & 7)));
+}
+
+static void emit_pop(jit_emit_t* e, int reg) {
+    if( reg & 8 ) {
+        emit_u8(e, 0x41);
+    }
+    emit_u8(e, (uint8_t) (0x58 + (reg & 7)));
+}
+
+static void emit_call(jit_emit_t* e, uint64_t fn) {
+    emit_mov_imm64(e, RAX, fn);
+    emit_rr(e, 0, false, 0xFF, 2, RAX);
+}
+
+// eax = (flags match cc) ? 1 : 0
+static void emit_setcc(jit_emit_t* e, int cc) {
+    emit_rr(e, 0, false, (uint16_t) (0x0F90 | cc), 0, RAX);
+    emit_rr(e, 0, false, 0x0FB6, RAX, RAX);
+}
+
+// jcc / jmp with a rel32 to patch, returns the patch offset
+static uint32_t emit_jcc(jit_emit_t* e, int cc) {
+    emit_u8(e, 0x0F);
+    emit_u8(e, (uint8_t) (0x80 | cc));
+    emit_u32(e, 0);
+    return e->size - 4;
+}
+
+static uint32_t emit_jmp(jit_emit_t* e) {
+    emit_u8(e, 0xE9);
+    emit_u32(e, 0);
+    return e->size - 4;
+}
+
+static void add_fixup(jit_emit_t* e, jit_fixup_t** list, uint32_t* count, uint32_t at, uint32_t pc) {
+    if( *count >= e->fixcap ) {
+        uint32_t fixcap = e->fixcap * 2;
+        jit_fixup_t* fixups = (jit_fixup_t*) realloc(e->fixups, fixcap * sizeof(jit_fixup_t));
+        jit_fixup_t* stubs = (jit_fixup_t*) realloc(e->stubs, fixcap * sizeof(jit_fixup_t));
+        if( fixups != NULL ) {
+            e->fixups = fixups;
+        }
+        if( stubs != NULL ) {
+            e->stubs = stubs;
+        }
+        if( fixups == NULL || stubs == NULL ) {
+            e->failed = true;
+            return;
+        }
+        e->fixcap = fixcap;
+    }
+    (*list)[(*count)++] = (jit_fixup_t) { .at = at, .pc = pc };
+}
+
+static void emit_jcc_to(jit_emit_t* e, int cc, uint32_t pc) {
+    uint32_t at = emit_jcc(e, cc);
+    add_fixup(e, &e->fixups, &e->nfixups, at, pc);
+}
+
+static void emit_jmp_to(jit_emit_t* e, uint32_t pc) {
+    uint32_t at = emit_jmp(e);
+    add_fixup(e, &e->fixups, &e->nfixups, at, pc);
+}
+
+/* --- vm state --- */
+
+// write top and base back to vm->mem.stack (as indices)
+static void emit_sync_out(jit_emit_t* e) {
+    emit_mov_rr64(e, RCX, R_TOP);
+    emit_rr(e, 0, true, 0x29, R_STACK, RCX);
+    emit_rr(e, 0, true, 0xC1, 7, RCX);
+    emit_u8(e, 3);
+    emit_store32(e, R_VM, OFF_TOP, RCX);
+    emit_mov_rr64(e, RCX, R_BASE);
+    emit_rr(e, 0, true, 0x29, R_STACK, RCX);
+    emit_rr(e, 0, true, 0xC1, 7, RCX);
+    emit_u8(e, 3);
+    emit_store32(e, R_VM, OFF_BASE, RCX);
+}
+
+// reload top and base (changed by a c helper)
+static void emit_sync_in(jit_emit_t* e) {
+    emit_mem(e, 0, true, 0x63, RCX, R_VM, OFF_TOP);
+    emit_rr(e, 0, true, 0xC1, 4, RCX);
+    emit_u8(e, 3);
+    emit_mov_rr64(e, R_TOP, R_STACK);
+    emit_rr(e, 0, true, 0x01, RCX, R_TOP);
+    emit_mem(e, 0, true, 0x63, RCX, R_VM, OFF_BASE);
+    emit_rr(e, 0, true, 0xC1, 4, RCX);
+    emit_u8(e, 3);
+    emit_mov_rr64(e, R_BASE, R_STACK);
+    emit_rr(e, 0, true, 0x01, RCX, R_BASE);
+}
+
+// leave the native code, the interpreter continues at pc. If the
+// cycle of the instruction was already taken it is given back,
+// the interpreter counts it again.
+static void emit_bail(jit_emit_t* e, uint32_t pc, bool refund) {
+    if( refund ) {
+        emit_rr(e, 0, false, 0x83, 0, R_CYC);
+        emit_u8(e, 1);
+    }
+    emit_store_imm32(e, R_VM, OFF_PC, pc);
+    uint32_t at = emit_jmp(e);
+    patch_rel32(e, at, e->exit_at);
+}
+
+static void emit_prologue(jit_emit_t* e) {
+    // 7 pushes keep the stack 16 byte aligned for calls
+    emit_push(e, RBX);
+    emit_push(e, RBP);
+    emit_push(e, R12);
+    emit_push(e, R13);
+    emit_push(e, R14);
+    emit_push(e, R15);
+    emit_push(e, RDX);
+    emit_mov_rr64(e, R_VM, RDI);
+    emit_load64(e, R_STACK, R_VM, OFF_VALUES);
+    emit_load32(e, R_CYC, RDX, 0);
+    emit_sync_in(e);
+    emit_rr(e, 0, false, 0xFF, 4, RSI);
+
+    e->exit_at = e->size;
+    emit_sync_out(e);
+    emit_pop(e, RDX);
+    emit_store32(e, RDX, 0, R_CYC);
+    emit_pop(e, R15);
+    emit_pop(e, R14);
+    emit_pop(e, R13);
+    emit_pop(e, R12);
+    emit_pop(e, RBP);
+    emit_pop(e, RBX);
+    emit_u8(e, 0xC3);
+}
+
+/* --- operands --- */
+
+static jit_opnd_t opnd_slot(int base, int32_t disp) {
+    return (jit_opnd_t) { .isimm = false, .base = base, .disp = disp };
+}
+
+static jit_opnd_t opnd_const(val_t value) {
+    jit_opnd_t opnd = { .isimm = true };
+    memcpy(&opnd.imm, &value, sizeof(val_t));
+    return opnd;
+}
+
+static jit_opnd_t opnd_rk(program_t* program, uint32_t arg) {
+    if( OP_RK_IS_CONST(arg) ) {
+        return opnd_const(program->cons.buffer[OP_RK_INDEX(arg)]);
+    }
+    return opnd_slot(R_BASE, SLOT(arg));
+}
+
+static void emit_load_payload(jit_emit_t* e, int dst, jit_opnd_t opnd) {
+    if( opnd.isimm ) {
+        emit_mov_imm32(e, dst, (uint32_t) (opnd.imm >> (8 * PAYLOAD)));
+    } else {
+        emit_load32(e, dst, opnd.base, opnd.disp + PAYLOAD);
+    }
+}
+
+static void emit_load_bool(jit_emit_t* e, int dst, jit_opnd_t opnd) {
+    if( opnd.isimm ) {
+        emit_mov_imm32(e, dst, (uint32_t) (opnd.imm >> (8 * PAYLOAD)) & 0xFF);
+    } else {
+        emit_mem(e, 0, false, 0x0FB6, dst, opnd.base, opnd.disp + PAYLOAD);
+    }
+}
+
+static void emit_copy_value(jit_emit_t* e, int base, int32_t disp, jit_opnd_t src) {
+    if( src.isimm ) {
+        emit_mov_imm64(e, RAX, src.imm);
+    } else {
+        emit_load64(e, RAX, src.base, src.disp);
+    }
+    emit_store64(e, base, disp, RAX);
+}
+
+static void emit_store_result(jit_emit_t* e, int base, int32_t disp, val_type_t type) {
+    emit_store_imm32(e, base, disp, (uint32_t) type);
+    emit_store32(e, base, disp + PAYLOAD, RAX);
+}
+
+/* --- value templates --- */
+
+// eax = a <op> b, op is a stack instruction (the register and
+// fused instructions are mapped to these), returns the type of
+// the result or VAL_NONE if op has no template
+static val_type_t emit_binary(jit_emit_t* e, vm_op_t op, jit_opnd_t a, jit_opnd_t b) {
+    switch(op) {
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL:
+        case OP_DIV:
+        case OP_CMP_EQUAL:
+        case OP_CMP_NOT_EQUAL:
+        case OP_CMP_LESS_THAN:
+        case OP_CMP_MORE_THAN:
+        case OP_CMP_LESS_THAN_OR_EQUAL:
+        case OP_CMP_MORE_THAN_OR_EQUAL: {
+            emit_load_payload(e, RAX, a);
+            emit_load_payload(e, RCX, b);
+            emit_rr(e, 0x66, false, 0x0F6E, 0, RAX);
+            emit_rr(e, 0x66, false, 0x0F6E, 1, RCX);
+            switch(op) {
+                case OP_ADD: emit_rr(e, 0xF3, false, 0x0F58, 0, 1); break;
+                case OP_MUL: emit_rr(e, 0xF3, false, 0x0F59, 0, 1); break;
+                case OP_SUB: emit_rr(e, 0xF3, false, 0x0F5C, 0, 1); break;
+                case OP_DIV: emit_rr(e, 0xF3, false, 0x0F5E, 0, 1); break;
+                // a < b as b > a, unordered (nan) compares false
+                case OP_CMP_LESS_THAN:
+                    emit_rr(e, 0, false, 0x0F2E, 1, 0);
+                    emit_setcc(e, CC_A);
+                    return VAL_BOOL;
+                case OP_CMP_LESS_THAN_OR_EQUAL:
+                    emit_rr(e, 0, false, 0x0F2E, 1, 0);
+                    emit_setcc(e, CC_AE);
+                    return VAL_BOOL;
+                case OP_CMP_MORE_THAN:
+                    emit_rr(e, 0, false, 0x0F2E, 0, 1);
+                    emit_setcc(e, CC_A);
+                    return VAL_BOOL;
+                case OP_CMP_MORE_THAN_OR_EQUAL:
+                    emit_rr(e, 0, false, 0x0F2E, 0, 1);
+                    emit_setcc(e, CC_AE);
+                    return VAL_BOOL;
+                default: {
+                    // fabs(a - b) compared with epsilon (0.0001f)
+                    float epsilon = 0.0001f;
+                    uint32_t epsilon_bits;
+                    memcpy(&epsilon_bits, &epsilon, sizeof(float));
+                    emit_rr(e, 0xF3, false, 0x0F5C, 0, 1);
+                    emit_rr(e, 0x66, false, 0x0F7E, 0, RAX);
+                    emit_rr(e, 0, false, 0x81, 4, RAX);
+                    emit_u32(e, 0x7FFFFFFF);
+                    emit_rr(e, 0x66, false, 0x0F6E, 0, RAX);
+                    emit_mov_imm32(e, RCX, epsilon_bits);
+                    emit_rr(e, 0x66, false, 0x0F6E, 1, RCX);
+                    if( op == OP_CMP_EQUAL ) {
+                        emit_rr(e, 0, false, 0x0F2E, 1, 0);
+                    } else {
+                        emit_rr(e, 0, false, 0x0F2E, 0, 1);
+                    }
+                    emit_setcc(e, CC_A);
+                    return VAL_BOOL;
+                }
+            }
+            emit_rr(e, 0x66, false, 0x0F7E, 0, RAX);
+            return VAL_NUMBER;
+        }
+        case OP_IADD:
+        case OP_ISUB:
+        case OP_IMUL:
+        case OP_ICMP_EQUAL:
+        case OP_ICMP_NOT_EQUAL:
+        case OP_ICMP_LESS_THAN:
+        case OP_ICMP_MORE_THAN:
+        case OP_ICMP_LESS_THAN_OR_EQUAL:
+        case OP_ICMP_MORE_THAN_OR_EQUAL: {
+            emit_load_payload(e, RAX, a);
+            emit_load_payload(e, RCX, b);
+            switch(op) {
+                case OP_IADD: emit_rr(e, 0, false, 0x01, RCX, RAX); return VAL_INT;
+                case OP_ISUB: emit_rr(e, 0, false, 0x29, RCX, RAX); return VAL_INT;
+                case OP_IMUL: emit_rr(e, 0, false, 0x0FAF, RAX, RCX); return VAL_INT;
+                default: break;
+            }
+            emit_rr(e, 0, false, 0x39, RCX, RAX);
+            switch(op) {
+                case OP_ICMP_EQUAL:                 emit_setcc(e, CC_E); break;
+                case OP_ICMP_NOT_EQUAL:             emit_setcc(e, CC_NE); break;
+                case OP_ICMP_LESS_THAN:             emit_setcc(e, CC_L); break;
+                case OP_ICMP_MORE_THAN:             emit_setcc(e, CC_G); break;
+                case OP_ICMP_LESS_THAN_OR_EQUAL:    emit_setcc(e, CC_LE); break;
+                default:                            emit_setcc(e, CC_GE); break;
+            }
+            return VAL_BOOL;
+        }
+        case OP_AND:
+        case OP_OR: {
+            emit_load_bool(e, RAX, a);
+            emit_load_bool(e, RCX, b);
+            emit_rr(e, 0, false, op == OP_AND ? 0x21 : 0x09, RCX, RAX);
+            return VAL_BOOL;
+        }
+        default: break;
+    }
+    return VAL_NONE;
+}
+
+// eax = <op> a
+static val_type_t emit_unary(jit_emit_t* e, vm_op_t op, jit_opnd_t a) {
+    switch(op) {
+        case OP_NEG:
+            emit_load_payload(e, RAX, a);
+            emit_rr(e, 0, false, 0x81, 6, RAX);
+            emit_u32(e, 0x80000000);
+            return VAL_NUMBER;
+        case OP_INEG:
+            emit_load_payload(e, RAX, a);
+            emit_rr(e, 0, false, 0xF7, 3, RAX);
+            return VAL_INT;
+        case OP_NOT:
+            emit_load_bool(e, RAX, a);
+            emit_rr(e, 0, false, 0x83, 6, RAX);
+            emit_u8(e, 1);
+            return VAL_BOOL;
+        case OP_INT_TO_FLOAT:
+            emit_load_payload(e, RAX, a);
+            emit_rr(e, 0xF3, false, 0x0F2A, 0, RAX);
+            emit_rr(e, 0x66, false, 0x0F7E, 0, RAX);
+            return VAL_NUMBER;
+        default: break;
+    }
+    return VAL_NONE;
+}
+
+// the stack instruction a register / fused instruction maps to
+static vm_op_t jit_base_op(vm_op_t op) {
+    switch(op) {
+        case OP_R_ADD:                              return OP_ADD;
+        case OP_R_SUB:                              return OP_SUB;
+        case OP_R_MUL:                              return OP_MUL;
+        case OP_R_DIV:                              return OP_DIV;
+        case OP_R_NEG:                              return OP_NEG;
+        case OP_R_AND:                              return OP_AND;
+        case OP_R_OR:                               return OP_OR;
+        case OP_R_NOT:                              return OP_NOT;
+        case OP_R_CMP_EQUAL:
+        case OP_R_JUMP_IF_NOT_EQUAL:
+        case OP_JUMP_IF_NOT_EQUAL:                  return OP_CMP_EQUAL;
+        case OP_R_CMP_NOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_JUMP_IF_NOT_NOT_EQUAL:              return OP_CMP_NOT_EQUAL;
+        case OP_R_CMP_LESS_THAN:
+        case OP_R_JUMP_IF_NOT_LESS_THAN:
+        case OP_JUMP_IF_NOT_LESS_THAN:              return OP_CMP_LESS_THAN;
+        case OP_R_CMP_MORE_THAN:
+        case OP_R_JUMP_IF_NOT_MORE_THAN:
+        case OP_JUMP_IF_NOT_MORE_THAN:              return OP_CMP_MORE_THAN;
+        case OP_R_CMP_LESS_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL:     return OP_CMP_LESS_THAN_OR_EQUAL;
+        case OP_R_CMP_MORE_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:     return OP_CMP_MORE_THAN_OR_EQUAL;
+        case OP_R_IADD:                             return OP_IADD;
+        case OP_R_ISUB:                             return OP_ISUB;
+        case OP_R_IMUL:                             return OP_IMUL;
+        case OP_R_INEG:                             return OP_INEG;
+        case OP_R_ICMP_EQUAL:
+        case OP_R_JUMP_IF_NOT_IEQUAL:
+        case OP_JUMP_IF_NOT_IEQUAL:                 return OP_ICMP_EQUAL;
+        case OP_R_ICMP_NOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_INOT_EQUAL:
+        case OP_JUMP_IF_NOT_INOT_EQUAL:             return OP_ICMP_NOT_EQUAL;
+        case OP_R_ICMP_LESS_THAN:
+        case OP_R_JUMP_IF_NOT_ILESS_THAN:
+        case OP_JUMP_IF_NOT_ILESS_THAN:             return OP_ICMP_LESS_THAN;
+        case OP_R_ICMP_MORE_THAN:
+        case OP_R_JUMP_IF_NOT_IMORE_THAN:
+        case OP_JUMP_IF_NOT_IMORE_THAN:             return OP_ICMP_MORE_THAN;
+        case OP_R_ICMP_LESS_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL:    return OP_ICMP_LESS_THAN_OR_EQUAL;
+        case OP_R_ICMP_MORE_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL:    return OP_ICMP_MORE_THAN_OR_EQUAL;
+        default: break;
+    }
+    return op;
+}
+
+/* --- c helpers, called from native code --- */
+
+// OP_CALL, false on call stack overflow
+static bool jit_push_frame(vm_t* vm, int return_pc) {
+    vm_mem_t* mem = &vm->mem;
+    if( mem->frames.top + 1 >= mem->frames.size
+        || mem->stack.top + vm->run.extent >= mem->stack.size ) {
+        return false;
+    }
+    mem->frames.frames[++mem->frames.top] = (vm_frame_t) {
+        .return_pc = return_pc,
+        .base = mem->stack.top + 1
+    };
+    return true;
+}
+
+// OP_TAIL_CALL, false on call stack overflow
+static bool jit_tail_call(vm_t* vm, uint32_t nargs) {
+    vm_mem_t* mem = &vm->mem;
+    int base = mem->stack.base;
+    if( base + (int) nargs - 1 + vm->run.extent >= mem->stack.size ) {
+        return false;
+    }
+    val_t* args = &mem->stack.values[mem->stack.top - nargs + 1];
+    for(uint32_t i = 0; i < nargs; i++) {
+        mem->stack.values[base + i] = args[i];
+    }
+    mem->stack.top = base + nargs - 1;
+    vm_frame_t* current = &mem->frames.frames[mem->frames.top];
+    current->num_args = nargs;
+    current->num_locals = 0;
+    return true;
+}
+
+// OP_MAKE_FRAME
+static void jit_make_frame(vm_t* vm, uint32_t nargs, uint32_t nlocals) {
+    vm_mem_t* mem = &vm->mem;
+    vm_frame_t* current = &mem->frames.frames[mem->frames.top];
+    current->base = mem->stack.top - nargs + 1;
+    current->num_args = nargs;
+    current->num_locals = nlocals;
+    mem->stack.base = current->base;
+    for(uint32_t i = 0; i < nlocals; i++) {
+        mem->stack.values[++mem->stack.top] = (val_t) { 0 };
+    }
+}
+
+// OP_RETURN_VALUE / OP_RETURN_NOTHING, returns the native code
+// to continue at or NULL when leaving the entry point (which is
+// left to the interpreter)
+static uint8_t* jit_return(vm_t* vm, vm_jit_t* jit, bool with_value) {
+    vm_mem_t* mem = &vm->mem;
+    int frame = mem->frames.top;
+    if( frame < 0 || mem->frames.frames[frame].return_pc < 0 ) {
+        return NULL;
+    }
+    vm_frame_t current = mem->frames.frames[frame];
+    int base = mem->stack.base;
+    int invoked_top = mem->stack.top;
+    mem->stack.top = base - 1;
+    if( with_value && invoked_top >= base + current.num_args + current.num_locals ) {
+        mem->stack.values[++mem->stack.top] = mem->stack.values[invoked_top];
+    }
+    frame --;
+    mem->frames.top = frame;
+    mem->stack.base = frame >= 0 ? mem->frames.frames[frame].base : 0;
+    return jit->code + jit->offsets[current.return_pc];
+}
+
+static void jit_make_iter(val_t* slot) {
+    *slot = val_iter(array_iter(val_into_array(*slot)));
+}
+
+static void jit_array_length(val_t* slot) {
+    *slot = val_int(val_into_array(*slot).length);
+}
+
+// OP_ITER_NEXT, false when the iterator is done
+static bool jit_iter_next(vm_t* vm, val_t* slot, val_t* dest) {
+    iter_t iter = val_into_iter(*slot);
+    if( iter.remaining == 0 ) {
+        return false;
+    }
+    *dest = iter_next_value(&iter, addr_get_ptr(vm, iter.current));
+    *slot = val_iter(iter);
+    return true;
+}
+
+#define FN_ADDR(F) ((uint64_t) (uintptr_t) (F))
+
+/* --- instructions --- */
+
+// emits the native code of one instruction, false if there is
+// no template for it (the caller emits a bail out instead)
+static bool emit_instruction(jit_emit_t* e, vm_jit_t* jit, program_t* program, vm_env_t* env, uint32_t pc) {
+
+    uint8_t* instructions = program->inst.buffer;
+    vm_op_t opcode = instructions[pc];
+    uint32_t arg0 = 0, arg1 = 0, arg2 = 0;
+    size_t argcount = get_op_arg_count(opcode);
+    if( argcount > 0 ) arg0 = READ_U32(instructions, pc + 1);
+    if( argcount > 1 ) arg1 = READ_U32(instructions, pc + 5);
+    if( argcount > 2 ) arg2 = READ_U32(instructions, pc + 9);
+    uint32_t next_pc = pc + 1 + 4 * argcount;
+
+    // the instructions with helpers / exits need to know
+    // their size ahead of the cycle check
+    switch(opcode) {
+        case OP_CALL_NATIVE: {
+            if( arg0 >= (uint32_t) env->count ) {
+                return false;
+            }
+            // async calls leave the native code
+            if( env->natives[arg0].handle.tag == FFI_HNDL_HOST_ASYNC ) {
+                return false;
+            }
+        } break;
+        case OP_PUSH_VALUE:
+        case OP_PUSH_VALUE_LOAD_LOCAL:
+        case OP_INC_LOCAL_BY_CONST:
+        case OP_IINC_LOCAL_BY_CONST: {
+            uint32_t index = opcode == OP_PUSH_VALUE
+                          || opcode == OP_PUSH_VALUE_LOAD_LOCAL ? arg0 : arg1;
+            if( index >= program->cons.count ) {
+                return false;
+            }
+        } break;
+        default: break;
+    }
+
+    vm_op_t base_op = jit_base_op(opcode);
+    switch(opcode) {
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+        case OP_CMP_EQUAL: case OP_CMP_NOT_EQUAL:
+        case OP_CMP_LESS_THAN: case OP_CMP_MORE_THAN:
+        case OP_CMP_LESS_THAN_OR_EQUAL: case OP_CMP_MORE_THAN_OR_EQUAL:
+        case OP_AND: case OP_OR:
+        case OP_IADD: case OP_ISUB: case OP_IMUL:
+        case OP_ICMP_EQUAL: case OP_ICMP_NOT_EQUAL:
+        case OP_ICMP_LESS_THAN: case OP_ICMP_MORE_THAN:
+        case OP_ICMP_LESS_THAN_OR_EQUAL: case OP_ICMP_MORE_THAN_OR_EQUAL:
+        case OP_NEG: case OP_INEG: case OP_NOT: case OP_INT_TO_FLOAT:
+        case OP_JUMP_IF_NOT_EQUAL: case OP_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_JUMP_IF_NOT_LESS_THAN: case OP_JUMP_IF_NOT_MORE_THAN:
+        case OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL: case OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_IEQUAL: case OP_JUMP_IF_NOT_INOT_EQUAL:
+        case OP_JUMP_IF_NOT_ILESS_THAN: case OP_JUMP_IF_NOT_IMORE_THAN:
+        case OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL: case OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL:
+        case OP_R_ADD: case OP_R_SUB: case OP_R_MUL: case OP_R_DIV:
+        case OP_R_AND: case OP_R_OR:
+        case OP_R_CMP_EQUAL: case OP_R_CMP_NOT_EQUAL:
+        case OP_R_CMP_LESS_THAN: case OP_R_CMP_MORE_THAN:
+        case OP_R_CMP_LESS_THAN_OR_EQUAL: case OP_R_CMP_MORE_THAN_OR_EQUAL:
+        case OP_R_IADD: case OP_R_ISUB: case OP_R_IMUL:
+        case OP_R_ICMP_EQUAL: case OP_R_ICMP_NOT_EQUAL:
+        case OP_R_ICMP_LESS_THAN: case OP_R_ICMP_MORE_THAN:
+        case OP_R_ICMP_LESS_THAN_OR_EQUAL: case OP_R_ICMP_MORE_THAN_OR_EQUAL:
+        case OP_R_NEG: case OP_R_INEG: case OP_R_NOT:
+        case OP_R_JUMP_IF_NOT_EQUAL: case OP_R_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_LESS_THAN: case OP_R_JUMP_IF_NOT_MORE_THAN:
+        case OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL: case OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_IEQUAL: case OP_R_JUMP_IF_NOT_INOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_ILESS_THAN: case OP_R_JUMP_IF_NOT_IMORE_THAN:
+        case OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL: case OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL:
+        case OP_PUSH_VALUE: case OP_POP_1: case OP_POP_2:
+        case OP_DUP_1: case OP_DUP_2: case OP_ROT_2:
+        case OP_LOAD_LOCAL: case OP_STORE_LOCAL:
+        case OP_LOAD_LOCAL_PAIR: case OP_PUSH_VALUE_LOAD_LOCAL:
+        case OP_ADD_LOCALS_TO_LOCAL: case OP_INC_LOCAL_BY_CONST:
+        case OP_IADD_LOCALS_TO_LOCAL: case OP_IINC_LOCAL_BY_CONST:
+        case OP_JUMP: case OP_JUMP_IF_FALSE:
+        case OP_CALL: case OP_TAIL_CALL: case OP_MAKE_FRAME:
+        case OP_RETURN_VALUE: case OP_RETURN_NOTHING:
+        case OP_CALL_NATIVE:
+        case OP_MAKE_ITER: case OP_ARRAY_LENGTH:
+        case OP_ITER_NEXT: case OP_ITER_NEXT_STORE_LOCAL:
+        case OP_R_MOVE: case OP_R_JUMP_IF_FALSE:
+            break;
+        default:
+            // halt, exit, make-array, the div and mod
+            // instructions (errors) are interpreted
+            return false;
+    }
+
+    // take a cycle, out of cycles exits to a stub
+    emit_rr(e, 0, false, 0x83, 5, R_CYC);
+    emit_u8(e, 1);
+    uint32_t stub_at = emit_jcc(e, CC_B);
+    add_fixup(e, &e->stubs, &e->nstubs, stub_at, pc);
+
+    switch(opcode) {
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV:
+        case OP_CMP_EQUAL: case OP_CMP_NOT_EQUAL:
+        case OP_CMP_LESS_THAN: case OP_CMP_MORE_THAN:
+        case OP_CMP_LESS_THAN_OR_EQUAL: case OP_CMP_MORE_THAN_OR_EQUAL:
+        case OP_AND: case OP_OR:
+        case OP_IADD: case OP_ISUB: case OP_IMUL:
+        case OP_ICMP_EQUAL: case OP_ICMP_NOT_EQUAL:
+        case OP_ICMP_LESS_THAN: case OP_ICMP_MORE_THAN:
+        case OP_ICMP_LESS_THAN_OR_EQUAL: case OP_ICMP_MORE_THAN_OR_EQUAL: {
+            // a is the top of the stack, b the value below
+            val_type_t type = emit_binary(e, opcode,
+                opnd_slot(R_TOP, 0), opnd_slot(R_TOP, -SLOT(1)));
+            emit_store_result(e, R_TOP, -SLOT(1), type);
+            emit_add_imm64(e, R_TOP, -SLOT(1));
+        } break;
+        case OP_NEG: case OP_INEG: case OP_NOT: case OP_INT_TO_FLOAT: {
+            val_type_t type = emit_unary(e, opcode, opnd_slot(R_TOP, 0));
+            emit_store_result(e, R_TOP, 0, type);
+        } break;
+        case OP_JUMP_IF_NOT_EQUAL: case OP_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_JUMP_IF_NOT_LESS_THAN: case OP_JUMP_IF_NOT_MORE_THAN:
+        case OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL: case OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_IEQUAL: case OP_JUMP_IF_NOT_INOT_EQUAL:
+        case OP_JUMP_IF_NOT_ILESS_THAN: case OP_JUMP_IF_NOT_IMORE_THAN:
+        case OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL: case OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL: {
+            emit_binary(e, base_op, opnd_slot(R_TOP, 0), opnd_slot(R_TOP, -SLOT(1)));
+            emit_add_imm64(e, R_TOP, -SLOT(2));
+            emit_rr(e, 0, false, 0x85, RAX, RAX);
+            emit_jcc_to(e, CC_E, arg0);
+        } break;
+        case OP_R_ADD: case OP_R_SUB: case OP_R_MUL: case OP_R_DIV:
+        case OP_R_AND: case OP_R_OR:
+        case OP_R_CMP_EQUAL: case OP_R_CMP_NOT_EQUAL:
+        case OP_R_CMP_LESS_THAN: case OP_R_CMP_MORE_THAN:
+        case OP_R_CMP_LESS_THAN_OR_EQUAL: case OP_R_CMP_MORE_THAN_OR_EQUAL:
+        case OP_R_IADD: case OP_R_ISUB: case OP_R_IMUL:
+        case OP_R_ICMP_EQUAL: case OP_R_ICMP_NOT_EQUAL:
+        case OP_R_ICMP_LESS_THAN: case OP_R_ICMP_MORE_THAN:
+        case OP_R_ICMP_LESS_THAN_OR_EQUAL: case OP_R_ICMP_MORE_THAN_OR_EQUAL: {
+            val_type_t type = emit_binary(e, base_op,
+                opnd_rk(program, arg1), opnd_rk(program, arg2));
+            emit_store_result(e, R_BASE, SLOT(arg0), type);
+        } break;
+        case OP_R_NEG: case OP_R_INEG: case OP_R_NOT: {
+            val_type_t type = emit_unary(e, base_op, opnd_rk(program, arg1));
+            emit_store_result(e, R_BASE, SLOT(arg0), type);
+        } break;
+        case OP_R_JUMP_IF_NOT_EQUAL: case OP_R_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_LESS_THAN: case OP_R_JUMP_IF_NOT_MORE_THAN:
+        case OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL: case OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_IEQUAL: case OP_R_JUMP_IF_NOT_INOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_ILESS_THAN: case OP_R_JUMP_IF_NOT_IMORE_THAN:
+        case OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL: case OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL: {
+            emit_binary(e, base_op, opnd_rk(program, arg1), opnd_rk(program, arg2));
+            emit_rr(e, 0, false, 0x85, RAX, RAX);
+            emit_jcc_to(e, CC_E, arg0);
+        } break;
+        case OP_R_JUMP_IF_FALSE: {
+            emit_load_bool(e, RAX, opnd_rk(program, arg1));
+            emit_rr(e, 0, false, 0x85, RAX, RAX);
+            emit_jcc_to(e, CC_E, arg0);
+        } break;
+        case OP_R_MOVE: {
+            emit_copy_value(e, R_BASE, SLOT(arg0), opnd_rk(program, arg1));
+        } break;
+        case OP_PUSH_VALUE: {
+            emit_copy_value(e, R_TOP, SLOT(1), opnd_const(program->cons.buffer[arg0]));
+            emit_add_imm64(e, R_TOP, SLOT(1));
+        } break;
+        case OP_POP_1: {
+            emit_add_imm64(e, R_TOP, -SLOT(1));
+        } break;
+        case OP_POP_2: {
+            emit_add_imm64(e, R_TOP, -SLOT(2));
+        } break;
+        case OP_DUP_1: {
+            emit_copy_value(e, R_TOP, SLOT(1), opnd_slot(R_TOP, 0));
+            emit_add_imm64(e, R_TOP, SLOT(1));
+        } break;
+        case OP_DUP_2: {
+            emit_load64(e, RAX, R_TOP, -SLOT(1));
+            emit_load64(e, RCX, R_TOP, 0);
+            emit_store64(e, R_TOP, SLOT(1), RAX);
+            emit_store64(e, R_TOP, SLOT(2), RCX);
+            emit_add_imm64(e, R_TOP, SLOT(2));
+        } break;
+        case OP_ROT_2: {
+            emit_load64(e, RAX, R_TOP, -SLOT(1));
+            emit_load64(e, RCX, R_TOP, 0);
+            emit_store64(e, R_TOP, -SLOT(1), RCX);
+            emit_store64(e, R_TOP, 0, RAX);
+        } break;
+        case OP_LOAD_LOCAL: {
+            emit_copy_value(e, R_TOP, SLOT(1), opnd_slot(R_BASE, SLOT(arg0)));
+            emit_add_imm64(e, R_TOP, SLOT(1));
+        } break;
+        case OP_STORE_LOCAL: {
+            emit_copy_value(e, R_BASE, SLOT(arg0), opnd_slot(R_TOP, 0));
+            emit_add_imm64(e, R_TOP, -SLOT(1));
+        } break;
+        case OP_LOAD_LOCAL_PAIR: {
+            emit_copy_value(e, R_TOP, SLOT(1), opnd_slot(R_BASE, SLOT(arg0)));
+            emit_copy_value(e, R_TOP, SLOT(2), opnd_slot(R_BASE, SLOT(arg1)));
+            emit_add_imm64(e, R_TOP, SLOT(2));
+        } break;
+        case OP_PUSH_VALUE_LOAD_LOCAL: {
+            emit_copy_value(e, R_TOP, SLOT(1), opnd_const(program->cons.buffer[arg0]));
+            emit_copy_value(e, R_TOP, SLOT(2), opnd_slot(R_BASE, SLOT(arg1)));
+            emit_add_imm64(e, R_TOP, SLOT(2));
+        } break;
+        case OP_ADD_LOCALS_TO_LOCAL:
+        case OP_IADD_LOCALS_TO_LOCAL: {
+            val_type_t type = emit_binary(e,
+                opcode == OP_ADD_LOCALS_TO_LOCAL ? OP_ADD : OP_IADD,
+                opnd_slot(R_BASE, SLOT(arg1)), opnd_slot(R_BASE, SLOT(arg0)));
+            emit_store_result(e, R_BASE, SLOT(arg2), type);
+        } break;
+        case OP_INC_LOCAL_BY_CONST:
+        case OP_IINC_LOCAL_BY_CONST: {
+            val_type_t type = emit_binary(e,
+                opcode == OP_INC_LOCAL_BY_CONST ? OP_ADD : OP_IADD,
+                opnd_slot(R_BASE, SLOT(arg0)), opnd_const(program->cons.buffer[arg1]));
+            emit_store_result(e, R_BASE, SLOT(arg0), type);
+        } break;
+        case OP_JUMP: {
+            emit_jmp_to(e, arg0);
+        } break;
+        case OP_JUMP_IF_FALSE: {
+            emit_load_bool(e, RAX, opnd_slot(R_TOP, 0));
+            emit_add_imm64(e, R_TOP, -SLOT(1));
+            emit_rr(e, 0, false, 0x85, RAX, RAX);
+            emit_jcc_to(e, CC_E, arg0);
+        } break;
+        case OP_CALL: {
+            emit_sync_out(e);
+            emit_mov_rr64(e, RDI, R_VM);
+            emit_mov_imm32(e, RSI, next_pc);
+            emit_call(e, FN_ADDR(jit_push_frame));
+            emit_rr(e, 0, false, 0x85, RAX, RAX);
+            uint32_t ok_at = emit_jcc(e, CC_NE);
+            // call stack overflow, reported by the interpreter
+            emit_bail(e, pc, true);
+            patch_rel32(e, ok_at, e->size);
+            emit_jmp_to(e, arg0);
+        } break;
+        case OP_TAIL_CALL: {
+            emit_sync_out(e);
+            emit_mov_rr64(e, RDI, R_VM);
+            emit_mov_imm32(e, RSI, arg1);
+            emit_call(e, FN_ADDR(jit_tail_call));
+            emit_rr(e, 0, false, 0x85, RAX, RAX);
+            uint32_t ok_at = emit_jcc(e, CC_NE);
+            // call stack overflow, reported by the interpreter
+            emit_bail(e, pc, true);
+            patch_rel32(e, ok_at, e->size);
+            emit_sync_in(e);
+            emit_jmp_to(e, arg0);
+        } break;
+        case OP_MAKE_FRAME: {
+            emit_sync_out(e);
+            emit_mov_rr64(e, RDI, R_VM);
+            emit_mov_imm32(e, RSI, arg0);
+            emit_mov_imm32(e, RDX, arg1);
+            emit_call(e, FN_ADDR(jit_make_frame));
+            emit_sync_in(e);
+        } break;
+        case OP_RETURN_VALUE:
+        case OP_RETURN_NOTHING: {
+            emit_sync_out(e);
+            emit_mov_rr64(e, RDI, R_VM);
+            emit_mov_imm64(e, RSI, FN_ADDR(jit));
+            emit_mov_imm32(e, RDX, opcode == OP_RETURN_VALUE);
+            emit_call(e, FN_ADDR(jit_return));
+            emit_rr(e, 0, true, 0x85, RAX, RAX);
+            uint32_t ok_at = emit_jcc(e, CC_NE);
+            // leaving the entry point
+            emit_bail(e, pc, true);
+            patch_rel32(e, ok_at, e->size);
+            emit_sync_in(e);
+            emit_rr(e, 0, false, 0xFF, 4, RAX);
+        } break;
+        case OP_CALL_NATIVE: {
+            vm_native_t* native = &env->natives[arg0];
+            ffi_handle_t handle = native->handle;
+            int32_t argc = native->argcount;
+            emit_sync_out(e);
+            if( handle.tag == FFI_HNDL_HOST_TYPED ) {
+                // the trampoline pops the args and pushes the result
+                emit_mov_rr64(e, RDI, R_VM);
+                emit_mov_imm64(e, RSI, FN_ADDR(native));
+                emit_call(e, FN_ADDR(native->call));
+                emit_sync_in(e);
+                break;
+            }
+            // call the host function directly, the args are
+            // left on the stack (and visible to the gc)
+            emit_mov_imm64(e, RDI, FN_ADDR(handle.local));
+            emit_mov_rr64(e, RSI, R_VM);
+            emit_mov_imm32(e, RDX, (uint32_t) argc);
+            emit_mem(e, 0, true, 0x8D, RCX, R_TOP, -SLOT(argc - 1));
+            emit_call(e, handle.tag == FFI_HNDL_HOST_FUNCTION
+                ? FN_ADDR(handle.u.host_function)
+                : FN_ADDR(handle.u.host_action));
+            emit_sync_in(e);
+            emit_add_imm64(e, R_TOP, -SLOT(argc));
+            if( handle.tag == FFI_HNDL_HOST_FUNCTION ) {
+                emit_store64(e, R_TOP, SLOT(1), RAX);
+                emit_add_imm64(e, R_TOP, SLOT(1));
+            }
+        } break;
+        case OP_MAKE_ITER:
+        case OP_ARRAY_LENGTH: {
+            emit_mov_rr64(e, RDI, R_TOP);
+            emit_call(e, opcode == OP_MAKE_ITER
+                ? FN_ADDR(jit_make_iter)
+                : FN_ADDR(jit_array_length));
+        } break;
+        case OP_ITER_NEXT:
+        case OP_ITER_NEXT_STORE_LOCAL: {
+            emit_mov_rr64(e, RDI, R_VM);
+            emit_mov_rr64(e, RSI, R_TOP);
+            if( opcode == OP_ITER_NEXT ) {
+                emit_mem(e, 0, true, 0x8D, RDX, R_TOP, SLOT(1));
+            } else {
+                emit_mem(e, 0, true, 0x8D, RDX, R_BASE, SLOT(arg1));
+            }
+            emit_call(e, FN_ADDR(jit_iter_next));
+            emit_rr(e, 0, false, 0x85, RAX, RAX);
+            uint32_t next_at = emit_jcc(e, CC_NE);
+            // done, drop the iterator
+            emit_add_imm64(e, R_TOP, -SLOT(1));
+            emit_jmp_to(e, arg0);
+            patch_rel32(e, next_at, e->size);
+            if( opcode == OP_ITER_NEXT ) {
+                emit_add_imm64(e, R_TOP, SLOT(1));
+            }
+        } break;
+        default:
+            assert(false && "unreachable");
+            break;
+    }
+    return true;
+}
+
+#if VM_JIT_PERF_MAP > 0
+
+// one symbol per function (from one make-frame to the next)
+static void jit_write_perf_map(vm_jit_t* jit, program_t* program, uint32_t code_end, uint32_t code_size) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int) getpid());
+    FILE* file = fopen(path, "a");
+    if( file == NULL ) {
+        return;
+    }
+    uint32_t fn_pc = 0;
+    for(uint32_t pc = 0; pc <= program->inst.size; ) {
+        bool is_end = pc == program->inst.size;
+        if( is_end || (pc > fn_pc && program->inst.buffer[pc] == OP_MAKE_FRAME) ) {
+            uint32_t start = jit->offsets[fn_pc];
+            uint32_t end = is_end ? code_end : jit->offsets[pc];
+            const char* name = NULL;
+            int name_len = 0;
+            for(int i = 0; i < program->exports.count; i++) {
+                if( program->expaddr[i] == fn_pc ) {
+                    name = sstr_ptr(&program->exports.def[i].name);
+                    name_len = sstr_len(&program->exports.def[i].name);
+                }
+            }
+            if( name != NULL ) {
+                fprintf(file, "%lx %x adder:%.*s\n",
+                    (unsigned long) (uintptr_t) (jit->code + start),
+                    end - start, name_len, name);
+            } else {
+                fprintf(file, "%lx %x adder:fn@%u\n",
+                    (unsigned long) (uintptr_t) (jit->code + start),
+                    end - start, fn_pc);
+            }
+            fn_pc = pc;
+        }
+        if( is_end ) {
+            break;
+        }
+        pc += 1 + 4 * get_op_arg_count(program->inst.buffer[pc]);
+    }
+    fprintf(file, "%lx %x adder:jit-stubs\n",
+        (unsigned long) (uintptr_t) (jit->code + code_end),
+        code_size - code_end);
+    fclose(file);
+}
+
+#endif
+
+static void jit_emit_destroy(jit_emit_t* e) {
+    free(e->buf);
+    free(e->fixups);
+    free(e->stubs);
+}
+
+vm_jit_t* vm_jit_compile(program_t* program, vm_env_t* env) {
+
+    if( program->inst.size == 0 ) {
+        return NULL;
+    }
+
+    vm_jit_t* jit = (vm_jit_t*) malloc(sizeof(vm_jit_t));
+    uint32_t* offsets = (uint32_t*) malloc(sizeof(uint32_t) * (program->inst.size + 1));
+    jit_emit_t e = {
+        .buf = (uint8_t*) malloc(4096),
+        .capacity = 4096,
+        .fixups = (jit_fixup_t*) malloc(sizeof(jit_fixup_t) * 64),
+        .stubs = (jit_fixup_t*) malloc(sizeof(jit_fixup_t) * 64),
+        .fixcap = 64
+    };
+
+    if( jit == NULL || offsets == NULL || e.buf == NULL
+     || e.fixups == NULL || e.stubs == NULL ) {
+        sh_log_error("jit: failed to allocate memory, out of memory?");
+        free(jit);
+        free(offsets);
+        jit_emit_destroy(&e);
+        return NULL;
+    }
+
+    *jit = (vm_jit_t) {
+        .offsets = offsets,
+        .inst_size = program->inst.size
+    };
+
+    for(uint32_t i = 0; i <= program->inst.size; i++) {
+        offsets[i] = JIT_NO_CODE;
+    }
+
+    emit_prologue(&e);
+
+    uint32_t pc = 0;
+    while( pc < program->inst.size && e.failed == false ) {
+        vm_op_t opcode = program->inst.buffer[pc];
+        uint32_t size = 1;
+        if( opcode < OP_OPCODE_COUNT ) {
+            size += 4 * get_op_arg_count(opcode);
+        }
+        offsets[pc] = e.size;
+        if( opcode >= OP_OPCODE_COUNT || pc + size > program->inst.size
+         || emit_instruction(&e, jit, program, env, pc) == false ) {
+            e.size = offsets[pc];
+            emit_bail(&e, pc, false);
+        }
+        pc += size;
+    }
+
+    // jumps may target the end of the program
+    offsets[program->inst.size] = e.size;
+    emit_bail(&e, program->inst.size, false);
+
+    for(uint32_t i = 0; i < e.nfixups; i++) {
+        uint32_t target = e.fixups[i].pc;
+        uint32_t offset = target <= program->inst.size ? offsets[target] : JIT_NO_CODE;
+        if( offset == JIT_NO_CODE ) {
+            // not an instruction, let the interpreter deal with it
+            offset = e.size;
+            emit_bail(&e, target, false);
+        }
+        patch_rel32(&e, e.fixups[i].at, offset);
+    }
+
+    uint32_t code_end = e.size;
+
+    // out of cycles, give the cycle back and exit
+    for(uint32_t i = 0; i < e.nstubs; i++) {
+        patch_rel32(&e, e.stubs[i].at, e.size);
+        emit_bail(&e, e.stubs[i].pc, true);
+    }
+
+    if( e.failed ) {
+        sh_log_error("jit: failed to allocate memory, out of memory?");
+        free(offsets);
+        free(jit);
+        jit_emit_destroy(&e);
+        return NULL;
+    }
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t map_size = ((e.size + page_size - 1) / page_size) * page_size;
+    void* code = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if( code == MAP_FAILED ) {
+        sh_log_error("jit: failed to map code memory.");
+        free(offsets);
+        free(jit);
+        jit_emit_destroy(&e);
+        return NULL;
+    }
+
+    memcpy(code, e.buf, e.size);
+    if( mprotect(code, map_size, PROT_READ | PROT_EXEC) != 0 ) {
+        sh_log_error("jit: failed to make code memory executable.");
+        munmap(code, map_size);
+        free(offsets);
+        free(jit);
+        jit_emit_destroy(&e);
+        return NULL;
+    }
+
+    jit->code = (uint8_t*) code;
+    jit->size = map_size;
+
+#if VM_JIT_PERF_MAP > 0
+    jit_write_perf_map(jit, program, code_end, e.size);
+#else
+    (void) code_end;
+#endif
+
+    jit_emit_destroy(&e);
+    return jit;
+}
+
+void vm_jit_destroy(vm_jit_t* jit) {
+    if( jit == NULL ) {
+        return;
+    }
+    munmap(jit->code, jit->size);
+    free(jit->offsets);
+    free(jit);
+}
+
+bool vm_jit_enter(vm_jit_t* jit, vm_t* vm, uint32_t* cycles) {
+    uint32_t pc = vm->run.pc;
+    if( pc > jit->inst_size || jit->offsets[pc] == JIT_NO_CODE ) {
+        return false;
+    }
+    // object to function pointer conversion (not iso c)
+    jit_entry_t entry;
+    void* code = jit->code;
+    memcpy(&entry, &code, sizeof(entry));
+    entry(vm, jit->code + jit->offsets[pc], cycles);
+    return true;
+}
+
+#else
+
+vm_jit_t* vm_jit_compile(program_t* program, vm_env_t* env) {
+    (void) program;
+    (void) env;
+    return NULL;
+}
+
+void vm_jit_destroy(vm_jit_t* jit) {
+    (void) jit;
+}
+
+bool vm_jit_enter(vm_jit_t* jit, vm_t* vm, uint32_t* cycles) {
+    (void) jit;
+    (void) vm;
+    (void) cycles;
+    return false;
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef VM_JIT_H_
+#define VM_JIT_H_
+
+#include "sh_types.h"
+#include "vm_types.h"
+
+// Template jit, translates the bytecode of a program (compiled
+// with compiler_opts_t.jit) to x86-64 machine code when its vm
+// env is set up. Every instruction gets its own block of native
+// code, instructions without a template bail out to the
+// interpreter for one step (see vm_run_native in vm.c).
+//
+// Only built when VM_JIT is set (sh_config.h), the functions
+// are no-ops otherwise.
+
+vm_jit_t* vm_jit_compile(program_t* program, vm_env_t* env);
+void      vm_jit_destroy(vm_jit_t* jit);
+
+// run native code from vm->run.pc until it reaches an instruction
+// it can't handle or runs out of cycles, the vm state (pc, stack
+// and frames) is up to date on return. False if there is no
+// native code for the current pc.
+bool      vm_jit_enter(vm_jit_t* jit, vm_t* vm, uint32_t* cycles);
+
+#endif // VM_JIT_H_
@@ -0,0 +1,194 @@
+#include "vm_native.h"
+#include "sh_ift.h"
+#include "sh_log.h"
+#include "sh_value.h"
+#include <assert.h>
+
+#define NATIVE_ARGS(VM, N) ((VM)->mem.stack.values + (VM)->mem.stack.top + 1 - (N))
+
+#define NATIVE_META(VM, NATIVE) (ffi_hndl_meta_t) {     \
+        .local = (NATIVE)->handle.local,                \
+        .vm = (VM)                                      \
+    }
+
+// host actions and functions, one trampoline per arity
+// (constant arg count) and one for the rest
+
+#define NATIVE_ACTION(NAME, N)                                      \
+    static void NAME(vm_t* vm, vm_native_t* native) {               \
+        native->handle.u.host_action(NATIVE_META(vm, native),       \
+            (N), NATIVE_ARGS(vm, (N)));                             \
+        vm->mem.stack.top -= (N);                                   \
+    }
+
+#define NATIVE_FUNCTION(NAME, N)                                    \
+    static void NAME(vm_t* vm, vm_native_t* native) {               \
+        val_t ret = native->handle.u.host_function(                 \
+            NATIVE_META(vm, native), (N), NATIVE_ARGS(vm, (N)));    \
+        vm->mem.stack.top -= (N);                                   \
+        vm->mem.stack.values[++vm->mem.stack.top] = ret;            \
+    }
+
+NATIVE_ACTION(native_action_0, 0)
+NATIVE_ACTION(native_action_1, 1)
+NATIVE_ACTION(native_action_2, 2)
+NATIVE_ACTION(native_action_3, 3)
+NATIVE_ACTION(native_action_4, 4)
+NATIVE_ACTION(native_action_n, native->argcount)
+
+NATIVE_FUNCTION(native_function_0, 0)
+NATIVE_FUNCTION(native_function_1, 1)
+NATIVE_FUNCTION(native_function_2, 2)
+NATIVE_FUNCTION(native_function_3, 3)
+NATIVE_FUNCTION(native_function_4, 4)
+NATIVE_FUNCTION(native_function_n, native->argcount)
+
+static const vm_trampoline_t native_actions[] = {
+    native_action_0, native_action_1, native_action_2,
+    native_action_3, native_action_4
+};
+
+static const vm_trampoline_t native_functions[] = {
+    native_function_0, native_function_1, native_function_2,
+    native_function_3, native_function_4
+};
+
+// async host functions: the run waits for vm_complete
+static void native_async(vm_t* vm, vm_native_t* native) {
+    vm_runtime_t* vm_run = &vm->run;
+    if( ++vm_run->tokens == 0 ) {
+        vm_run->tokens = 1;
+    }
+    vm_run->waiting = vm_run->tokens;
+    vm_run->awaits_value = native->returns;
+    native->handle.u.host_async(NATIVE_META(vm, native),
+        native->argcount, NATIVE_ARGS(vm, native->argcount));
+    vm->mem.stack.top -= native->argcount;
+}
+
+// typed host functions: the args are unboxed and the
+// result is boxed by the trampoline
+
+#define TYPED_PARAMS_0(T) void
+#define TYPED_PARAMS_1(T) T
+#define TYPED_PARAMS_2(T) T, T
+#define TYPED_PARAMS_3(T) T, T, T
+#define TYPED_PARAMS_4(T) T, T, T, T
+
+#define TYPED_ARGS_0(U)
+#define TYPED_ARGS_1(U) U(args[0])
+#define TYPED_ARGS_2(U) U(args[0]), U(args[1])
+#define TYPED_ARGS_3(U) U(args[0]), U(args[1]), U(args[2])
+#define TYPED_ARGS_4(U) U(args[0]), U(args[1]), U(args[2]), U(args[3])
+
+#define TYPED_ACTION(NAME, N, T, UNBOX)                                     \
+    static void NAME(vm_t* vm, vm_native_t* native) {                       \
+        val_t* args = NATIVE_ARGS(vm, N);                                   \
+        void (*fn)(TYPED_PARAMS_##N(T)) =                                   \
+            (void (*)(TYPED_PARAMS_##N(T))) native->handle.u.host_typed;    \
+        fn(TYPED_ARGS_##N(UNBOX));                                          \
+        vm->mem.stack.top -= N;                                             \
+        (void) args;                                                        \
+    }
+
+#define TYPED_FUNCTION(NAME, N, T, UNBOX, R, BOX)                           \
+    static void NAME(vm_t* vm, vm_native_t* native) {                       \
+        val_t* args = NATIVE_ARGS(vm, N);                                   \
+        R (*fn)(TYPED_PARAMS_##N(T)) =                                      \
+            (R (*)(TYPED_PARAMS_##N(T))) native->handle.u.host_typed;       \
+        R ret = fn(TYPED_ARGS_##N(UNBOX));                                  \
+        vm->mem.stack.top -= N;                                             \
+        vm->mem.stack.values[++vm->mem.stack.top] = BOX(ret);               \
+        (void) args;                                                        \
+    }
+
+#define TYPED_ARITY(N, K, T, UNBOX)                                         \
+    TYPED_ACTION(typed_##K##N##_v, N, T, UNBOX)                             \
+    TYPED_FUNCTION(typed_##K##N##_i, N, T, UNBOX, int32_t, val_int)         \
+    TYPED_FUNCTION(typed_##K##N##_f, N, T, UNBOX, float, val_number)        \
+    TYPED_FUNCTION(typed_##K##N##_b, N, T, UNBOX, bool, val_bool)
+
+// no args (one set for both kinds)
+TYPED_ARITY(0, i, int32_t, val_into_int)
+TYPED_ARITY(1, i, int32_t, val_into_int)
+TYPED_ARITY(2, i, int32_t, val_into_int)
+TYPED_ARITY(3, i, int32_t, val_into_int)
+TYPED_ARITY(4, i, int32_t, val_into_int)
+TYPED_ARITY(1, f, float, val_into_number)
+TYPED_ARITY(2, f, float, val_into_number)
+TYPED_ARITY(3, f, float, val_into_number)
+TYPED_ARITY(4, f, float, val_into_number)
+
+#define TYPED_ROW(K, N) { typed_##K##N##_v, typed_##K##N##_i, typed_##K##N##_f, typed_##K##N##_b }
+
+// [arg kind][arity][result]
+static const vm_trampoline_t native_typed[2][VM_NATIVE_TYPED_MAX_ARGS + 1][4] = {
+    { TYPED_ROW(i, 0), TYPED_ROW(i, 1), TYPED_ROW(i, 2), TYPED_ROW(i, 3), TYPED_ROW(i, 4) },
+    { TYPED_ROW(i, 0), TYPED_ROW(f, 1), TYPED_ROW(f, 2), TYPED_ROW(f, 3), TYPED_ROW(f, 4) }
+};
+
+// index of a typed arg / result (-1: not supported)
+static int native_typed_kind(ift_t type, bool result) {
+    ift_t kinds[] = { ift_int(), ift_float(), ift_bool() };
+    if( result && ift_is_void(type) ) {
+        return 0;
+    }
+    for(int i = 0; i < (result ? 3 : 2); i++) {
+        if( ift_type_equals(&type, &kinds[i]) ) {
+            return result ? i + 1 : i;
+        }
+    }
+    return -1;
+}
+
+static vm_trampoline_t native_typed_trampoline(ift_t type) {
+    int argc = ift_func_arg_count(type);
+    int result = native_typed_kind(ift_func_get_return_type(type), true);
+    if( argc > VM_NATIVE_TYPED_MAX_ARGS || result < 0 ) {
+        return NULL;
+    }
+    int kind = 0;
+    for(int i = 0; i < argc; i++) {
+        int arg = native_typed_kind(ift_func_get_arg(type, i), false);
+        if( arg < 0 || (i > 0 && arg != kind) ) {
+            return NULL;
+        }
+        kind = arg;
+    }
+    return native_typed[kind][argc][result];
+}
+
+bool vm_native_bind(vm_native_t* native, ffi_handle_t handle, ift_t type) {
+    int argc = ift_func_arg_count(type);
+    *native = (vm_native_t) {
+        .call = NULL,
+        .handle = handle,
+        .argcount = argc,
+        .returns = ift_is_void(ift_func_get_return_type(type)) == false
+    };
+    switch(handle.tag) {
+        case FFI_HNDL_HOST_ACTION: {
+            native->call = argc <= 4 ? native_actions[argc] : native_action_n;
+        } break;
+        case FFI_HNDL_HOST_FUNCTION: {
+            native->call = argc <= 4 ? native_functions[argc] : native_function_n;
+        } break;
+        case FFI_HNDL_HOST_ASYNC: {
+            native->call = native_async;
+        } break;
+        case FFI_HNDL_HOST_TYPED: {
+            native->call = native_typed_trampoline(type);
+            if( native->call == NULL ) {
+                sstr_t s = ift_type_to_sstr(type);
+                sh_log_error("unsupported signature for a typed host function: '%.*s'",
+                    sstr_len(&s), sstr_ptr(&s));
+                return false;
+            }
+        } break;
+        default: {
+            sh_log_error("unknown ffi handle type %i", handle.tag);
+            return false;
+        }
+    }
+    return true;
+}
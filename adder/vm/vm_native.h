@@ -0,0 +1,26 @@
+#ifndef VM_NATIVE_H_
+#define VM_NATIVE_H_
+
+#include "sh_types.h"
+#include "vm_types.h"
+
+// Calls into the host. vm_env_setup binds each import to a
+// trampoline picked by the handle tag and the arity (0 - 4
+// get their own), call-native then only calls it:
+//
+//   native->call(vm, native);
+//
+// A trampoline takes the args from the stack and pushes the
+// result, if any. Typed host functions (FFI_HNDL_HOST_TYPED)
+// are plain c functions with the signature of the import,
+// the args are unboxed and the result is boxed by the
+// trampoline. Supported typed signatures: all args int or
+// all args float (at most VM_NATIVE_TYPED_MAX_ARGS) and a
+// void, int, float or bool result.
+
+#define VM_NATIVE_TYPED_MAX_ARGS 4
+
+// false if the handle can't be called with the type (logs why)
+bool vm_native_bind(vm_native_t* native, ffi_handle_t handle, ift_t type);
+
+#endif // VM_NATIVE_H_
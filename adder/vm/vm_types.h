@@ -7,20 +7,68 @@
 typedef struct vm_stack_t {
     val_t* values;  // pointer to the stack
     int top;        // the index of the top element on the stack
-    int frame;      // the index of the current stack (call) frame
+    int base;       // the index of the first arg/local of the current frame
     int size;       // size of the stack (in val_t count)
 } vm_stack_t;
 
+typedef struct vm_frame_t {
+    int return_pc;      // the instruction to resume (negative: leave the vm)
+    int base;           // the stack index of the first arg
+    uint8_t num_args;   // the number of args
+    uint8_t num_locals; // the number of locals
+} vm_frame_t;
+
+typedef struct vm_frames_t {
+    vm_frame_t* frames; // pointer to the call-frame stack
+    int top;            // the index of the current frame
+    int size;           // size of the frame stack (in vm_frame_t count)
+} vm_frames_t;
+
+// size classes of the free chunk pools: 1, 2, 4 .. 64 values
+#define HEAP_POOL_CLASSES 7
+
+// pause times of the collector, bucket i counts the pauses
+// shorter than 2^i microseconds (the last one the longer ones)
+#define HEAP_PAUSE_BUCKETS 16
+
+typedef struct vm_gc_stats_t {
+    uint32_t    pauses[HEAP_PAUSE_BUCKETS];
+    uint32_t    max_pause_us;
+    uint64_t    total_pause_us;
+    uint32_t    cycles;       // completed incremental marking cycles
+    uint32_t    collections;  // stop-the-world collections
+} vm_gc_stats_t;
+
 typedef struct vm_heap_t {
     uint64_t*   gc_marks; // garbage collector (marking region)
+    uint64_t*   gc_full;  // one bit per full mark word (vm_heap.c)
+    int         cursor;   // mark word the next allocation starts at
+    int         compactions; // times the live values were moved
+    uint32_t*   pools;    // free chunks by size class (heap indices,
+    int         pool_counts[HEAP_POOL_CLASSES]; // VM_HEAP_POOL_CAPACITY each)
     val_t*      values;   // pointer to heap memory region
     int         size;     // size of the heap memory (in val_t count)
+    val_t*      roots[2]; // host values kept by the GC (args and
+    int         rootcounts[2]; // results of vm_call_batch)
+    // incremental marking (vm_heap.c)
+    uint32_t    gc_budget;  // values scanned per allocation (0: off)
+    bool        gc_marking; // a cycle is in progress
+    uint64_t*   gc_live;    // values the cycle has reached
+    val_t*      grey;       // arrays it has yet to scan
+    int         grey_count; // (VM_HEAP_GREY_CAPACITY at most)
+    bool        grey_overflow;
+    int         allocated;  // values allocated since the last cycle
+    int         gc_trigger; // a cycle starts once allocated reaches it
+    vm_gc_stats_t gc_stats;
+    int         dirty_first; // mark words set since heap_reset_save
+    int         dirty_last;  // (none if first > last)
 } vm_heap_t;
 
 typedef struct vm_mem_t {
     val_t*      membase;   // base pointer to the memory region (stack + heap)
     int         memsize;   // total size of stack + heap (in val_t count)
     vm_stack_t stack;
+    vm_frames_t frames;
     vm_heap_t  heap;
 } vm_mem_t;
 
@@ -28,11 +76,23 @@ typedef struct vm_mem_t {
 typedef val_t* (*addr_lookup_fn)(void* user, val_addr_t addr);
 
 typedef struct vm_t vm_t;
+typedef struct vm_jit_t vm_jit_t;
+typedef struct vm_verify_t vm_verify_t;
 
 typedef struct vm_runtime_t {
-    val_t*      constants;
-    uint8_t*    instructions;
+    const val_t*    constants;      // of the program (read only, the
+    const uint8_t*  instructions;   // program may be shared by vms)
     uint32_t    pc;
+    uint32_t    cycles;     // instructions executed by the last run
+    uint32_t    budget;     // max instructions per execute / resume
+    bool        suspended;  // out of budget, continue with vm_resume
+    bool        checked;    // validate each instruction (not verified)
+    int         extent;     // max stack values a call adds (vm_verify.h)
+    struct vm_env_t* env;   // env & program of a suspended run
+    program_t*  program;
+    uint32_t    waiting;    // token of a pending async host call (0: none)
+    uint32_t    tokens;     // the last token handed out
+    bool        awaits_value; // the pending call returns a value
 } vm_runtime_t;
 
 typedef struct vm_t {
@@ -41,11 +101,34 @@ typedef struct vm_t {
     void*          validation; // validation data (NULL if no validation)
 } vm_t;
 
+// an import bound to its trampoline (vm_native.h)
+typedef struct vm_native_t vm_native_t;
+typedef void (*vm_trampoline_t)(vm_t* vm, vm_native_t* native);
+
+struct vm_native_t {
+    vm_trampoline_t call;
+    ffi_handle_t    handle;
+    int             argcount;
+    bool            returns;    // pushes a value
+};
+
 typedef struct vm_env_t {
     int             count;
-    ffi_handle_t*   handles;
-    int*            argcounts;
+    vm_native_t*    natives;
     bool            isready;
+    vm_jit_t*       jit;        // native code (NULL: interpreted)
+    vm_verify_t*    verified;   // verified exports (NULL: not verified)
 } vm_env_t;
 
+// a call bound to a vm, env and entry point (vm_call_prepare)
+typedef struct vm_call_t {
+    vm_t*       vm;
+    vm_env_t*   env;
+    program_t*  program;
+    int         address;    // the entry point
+    int         argcount;
+    vm_verify_t* verified;  // of env when the export was resolved
+    int         index;      // of the verified export (-1: checked runs)
+} vm_call_t;
+
 #endif // VM_VM_TYPES_H_
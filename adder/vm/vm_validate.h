@@ -78,6 +78,33 @@ inline static bool validation_check_stack_args(vm_t* vm, char* context, int arg_
     return true;
 }
 
+// int and char share the integer representation, the
+// integer instructions accept either of them
+inline static bool validation_is_int_type(val_type_t type) {
+    return type == VAL_INT || type == VAL_CHAR;
+}
+
+inline static bool validation_check_stack_int_args(vm_t* vm, char* context, int arg_count) {
+    validation_t* validation = ((validation_t*)vm->validation);
+    if( validation_check_stack_arg_count(vm, context, arg_count) == false ) {
+        return false;
+    }
+    int stack_top = vm->mem.stack.top;
+    for(int i = 0; i < arg_count; i++) {
+        val_type_t arg_type = vm->mem.stack.values[stack_top - i].type;
+        if( validation_is_int_type(arg_type) == false ) {
+            snprintf(validation->message, 256,
+                "'%s' arg #%i should have been int but was %s.\n",
+                context,
+                i + 1,
+                val_get_type_name(arg_type));
+            validation->message[256] = '\0';
+            return false;
+        }
+    }
+    return true;
+}
+
 inline static bool validation_check_stack(vm_t* vm, char* context) {
     validation_t* validation = ((validation_t*)vm->validation);
     if( vm->mem.stack.top >= vm->mem.stack.size ) {
@@ -94,12 +121,11 @@ inline static bool validation_check_stack(vm_t* vm, char* context) {
         validation->message[256] = '\0';
         return false;
     }
-    int stack_frame = vm->mem.stack.frame;
-    if( stack_frame < 0 ) {
+    if( vm->mem.frames.top < 0 ) {
         return true;
     }
-    frame_t frame = val_into_frame(vm->mem.stack.values[stack_frame]);
-    int frame_upper = stack_frame + frame.num_args + frame.num_locals;
+    vm_frame_t frame = vm->mem.frames.frames[vm->mem.frames.top];
+    int frame_upper = frame.base + frame.num_args + frame.num_locals - 1;
     if( vm->mem.stack.top < frame_upper ) {
         snprintf(validation->message, 256,
             "'%s' stack call-frame compromised.\n",
@@ -110,15 +136,150 @@ inline static bool validation_check_stack(vm_t* vm, char* context) {
     return true;
 }
 
+// checks that a frame has been pushed (by OP_CALL or
+// the entry point) and that its args are on the stack
+inline static bool validation_check_new_frame(vm_t* vm, char* op_name) {
+    validation_t* validation = ((validation_t*)vm->validation);
+    if( vm->mem.frames.top < 0 ) {
+        snprintf(validation->message, 256,
+            "'%s' has no call frame to set up.\n",
+            op_name);
+        validation->message[256] = '\0';
+        return false;
+    }
+    int nargs = READ_U32(vm->run.instructions, vm->run.pc);
+    return validation_check_stack_arg_count(vm, op_name, nargs);
+}
+
+// checks that there is a frame to reuse and that
+// the args of the tail call are above its base
+inline static bool validation_check_tail_call(vm_t* vm, char* op_name) {
+    validation_t* validation = ((validation_t*)vm->validation);
+    if( vm->mem.frames.top < 0 ) {
+        snprintf(validation->message, 256,
+            "'%s' has no call frame to reuse.\n",
+            op_name);
+        validation->message[256] = '\0';
+        return false;
+    }
+    int nargs = READ_U32(vm->run.instructions, vm->run.pc + 4);
+    int base = vm->mem.frames.frames[vm->mem.frames.top].base;
+    if( vm->mem.stack.top - nargs + 1 < base ) {
+        snprintf(validation->message, 256,
+            "'%s' requres %i args above the frame.\n",
+            op_name, nargs);
+        validation->message[256] = '\0';
+        return false;
+    }
+    return true;
+}
+
+// checks that the instruction argument at arg_index
+// refers to a reserved local/arg in the current frame
+inline static bool validation_check_local_arg(vm_t* vm, char* op_name, int arg_index) {
+    validation_t* validation = ((validation_t*)vm->validation);
+    int nreserved = 0;
+    if( vm->mem.frames.top >= 0 ) {
+        vm_frame_t frame = vm->mem.frames.frames[vm->mem.frames.top];
+        nreserved = (frame.num_locals + frame.num_args);
+    }
+    int id = READ_U32(vm->run.instructions, vm->run.pc + 4 * arg_index);
+    if( id < 0 || id >= nreserved ) {
+        if( nreserved < 1 ) {
+            snprintf(validation->message, 256,
+                "'%s' tried to load local/arg with index %i "
+                "but the current frame has no reserved values.",
+                op_name, id);
+        } else {
+            snprintf(validation->message, 256,
+                "'%s' tried to load local with index %i "
+                "but the current frame has reserved #0 to #%i.",
+                op_name, id, nreserved - 1);
+        }
+        validation->message[256] = '\0';
+        return false;
+    }
+    return true;
+}
+
+// checks all frame slot arguments of the instruction
+inline static bool validation_check_local_args(vm_t* vm, vm_op_t opcode) {
+    char* op_name = get_op_name(opcode);
+    size_t arg_count = get_op_arg_count(opcode);
+    op_argtype_t* arg_types = get_op_arg_types(opcode);
+    for(size_t i = 0; i < arg_count; i++) {
+        bool is_local = arg_types[i] == OP_ARG_LOCAL;
+        if( arg_types[i] == OP_ARG_RK ) {
+            uint32_t arg = READ_U32(vm->run.instructions, vm->run.pc + 4 * i);
+            is_local = OP_RK_IS_CONST(arg) == false;
+        }
+        if( is_local && validation_check_local_arg(vm, op_name, i) == false ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// checks the type of a register operand (frame slot or constant)
+inline static bool validation_check_rk_arg_type(vm_t* vm, char* op_name, int arg_index, val_type_t expected) {
+    validation_t* validation = ((validation_t*)vm->validation);
+    uint32_t arg = READ_U32(vm->run.instructions, vm->run.pc + 4 * arg_index);
+    val_t value;
+    if( OP_RK_IS_CONST(arg) ) {
+        value = vm->run.constants[OP_RK_INDEX(arg)];
+    } else {
+        value = vm->mem.stack.values[vm->mem.stack.base + arg];
+    }
+    if( value.type != expected ) {
+        snprintf(validation->message, 256,
+            "'%s' operand #%i should have been %s but was %s.\n",
+            op_name,
+            arg_index,
+            val_get_type_name(expected),
+            val_get_type_name(value.type));
+        validation->message[256] = '\0';
+        return false;
+    }
+    return true;
+}
+
+inline static bool validation_check_rk_int_arg(vm_t* vm, char* op_name, int arg_index) {
+    validation_t* validation = ((validation_t*)vm->validation);
+    uint32_t arg = READ_U32(vm->run.instructions, vm->run.pc + 4 * arg_index);
+    val_t value;
+    if( OP_RK_IS_CONST(arg) ) {
+        value = vm->run.constants[OP_RK_INDEX(arg)];
+    } else {
+        value = vm->mem.stack.values[vm->mem.stack.base + arg];
+    }
+    if( validation_is_int_type(value.type) == false ) {
+        snprintf(validation->message, 256,
+            "'%s' operand #%i should have been int but was %s.\n",
+            op_name,
+            arg_index,
+            val_get_type_name(value.type));
+        validation->message[256] = '\0';
+        return false;
+    }
+    return true;
+}
+
 inline static bool validation_pre_exec(vm_t* vm, vm_op_t opcode) {
+    if( opcode >= OP_OPCODE_COUNT ) {
+        return true; // unknown, the default handler stops the run
+    }
     validation_t* validation = ((validation_t*)vm->validation);
     char* op_name = get_op_name(opcode);
     bool no_error = true;
-    if( validation->last_opcode == OP_CALL && opcode != OP_MAKE_FRAME  ) {
+    if( (validation->last_opcode == OP_CALL || validation->last_opcode == OP_TAIL_CALL)
+        && opcode != OP_MAKE_FRAME  ) {
         snprintf(validation->message, 256,
-                "the OP_CALL instruction must be immediatly followed by OP_MAKE_FRAME.\n");
+                "the %s instruction must be immediatly followed by OP_MAKE_FRAME.\n",
+                validation->last_opcode == OP_CALL ? "OP_CALL" : "OP_TAIL_CALL");
         validation->message[256] = '\0';
         no_error = false;
+    } else if( validation_check_local_args(vm, opcode) == false ) {
+        no_error = false;
     } else {
         switch (opcode) {
             case OP_ADD:
@@ -131,9 +292,38 @@ inline static bool validation_pre_exec(vm_t* vm, vm_op_t opcode) {
             case OP_CMP_LESS_THAN_OR_EQUAL:
             case OP_CMP_MORE_THAN_OR_EQUAL:
             case OP_CMP_NOT_EQUAL:
-            case OP_CMP_EQUAL: {
+            case OP_CMP_EQUAL:
+            case OP_JUMP_IF_NOT_EQUAL:
+            case OP_JUMP_IF_NOT_NOT_EQUAL:
+            case OP_JUMP_IF_NOT_LESS_THAN:
+            case OP_JUMP_IF_NOT_MORE_THAN:
+            case OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL:
+            case OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL: {
                 no_error = validation_check_stack_args(vm, op_name, 2, VAL_NUMBER, VAL_NUMBER);
             } break;
+            case OP_IADD:
+            case OP_ISUB:
+            case OP_IMUL:
+            case OP_IDIV:
+            case OP_IMOD:
+            case OP_ICMP_EQUAL:
+            case OP_ICMP_NOT_EQUAL:
+            case OP_ICMP_LESS_THAN:
+            case OP_ICMP_MORE_THAN:
+            case OP_ICMP_LESS_THAN_OR_EQUAL:
+            case OP_ICMP_MORE_THAN_OR_EQUAL:
+            case OP_JUMP_IF_NOT_IEQUAL:
+            case OP_JUMP_IF_NOT_INOT_EQUAL:
+            case OP_JUMP_IF_NOT_ILESS_THAN:
+            case OP_JUMP_IF_NOT_IMORE_THAN:
+            case OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL:
+            case OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL: {
+                no_error = validation_check_stack_int_args(vm, op_name, 2);
+            } break;
+            case OP_INEG:
+            case OP_INT_TO_FLOAT: {
+                no_error = validation_check_stack_int_args(vm, op_name, 1);
+            } break;
             case OP_AND:
             case OP_OR: {
                 no_error = validation_check_stack_args(vm, op_name, 2, VAL_BOOL, VAL_BOOL);
@@ -153,31 +343,69 @@ inline static bool validation_pre_exec(vm_t* vm, vm_op_t opcode) {
             case OP_JUMP_IF_FALSE: {
                 no_error = validation_check_stack_args(vm, op_name, 1, VAL_BOOL);
             } break;
-            case OP_NEG:
-            case OP_MAKE_FRAME: {
+            case OP_NEG: {
                 no_error = validation_check_stack_args(vm, op_name, 1, VAL_NUMBER);
             } break;
-            case OP_STORE_LOCAL:
-            case OP_LOAD_LOCAL: {
-                val_t val = vm->mem.stack.values[vm->mem.stack.frame];
-                frame_t frame = val_into_frame(val);
-                int nreserved = (frame.num_locals + frame.num_args);
-                int id = READ_U32(vm->run.instructions, vm->run.pc);
-                if( id < 0 || id >= nreserved ) {
-                    if( nreserved < 1 ) {
-                        snprintf(validation->message, 256,
-                            "'%s' tried to load local/arg with index %i "
-                            "but the current frame has no reserved values.",
-                            op_name, id);
-                    } else {
-                        snprintf(validation->message, 256,
-                            "'%s' tried to load local with index %i "
-                            "but the current frame has reserved #0 to #%i.",
-                             op_name, id, frame.num_locals - 1);
-                    }
-                    validation->message[256] = '\0';
-                    no_error = false;
-                }
+            case OP_MAKE_FRAME: {
+                no_error = validation_check_new_frame(vm, op_name);
+            } break;
+            case OP_TAIL_CALL: {
+                no_error = validation_check_tail_call(vm, op_name);
+            } break;
+            case OP_R_ADD:
+            case OP_R_SUB:
+            case OP_R_MUL:
+            case OP_R_DIV:
+            case OP_R_MOD:
+            case OP_R_CMP_EQUAL:
+            case OP_R_CMP_NOT_EQUAL:
+            case OP_R_CMP_LESS_THAN:
+            case OP_R_CMP_MORE_THAN:
+            case OP_R_CMP_LESS_THAN_OR_EQUAL:
+            case OP_R_CMP_MORE_THAN_OR_EQUAL:
+            case OP_R_JUMP_IF_NOT_EQUAL:
+            case OP_R_JUMP_IF_NOT_NOT_EQUAL:
+            case OP_R_JUMP_IF_NOT_LESS_THAN:
+            case OP_R_JUMP_IF_NOT_MORE_THAN:
+            case OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL:
+            case OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL: {
+                no_error = validation_check_rk_arg_type(vm, op_name, 1, VAL_NUMBER)
+                    && validation_check_rk_arg_type(vm, op_name, 2, VAL_NUMBER);
+            } break;
+            case OP_R_NEG: {
+                no_error = validation_check_rk_arg_type(vm, op_name, 1, VAL_NUMBER);
+            } break;
+            case OP_R_IADD:
+            case OP_R_ISUB:
+            case OP_R_IMUL:
+            case OP_R_IDIV:
+            case OP_R_IMOD:
+            case OP_R_ICMP_EQUAL:
+            case OP_R_ICMP_NOT_EQUAL:
+            case OP_R_ICMP_LESS_THAN:
+            case OP_R_ICMP_MORE_THAN:
+            case OP_R_ICMP_LESS_THAN_OR_EQUAL:
+            case OP_R_ICMP_MORE_THAN_OR_EQUAL:
+            case OP_R_JUMP_IF_NOT_IEQUAL:
+            case OP_R_JUMP_IF_NOT_INOT_EQUAL:
+            case OP_R_JUMP_IF_NOT_ILESS_THAN:
+            case OP_R_JUMP_IF_NOT_IMORE_THAN:
+            case OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL:
+            case OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL: {
+                no_error = validation_check_rk_int_arg(vm, op_name, 1)
+                    && validation_check_rk_int_arg(vm, op_name, 2);
+            } break;
+            case OP_R_INEG: {
+                no_error = validation_check_rk_int_arg(vm, op_name, 1);
+            } break;
+            case OP_R_AND:
+            case OP_R_OR: {
+                no_error = validation_check_rk_arg_type(vm, op_name, 1, VAL_BOOL)
+                    && validation_check_rk_arg_type(vm, op_name, 2, VAL_BOOL);
+            } break;
+            case OP_R_NOT:
+            case OP_R_JUMP_IF_FALSE: {
+                no_error = validation_check_rk_arg_type(vm, op_name, 1, VAL_BOOL);
             } break;
             default: {
                 /* nothing */
@@ -197,7 +425,7 @@ inline static bool validation_pre_exec(vm_t* vm, vm_op_t opcode) {
 }
 
 inline static bool validation_post_exec(vm_t* vm, vm_op_t opcode) {
-    assert(OP_OPCODE_COUNT == 37 && "Opcode count changed.");
+    assert(OP_OPCODE_COUNT == 112 && "Opcode count changed.");
     char* op_name = get_op_name(opcode);
     validation_t* validation = ((validation_t*)vm->validation);
     bool no_error = true;
@@ -224,10 +452,84 @@ inline static bool validation_post_exec(vm_t* vm, vm_op_t opcode) {
             case OP_DUP_2:
             case OP_JUMP_IF_FALSE:
             case OP_CALL:
+            case OP_TAIL_CALL:
             case OP_MAKE_FRAME:
             case OP_PRINT:
             case OP_STORE_LOCAL:
-            case OP_LOAD_LOCAL: {
+            case OP_LOAD_LOCAL:
+            case OP_LOAD_LOCAL_PAIR:
+            case OP_PUSH_VALUE_LOAD_LOCAL:
+            case OP_ADD_LOCALS_TO_LOCAL:
+            case OP_INC_LOCAL_BY_CONST:
+            case OP_JUMP_IF_NOT_EQUAL:
+            case OP_JUMP_IF_NOT_NOT_EQUAL:
+            case OP_JUMP_IF_NOT_LESS_THAN:
+            case OP_JUMP_IF_NOT_MORE_THAN:
+            case OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL:
+            case OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+            case OP_ITER_NEXT_STORE_LOCAL:
+            case OP_R_MOVE:
+            case OP_R_ADD:
+            case OP_R_SUB:
+            case OP_R_MUL:
+            case OP_R_DIV:
+            case OP_R_MOD:
+            case OP_R_NEG:
+            case OP_R_AND:
+            case OP_R_OR:
+            case OP_R_NOT:
+            case OP_R_CMP_EQUAL:
+            case OP_R_CMP_NOT_EQUAL:
+            case OP_R_CMP_LESS_THAN:
+            case OP_R_CMP_MORE_THAN:
+            case OP_R_CMP_LESS_THAN_OR_EQUAL:
+            case OP_R_CMP_MORE_THAN_OR_EQUAL:
+            case OP_R_JUMP_IF_FALSE:
+            case OP_R_JUMP_IF_NOT_EQUAL:
+            case OP_R_JUMP_IF_NOT_NOT_EQUAL:
+            case OP_R_JUMP_IF_NOT_LESS_THAN:
+            case OP_R_JUMP_IF_NOT_MORE_THAN:
+            case OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL:
+            case OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+            case OP_IADD:
+            case OP_ISUB:
+            case OP_IMUL:
+            case OP_IDIV:
+            case OP_IMOD:
+            case OP_INEG:
+            case OP_ICMP_EQUAL:
+            case OP_ICMP_NOT_EQUAL:
+            case OP_ICMP_LESS_THAN:
+            case OP_ICMP_MORE_THAN:
+            case OP_ICMP_LESS_THAN_OR_EQUAL:
+            case OP_ICMP_MORE_THAN_OR_EQUAL:
+            case OP_INT_TO_FLOAT:
+            case OP_IADD_LOCALS_TO_LOCAL:
+            case OP_IINC_LOCAL_BY_CONST:
+            case OP_JUMP_IF_NOT_IEQUAL:
+            case OP_JUMP_IF_NOT_INOT_EQUAL:
+            case OP_JUMP_IF_NOT_ILESS_THAN:
+            case OP_JUMP_IF_NOT_IMORE_THAN:
+            case OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL:
+            case OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL:
+            case OP_R_IADD:
+            case OP_R_ISUB:
+            case OP_R_IMUL:
+            case OP_R_IDIV:
+            case OP_R_IMOD:
+            case OP_R_INEG:
+            case OP_R_ICMP_EQUAL:
+            case OP_R_ICMP_NOT_EQUAL:
+            case OP_R_ICMP_LESS_THAN:
+            case OP_R_ICMP_MORE_THAN:
+            case OP_R_ICMP_LESS_THAN_OR_EQUAL:
+            case OP_R_ICMP_MORE_THAN_OR_EQUAL:
+            case OP_R_JUMP_IF_NOT_IEQUAL:
+            case OP_R_JUMP_IF_NOT_INOT_EQUAL:
+            case OP_R_JUMP_IF_NOT_ILESS_THAN:
+            case OP_R_JUMP_IF_NOT_IMORE_THAN:
+            case OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL:
+            case OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL: {
                 no_error = validation_check_stack(vm, op_name);
             } break;
             case OP_ROT_2:
@@ -3,6 +3,7 @@
 #include "vm.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 void val_sprint(cstr_t str, val_t val) {
@@ -11,6 +12,9 @@ void val_sprint(cstr_t str, val_t val) {
     case VAL_NUMBER:
         cstr_append_fmt(str, "%f", val_into_number(val));
         break;
+    case VAL_INT:
+        cstr_append_fmt(str, "%d", val_into_int(val));
+        break;
     case VAL_CHAR:
         cstr_append_fmt(str, "%c", val_into_char(val));
         break;
@@ -25,13 +29,6 @@ void val_sprint(cstr_t str, val_t val) {
         iter_t v = val_into_iter(val);
         cstr_append_fmt(str, "{curr:0x%08X, rem:%i}", v.current, v.remaining);
     } break;
-    case VAL_FRAME: {
-        frame_t frame = val_into_frame(val);
-        cstr_append_fmt(str, "<pc: %i, nargs: %i, nlocals: %i>",
-            frame.return_pc,
-            frame.num_args,
-            frame.num_locals);
-    } break;
     case VAL_ARRAY: {
         array_t a = val_into_array(val);
         cstr_append_fmt(str, "[addr: 0x%08X, len: %d]",
@@ -53,6 +50,20 @@ void val_sprint_string(cstr_t str, val_t* valbuf, int valbuf_length) {
     cstr_append_fmt(str, "%s", cbuf);
 }
 
+void val_sprint_packed(cstr_t str, uint8_t* bytes, array_t array) {
+    if( array.pack == VAL_CHAR ) {
+        cstr_append_fmt(str, "%.*s", array.length, (char*) bytes);
+        return;
+    }
+    int width = pack_width(array.pack);
+    cstr_append_fmt(str, "[ ");
+    for(int i = 0; i < array.length; i++) {
+        val_sprint(str, pack_load(bytes + i * width, array.pack));
+        cstr_append_fmt(str, " ");
+    }
+    cstr_append_fmt(str, "]");
+}
+
 void val_sprint_lookup(cstr_t str, val_t val, addr_lookup_fn lookup, void* user) {
     if( val.type == VAL_ARRAY && lookup != NULL && user != NULL ) {
         array_t array = val_into_array(val);
@@ -62,6 +73,10 @@ void val_sprint_lookup(cstr_t str, val_t val, addr_lookup_fn lookup, void* user)
             return;
         }
         int length = array.length;
+        if( array.pack != VAL_NONE ) {
+            val_sprint_packed(str, pack_bytes(buffer, array), array);
+            return;
+        }
         bool is_list = buffer[0].type != VAL_CHAR;
         if(is_list) {
             cstr_append_fmt(str, "[ ");
@@ -90,8 +105,17 @@ int val_get_string(val_t val, addr_lookup_fn lookup, void* user, char* dest, int
         length = (dest_len - 1);
     }
     val_t* vbuf = lookup(user, array.address);
-    for(int i = 0; i < length; i++) {
-        dest[i] = val_into_char(vbuf[i]);
+    if( array.pack == VAL_CHAR ) {
+        memcpy(dest, pack_bytes(vbuf, array), length);
+    } else if( array.pack != VAL_NONE ) {
+        int width = pack_width(array.pack);
+        for(int i = 0; i < length; i++) {
+            dest[i] = val_into_char(pack_load(pack_bytes(vbuf, array) + i * width, array.pack));
+        }
+    } else {
+        for(int i = 0; i < length; i++) {
+            dest[i] = val_into_char(vbuf[i]);
+        }
     }
     dest[length] = '\0';
     return length;
@@ -111,7 +135,7 @@ char* val_get_type_name(val_type_t type) {
         case VAL_ARRAY:  return "array";
         case VAL_BOOL:   return "bool";
         case VAL_CHAR:   return "char";
-        case VAL_FRAME:  return "frame";
+        case VAL_INT:    return "int";
         case VAL_IVEC2:  return "ivec2";
         case VAL_NUMBER: return "number";
         default:         return "<unknown-type>";
@@ -2,33 +2,70 @@
 #define VM_VALUE_TOOLS_H_
 
 #include "sh_types.h"
+#include "sh_value.h"
 #include "vm_types.h"
+#include "vm_heap.h"
+#include "sh_log.h"
 #include <stdint.h>
 #include <stdbool.h>
 #include <assert.h>
 
 void val_sprint(cstr_t str, val_t val);
+// a packed array, bytes are its elements
+void val_sprint_packed(cstr_t str, uint8_t* bytes, array_t array);
 void val_sprint_lookup(cstr_t str, val_t val, addr_lookup_fn lookup, void* user);
 int  val_get_string(val_t val, addr_lookup_fn lookup, void* user, char* dest, int dest_len);
 char* val_get_type_name(val_type_t type);
 
+// the value at an array or iterator address, constant arrays live
+// in the (shared) program and must only be read
+inline static val_t* addr_get_ptr(vm_t* vm, val_addr_t addr) {
+    if( ADDR_IS_CONST(addr) )
+        return (val_t*) (vm->run.constants + MEM_ADDR_TO_INDEX(addr));
+    else
+        return (vm->mem.membase + MEM_ADDR_TO_INDEX(addr));
+}
+
+// the values of an array that isn't packed (see array_get)
 inline static val_t* array_get_ptr(vm_t* vm, array_t array, int index) {
     if(ADDR_IS_NULL(array.address)) 
         return NULL;
+    assert(array.pack == VAL_NONE && "the array is packed");
+    return addr_get_ptr(vm, array.address) + index;
+}
 
-    if( ADDR_IS_CONST(array.address) )
-        return (vm->run.constants + MEM_ADDR_TO_INDEX(array.address) + index);
-    else
-        return (vm->mem.membase + MEM_ADDR_TO_INDEX(array.address) + index);
+// the elements of a packed array
+inline static uint8_t* array_get_bytes(vm_t* vm, array_t array) {
+    if(ADDR_IS_NULL(array.address)) 
+        return NULL;
+    return pack_bytes(addr_get_ptr(vm, array.address), array);
 }
 
 inline static val_t array_get(vm_t* vm, array_t array, int index) {
+    if( array.pack != VAL_NONE ) {
+        int width = pack_width(array.pack);
+        return pack_load(array_get_bytes(vm, array) + index * width, array.pack);
+    }
     return *array_get_ptr(vm, array, index);
 }
 
-inline static void array_set(vm_t* vm, array_t array, int index, val_t value) {
+// false for constant arrays, they are shared by the vms that
+// run the program: see heap_array_unshare for arrays that may
+// be constant
+inline static bool array_set(vm_t* vm, array_t array, int index, val_t value) {
+    if( ADDR_IS_CONST(array.address) ) {
+        sh_log_error("cannot write to a constant array (heap_array_unshare)");
+        return false;
+    }
+    if( array.pack != VAL_NONE ) {
+        int width = pack_width(array.pack);
+        pack_store(array_get_bytes(vm, array) + index * width, array.pack, value);
+        return true;
+    }
     val_t* loc = array_get_ptr(vm, array, index);
+    heap_write_barrier(vm, value);
     *loc = value;
+    return true;
 }
 
 #endif // VM_VALUE_TOOLS_H_
@@ -0,0 +1,1057 @@
+#include "vm_verify.h"
+#include "sh_asminfo.h"
+#include "sh_value.h"
+#include "sh_utils.h"
+#include "sh_ift.h"
+#include "sh_log.h"
+#include "vm_value_tools.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// abstract types besides the val_type_t ones
+#define VF_ANY      0xFF    // any type (not known)
+#define VF_INTEGER  0xFE    // int or char
+#define VF_EMPTY    0xFD    // the elements of an empty array
+
+// nesting levels of constant arrays the verifier follows
+#define VF_MAX_CONST_NESTING 8
+
+typedef struct vf_val_t {
+    uint8_t type;       // val_type_t or VF_*
+    uint8_t elem;       // element type of arrays and iterators
+    uint8_t leaf;       // elements that are arrays: the element type of
+    uint8_t depth;      // the innermost ones and the levels down to them
+    bool    known;      // an int with a value known at load time
+    int32_t konst;
+} vf_val_t;
+
+// the frame slots followed by the values above them
+typedef struct vf_state_t {
+    int      height;
+    vf_val_t vals[];
+} vf_state_t;
+
+// the ways a function returns (flags)
+typedef enum vf_returns_t {
+    VF_RET_NOTHING = 1,
+    VF_RET_VALUE   = 2
+} vf_returns_t;
+
+typedef struct vf_func_t {
+    uint32_t     entry;     // address of its make-frame
+    int          nargs;
+    int          nslots;    // args + locals
+    bool         reached;   // exported or called
+    vf_val_t*    args;
+    int          returns;   // vf_returns_t flags, 0 until a return is reached
+    vf_val_t     ret;
+    int          max_height;
+} vf_func_t;
+
+typedef struct vf_t {
+    program_t*   program;
+    uint8_t*     code;
+    uint32_t     size;
+    uint8_t*     starts;    // 1 at the start of each instruction
+    int*         owner;     // the function of each instruction (-1: none)
+    int*         func_at;   // the function at each entry address (-1: none)
+    vf_state_t** states;    // the state before each instruction
+    uint32_t*    visited;   // the pass an instruction was last visited in
+    uint8_t*     queued;
+    uint32_t*    work;
+    int          nwork;
+    uint32_t     pass;
+    vf_func_t*   funcs;
+    int          nfuncs;
+    vf_state_t*  scratch;
+    bool         changed;   // the args or returns of a function changed
+} vf_t;
+
+#define VF_ARG(VF, PC, I) READ_U32((VF)->code, (PC) + 1 + 4 * (I))
+
+static bool vf_fail(vf_t* vf, uint32_t pc, char* fmt, ...) {
+    char message[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+    char* op_name = pc < vf->size && vf->code[pc] < OP_OPCODE_COUNT
+        ? get_op_name(vf->code[pc])
+        : "?";
+    sh_log_warning("program not verified, #%u %s: %s", pc, op_name, message);
+    return false;
+}
+
+static char* vf_type_name(uint8_t type) {
+    switch(type) {
+        case VF_ANY:     return "unknown";
+        case VF_INTEGER: return "int or char";
+        case VF_EMPTY:   return "nothing";
+        case VAL_NONE:   return "none";
+        case VAL_ITER:   return "iterator";
+        default:         return val_get_type_name((val_type_t) type);
+    }
+}
+
+static bool vf_is_integer(uint8_t type) {
+    return type == VAL_INT || type == VAL_CHAR || type == VF_INTEGER;
+}
+
+static vf_val_t vf_scalar(uint8_t type) {
+    return (vf_val_t) { .type = type, .elem = VAL_NONE };
+}
+
+static vf_val_t vf_array(uint8_t elem) {
+    return (vf_val_t) { .type = VAL_ARRAY, .elem = elem };
+}
+
+// an array of arrays (depth levels down to arrays of leaf)
+static vf_val_t vf_nested(uint8_t leaf, int depth) {
+    if( depth > UINT8_MAX ) {
+        leaf = VF_ANY;
+        depth = 1;
+    }
+    return (vf_val_t) { .type = VAL_ARRAY, .elem = VAL_ARRAY,
+        .leaf = leaf, .depth = (uint8_t) depth };
+}
+
+// an array of elem values
+static vf_val_t vf_array_of(vf_val_t elem) {
+    if( elem.type != VAL_ARRAY ) {
+        return vf_array(elem.type);
+    }
+    if( elem.elem != VAL_ARRAY ) {
+        return vf_nested(elem.elem, 1);
+    }
+    return vf_nested(elem.leaf, elem.depth + 1);
+}
+
+static uint8_t vf_join_type(uint8_t a, uint8_t b) {
+    if( a == b || b == VF_EMPTY ) {
+        return a;
+    }
+    if( a == VF_EMPTY ) {
+        return b;
+    }
+    if( vf_is_integer(a) && vf_is_integer(b) ) {
+        return VF_INTEGER;
+    }
+    return VF_ANY;
+}
+
+static vf_val_t vf_join(vf_val_t a, vf_val_t b) {
+    vf_val_t r = vf_scalar(vf_join_type(a.type, b.type));
+    if( r.type == VAL_ARRAY || r.type == VAL_ITER ) {
+        r.elem = vf_join_type(a.elem, b.elem);
+    }
+    if( r.elem == VAL_ARRAY ) {
+        // the other one is empty or also nested
+        vf_val_t nested = a.elem == VAL_ARRAY ? a : b;
+        r.leaf = nested.leaf;
+        r.depth = nested.depth;
+        if( a.elem == VAL_ARRAY && b.elem == VAL_ARRAY ) {
+            bool same = a.depth == b.depth;
+            r.leaf = same ? vf_join_type(a.leaf, b.leaf) : VF_ANY;
+            r.depth = same ? a.depth : 1;
+        }
+    }
+    if( a.known && b.known && a.konst == b.konst ) {
+        r.known = true;
+        r.konst = a.konst;
+    }
+    return r;
+}
+
+static bool vf_equals(vf_val_t a, vf_val_t b) {
+    return a.type == b.type
+        && a.elem == b.elem
+        && a.leaf == b.leaf
+        && a.depth == b.depth
+        && a.known == b.known
+        && (a.known == false || a.konst == b.konst);
+}
+
+static vf_val_t vf_from_ift(ift_t type) {
+    switch(type.tags[0]) {
+        case IFT_VOID: return vf_scalar(VAL_NONE);
+        case IFT_BOOL: return vf_scalar(VAL_BOOL);
+        case IFT_CHAR: return vf_scalar(VAL_CHAR);
+        case IFT_I32:  return vf_scalar(VAL_INT);
+        case IFT_F32:  return vf_scalar(VAL_NUMBER);
+        case IFT_LST: {
+            return vf_array_of(vf_from_ift(ift_list_get_content_type(type)));
+        }
+        default:       return vf_scalar(VF_ANY);
+    }
+}
+
+// values of type elem can be stored in a packed array of pack
+static bool vf_can_pack(uint32_t pack, uint8_t elem) {
+    if( pack >= VAL_TYPE_COUNT || pack_width((val_type_t) pack) == 0 ) {
+        return false;
+    }
+    if( elem == VF_EMPTY || elem == pack ) {
+        return true;
+    }
+    // ints and chars share the representation (and are
+    // converted when floats are packed)
+    return pack != VAL_BOOL && vf_is_integer(elem);
+}
+
+// the element an iterator (or array) yields
+static vf_val_t vf_elem(vf_val_t iter) {
+    if( iter.elem != VAL_ARRAY ) {
+        return vf_scalar(iter.elem);
+    }
+    if( iter.depth <= 1 ) {
+        return vf_array(iter.leaf);
+    }
+    return vf_nested(iter.leaf, iter.depth - 1);
+}
+
+// the type of a constant, arrays in the pool are followed
+// down to VF_MAX_CONST_NESTING levels
+static vf_val_t vf_const_value(vf_t* vf, val_t value, int nesting) {
+    vf_val_t r = vf_scalar(value.type);
+    if( value.type == VAL_INT ) {
+        r.known = true;
+        r.konst = value.u.integer;
+    } else if( value.type == VAL_ARRAY ) {
+        r.elem = VF_ANY;
+        array_t array = val_into_array(value);
+        uint32_t start = MEM_ADDR_TO_INDEX(array.address);
+        uint32_t count = (uint32_t) array_slot_count(array);
+        if( ADDR_IS_CONST(array.address)
+            && start <= vf->program->cons.count
+            && count <= vf->program->cons.count - start
+            && nesting < VF_MAX_CONST_NESTING ) {
+            r.elem = VF_EMPTY;
+            if( array.pack != VAL_NONE ) {
+                if( array.length > 0 ) {
+                    r.elem = array.pack;
+                }
+                return r;
+            }
+            for(uint32_t i = 0; i < count; i++) {
+                val_t slot = vf->program->cons.buffer[start + i];
+                vf_val_t elem = vf_array_of(vf_const_value(vf, slot, nesting + 1));
+                r = i == 0 ? elem : vf_join(r, elem);
+            }
+        }
+    }
+    return r;
+}
+
+static vf_val_t vf_const(vf_t* vf, uint32_t index) {
+    return vf_const_value(vf, vf->program->cons.buffer[index], 0);
+}
+
+/* --- decoding --- */
+
+static int vf_add_func(vf_t* vf, uint32_t entry) {
+    if( vf->func_at[entry] >= 0 ) {
+        return vf->func_at[entry];
+    }
+    vf_func_t* f = &vf->funcs[vf->nfuncs];
+    *f = (vf_func_t) {
+        .entry = entry,
+        .nargs = VF_ARG(vf, entry, 0),
+        .nslots = VF_ARG(vf, entry, 0) + VF_ARG(vf, entry, 1)
+    };
+    f->args = calloc(f->nargs > 0 ? f->nargs : 1, sizeof(vf_val_t));
+    if( f->args == NULL ) {
+        return -1;
+    }
+    vf->func_at[entry] = vf->nfuncs;
+    return vf->nfuncs++;
+}
+
+// checks the encoding and the operands that don't depend on
+// the control flow, and collects the functions
+static bool vf_decode(vf_t* vf) {
+
+    program_t* program = vf->program;
+    int nframes = 0;
+
+    for(uint32_t pc = 0; pc < vf->size; ) {
+        vm_op_t opcode = vf->code[pc];
+        if( opcode >= OP_OPCODE_COUNT ) {
+            return vf_fail(vf, pc, "unknown opcode %i", opcode);
+        }
+        uint32_t length = 1 + 4 * get_op_arg_count(opcode);
+        if( length > vf->size - pc ) {
+            return vf_fail(vf, pc, "the instruction is cut off");
+        }
+        nframes += opcode == OP_MAKE_FRAME;
+        vf->starts[pc] = 1;
+        pc += length;
+    }
+
+    vf->funcs = calloc(nframes > 0 ? nframes : 1, sizeof(vf_func_t));
+    if( vf->funcs == NULL ) {
+        return vf_fail(vf, 0, "out of memory");
+    }
+
+    for(uint32_t pc = 0; pc < vf->size; pc += 1 + 4 * get_op_arg_count(vf->code[pc])) {
+        vm_op_t opcode = vf->code[pc];
+        int argc = get_op_arg_count(opcode);
+        op_argtype_t* types = get_op_arg_types(opcode);
+        for(int i = 0; i < argc; i++) {
+            uint32_t arg = VF_ARG(vf, pc, i);
+            if( types[i] == OP_ARG_CONSTANT && arg >= program->cons.count ) {
+                return vf_fail(vf, pc, "constant %u out of range", arg);
+            }
+            if( types[i] == OP_ARG_RK && OP_RK_IS_CONST(arg)
+                && OP_RK_INDEX(arg) >= program->cons.count ) {
+                return vf_fail(vf, pc, "constant %u out of range", OP_RK_INDEX(arg));
+            }
+            if( types[i] == OP_ARG_ADDRESS ) {
+                if( opcode == OP_CALL_NATIVE ) {
+                    if( arg >= (uint32_t) program->imports.count ) {
+                        return vf_fail(vf, pc, "host function %u is not imported", arg);
+                    }
+                } else if( arg >= vf->size || vf->starts[arg] == 0 ) {
+                    return vf_fail(vf, pc, "#%u is not an instruction", arg);
+                }
+            }
+        }
+        if( opcode == OP_MAKE_FRAME ) {
+            // the frame sizes are kept in bytes (vm_frame_t)
+            if( VF_ARG(vf, pc, 0) > UINT8_MAX || VF_ARG(vf, pc, 1) > UINT8_MAX ) {
+                return vf_fail(vf, pc, "the frame has more than %i args or locals", UINT8_MAX);
+            }
+            if( vf_add_func(vf, pc) < 0 ) {
+                return vf_fail(vf, pc, "out of memory");
+            }
+        }
+    }
+
+    for(uint32_t pc = 0; pc < vf->size; pc += 1 + 4 * get_op_arg_count(vf->code[pc])) {
+        vm_op_t opcode = vf->code[pc];
+        if( (opcode == OP_CALL || opcode == OP_TAIL_CALL)
+            && vf->code[VF_ARG(vf, pc, 0)] != OP_MAKE_FRAME ) {
+            return vf_fail(vf, pc, "#%u is not a function", VF_ARG(vf, pc, 0));
+        }
+        if( opcode == OP_TAIL_CALL && VF_ARG(vf, pc, 1) != VF_ARG(vf, VF_ARG(vf, pc, 0), 0) ) {
+            return vf_fail(vf, pc, "passes %u args, the function at #%u takes %u",
+                VF_ARG(vf, pc, 1), VF_ARG(vf, pc, 0), VF_ARG(vf, VF_ARG(vf, pc, 0), 0));
+        }
+    }
+
+    for(int i = 0; i < program->exports.count; i++) {
+        uint32_t entry = program->expaddr[i];
+        ift_t type = program->exports.def[i].type;
+        if( entry >= vf->size || vf->starts[entry] == 0 || vf->code[entry] != OP_MAKE_FRAME ) {
+            return vf_fail(vf, entry, "export %i is not a function", i);
+        }
+        vf_func_t* f = &vf->funcs[vf->func_at[entry]];
+        if( ift_func_arg_count(type) != f->nargs ) {
+            return vf_fail(vf, entry, "export %i takes %i args, the frame has %i",
+                i, ift_func_arg_count(type), f->nargs);
+        }
+        for(int a = 0; a < f->nargs; a++) {
+            vf_val_t arg = vf_from_ift(ift_func_get_arg(type, a));
+            f->args[a] = f->reached ? vf_join(f->args[a], arg) : arg;
+        }
+        f->reached = true;
+    }
+
+    return true;
+}
+
+/* --- abstract interpretation --- */
+
+static vf_state_t* vf_state_alloc(int nvals) {
+    return malloc(sizeof(vf_state_t) + sizeof(vf_val_t) * (nvals > 0 ? nvals : 1));
+}
+
+// merges a state into the one before pc and queues pc if it changed
+static bool vf_merge(vf_t* vf, int fi, uint32_t from, uint32_t pc, vf_state_t* state) {
+    vf_func_t* f = &vf->funcs[fi];
+    if( pc >= vf->size ) {
+        return vf_fail(vf, from, "runs past the end of the program");
+    }
+    if( vf->func_at[pc] >= 0 ) {
+        return vf_fail(vf, from, "continues into the function at #%u", pc);
+    }
+    if( vf->owner[pc] >= 0 && vf->owner[pc] != fi ) {
+        return vf_fail(vf, from, "continues into the function at #%u",
+            vf->funcs[vf->owner[pc]].entry);
+    }
+    int nvals = f->nslots + state->height;
+    vf_state_t* current = vf->states[pc];
+    bool changed = false;
+    if( current == NULL ) {
+        current = vf_state_alloc(nvals);
+        if( current == NULL ) {
+            return vf_fail(vf, from, "out of memory");
+        }
+        memcpy(current, state, sizeof(vf_state_t) + sizeof(vf_val_t) * nvals);
+        vf->states[pc] = current;
+        vf->owner[pc] = fi;
+        changed = true;
+    } else {
+        if( current->height != state->height ) {
+            return vf_fail(vf, from, "the stack holds %i values at #%u, "
+                "but %i on another path", state->height, pc, current->height);
+        }
+        for(int i = 0; i < nvals; i++) {
+            vf_val_t joined = vf_join(current->vals[i], state->vals[i]);
+            if( vf_equals(joined, current->vals[i]) == false ) {
+                current->vals[i] = joined;
+                changed = true;
+            }
+        }
+    }
+    if( state->height > f->max_height ) {
+        f->max_height = state->height;
+    }
+    if( (changed || vf->visited[pc] != vf->pass) && vf->queued[pc] == 0 ) {
+        vf->queued[pc] = 1;
+        vf->work[vf->nwork++] = pc;
+    }
+    return true;
+}
+
+static void vf_returned(vf_t* vf, vf_func_t* f, vf_returns_t returns, vf_val_t value) {
+    if( (f->returns & returns) == 0 ) {
+        f->returns |= returns;
+        vf->changed = true;
+        if( returns == VF_RET_VALUE ) {
+            f->ret = value;
+            return;
+        }
+    }
+    vf_val_t joined = vf_join(f->ret, value);
+    if( returns == VF_RET_VALUE && vf_equals(joined, f->ret) == false ) {
+        f->ret = joined;
+        vf->changed = true;
+    }
+}
+
+// joins the args of a call into the ones the callee is analyzed with
+static void vf_called(vf_t* vf, vf_func_t* callee, vf_val_t* args) {
+    for(int i = 0; i < callee->nargs; i++) {
+        vf_val_t joined = callee->reached ? vf_join(callee->args[i], args[i]) : args[i];
+        if( callee->reached == false || vf_equals(joined, callee->args[i]) == false ) {
+            callee->args[i] = joined;
+            vf->changed = true;
+        }
+    }
+    if( callee->reached == false ) {
+        callee->reached = true;
+        vf->changed = true;
+    }
+}
+
+#define VF_SLOTS        (f->nslots)
+#define VF_TOP(N)       (S->vals[VF_SLOTS + S->height - 1 - (N)])
+#define VF_POP(N)       (S->height -= (N))
+#define VF_PUSH(V)      (S->vals[VF_SLOTS + S->height++] = (V))
+#define VF_SLOT(ARG)    (S->vals[VF_ARG(vf, pc, ARG)])
+
+#define VF_NEED(N) do {                                                 \
+        if( S->height < (N) ) {                                         \
+            return vf_fail(vf, pc, "needs %i values on the stack "      \
+                "but has %i", (N), S->height);                          \
+        }                                                               \
+    } while(false)
+
+#define VF_EXPECT(V, TYPE, OPERAND) do {                                \
+        if( vf_expect(vf, pc, (V), (TYPE), (OPERAND)) == false ) {      \
+            return false;                                               \
+        }                                                               \
+    } while(false)
+
+#define VF_MERGE(TARGET) do {                                           \
+        if( vf_merge(vf, fi, pc, (TARGET), S) == false ) {              \
+            return false;                                               \
+        }                                                               \
+    } while(false)
+
+static bool vf_expect(vf_t* vf, uint32_t pc, vf_val_t value, uint8_t type, int operand) {
+    bool ok = type == VF_INTEGER
+        ? vf_is_integer(value.type)
+        : value.type == type;
+    if( ok == false ) {
+        return vf_fail(vf, pc, "operand #%i should be %s but may be %s",
+            operand, vf_type_name(type), vf_type_name(value.type));
+    }
+    return true;
+}
+
+// the type of the RK operand at arg
+static vf_val_t vf_rk(vf_t* vf, vf_state_t* S, uint32_t pc, int arg) {
+    uint32_t rk = VF_ARG(vf, pc, arg);
+    if( OP_RK_IS_CONST(rk) ) {
+        return vf_const(vf, OP_RK_INDEX(rk));
+    }
+    return S->vals[rk];
+}
+
+// the operand type of the stack and register instructions
+// that read two values of the same type
+static uint8_t vf_binary_type(vm_op_t opcode) {
+    switch(opcode) {
+        case OP_AND: case OP_OR:
+        case OP_R_AND: case OP_R_OR:
+            return VAL_BOOL;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_CMP_EQUAL: case OP_CMP_NOT_EQUAL:
+        case OP_CMP_LESS_THAN: case OP_CMP_MORE_THAN:
+        case OP_CMP_LESS_THAN_OR_EQUAL: case OP_CMP_MORE_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_EQUAL: case OP_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_JUMP_IF_NOT_LESS_THAN: case OP_JUMP_IF_NOT_MORE_THAN:
+        case OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL: case OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+        case OP_R_ADD: case OP_R_SUB: case OP_R_MUL: case OP_R_DIV: case OP_R_MOD:
+        case OP_R_CMP_EQUAL: case OP_R_CMP_NOT_EQUAL:
+        case OP_R_CMP_LESS_THAN: case OP_R_CMP_MORE_THAN:
+        case OP_R_CMP_LESS_THAN_OR_EQUAL: case OP_R_CMP_MORE_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_EQUAL: case OP_R_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_LESS_THAN: case OP_R_JUMP_IF_NOT_MORE_THAN:
+        case OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL: case OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+            return VAL_NUMBER;
+        default:
+            return VF_INTEGER;
+    }
+}
+
+// the result type of a binary instruction
+static uint8_t vf_binary_result(vm_op_t opcode) {
+    switch(opcode) {
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_R_ADD: case OP_R_SUB: case OP_R_MUL: case OP_R_DIV: case OP_R_MOD:
+            return VAL_NUMBER;
+        case OP_IADD: case OP_ISUB: case OP_IMUL: case OP_IDIV: case OP_IMOD:
+        case OP_R_IADD: case OP_R_ISUB: case OP_R_IMUL: case OP_R_IDIV: case OP_R_IMOD:
+            return VAL_INT;
+        default:
+            return VAL_BOOL;
+    }
+}
+
+// checks that the frame slot operands are in the frame
+static bool vf_check_slots(vf_t* vf, vf_func_t* f, uint32_t pc) {
+    vm_op_t opcode = vf->code[pc];
+    int argc = get_op_arg_count(opcode);
+    op_argtype_t* types = get_op_arg_types(opcode);
+    for(int i = 0; i < argc; i++) {
+        uint32_t arg = VF_ARG(vf, pc, i);
+        bool is_slot = types[i] == OP_ARG_LOCAL
+            || (types[i] == OP_ARG_RK && OP_RK_IS_CONST(arg) == false);
+        if( is_slot && arg >= (uint32_t) f->nslots ) {
+            return vf_fail(vf, pc, "slot %u is not in the frame (%i slots)", arg, f->nslots);
+        }
+    }
+    return true;
+}
+
+// applies the instruction at pc to the state before it and
+// merges the results into the states of its successors
+static bool vf_step(vf_t* vf, int fi, uint32_t pc) {
+
+    vf_func_t* f = &vf->funcs[fi];
+    vf_state_t* S = vf->scratch;
+    vf_state_t* before = vf->states[pc];
+    memcpy(S, before, sizeof(vf_state_t) + sizeof(vf_val_t) * (f->nslots + before->height));
+
+    vm_op_t opcode = vf->code[pc];
+    uint32_t next = pc + 1 + 4 * get_op_arg_count(opcode);
+
+    if( vf_check_slots(vf, f, pc) == false ) {
+        return false;
+    }
+
+    switch(opcode) {
+        case OP_HALT:
+        case OP_EXIT:
+        case OP_PRINT: {
+            // leaves the vm (print is not implemented)
+        } return true;
+        case OP_PUSH_VALUE: {
+            VF_PUSH(vf_const(vf, VF_ARG(vf, pc, 0)));
+        } break;
+        case OP_POP_1:
+        case OP_POP_2: {
+            int n = opcode == OP_POP_1 ? 1 : 2;
+            VF_NEED(n);
+            VF_POP(n);
+        } break;
+        case OP_DUP_1: {
+            VF_NEED(1);
+            vf_val_t a = VF_TOP(0);
+            VF_PUSH(a);
+        } break;
+        case OP_DUP_2: {
+            VF_NEED(2);
+            vf_val_t a = VF_TOP(1);
+            vf_val_t b = VF_TOP(0);
+            VF_PUSH(a);
+            VF_PUSH(b);
+        } break;
+        case OP_ROT_2: {
+            VF_NEED(2);
+            vf_val_t a = VF_TOP(1);
+            VF_TOP(1) = VF_TOP(0);
+            VF_TOP(0) = a;
+        } break;
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_CMP_EQUAL: case OP_CMP_NOT_EQUAL:
+        case OP_CMP_LESS_THAN: case OP_CMP_MORE_THAN:
+        case OP_CMP_LESS_THAN_OR_EQUAL: case OP_CMP_MORE_THAN_OR_EQUAL:
+        case OP_AND: case OP_OR:
+        case OP_IADD: case OP_ISUB: case OP_IMUL: case OP_IDIV: case OP_IMOD:
+        case OP_ICMP_EQUAL: case OP_ICMP_NOT_EQUAL:
+        case OP_ICMP_LESS_THAN: case OP_ICMP_MORE_THAN:
+        case OP_ICMP_LESS_THAN_OR_EQUAL: case OP_ICMP_MORE_THAN_OR_EQUAL: {
+            VF_NEED(2);
+            VF_EXPECT(VF_TOP(0), vf_binary_type(opcode), 1);
+            VF_EXPECT(VF_TOP(1), vf_binary_type(opcode), 2);
+            VF_POP(2);
+            VF_PUSH(vf_scalar(vf_binary_result(opcode)));
+        } break;
+        case OP_NEG:
+        case OP_NOT:
+        case OP_INEG:
+        case OP_INT_TO_FLOAT: {
+            VF_NEED(1);
+            uint8_t type = opcode == OP_NEG ? VAL_NUMBER
+                : opcode == OP_NOT ? VAL_BOOL : VF_INTEGER;
+            VF_EXPECT(VF_TOP(0), type, 1);
+            VF_TOP(0) = vf_scalar(opcode == OP_INEG ? VAL_INT
+                : opcode == OP_INT_TO_FLOAT ? VAL_NUMBER : type);
+        } break;
+        case OP_JUMP: {
+            VF_MERGE(VF_ARG(vf, pc, 0));
+        } return true;
+        case OP_JUMP_IF_FALSE: {
+            VF_NEED(1);
+            VF_EXPECT(VF_TOP(0), VAL_BOOL, 1);
+            VF_POP(1);
+            VF_MERGE(VF_ARG(vf, pc, 0));
+        } break;
+        case OP_JUMP_IF_NOT_EQUAL: case OP_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_JUMP_IF_NOT_LESS_THAN: case OP_JUMP_IF_NOT_MORE_THAN:
+        case OP_JUMP_IF_NOT_LESS_THAN_OR_EQUAL: case OP_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+        case OP_JUMP_IF_NOT_IEQUAL: case OP_JUMP_IF_NOT_INOT_EQUAL:
+        case OP_JUMP_IF_NOT_ILESS_THAN: case OP_JUMP_IF_NOT_IMORE_THAN:
+        case OP_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL: case OP_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL: {
+            VF_NEED(2);
+            VF_EXPECT(VF_TOP(0), vf_binary_type(opcode), 1);
+            VF_EXPECT(VF_TOP(1), vf_binary_type(opcode), 2);
+            VF_POP(2);
+            VF_MERGE(VF_ARG(vf, pc, 0));
+        } break;
+        case OP_CALL: {
+            vf_func_t* callee = &vf->funcs[vf->func_at[VF_ARG(vf, pc, 0)]];
+            VF_NEED(callee->nargs);
+            vf_called(vf, callee, &VF_TOP(callee->nargs - 1));
+            if( callee->returns == 0 ) {
+                // continues once the callee is known to return
+                return true;
+            }
+            if( callee->returns == (VF_RET_NOTHING | VF_RET_VALUE) ) {
+                // only the entry function may do this, it leaves the vm
+                return vf_fail(vf, pc, "the function at #%u returns both "
+                    "with and without a value", callee->entry);
+            }
+            VF_POP(callee->nargs);
+            if( callee->returns == VF_RET_VALUE ) {
+                VF_PUSH(callee->ret);
+            }
+        } break;
+        case OP_TAIL_CALL: {
+            // the callee returns in place of the function
+            vf_func_t* callee = &vf->funcs[vf->func_at[VF_ARG(vf, pc, 0)]];
+            VF_NEED(callee->nargs);
+            vf_called(vf, callee, &VF_TOP(callee->nargs - 1));
+            if( callee->returns & VF_RET_NOTHING ) {
+                vf_returned(vf, f, VF_RET_NOTHING, vf_scalar(VAL_NONE));
+            }
+            if( callee->returns & VF_RET_VALUE ) {
+                vf_returned(vf, f, VF_RET_VALUE, callee->ret);
+            }
+        } return true;
+        case OP_MAKE_FRAME: {
+            return vf_fail(vf, pc, "the frame is not set up by a call");
+        }
+        case OP_RETURN_NOTHING: {
+            vf_returned(vf, f, VF_RET_NOTHING, vf_scalar(VAL_NONE));
+        } return true;
+        case OP_RETURN_VALUE: {
+            // returns nothing if there is no value above the frame
+            if( S->height == 0 ) {
+                vf_returned(vf, f, VF_RET_NOTHING, vf_scalar(VAL_NONE));
+            } else {
+                vf_returned(vf, f, VF_RET_VALUE, VF_TOP(0));
+            }
+        } return true;
+        case OP_STORE_LOCAL: {
+            VF_NEED(1);
+            VF_SLOT(0) = VF_TOP(0);
+            VF_POP(1);
+        } break;
+        case OP_LOAD_LOCAL: {
+            VF_PUSH(VF_SLOT(0));
+        } break;
+        case OP_MAKE_ARRAY:
+        case OP_MAKE_PACKED_ARRAY: {
+            VF_NEED(1);
+            vf_val_t size = VF_TOP(0);
+            if( size.type != VAL_INT || size.known == false || size.konst < 0 ) {
+                return vf_fail(vf, pc, "the array size is not a constant");
+            }
+            if( size.konst >= S->height ) {
+                return vf_fail(vf, pc, "needs %i values on the stack "
+                    "but has %i", size.konst, S->height - 1);
+            }
+            vf_val_t array = vf_array(VF_EMPTY);
+            for(int i = 1; i <= size.konst; i++) {
+                vf_val_t elem = vf_array_of(VF_TOP(i));
+                array = i == 1 ? elem : vf_join(array, elem);
+            }
+            uint8_t elem = array.elem;
+            if( opcode == OP_MAKE_PACKED_ARRAY ) {
+                uint32_t pack = VF_ARG(vf, pc, 0);
+                if( vf_can_pack(pack, elem) == false ) {
+                    return vf_fail(vf, pc, "can't pack %s values as %s",
+                        vf_type_name(elem), vf_type_name((uint8_t) pack));
+                }
+                if( elem != VF_EMPTY ) {
+                    elem = (uint8_t) pack;
+                }
+            }
+            VF_POP(size.konst + 1);
+            VF_PUSH(opcode == OP_MAKE_ARRAY ? array : vf_array(elem));
+        } break;
+        case OP_ARRAY_LENGTH: {
+            VF_NEED(1);
+            VF_EXPECT(VF_TOP(0), VAL_ARRAY, 1);
+            VF_TOP(0) = vf_scalar(VAL_INT);
+        } break;
+        case OP_MAKE_ITER: {
+            VF_NEED(1);
+            VF_EXPECT(VF_TOP(0), VAL_ARRAY, 1);
+            VF_TOP(0).type = VAL_ITER;
+        } break;
+        case OP_ITER_NEXT:
+        case OP_ITER_NEXT_STORE_LOCAL: {
+            VF_NEED(1);
+            VF_EXPECT(VF_TOP(0), VAL_ITER, 1);
+            vf_val_t iter = VF_TOP(0);
+            uint8_t elem = iter.elem;
+            // done: the iterator is dropped
+            S->height --;
+            VF_MERGE(VF_ARG(vf, pc, 0));
+            S->height ++;
+            if( elem == VF_EMPTY ) {
+                // never yields
+                return true;
+            }
+            if( opcode == OP_ITER_NEXT ) {
+                VF_PUSH(vf_elem(iter));
+            } else {
+                VF_SLOT(1) = vf_elem(iter);
+            }
+        } break;
+        case OP_CALL_NATIVE: {
+            ift_t type = vf->program->imports.def[VF_ARG(vf, pc, 0)].type;
+            int argc = ift_func_arg_count(type);
+            VF_NEED(argc);
+            VF_POP(argc);
+            ift_t ret = ift_func_get_return_type(type);
+            if( ift_is_void(ret) == false ) {
+                // the host function is trusted to return its declared type
+                VF_PUSH(vf_from_ift(ret));
+            }
+        } break;
+        case OP_LOAD_LOCAL_PAIR: {
+            vf_val_t a = VF_SLOT(0);
+            vf_val_t b = VF_SLOT(1);
+            VF_PUSH(a);
+            VF_PUSH(b);
+        } break;
+        case OP_PUSH_VALUE_LOAD_LOCAL: {
+            vf_val_t b = VF_SLOT(1);
+            VF_PUSH(vf_const(vf, VF_ARG(vf, pc, 0)));
+            VF_PUSH(b);
+        } break;
+        case OP_ADD_LOCALS_TO_LOCAL:
+        case OP_IADD_LOCALS_TO_LOCAL: {
+            uint8_t type = opcode == OP_ADD_LOCALS_TO_LOCAL ? VAL_NUMBER : VF_INTEGER;
+            VF_EXPECT(VF_SLOT(0), type, 0);
+            VF_EXPECT(VF_SLOT(1), type, 1);
+            VF_SLOT(2) = vf_scalar(opcode == OP_ADD_LOCALS_TO_LOCAL ? VAL_NUMBER : VAL_INT);
+        } break;
+        case OP_INC_LOCAL_BY_CONST:
+        case OP_IINC_LOCAL_BY_CONST: {
+            uint8_t type = opcode == OP_INC_LOCAL_BY_CONST ? VAL_NUMBER : VF_INTEGER;
+            VF_EXPECT(VF_SLOT(0), type, 0);
+            VF_EXPECT(vf_const(vf, VF_ARG(vf, pc, 1)), type, 1);
+            VF_SLOT(0) = vf_scalar(opcode == OP_INC_LOCAL_BY_CONST ? VAL_NUMBER : VAL_INT);
+        } break;
+        case OP_R_MOVE: {
+            VF_SLOT(0) = vf_rk(vf, S, pc, 1);
+        } break;
+        case OP_R_NEG:
+        case OP_R_NOT:
+        case OP_R_INEG: {
+            uint8_t type = opcode == OP_R_NEG ? VAL_NUMBER
+                : opcode == OP_R_NOT ? VAL_BOOL : VF_INTEGER;
+            VF_EXPECT(vf_rk(vf, S, pc, 1), type, 1);
+            VF_SLOT(0) = vf_scalar(opcode == OP_R_INEG ? VAL_INT : type);
+        } break;
+        case OP_R_JUMP_IF_FALSE: {
+            VF_EXPECT(vf_rk(vf, S, pc, 1), VAL_BOOL, 1);
+            VF_MERGE(VF_ARG(vf, pc, 0));
+        } break;
+        case OP_R_ADD: case OP_R_SUB: case OP_R_MUL: case OP_R_DIV: case OP_R_MOD:
+        case OP_R_AND: case OP_R_OR:
+        case OP_R_CMP_EQUAL: case OP_R_CMP_NOT_EQUAL:
+        case OP_R_CMP_LESS_THAN: case OP_R_CMP_MORE_THAN:
+        case OP_R_CMP_LESS_THAN_OR_EQUAL: case OP_R_CMP_MORE_THAN_OR_EQUAL:
+        case OP_R_IADD: case OP_R_ISUB: case OP_R_IMUL: case OP_R_IDIV: case OP_R_IMOD:
+        case OP_R_ICMP_EQUAL: case OP_R_ICMP_NOT_EQUAL:
+        case OP_R_ICMP_LESS_THAN: case OP_R_ICMP_MORE_THAN:
+        case OP_R_ICMP_LESS_THAN_OR_EQUAL: case OP_R_ICMP_MORE_THAN_OR_EQUAL: {
+            VF_EXPECT(vf_rk(vf, S, pc, 1), vf_binary_type(opcode), 1);
+            VF_EXPECT(vf_rk(vf, S, pc, 2), vf_binary_type(opcode), 2);
+            VF_SLOT(0) = vf_scalar(vf_binary_result(opcode));
+        } break;
+        case OP_R_JUMP_IF_NOT_EQUAL: case OP_R_JUMP_IF_NOT_NOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_LESS_THAN: case OP_R_JUMP_IF_NOT_MORE_THAN:
+        case OP_R_JUMP_IF_NOT_LESS_THAN_OR_EQUAL: case OP_R_JUMP_IF_NOT_MORE_THAN_OR_EQUAL:
+        case OP_R_JUMP_IF_NOT_IEQUAL: case OP_R_JUMP_IF_NOT_INOT_EQUAL:
+        case OP_R_JUMP_IF_NOT_ILESS_THAN: case OP_R_JUMP_IF_NOT_IMORE_THAN:
+        case OP_R_JUMP_IF_NOT_ILESS_THAN_OR_EQUAL: case OP_R_JUMP_IF_NOT_IMORE_THAN_OR_EQUAL: {
+            VF_EXPECT(vf_rk(vf, S, pc, 1), vf_binary_type(opcode), 1);
+            VF_EXPECT(vf_rk(vf, S, pc, 2), vf_binary_type(opcode), 2);
+            VF_MERGE(VF_ARG(vf, pc, 0));
+        } break;
+        default: {
+            return vf_fail(vf, pc, "not handled by the verifier");
+        }
+    }
+
+    VF_MERGE(next);
+    return true;
+}
+
+// follows every path through a function from its entry
+static bool vf_analyze(vf_t* vf, int fi) {
+
+    vf_func_t* f = &vf->funcs[fi];
+    vf_state_t* S = vf->scratch;
+
+    vf->pass ++;
+    S->height = 0;
+    for(int i = 0; i < f->nslots; i++) {
+        S->vals[i] = i < f->nargs ? f->args[i] : vf_scalar(VAL_NONE);
+    }
+    if( vf_merge(vf, fi, f->entry, f->entry + 9, S) == false ) {
+        return false;
+    }
+
+    while( vf->nwork > 0 ) {
+        uint32_t pc = vf->work[--vf->nwork];
+        vf->queued[pc] = 0;
+        vf->visited[pc] = vf->pass;
+        if( vf_step(vf, fi, pc) == false ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void vf_destroy(vf_t* vf) {
+    if( vf->states != NULL ) {
+        for(uint32_t i = 0; i < vf->size; i++) {
+            free(vf->states[i]);
+        }
+    }
+    for(int i = 0; i < vf->nfuncs; i++) {
+        free(vf->funcs[i].args);
+    }
+    free(vf->funcs);
+    free(vf->states);
+    free(vf->starts);
+    free(vf->owner);
+    free(vf->func_at);
+    free(vf->visited);
+    free(vf->queued);
+    free(vf->work);
+    free(vf->scratch);
+}
+
+static bool vf_run(vf_t* vf) {
+
+    uint32_t size = vf->size;
+    vf->starts  = calloc(size, sizeof(uint8_t));
+    vf->owner   = malloc(sizeof(int) * size);
+    vf->func_at = malloc(sizeof(int) * size);
+    vf->states  = calloc(size, sizeof(vf_state_t*));
+    vf->visited = calloc(size, sizeof(uint32_t));
+    vf->queued  = calloc(size, sizeof(uint8_t));
+    vf->work    = malloc(sizeof(uint32_t) * size);
+    // the largest frame plus the largest stack, the heights
+    // match at joins so no instruction pushes more than twice
+    vf->scratch = vf_state_alloc(2 * UINT8_MAX + 2 * size + 2);
+
+    if( vf->starts == NULL || vf->owner == NULL || vf->func_at == NULL
+        || vf->states == NULL || vf->visited == NULL || vf->queued == NULL
+        || vf->work == NULL || vf->scratch == NULL ) {
+        return vf_fail(vf, 0, "out of memory");
+    }
+
+    for(uint32_t i = 0; i < size; i++) {
+        vf->owner[i] = -1;
+        vf->func_at[i] = -1;
+    }
+
+    if( vf_decode(vf) == false ) {
+        return false;
+    }
+
+    // until the args and returns of the reached functions are
+    // stable (they only grow, so this ends)
+    do {
+        vf->changed = false;
+        for(int i = 0; i < vf->nfuncs; i++) {
+            if( vf->funcs[i].reached && vf_analyze(vf, i) == false ) {
+                return false;
+            }
+        }
+    } while( vf->changed );
+
+    return true;
+}
+
+vm_verify_t* vm_verify_program(program_t* program) {
+
+    if( program == NULL || program->inst.size == 0 || program->exports.count == 0 ) {
+        return NULL;
+    }
+
+    vf_t vf = {
+        .program = program,
+        .code = program->inst.buffer,
+        .size = program->inst.size
+    };
+
+    vm_verify_t* verify = NULL;
+
+    if( vf_run(&vf) ) {
+        verify = malloc(sizeof(vm_verify_t));
+        int count = program->exports.count;
+        if( verify != NULL ) {
+            *verify = (vm_verify_t) {
+                .count = count,
+                .entries = malloc(sizeof(uint32_t) * count),
+                .types = malloc(sizeof(ift_t) * count),
+                .argtypes = calloc(count, VM_VERIFY_MAX_ARGS)
+            };
+            if( verify->entries == NULL || verify->types == NULL || verify->argtypes == NULL ) {
+                vm_verify_destroy(verify);
+                verify = NULL;
+            }
+        }
+        if( verify != NULL ) {
+            for(int i = 0; i < count; i++) {
+                verify->entries[i] = program->expaddr[i];
+                verify->types[i] = program->exports.def[i].type;
+                ift_t type = verify->types[i];
+                int argc = ift_func_arg_count(type);
+                for(int a = 0; a < argc && a < VM_VERIFY_MAX_ARGS; a++) {
+                    verify->argtypes[i * VM_VERIFY_MAX_ARGS + a] = vf_from_ift(ift_func_get_arg(type, a)).type;
+                }
+            }
+            for(int i = 0; i < vf.nfuncs; i++) {
+                vf_func_t* f = &vf.funcs[i];
+                int extent = f->nslots - f->nargs + f->max_height;
+                if( f->reached && extent > verify->frame_extent ) {
+                    verify->frame_extent = extent;
+                }
+            }
+        }
+    }
+
+    vf_destroy(&vf);
+    return verify;
+}
+
+void vm_verify_destroy(vm_verify_t* verify) {
+    if( verify == NULL ) {
+        return;
+    }
+    free(verify->entries);
+    free(verify->types);
+    free(verify->argtypes);
+    free(verify);
+}
+
+// checks that a value from the host has the declared type,
+// including the elements of lists
+static bool vf_check_arg(vm_t* vm, val_t value, ift_t type) {
+    vf_val_t expected = vf_from_ift(type);
+    if( expected.type != value.type ) {
+        return false;
+    }
+    if( value.type != VAL_ARRAY ) {
+        return true;
+    }
+    if( ADDR_IS_CONST(value.u.address) ) {
+        return false;
+    }
+    array_t array = val_into_array(value);
+    uint32_t start = MEM_ADDR_TO_INDEX(array.address);
+    uint32_t count = (uint32_t) array_slot_count(array);
+    if( start > (uint32_t) vm->mem.memsize || count > vm->mem.memsize - start ) {
+        return false;
+    }
+    ift_t content = ift_list_get_content_type(type);
+    if( array.pack != VAL_NONE ) {
+        return vf_from_ift(content).type == array.pack;
+    }
+    for(uint32_t i = 0; i < count; i++) {
+        if( vf_check_arg(vm, vm->mem.membase[start + i], content) == false ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int vm_verify_find(vm_verify_t* verify, vm_t* vm, int address, int argc) {
+    if( verify == NULL || argc + verify->frame_extent >= vm->mem.stack.size ) {
+        return -1;
+    }
+    for(int i = 0; i < verify->count; i++) {
+        if( verify->entries[i] == (uint32_t) address ) {
+            bool argc_ok = ift_func_arg_count(verify->types[i]) == argc
+                && argc <= VM_VERIFY_MAX_ARGS;
+            return argc_ok ? i : -1;
+        }
+    }
+    return -1;
+}
+
+bool vm_verify_args(vm_verify_t* verify, vm_t* vm, int index, int argc, val_t* args) {
+    uint8_t* types = &verify->argtypes[index * VM_VERIFY_MAX_ARGS];
+    for(int a = 0; a < argc; a++) {
+        if( args[a].type != types[a] ) {
+            return false;
+        }
+        if( types[a] == VAL_ARRAY
+            && vf_check_arg(vm, args[a], ift_func_get_arg(verify->types[index], a)) == false ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool vm_verify_entry(vm_verify_t* verify, vm_t* vm, int address, int argc, val_t* args) {
+    int index = vm_verify_find(verify, vm, address, argc);
+    return index >= 0 && vm_verify_args(verify, vm, index, argc, args);
+}
@@ -0,0 +1,44 @@
+#ifndef VM_VERIFY_H_
+#define VM_VERIFY_H_
+
+#include "sh_types.h"
+#include "vm_types.h"
+
+// Load-time bytecode verifier, run by vm_env_setup. It follows
+// every path from the exports of a program through its calls
+// (abstract interpretation) and proves what the runtime
+// validation (vm_validate.h) checks per instruction: stack
+// depths, frame slot indices, jump targets, frames and the
+// operand types. Runs that start at a verified export with
+// matching args use the interpreter without validation.
+//
+// Rejected programs log a diagnostic and keep running with
+// the runtime validation.
+
+struct vm_verify_t {
+    int         count;
+    uint32_t*   entries;        // addresses of the verified exports
+    ift_t*      types;          // and their types
+    uint8_t*    argtypes;       // val types of their args (VM_VERIFY_MAX_ARGS each)
+    int         frame_extent;   // max stack values a call adds
+};
+
+// as many args as an entry point can hold
+#define VM_VERIFY_MAX_ARGS 16
+
+vm_verify_t* vm_verify_program(program_t* program);
+void         vm_verify_destroy(vm_verify_t* verify);
+
+// the export at address if a run with argc args may start
+// there without runtime validation (-1: no)
+int          vm_verify_find(vm_verify_t* verify, vm_t* vm, int address, int argc);
+
+// true if the args (as many as found by vm_verify_find)
+// have the types declared by the export
+bool         vm_verify_args(vm_verify_t* verify, vm_t* vm, int index, int argc, val_t* args);
+
+// true if a run may start at address with these args
+// without runtime validation
+bool         vm_verify_entry(vm_verify_t* verify, vm_t* vm, int address, int argc, val_t* args);
+
+#endif // VM_VERIFY_H_
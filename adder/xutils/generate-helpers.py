@@ -23,14 +23,14 @@ return_type_list = [
 def gen_native_to_val_call(ctype:str, argname:str):
     if ctype == "char*":
         return f"xu_string_to_val(vm, ({argname}))"
-    if ctype == "int" or ctype == "float":
+    if ctype == "float":
         return f"val_number(({argname}))"
     return f"val_{ctype}(({argname}))"
 
 def gen_val_to_native_call(return_ctype:str, argname:str):
     if return_ctype == "char*":
         return f"xu_val_to_string(vm, {argname})"
-    if return_ctype == "int" or return_ctype == "float":
+    if return_ctype == "float":
         return f"val_into_number({argname})"
     return f"val_into_{return_ctype}({argname})"
 
@@ -127,29 +127,21 @@ def gen_c_definition(fun:InvokeFun):
     code =   gen_c_declaraction(fun)
     code +=  " {\n"
     code += f"    assert(caller->entrypoint.argcount == {fun.get_arg_count()});\n"
-    
-    code +=  "\n"
-    
-    code += f"    xu_classlist_t* classes = caller->class.classlist;\n"
-    code += f"    int ref = caller->class.classref;\n"
-    code += f"    vm_env_t* env = &classes->envs[ref];\n"
-    code += f"    program_t* program = &classes->programs[ref];\n"
-    
     code +=  "\n"
     
-    index = 0
-    for a in fun.get_args():
-        code += f"    program_entry_point_set_arg(&caller->entrypoint, {index}, {a.get_name()});\n"
-        index += 1
+    args = "NULL"
+    if fun.get_arg_count() > 0:
+        argvals = ", ".join([ a.get_name() for a in fun.get_args() ])
+        code += f"    val_t args[{fun.get_arg_count()}] = {{ {argvals} }};\n"
+        args = "args"
     
-    if index > 0:
-        code +=  "\n"
+    code += f"    vm_call_t* call = xu_caller_prepare(vm, caller);\n"
     
     if fun.get_ctype() == "void":
-        code += f"    vm_execute(vm, env, &caller->entrypoint, program);\n"
+        code += f"    vm_call(call, {args});\n"
     else:
         conv_code = gen_val_to_native_call(fun.get_ctype(), "result")
-        code += f"    val_t result = vm_execute(vm, env, &caller->entrypoint, program);\n"
+        code += f"    val_t result = vm_call(call, {args});\n"
         code += f"    return {conv_code};\n"
         
     code +=  "}\n"
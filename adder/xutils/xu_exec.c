@@ -0,0 +1,344 @@
+#include "xu_exec.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define XU_EXEC_MASK (XU_EXEC_DEQUE_SIZE - 1)
+
+// jobs a worker moves from the shared queue to its own
+// deque at once, the rest of them can be stolen
+#define XU_EXEC_GRAB 8
+
+// Chase-Lev deque (fixed size). The owner pushes and pops at
+// the bottom, other workers steal from the top.
+typedef struct xu_deque_t {
+    _Alignas(64) _Atomic(int64_t) top;
+    _Alignas(64) _Atomic(int64_t) bottom;
+    _Atomic(xu_job_t*) jobs[XU_EXEC_DEQUE_SIZE];
+} xu_deque_t;
+
+typedef struct xu_worker_t {
+    xu_deque_t      deque;
+    xu_executor_t*  executor;
+    pthread_t       thread;
+    vm_t            vm;
+    uint32_t        seed;       // victim selection
+} xu_worker_t;
+
+struct xu_executor_t {
+    int             nworkers;
+    xu_worker_t*    workers;
+    pthread_mutex_t lock;       // guards the shared queue and stop
+    pthread_cond_t  wake;       // jobs were queued (or stop)
+    pthread_cond_t  idle;       // all jobs are completed
+    xu_job_t**      queue;      // shared queue (ring buffer)
+    int             head;
+    int             count;
+    int             size;
+    bool            stop;
+    _Atomic(int)    pending;    // submitted, not completed
+    _Atomic(int)    sleeping;   // workers waiting for jobs
+};
+
+static _Thread_local xu_worker_t* xu_current_worker = NULL;
+
+static bool deque_push(xu_deque_t* d, xu_job_t* job) {
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    int64_t t = atomic_load(&d->top);
+    if( b - t >= XU_EXEC_DEQUE_SIZE ) {
+        return false;
+    }
+    atomic_store_explicit(&d->jobs[b & XU_EXEC_MASK], job, memory_order_relaxed);
+    atomic_store(&d->bottom, b + 1);
+    return true;
+}
+
+static xu_job_t* deque_pop(xu_deque_t* d) {
+    int64_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    atomic_store(&d->bottom, b);
+    int64_t t = atomic_load(&d->top);
+    if( t > b ) {
+        // empty
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    xu_job_t* job = atomic_load_explicit(&d->jobs[b & XU_EXEC_MASK], memory_order_relaxed);
+    if( t == b ) {
+        // the last job, race the thieves for it
+        if( atomic_compare_exchange_strong(&d->top, &t, t + 1) == false ) {
+            job = NULL;
+        }
+        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+    return job;
+}
+
+static xu_job_t* deque_steal(xu_deque_t* d) {
+    int64_t t = atomic_load(&d->top);
+    int64_t b = atomic_load(&d->bottom);
+    if( t >= b ) {
+        return NULL;
+    }
+    xu_job_t* job = atomic_load_explicit(&d->jobs[t & XU_EXEC_MASK], memory_order_relaxed);
+    if( atomic_compare_exchange_strong(&d->top, &t, t + 1) == false ) {
+        return NULL;
+    }
+    return job;
+}
+
+// lock must be held
+static bool queue_put(xu_executor_t* ex, xu_job_t* job) {
+    if( ex->count == ex->size ) {
+        int size = ex->size > 0 ? ex->size * 2 : 64;
+        xu_job_t** queue = (xu_job_t**) malloc(size * sizeof(xu_job_t*));
+        if( queue == NULL ) {
+            return false;
+        }
+        for(int i = 0; i < ex->count; i++) {
+            queue[i] = ex->queue[(ex->head + i) % ex->size];
+        }
+        free(ex->queue);
+        ex->queue = queue;
+        ex->head = 0;
+        ex->size = size;
+    }
+    ex->queue[(ex->head + ex->count) % ex->size] = job;
+    ex->count++;
+    return true;
+}
+
+// lock must be held
+static xu_job_t* queue_take(xu_executor_t* ex) {
+    if( ex->count == 0 ) {
+        return NULL;
+    }
+    xu_job_t* job = ex->queue[ex->head];
+    ex->head = (ex->head + 1) % ex->size;
+    ex->count--;
+    return job;
+}
+
+static xu_job_t* worker_take_shared(xu_worker_t* w) {
+    xu_executor_t* ex = w->executor;
+    pthread_mutex_lock(&ex->lock);
+    xu_job_t* job = queue_take(ex);
+    for(int i = 1; job != NULL && i < XU_EXEC_GRAB && ex->count > 0; i++) {
+        if( deque_push(&w->deque, ex->queue[ex->head]) == false ) {
+            break;
+        }
+        queue_take(ex);
+    }
+    pthread_mutex_unlock(&ex->lock);
+    return job;
+}
+
+static xu_job_t* worker_steal(xu_worker_t* w) {
+    xu_executor_t* ex = w->executor;
+    // xorshift, start at a random victim
+    w->seed ^= w->seed << 13;
+    w->seed ^= w->seed >> 17;
+    w->seed ^= w->seed << 5;
+    int start = w->seed % ex->nworkers;
+    for(int i = 0; i < ex->nworkers; i++) {
+        xu_worker_t* victim = &ex->workers[(start + i) % ex->nworkers];
+        if( victim == w ) {
+            continue;
+        }
+        xu_job_t* job = deque_steal(&victim->deque);
+        if( job != NULL ) {
+            return job;
+        }
+    }
+    return NULL;
+}
+
+static void worker_run(xu_worker_t* w, xu_job_t* job) {
+    xu_executor_t* ex = w->executor;
+    vm_set_cycle_budget(&w->vm, job->budget);
+    int completed = xu_call_batch(&w->vm, job->caller,
+        job->args, job->count, job->results, job->reset_heap);
+    if( job->done != NULL ) {
+        // the job may be released by the callback
+        job->done(job, completed);
+    }
+    if( atomic_fetch_sub(&ex->pending, 1) == 1 ) {
+        pthread_mutex_lock(&ex->lock);
+        pthread_cond_broadcast(&ex->idle);
+        pthread_mutex_unlock(&ex->lock);
+    }
+}
+
+static void* worker_main(void* data) {
+    xu_worker_t* w = (xu_worker_t*) data;
+    xu_executor_t* ex = w->executor;
+    xu_current_worker = w;
+    while( true ) {
+        xu_job_t* job = deque_pop(&w->deque);
+        if( job == NULL ) {
+            job = worker_take_shared(w);
+        }
+        if( job == NULL ) {
+            job = worker_steal(w);
+        }
+        if( job != NULL ) {
+            worker_run(w, job);
+            continue;
+        }
+        pthread_mutex_lock(&ex->lock);
+        if( ex->stop ) {
+            pthread_mutex_unlock(&ex->lock);
+            break;
+        }
+        if( ex->count == 0 ) {
+            atomic_fetch_add(&ex->sleeping, 1);
+            pthread_cond_wait(&ex->wake, &ex->lock);
+            atomic_fetch_sub(&ex->sleeping, 1);
+        }
+        pthread_mutex_unlock(&ex->lock);
+    }
+    xu_current_worker = NULL;
+    return NULL;
+}
+
+xu_executor_t* xu_executor_create(int nthreads, int vm_memory) {
+
+    if( nthreads <= 0 ) {
+        sh_log_error("xu_executor_create: invalid thread count %i", nthreads);
+        return NULL;
+    }
+
+    xu_executor_t* ex = (xu_executor_t*) malloc(sizeof(xu_executor_t));
+    xu_worker_t* workers = (xu_worker_t*) aligned_alloc(64,
+        ((nthreads * sizeof(xu_worker_t) + 63) / 64) * 64);
+    if( ex == NULL || workers == NULL ) {
+        sh_log_error("xu_executor_create: could'nt allocate the executor");
+        free(ex);
+        free(workers);
+        return NULL;
+    }
+    memset(ex, 0, sizeof(xu_executor_t));
+    memset(workers, 0, nthreads * sizeof(xu_worker_t));
+
+    ex->workers = workers;
+    pthread_mutex_init(&ex->lock, NULL);
+    pthread_cond_init(&ex->wake, NULL);
+    pthread_cond_init(&ex->idle, NULL);
+    atomic_init(&ex->pending, 0);
+    atomic_init(&ex->sleeping, 0);
+
+    for(int i = 0; i < nthreads; i++) {
+        xu_worker_t* w = &workers[i];
+        w->executor = ex;
+        w->seed = 0x9E3779B9u * (i + 1);
+        atomic_init(&w->deque.top, 0);
+        atomic_init(&w->deque.bottom, 0);
+        if( vm_create(&w->vm, vm_memory) == false ) {
+            break;
+        }
+        // workers only read ex->workers[0..nworkers) after start
+        ex->nworkers = i + 1;
+    }
+
+    for(int i = 0; i < ex->nworkers; i++) {
+        if( pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0 ) {
+            sh_log_error("xu_executor_create: could'nt start worker thread %i", i);
+            pthread_mutex_lock(&ex->lock);
+            ex->stop = true;
+            pthread_cond_broadcast(&ex->wake);
+            pthread_mutex_unlock(&ex->lock);
+            for(int j = 0; j < i; j++) {
+                pthread_join(workers[j].thread, NULL);
+            }
+            for(int j = 0; j < ex->nworkers; j++) {
+                vm_destroy(&workers[j].vm);
+            }
+            ex->nworkers = 0;
+            break;
+        }
+    }
+
+    if( ex->nworkers == 0 ) {
+        sh_log_error("xu_executor_create: no worker could be started");
+        pthread_mutex_destroy(&ex->lock);
+        pthread_cond_destroy(&ex->wake);
+        pthread_cond_destroy(&ex->idle);
+        free(workers);
+        free(ex);
+        return NULL;
+    }
+
+    return ex;
+}
+
+bool xu_executor_submit(xu_executor_t* executor, xu_job_t* job) {
+
+    if( executor == NULL || job == NULL || job->caller == NULL || job->count < 0
+        || (job->count > 0 && job->results == NULL) ) {
+        sh_log_error("xu_executor_submit: invalid job");
+        return false;
+    }
+
+    atomic_fetch_add(&executor->pending, 1);
+
+    // jobs submitted by a worker (from a done callback) are
+    // kept close, the other workers may steal them
+    xu_worker_t* w = xu_current_worker;
+    if( w != NULL && w->executor == executor && deque_push(&w->deque, job) ) {
+        if( atomic_load(&executor->sleeping) > 0 ) {
+            pthread_mutex_lock(&executor->lock);
+            pthread_cond_signal(&executor->wake);
+            pthread_mutex_unlock(&executor->lock);
+        }
+        return true;
+    }
+
+    pthread_mutex_lock(&executor->lock);
+    bool ok = queue_put(executor, job);
+    if( ok ) {
+        pthread_cond_signal(&executor->wake);
+    }
+    pthread_mutex_unlock(&executor->lock);
+
+    if( ok == false ) {
+        sh_log_error("xu_executor_submit: could'nt grow the job queue");
+        atomic_fetch_sub(&executor->pending, 1);
+    }
+    return ok;
+}
+
+void xu_executor_wait(xu_executor_t* executor) {
+    pthread_mutex_lock(&executor->lock);
+    while( atomic_load(&executor->pending) > 0 ) {
+        pthread_cond_wait(&executor->idle, &executor->lock);
+    }
+    pthread_mutex_unlock(&executor->lock);
+}
+
+void xu_executor_destroy(xu_executor_t* executor) {
+    if( executor == NULL ) {
+        return;
+    }
+    xu_executor_wait(executor);
+
+    pthread_mutex_lock(&executor->lock);
+    executor->stop = true;
+    pthread_cond_broadcast(&executor->wake);
+    pthread_mutex_unlock(&executor->lock);
+
+    for(int i = 0; i < executor->nworkers; i++) {
+        pthread_join(executor->workers[i].thread, NULL);
+        vm_destroy(&executor->workers[i].vm);
+    }
+
+    pthread_mutex_destroy(&executor->lock);
+    pthread_cond_destroy(&executor->wake);
+    pthread_cond_destroy(&executor->idle);
+    free(executor->queue);
+    free(executor->workers);
+    free(executor);
+}
+
+int xu_executor_thread_count(xu_executor_t* executor) {
+    return executor != NULL ? executor->nworkers : 0;
+}
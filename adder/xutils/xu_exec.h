@@ -0,0 +1,53 @@
+#ifndef XU_EXEC_H_
+#define XU_EXEC_H_
+
+#include "xu_lib.h"
+
+// Executor for calls into xu classes: a pool of worker threads,
+// each owning a vm_t, running jobs from per worker work-stealing
+// deques. Jobs submitted from outside the pool go to a shared
+// queue, jobs submitted from a completion callback go to the
+// deque of the worker that ran the callback. Idle workers take
+// from the shared queue first and steal from the others when it
+// is empty. The classes must be finalized before jobs are
+// submitted and not be refreshed while the executor runs them.
+
+// jobs a worker deque holds before the shared queue is used
+#define XU_EXEC_DEQUE_SIZE 1024
+
+typedef struct xu_job_t xu_job_t;
+typedef struct xu_executor_t xu_executor_t;
+
+// called on the worker thread with the number of completed
+// items (less than count if an item ran out of budget or called
+// an async host function, such calls are not completed)
+typedef void (*xu_job_done_fn)(xu_job_t* job, int completed);
+
+typedef struct xu_job_t {
+    xu_caller_t*    caller;
+    val_t*          args;       // count tuples of the caller's arg count
+    val_t*          results;    // one value per item
+    int             count;      // items, run as one batch (vm_call_batch)
+    uint32_t        budget;     // instructions per item (0: default budget)
+    bool            reset_heap; // restore the heap after each item
+    xu_job_done_fn  done;       // may be NULL
+    void*           user;
+} xu_job_t;
+
+// nthreads workers with vms of vm_memory values each
+xu_executor_t* xu_executor_create(int nthreads, int vm_memory);
+
+// the job is owned by the caller and must stay valid
+// until its done callback has been called
+bool xu_executor_submit(xu_executor_t* executor, xu_job_t* job);
+
+// waits until all submitted jobs are completed (must not
+// be called from a done callback)
+void xu_executor_wait(xu_executor_t* executor);
+
+// waits for the submitted jobs and stops the workers
+void xu_executor_destroy(xu_executor_t* executor);
+
+int  xu_executor_thread_count(xu_executor_t* executor);
+
+#endif // XU_EXEC_H_
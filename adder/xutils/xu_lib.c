@@ -43,12 +43,7 @@ val_t xu_ffi_to_string(ffi_hndl_meta_t md, int argcount, val_t* args) {
     }
 
     int len = strlen(str.ptr);
-    array_t arr = heap_array_alloc(md.vm, len);
-    val_t* ptr = array_get_ptr(md.vm, arr, 0);
-    for(int i = 0; i < len; i++) {
-        ptr[i] = val_char(str.ptr[i]);
-    }
-    return val_array(arr);
+    return val_array(heap_string_alloc(md.vm, str.ptr, len));
 }
 
 val_t xu_ffi_add_strings(ffi_hndl_meta_t md, int argcount, val_t* args) {
@@ -56,20 +51,34 @@ val_t xu_ffi_add_strings(ffi_hndl_meta_t md, int argcount, val_t* args) {
     assert(argcount == 2);
     (void)(argcount);
 
+    int length = val_into_array(args[0]).length + val_into_array(args[1]).length;
+    array_t new_array = heap_packed_alloc(md.vm, VAL_CHAR, length);
+    if( ADDR_IS_NULL(new_array.address) ) {
+        return val_array(new_array);
+    }
+
+    // the allocation may have moved the args
     array_t a = val_into_array(args[0]);
     array_t b = val_into_array(args[1]);
 
-    array_t new_array = heap_array_alloc(md.vm, a.length + b.length);
-    val_t* new_ptr = array_get_ptr(md.vm, new_array, 0);
+    // strings are packed chars, their bytes are copied as is
+    if( a.pack == VAL_CHAR && b.pack == VAL_CHAR ) {
+        uint8_t* dest = array_get_bytes(md.vm, new_array);
+        if( a.length > 0 ) {
+            memcpy(dest, array_get_bytes(md.vm, a), a.length);
+        }
+        if( b.length > 0 ) {
+            memcpy(dest + a.length, array_get_bytes(md.vm, b), b.length);
+        }
+        return val_array(new_array);
+    }
 
-    val_t* a_ptr = array_get_ptr(md.vm, a, 0);
     for(int i = 0; i < a.length; i++) {
-        new_ptr[i] = a_ptr[i];
+        array_set(md.vm, new_array, i, array_get(md.vm, a, i));
     }
 
-    val_t* b_ptr = array_get_ptr(md.vm, b, 0);
     for(int i = 0; i < b.length; i++) {
-        new_ptr[a.length + i] = b_ptr[i];
+        array_set(md.vm, new_array, a.length + i, array_get(md.vm, b, i));
     }
 
     return val_array(new_array);
@@ -219,16 +228,7 @@ val_t xu_alloc_user_string(vm_t* vm, int len, char* str) {
     if( start < 0 || end < 0 || arraylen < 0 )
         arraylen = 0;
 
-    array_t array = heap_array_alloc(vm, arraylen);
-    val_t* ptr = array_get_ptr(vm, array, 0);
-    for(int i = 0; i < arraylen; i++) {
-        ptr[i] = (val_t) {
-            .type = VAL_CHAR,
-            .u.character = str[i + start]
-        };
-    }
-
-    return val_array(array);
+    return val_array(heap_string_alloc(vm, str + start, arraylen));
 }
 
 int xu_args_from_callstring(vm_t* vm, char* callstr, int maxlen, val_t* args) {
@@ -262,7 +262,7 @@ int xu_args_from_callstring(vm_t* vm, char* callstr, int maxlen, val_t* args) {
         } else if (str_is_int(callstr + start, seglen)) {
             int v = 0;
             sscanf(callstr + start, "%d", &v);
-            args[argc++] = val_number(v);
+            args[argc++] = val_int(v);
         } else {
             break;
         }
@@ -319,10 +319,19 @@ bool xu_quick_run(char* filepath, xu_quickopts_t opts) {
 
         last_creation_time = creation_time;
         source_code_t code = program_source_read_from_file(filepath);
-        program_t program = program_compile(&code, opts.show_ast);
+        program_t program = program_compile(&code, opts.show_ast, opts.compiler);
         program_source_free(&code);
         all_checks_passed = program_is_valid(&program);
         sh_log("%s [%s]\n", filepath, all_checks_passed ? "OK" : "FAILED");
+        if( all_checks_passed && opts.compiler.stats != NULL ) {
+            compiler_stats_t* stats = opts.compiler.stats;
+            sh_log("optimizer: %u expressions folded, %u instructions removed, %u fused\n",
+                stats->folded, stats->removed, stats->fused);
+            if( stats->ssa_functions > 0 ) {
+                sh_log("optimizer: %u functions in ssa form, %u values eliminated\n",
+                    stats->ssa_functions, stats->eliminated);
+            }
+        }
 
         entry_point_t entrypoint = { 0 };
 
@@ -426,6 +435,14 @@ ffi_handle_t xu_ffi_function(ffi_funcall_t function, void* user) {
     };
 }
 
+ffi_handle_t xu_ffi_async(ffi_actcall_t start, void* user) {
+    return (ffi_handle_t) {
+        .local = user,
+        .tag = FFI_HNDL_HOST_ASYNC,
+        .u.host_async = start
+    };
+}
+
 xu_class_t mk_invalid_class(void) {
     return (xu_class_t) {
         .classlist = NULL,
@@ -466,7 +483,7 @@ xu_class_t xu_class_create(xu_classlist_t* classes, source_code_t* code, int cla
         classes->programs[ref] = (program_t) { 0 };
     }
 
-    classes->programs[ref] = program_compile(code, false);
+    classes->programs[ref] = program_compile(code, false, (compiler_opts_t) { 0 });
     if( program_is_valid(&classes->programs[ref]) == false )
         return mk_invalid_class();
 
@@ -567,6 +584,29 @@ bool xu_class_caller_is_valid(xu_caller_t caller) {
         && program_entry_point_is_valid(caller.entrypoint);
 }
 
+vm_call_t* xu_caller_prepare(vm_t* vm, xu_caller_t* caller) {
+    if( caller->call.vm != vm ) {
+        xu_classlist_t* classes = caller->class.classlist;
+        int ref = caller->class.classref;
+        vm_env_t* env = &classes->envs[ref];
+        program_t* program = &classes->programs[ref];
+        caller->call = vm_call_prepare(vm, env, &caller->entrypoint, program);
+    }
+    return &caller->call;
+}
+
+int xu_call_batch(vm_t* vm, xu_caller_t* caller, val_t* args, int count, val_t* results, bool reset_heap) {
+    xu_classlist_t* classes = caller->class.classlist;
+    int ref = caller->class.classref;
+    vm_env_t* env = &classes->envs[ref];
+    program_t* program = &classes->programs[ref];
+
+    // prepared once per batch, the caller is shared by the
+    // workers of an executor (xu_exec.h)
+    vm_call_t call = vm_call_prepare(vm, env, &caller->entrypoint, program);
+    return vm_call_batch(&call, args, count, results, reset_heap);
+}
+
 bool xu_class_inject(xu_class_t class, char* name, ift_t type, ffi_handle_t handle) {
 
     // TODO: Verify that the type is function / action etc.
@@ -668,7 +708,7 @@ xu_result_t xu_refresh_class(xu_class_t class) {
     classes->modtimes[classref] = new_modtime;
 
     source_code_t code = program_source_read_from_file(srcpath);
-    program_t new_program = program_compile(&code, false);
+    program_t new_program = program_compile(&code, false, (compiler_opts_t) { 0 });
     program_source_free(&code);
 
     // keep the old program if we fail to compile
@@ -729,18 +769,13 @@ void xu_cleanup_all(xu_classlist_t* classes) {
 val_t xu_string_to_val(vm_t* vm, char* val) {
     int len = strnlen(val, 2048);
     assert(len < 2048);
-    array_t array = heap_array_alloc(vm, len);
-    val_t* ptr = array_get_ptr(vm, array, 0);
-    for(int i = 0; i < len; i++) {
-        ptr[i] = val_char(val[i]);
-    }
-    return val_array(array);
+    return val_array(heap_string_alloc(vm, val, len));
 }
 
 char* xu_val_to_string(vm_t* vm, val_t val) {
-    // note: this will get messy if 
-    // called from multiple threads
-    static char buf[2048];
+    // note: the string is valid until the next
+    // call from the same thread
+    static _Thread_local char buf[2048];
     buf[0] = '\0'; // reset previous
     cstr_t str = {
         .maxlen = 2048,
@@ -51,10 +51,12 @@ typedef struct xu_classlist_t {
 typedef struct xu_caller_t {
     xu_class_t      class;
     entry_point_t   entrypoint;
+    vm_call_t       call;       // prepared on the first call (per vm)
 } xu_caller_t;
 
 ffi_handle_t xu_ffi_action(ffi_actcall_t action, void* user);
 ffi_handle_t xu_ffi_function(ffi_funcall_t function, void* user);
+ffi_handle_t xu_ffi_async(ffi_actcall_t start, void* user);
 
 xu_class_t xu_class_read_and_create(xu_classlist_t* classes, char* file_path, int class_id);
 xu_class_t xu_class_create(xu_classlist_t* classes, source_code_t* code, int class_id);
@@ -66,8 +68,23 @@ int  xu_class_get_id(xu_class_t class, int not_found_default);
 xu_caller_t xu_class_extract(xu_class_t class, char* name, ift_t type);
 bool xu_class_caller_is_valid(xu_caller_t caller);
 
+// the prepared call (vm_call_prepare) of the caller on vm, the
+// invoke helpers (xu_invoke.h) prepare it once and reuse it. A
+// caller used by the helpers from several threads (each with its
+// own vm) needs a copy per thread.
+vm_call_t* xu_caller_prepare(vm_t* vm, xu_caller_t* caller);
+
+// calls the function once per item of args (count tuples of
+// its arg count values) in one vm session, see vm_call_batch
+int xu_call_batch(vm_t* vm, xu_caller_t* caller, val_t* args, int count, val_t* results, bool reset_heap);
+
 bool xu_class_inject(xu_class_t class, char* name, ift_t type, ffi_handle_t handle);
 
+// initializes ffi with the default imports (print, stradd, itos ..)
+// that every class gets, for code that runs without a class list
+// (programs translated to c, see adrrun -c)
+bool xu_setup_default_interface(ffi_t* ffi);
+
 bool xu_class_finalize(xu_class_t class);
 
 typedef struct xu_iterator_t {
@@ -90,6 +107,8 @@ typedef enum xu_result_t {
 
 #define xu_result_is_error(rescode) ((rescode & 0xF0) > 0)
 
+// recompiles the class in place: no other thread may call
+// into the class list while it is refreshed or finalized
 xu_result_t xu_refresh_class(xu_class_t class);
 
 bool xu_finalize_all(xu_classlist_t* classes);
@@ -101,6 +120,7 @@ typedef struct xu_quickopts_t {
     bool        keep_alive;
     int         vm_memory;
     char*       callstr; // fname(0, false, 1.3, "hello")
+    compiler_opts_t compiler;
 } xu_quickopts_t;
 
 
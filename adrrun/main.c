@@ -18,6 +18,8 @@
 #include <sh_arena.h>
 #include <sh_ift.h>
 #include <xu_lib.h>
+#include <co_cgen.h>
+#include <ctype.h>
 
 bool is_adr_path(char* str) {
     int len = strnlen(str, 1024);
@@ -35,6 +37,52 @@ bool is_adr_call(char* str) {
     return strncmp((str + len), ")", 1) == 0;
 }
 
+// writes the program as c source to out (.c appended if it
+// doesn't end with it) and its declarations to a header next
+// to it (.c -> .h)
+bool translate_to_c(char* path, char* out, compiler_opts_t opts) {
+
+    char c_path[1024];
+    int out_len = strnlen(out, sizeof(c_path) - 3);
+    bool has_ext = out_len >= 3 && strncmp(out + out_len - 2, ".c", 2) == 0;
+    snprintf(c_path, sizeof(c_path), "%.*s%s", out_len, out, has_ext ? "" : ".c");
+    int c_len = strnlen(c_path, sizeof(c_path));
+
+    // the file name is the prefix of the generated functions
+    char prefix[64];
+    char* name = strrchr(c_path, '/');
+    name = name == NULL ? c_path : name + 1;
+    int plen = 0;
+    for(; name[plen] != '.' && plen < (int) sizeof(prefix) - 1; plen++) {
+        prefix[plen] = isalnum((unsigned char) name[plen]) ? name[plen] : '_';
+    }
+    prefix[plen] = '\0';
+
+    source_code_t code = program_source_read_from_file(path);
+    program_t program = program_compile(&code, false, opts);
+    program_source_free(&code);
+    if( plen == 0 || program_is_valid(&program) == false ) {
+        program_destroy(&program);
+        return false;
+    }
+
+    char h_path[1024];
+    snprintf(h_path, sizeof(h_path), "%.*sh", c_len - 1, c_path);
+    FILE* c_file = fopen(c_path, "w");
+    FILE* h_file = fopen(h_path, "w");
+    bool ok = c_file != NULL && h_file != NULL
+        && program_translate_to_c(&program, prefix, c_file)
+        && program_translate_to_c_header(&program, prefix, h_file);
+    if( c_file != NULL ) {
+        ok &= fclose(c_file) == 0;
+    }
+    if( h_file != NULL ) {
+        ok &= fclose(h_file) == 0;
+    }
+    sh_log("%s -> %s, %s [%s]\n", path, c_path, h_path, ok ? "OK" : "FAILED");
+    program_destroy(&program);
+    return ok;
+}
 
 int main(int argv, char** argc) {
 
@@ -46,9 +94,17 @@ int main(int argv, char** argc) {
     bool print_help = false;
     bool keep_alive = false;
     bool run_tests = false;
+    bool run_bench = false;
+    bool run_exec_bench = false;
+    bool run_heap_bench = false;
+    bool register_backend = false;
+    bool native_code = false;
+    bool optimize = false;
+    int opt_level = 1;
     int path_arg = -1;
     int ep_arg = -1;
     int mem_arg = -1;
+    int c_arg = -1;
     
     for(int i = 0; i < argv; i++) {
 
@@ -57,6 +113,15 @@ int main(int argv, char** argc) {
         print_help  |= strncmp(argc[i], "-h", 2) == 0;
         keep_alive  |= strncmp(argc[i], "-k", 2) == 0;
         run_tests   |= strncmp(argc[i], "-t", 2) == 0;
+        run_bench   |= strncmp(argc[i], "-b", 2) == 0;
+        run_exec_bench |= strncmp(argc[i], "-e", 2) == 0;
+        run_heap_bench |= strncmp(argc[i], "-g", 2) == 0;
+        register_backend |= strncmp(argc[i], "-r", 2) == 0;
+        native_code |= strncmp(argc[i], "-j", 2) == 0;
+        optimize    |= strncmp(argc[i], "-O", 2) == 0;
+
+        if( strncmp(argc[i], "-O2", 3) == 0 )
+            opt_level = 2;
 
         if( is_adr_path(argc[i]) )
             path_arg = i;
@@ -66,6 +131,9 @@ int main(int argv, char** argc) {
 
         if( strncmp(argc[i], "-m=", 3) == 0 )
             mem_arg = i;
+
+        if( strncmp(argc[i], "-c=", 3) == 0 )
+            c_arg = i;
     }
 
     if( path_arg >= 0 ) {
@@ -83,22 +151,61 @@ int main(int argv, char** argc) {
         }
     }
 
-    if( path != NULL ) {
+    compiler_stats_t compiler_stats = { 0 };
+    compiler_opts_t compiler_opts = {
+        .backend = register_backend
+            ? CO_BACKEND_REGISTER
+            : CO_BACKEND_STACK,
+        .jit = native_code,
+        .opt_level = optimize ? opt_level : 0,
+        .stats = optimize ? &compiler_stats : NULL
+    };
+
+    int status = 0;
+
+    if( path != NULL && c_arg >= 0 ) {
+        if( translate_to_c(path, argc[c_arg] + 3, compiler_opts) == false ) {
+            status = 1;
+        }
+    } else if( path != NULL ) {
         xu_quick_run(path, (xu_quickopts_t) {
             disassemble, print_ast, 
-            keep_alive, memory, callstr 
+            keep_alive, memory, callstr,
+            compiler_opts
         });
-    } else {
+    } else if( run_bench == false && run_exec_bench == false && run_heap_bench == false ) {
         print_help = true;
     }
 
-    if( run_tests || path == NULL ) {
+    if( run_tests || (path == NULL && run_bench == false && run_exec_bench == false && run_heap_bench == false) ) {
         sh_log_info("RUNNING TESTS\n");
         test_results_t result = run_testcases();
         int total = result.nfailed + result.npassed;
         sh_log_info("[%i / %i TESTS PASSED]\n", result.npassed, total);
     }
 
+    if( run_bench ) {
+        sh_log_info("RUNNING BENCHMARKS\n");
+        vm_profile_reset();
+        bench_results_t result = run_benchmarks(100000, compiler_opts);
+        double mips = result.seconds > 0.0
+            ? (result.instructions / result.seconds) / 1e6
+            : 0.0;
+        sh_log_info("[%i programs, %llu instructions in %.3f s, %.2f Minstr/s]\n",
+            result.nprograms, result.instructions, result.seconds, mips);
+        vm_profile_dump(16);
+    }
+
+    if( run_exec_bench ) {
+        sh_log_info("RUNNING EXECUTOR BENCHMARK\n");
+        run_executor_benchmark(4096, 64);
+    }
+
+    if( run_heap_bench ) {
+        sh_log_info("RUNNING HEAP BENCHMARK\n");
+        run_heap_benchmark(1 << 16, 200);
+    }
+
     if( print_help ) {
         sh_log_info(
         "\n\tusage: adrrun <filename>"
@@ -107,11 +214,19 @@ int main(int argv, char** argc) {
         "\n\t\t -h     : show this help message"
         "\n\t\t -k     : keep alive, reload and run on file update"
         "\n\t\t -t     : run test cases"
+        "\n\t\t -b     : run langtest benchmark (instructions/sec)"
+        "\n\t\t -e     : run executor benchmark (calls/sec per thread count)"
+        "\n\t\t -g     : run heap benchmark (allocs/sec at 10, 50 and 90%% used)"
         "\n\t\t -a     : show ast"
         "\n\t\t -d     : show disassembly"
+        "\n\t\t -r     : compile to register instructions"
+        "\n\t\t -j     : run as native code (jit)"
+        "\n\t\t -O     : optimize (constant folding and peephole pass)"
+        "\n\t\t -O2    : also optimize functions in ssa form (cse, licm, ...)"
         "\n\t\t -m=<n> : specify VM total memory (value count)"
+        "\n\t\t -c=<f> : translate to c source f.c and header f.h (f or f.c)"
         "\n" );
     }
 
-    return 0;
+    return status;
 }
@@ -125,7 +125,7 @@ ltc_t langtest_testcases[] = {
         "    int a = 1;\n"
         "    return a / 2;\n"
         "}\n",
-        .expect = "0.5",
+        .expect = "0",
         .filepath = "basics.txt",
     },
     {
@@ -236,6 +236,209 @@ ltc_t langtest_testcases[] = {
         "}\n",
         .expect = "1",
         .filepath = "basics.txt",
+    },
+    {
+        .category = "verify",
+        .name = "int-precision",
+        .code = 
+        "int main() {\n"
+        "    int a = 16777216;\n"
+        "    return a + 1;\n"
+        "}\n",
+        .expect = "16777217",
+        .filepath = "basics.txt",
+    },
+    {
+        .category = "verify",
+        .name = "int-float-mix",
+        .code = 
+        "float main() {\n"
+        "    int a = 3;\n"
+        "    float b = 0.5;\n"
+        "    float c = a;\n"
+        "    return (a + b) + c;\n"
+        "}\n",
+        .expect = "6.5",
+        .filepath = "basics.txt",
+    },
+    {
+        .category = "verify",
+        .name = "int-division-by-zero",
+        .code = 
+        "int main() {\n"
+        "    int a = 0;\n"
+        "    return 1 / a;\n"
+        "}\n",
+        .expect = "-1007",
+        .filepath = "basics.txt",
+    },
+    {
+        .category = "verify",
+        .name = "constant-expressions",
+        .code = 
+        "int main() {\n"
+        "    int a = 65536 * 32768;\n"
+        "    int b = (7 - 3 * 4) / 2 % 3;\n"
+        "    float c = 7.5 % 2 + 1 / 2.0;\n"
+        "    bool d = (0.1 + 0.2 == 0.3) and (1 < 2.5) and (not (2 >= 3));\n"
+        "    if( d and (c == 1.5) and (a < 0) ) {\n"
+        "        return b - -a;\n"
+        "    }\n"
+        "    return 100;\n"
+        "}\n",
+        .expect = "2147483646",
+        .filepath = "basics.txt",
+    },
+    {
+        .category = "verify",
+        .name = "constant-division-by-zero",
+        .code = 
+        "int main() {\n"
+        "    return 1 / 0;\n"
+        "}\n",
+        .expect = "-1007",
+        .filepath = "basics.txt",
+    },
+    {
+        .category = "verify",
+        .name = "constant-branches",
+        .code = 
+        "int main() {\n"
+        "    int total = 0;\n"
+        "    for(int i in [1, 2, 3]) {\n"
+        "        if( 1 > 2 ) {\n"
+        "            total = total + 100;\n"
+        "        } else if( true ) {\n"
+        "            int t = i * 2;\n"
+        "            total = total + t;\n"
+        "        } else {\n"
+        "            total = total - 1;\n"
+        "        }\n"
+        "    }\n"
+        "    return total;\n"
+        "}\n",
+        .expect = "12",
+        .filepath = "basics.txt",
+    },
+    {
+        .category = "verify",
+        .name = "nested-foreach",
+        .code = 
+        "int main() {\n"
+        "    int sum = 0;\n"
+        "    int count = 0;\n"
+        "    array<int> xs = [1, 2, 3, 4, 5, 6, 7, 8, 9, 10];\n"
+        "    for(int a in xs) {\n"
+        "        for(int b in xs) {\n"
+        "            if( a < b ) {\n"
+        "                sum = sum + a + b;\n"
+        "            }\n"
+        "            count = count + 1;\n"
+        "        }\n"
+        "    }\n"
+        "    return sum + count;\n"
+        "}\n",
+        .expect = "595",
+        .filepath = "loops.txt",
+    },
+    {
+        .category = "verify",
+        .name = "recursive-fib",
+        .code = 
+        "int fib(int n) {\n"
+        "    if( n < 2 ) {\n"
+        "        return n;\n"
+        "    }\n"
+        "    return fib(n - 1) + fib(n - 2);\n"
+        "}\n"
+        "int main() {\n"
+        "    return fib(10);\n"
+        "}\n",
+        .expect = "55",
+        .filepath = "loops.txt",
+    },
+    {
+        .category = "verify",
+        .name = "counters",
+        .code = 
+        "int main() {\n"
+        "    int even = 0;\n"
+        "    int odd = 0;\n"
+        "    int total = 0;\n"
+        "    for(int i in [3, 8, 1, 9, 4, 4, 7, 2, 6, 5, 0, 11]) {\n"
+        "        if( i % 2 == 0 ) {\n"
+        "            even = even + 1;\n"
+        "        } else {\n"
+        "            odd = odd + 1;\n"
+        "        }\n"
+        "        if( i >= 5 ) {\n"
+        "            total = total + i;\n"
+        "        }\n"
+        "    }\n"
+        "    return (even * 100) + ((odd * 10) + total);\n"
+        "}\n",
+        .expect = "706",
+        .filepath = "loops.txt",
+    },
+    {
+        .category = "verify",
+        .name = "tail-recursion",
+        .code = 
+        "int sum_to(int n, int acc) {\n"
+        "    if( n == 0 ) {\n"
+        "        return acc;\n"
+        "    }\n"
+        "    return sum_to(n - 1, acc + n);\n"
+        "}\n"
+        "int main() {\n"
+        "    return sum_to(2000, 0);\n"
+        "}\n",
+        .expect = "2001000",
+        .filepath = "loops.txt",
+    },
+    {
+        .category = "verify",
+        .name = "tail-calls",
+        .code = 
+        "bool is_even(int n) {\n"
+        "    if( n < 2 ) {\n"
+        "        return n == 0;\n"
+        "    }\n"
+        "    return is_even(n - 2);\n"
+        "}\n"
+        "bool is_odd(int n) {\n"
+        "    return is_even(n + 1);\n"
+        "}\n"
+        "int finish(int count, int last) {\n"
+        "    return count * 1000 + last;\n"
+        "}\n"
+        "int count_even(array<int> numbers, int limit) {\n"
+        "    int count = 0;\n"
+        "    for(int n in numbers) {\n"
+        "        if( n > limit ) {\n"
+        "            return finish(count, n);\n"
+        "        }\n"
+        "        if( is_even(n) ) {\n"
+        "            count = count + 1;\n"
+        "        }\n"
+        "    }\n"
+        "    return count;\n"
+        "}\n"
+        "int sum(int a, int b) {\n"
+        "    return a + b;\n"
+        "}\n"
+        "float as_float(int n) {\n"
+        "    return sum(n, n);\n"
+        "}\n"
+        "int main() {\n"
+        "    float f = as_float(3);\n"
+        "    if( f > 5.5 and is_odd(301) ) {\n"
+        "        return count_even([4, 7, 10, 800, 12], 500);\n"
+        "    }\n"
+        "    return 0;\n"
+        "}\n",
+        .expect = "2800",
+        .filepath = "loops.txt",
     }
 };
 
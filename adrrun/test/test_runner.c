@@ -2,6 +2,7 @@
 #include <vm.h>
 #include <vm_heap.h>
 #include <sh_value.h>
+#include <sh_config.h>
 #include <sh_arena.h>
 #include <co_ast.h>
 #include <co_trace.h>
@@ -9,7 +10,10 @@
 #include <co_compiler.h>
 #include <co_program.h>
 #include <co_bty.h>
+#include <co_cgen.h>
+#include <vm_verify.h>
 #include <sh_program.h>
+#include <sh_asminfo.h>
 #include <sh_log.h>
 #include <vm_env.h>
 #include <sh_ffi.h>
@@ -18,10 +22,15 @@
 #include <stdint.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
 #include "termhax.h"
 #include "langtest.h"
 #include <sh_ift.h>
 #include <xu_lib.h>
+#include <xu_exec.h>
+#include <stdatomic.h>
 #include <xu_invoke.h>
 #include <vm_value_tools.h>
 
@@ -146,6 +155,288 @@ void test_heap_memory(test_case_t* this) {
     vm_destroy(&vm);
 }
 
+void test_heap_allocator(test_case_t* this) {
+    vm_t vm;
+
+    TEST_ASSERT_MSG(this, vm_create(&vm, 512), "failed to create gvm\n");
+
+    // 256 values, 4 mark words
+    uint32_t heap_base = (uint32_t) vm.mem.stack.size;
+    vm.mem.stack.top = -1;
+
+    array_t a = heap_array_alloc(&vm, 60);
+    array_t b = heap_array_alloc(&vm, 60);
+    TEST_ASSERT_MSG(this,
+        MEM_ADDR_TO_INDEX(a.address) == heap_base
+        && MEM_ADDR_TO_INDEX(b.address) == heap_base + 64,
+        "#1.1 small chunks crossed a word");
+
+    // next fit: the search continues in the word of b
+    array_t c = heap_array_alloc(&vm, 4);
+    TEST_ASSERT_MSG(this,
+        MEM_ADDR_TO_INDEX(c.address) == heap_base + 124
+        && vm.mem.heap.gc_marks[1] == ~0UL
+        && (vm.mem.heap.gc_full[0] & 0x3UL) == 0x2UL,
+        "#1.2 unexpected next fit allocation");
+
+    // a search that reaches the end wraps around
+    vm.mem.heap.cursor = 3;
+    array_t d = heap_array_alloc(&vm, 64);
+    array_t e = heap_array_alloc(&vm, 4);
+    TEST_ASSERT_MSG(this,
+        MEM_ADDR_TO_INDEX(d.address) == heap_base + 192
+        && MEM_ADDR_TO_INDEX(e.address) == heap_base + 60
+        && (vm.mem.heap.gc_full[0] & 0xFUL) == 0xBUL,
+        "#1.3 the search did not wrap around");
+
+    // large chunks start at an empty word (word 2 is
+    // empty but 70 values don't fit)
+    array_t kept[] = { a, b, c, d, e };
+    for(int i = 0; i < 5; i++) {
+        vm.mem.stack.values[++vm.mem.stack.top] = val_array(kept[i]);
+    }
+    array_t f = heap_array_alloc(&vm, 70);
+    TEST_ASSERT_MSG(this,
+        ADDR_IS_NULL(f.address)
+        && heap_get_used(&vm) == (60 + 60 + 4 + 64 + 4) * 8,
+        "#2.1 large chunk allocated in a full heap");
+
+    vm.mem.stack.values[0] = val_array(b);
+    vm.mem.stack.top = 0;
+    heap_gc_collect(&vm);
+    f = heap_array_alloc(&vm, 64);
+    TEST_ASSERT_MSG(this,
+        MEM_ADDR_TO_INDEX(f.address) == heap_base
+        && heap_get_used(&vm) == (60 + 64) * 8,
+        "#2.2 unexpected large chunk after a collection");
+
+    // empty arrays take up no values
+    array_t g = heap_array_alloc(&vm, 0);
+    TEST_ASSERT_MSG(this,
+        ADDR_IS_NULL(g.address) == false
+        && heap_get_used(&vm) == (60 + 64) * 8,
+        "#3.1 empty array allocation failed");
+
+    vm_destroy(&vm);
+}
+
+void test_heap_pools(test_case_t* this) {
+    vm_t vm;
+
+    TEST_ASSERT_MSG(this, vm_create(&vm, 512), "failed to create gvm\n");
+
+    uint32_t heap_base = (uint32_t) vm.mem.stack.size;
+    vm.mem.stack.top = -1;
+
+    #define KEEP(ARRAY) vm.mem.stack.values[++vm.mem.stack.top] = val_array(ARRAY)
+    #define HEAP_INDEX(ARRAY) (MEM_ADDR_TO_INDEX((ARRAY).address) - heap_base)
+
+    // the collection splits the free values into aligned
+    // chunks: 10 (2), 12 (4), 16 (16), 32 (32), 64 (64) ..
+    array_t a = heap_array_alloc(&vm, 10);
+    KEEP(a);
+    heap_gc_collect(&vm);
+    TEST_ASSERT_MSG(this,
+        vm.mem.heap.pool_counts[1] == 1
+        && vm.mem.heap.pool_counts[2] == 1
+        && vm.mem.heap.pool_counts[3] == 0
+        && vm.mem.heap.pool_counts[6] == 3,
+        "#1.1 unexpected pools after a collection");
+
+    // the rest of a chunk goes back to the pools
+    array_t b = heap_array_alloc(&vm, 2);
+    array_t c = heap_array_alloc(&vm, 3);
+    array_t d = heap_array_alloc(&vm, 1);
+    array_t e = heap_array_alloc(&vm, 1);
+    KEEP(b); KEEP(c); KEEP(d); KEEP(e);
+    TEST_ASSERT_MSG(this,
+        HEAP_INDEX(b) == 10 && HEAP_INDEX(c) == 12
+        && HEAP_INDEX(d) == 15 && HEAP_INDEX(e) == 16,
+        "#1.2 unexpected chunks from the pools");
+
+    // the search takes values that are still in the pools,
+    // the pools skip them
+    array_t f = heap_array_alloc(&vm, 64);
+    array_t g = heap_array_alloc(&vm, 70);
+    KEEP(f); KEEP(g);
+    TEST_ASSERT_MSG(this,
+        HEAP_INDEX(f) == 64 && HEAP_INDEX(g) == 128,
+        "#2.1 unexpected large chunks");
+    // no chunk is left for h, the heap is compacted (the
+    // arrays are already at the front but the stack holds
+    // the only references that are rewritten)
+    array_t h = heap_array_alloc(&vm, 64);
+    TEST_ASSERT_MSG(this,
+        HEAP_INDEX(h) == 10 + 2 + 3 + 1 + 1 + 64 + 70
+        && HEAP_INDEX(val_into_array(vm.mem.stack.values[vm.mem.stack.top])) == 81
+        && heap_get_used(&vm) == (10 + 2 + 3 + 1 + 1 + 64 + 70 + 64) * 8,
+        "#2.2 a used chunk was taken from the pools");
+
+    // make-array writes the values once
+    val_t src[] = { val_int(1), val_int(2), val_int(3) };
+    array_t i = heap_array_make(&vm, VAL_NONE, src, 3);
+    array_t j = heap_array_make(&vm, VAL_INT, src, 3);
+    TEST_ASSERT_MSG(this,
+        val_into_int(array_get(&vm, i, 2)) == 3
+        && val_into_int(array_get(&vm, j, 2)) == 3
+        && vm.mem.membase[MEM_ADDR_TO_INDEX(j.address)].type == VAL_NONE,
+        "#3.1 unexpected values of a made array");
+
+    #undef KEEP
+    #undef HEAP_INDEX
+
+    vm_destroy(&vm);
+}
+
+void test_heap_compaction(test_case_t* this) {
+    vm_t vm;
+
+    TEST_ASSERT_MSG(this, vm_create(&vm, 512), "failed to create gvm\n");
+
+    uint32_t heap_base = (uint32_t) vm.mem.stack.size;
+    vm.mem.stack.top = -1;
+
+    #define HEAP_INDEX(ARRAY) (MEM_ADDR_TO_INDEX((ARRAY).address) - heap_base)
+    #define VALUE(ARRAY, I) vm.mem.membase[MEM_ADDR_TO_INDEX((ARRAY).address) + (I)]
+
+    // two arrays of 30 values per mark word
+    array_t arrays[8];
+    for(int i = 0; i < 8; i++) {
+        arrays[i] = heap_array_alloc(&vm, 30);
+        for(int j = 0; j < 30; j++) {
+            VALUE(arrays[i], j) = val_int(i * 100 + j);
+        }
+    }
+    TEST_ASSERT_MSG(this,
+        HEAP_INDEX(arrays[1]) == 30 && HEAP_INDEX(arrays[7]) == 222,
+        "#1.1 unexpected array placement");
+
+    // arrays[3] is only referenced by the first value of arrays[1]
+    // and arrays[5] only by an iterator with 10 values left
+    VALUE(arrays[1], 0) = val_array(arrays[3]);
+    vm.mem.stack.values[++vm.mem.stack.top] = val_array(arrays[1]);
+    vm.mem.stack.values[++vm.mem.stack.top] = val_iter((iter_t) {
+        .current = arrays[5].address + 20,
+        .remaining = 10,
+        .pack = VAL_NONE
+    });
+    vm.mem.stack.values[++vm.mem.stack.top] = val_array(arrays[7]);
+
+    // 156 values are free but no mark word is empty
+    array_t big = heap_array_alloc(&vm, 100);
+    array_t a1 = val_into_array(vm.mem.stack.values[0]);
+    iter_t it = val_into_iter(vm.mem.stack.values[1]);
+    array_t a7 = val_into_array(vm.mem.stack.values[2]);
+    TEST_ASSERT_MSG(this,
+        ADDR_IS_NULL(big.address) == false
+        && HEAP_INDEX(big) == 100
+        && vm.mem.heap.compactions == 1
+        && heap_get_used(&vm) == 200 * 8,
+        "#2.1 the heap was not compacted");
+
+    array_t a3 = val_into_array(VALUE(a1, 0));
+    TEST_ASSERT_MSG(this,
+        HEAP_INDEX(a1) == 0 && val_into_int(VALUE(a1, 29)) == 129
+        && HEAP_INDEX(a3) == 30 && val_into_int(VALUE(a3, 0)) == 300
+        && val_into_int(VALUE(a3, 29)) == 329,
+        "#2.2 nested array was not moved");
+
+    TEST_ASSERT_MSG(this,
+        MEM_ADDR_TO_INDEX(it.current) - heap_base == 60 && it.remaining == 10
+        && val_into_int(vm.mem.membase[MEM_ADDR_TO_INDEX(it.current)]) == 520
+        && val_into_int(vm.mem.membase[MEM_ADDR_TO_INDEX(it.current) + 9]) == 529
+        && HEAP_INDEX(a7) == 70 && val_into_int(VALUE(a7, 0)) == 700,
+        "#2.3 iterator values were not moved");
+
+    // not enough free values: no compaction
+    array_t huge = heap_array_alloc(&vm, 160);
+    TEST_ASSERT_MSG(this,
+        ADDR_IS_NULL(huge.address) && vm.mem.heap.compactions == 1,
+        "#3.1 unexpected compaction");
+
+    #undef HEAP_INDEX
+    #undef VALUE
+
+    vm_destroy(&vm);
+}
+
+void test_heap_incremental(test_case_t* this) {
+    vm_t vm;
+
+    TEST_ASSERT_MSG(this, vm_create(&vm, 512), "failed to create gvm\n");
+
+    vm.mem.stack.top = -1;
+    vm_set_gc_budget(&vm, 8);
+
+    #define MARKED(ARRAY) ((vm.mem.heap.gc_marks[HEAP_TO_PAGE_INDEX(MEM_ADDR_TO_INDEX((ARRAY).address) \
+        - vm.mem.stack.size)] >> HEAP_TO_BIT_INDEX(MEM_ADDR_TO_INDEX((ARRAY).address) - vm.mem.stack.size)) & 1)
+
+    // a holds b (first value) and w, b holds a packed array c
+    array_t a = heap_array_alloc(&vm, 10);
+    array_t b = heap_array_alloc(&vm, 4);
+    array_t c = heap_packed_alloc(&vm, VAL_CHAR, 8);
+    array_t w = heap_array_alloc(&vm, 3);
+    array_set(&vm, a, 0, val_array(b));
+    array_set(&vm, a, 5, val_array(w));
+    array_set(&vm, b, 3, val_array(c));
+    vm.mem.stack.values[++vm.mem.stack.top] = val_array(a);
+
+    // garbage until a cycle starts (half of the heap is allocated),
+    // the array allocated by that allocation is black
+    array_t g = { 0 };
+    int allocs = 0;
+    while( vm.mem.heap.gc_marking == false && allocs < 16 ) {
+        g = heap_array_alloc(&vm, 16);
+        allocs++;
+    }
+    TEST_ASSERT_MSG(this,
+        vm.mem.heap.gc_marking && allocs == 8 && vm.mem.heap.grey_count == 1,
+        "#1.1 the marking cycle did not start");
+
+    // w moves from a (not yet scanned) to g (black), the
+    // barrier has to shade it
+    vm.mem.stack.values[++vm.mem.stack.top] = val_array(g);
+    array_set(&vm, a, 5, val_int(0));
+    array_set(&vm, g, 0, val_array(w));
+
+    int black = 0;
+    while( vm.mem.heap.gc_marking && allocs < 32 ) {
+        heap_array_alloc(&vm, 16);
+        allocs++;
+        black += vm.mem.heap.gc_marking ? 1 : 0;
+    }
+    vm_gc_stats_t stats = vm_gc_stats(&vm);
+    TEST_ASSERT_MSG(this,
+        vm.mem.heap.gc_marking == false && stats.cycles == 1 && stats.collections == 0,
+        "#1.2 the marking cycle did not finish");
+
+    // the garbage of the cycle (black) survives it, the
+    // array allocated after it doesn't count
+    TEST_ASSERT_MSG(this,
+        MARKED(a) && MARKED(b) && MARKED(c) && MARKED(w) && MARKED(g)
+        && heap_get_used(&vm) == (10 + 4 + 1 + 3 + 16 + 16 * black + 16) * 8,
+        "#2.1 unexpected marks after the cycle");
+
+    heap_gc_collect(&vm);
+    TEST_ASSERT_MSG(this,
+        heap_get_used(&vm) == (10 + 4 + 1 + 3 + 16) * 8,
+        "#2.2 unexpected marks after a collection");
+
+    // one pause per step, begin and finish included
+    stats = vm_gc_stats(&vm);
+    uint32_t pauses = 0;
+    for(int i = 0; i < HEAP_PAUSE_BUCKETS; i++) {
+        pauses += stats.pauses[i];
+    }
+    TEST_ASSERT_MSG(this,
+        pauses == (uint32_t) (allocs - 7) && stats.collections == 1,
+        "#3.1 unexpected pause histogram");
+
+    #undef MARKED
+
+    vm_destroy(&vm);
+}
+
 void test_utils(test_case_t* this) {
 
     srcref_t ref = srcref_const("[##hello##]");
@@ -295,15 +586,15 @@ void test_vm(test_case_t* this) {
     // PROGRAM -- BEGIN
 
     TEST_ASSERT_MSG(this,
-        0 == valbuffer_insert_int(&const_buf, 100).index,
+        0 == valbuffer_insert_float(&const_buf, 100).index,
         "2.1 unexpected index.");
 
     TEST_ASSERT_MSG(this,
-        1 == valbuffer_insert_int(&const_buf, 3).index,
+        1 == valbuffer_insert_float(&const_buf, 3).index,
         "2.2 unexpected index.");
 
     TEST_ASSERT_MSG(this,
-        0 == valbuffer_insert_int(&const_buf, 100).index,
+        0 == valbuffer_insert_float(&const_buf, 100).index,
         "2.3 unexpected index.");
 
     uint32_t value;
@@ -360,7 +651,7 @@ void test_vm(test_case_t* this) {
     // PROGRAM -- BEGIN
 
     TEST_ASSERT_MSG(this,
-        0 == valbuffer_insert_int(&const_buf, 100).index,
+        0 == valbuffer_insert_float(&const_buf, 100).index,
         "2.1 unexpected index.");
 
     value = 0;
@@ -477,7 +768,7 @@ void test_ast(test_case_t* this) {
     trace_t trace = { 0 };
     trace_init(&trace, 16);
 
-    program_t program = gvm_compile(arena, ast_block_with(arena, fun), &trace);
+    program_t program = gvm_compile(arena, ast_block_with(arena, fun), &trace, (compiler_opts_t) { 0 });
     if( trace_get_error_count(&trace) > 0 ) {
         define_cstr(str, 2048);
         trace_sprint(str, &trace);
@@ -739,7 +1030,7 @@ bool test_setup_default_env(ffi_t* ffi) {
 }
 
 
-bool test_compile_and_run(test_case_t* this, char* test_category, char* source_code, char* expected_result, char* tc_name, char* tc_filepath) {
+bool test_compile_and_run(test_case_t* this, char* test_category, char* source_code, char* expected_result, char* tc_name, char* tc_filepath, compiler_opts_t opts) {
 
     static char result_as_text[512] = {0};
     arena_t* arena = arena_create(1024);
@@ -798,7 +1089,7 @@ bool test_compile_and_run(test_case_t* this, char* test_category, char* source_c
 
     ast_node_t* node = par_extract_node(result);
 
-    program_t program = gvm_compile(arena, node, &trace);
+    program_t program = gvm_compile(arena, node, &trace, opts);
     if( trace_get_error_count(&trace) > 0 && is_known_todo == false ) {
         define_cstr(str, 2048);
         trace_sprint(str, &trace);
@@ -842,6 +1133,10 @@ bool test_compile_and_run(test_case_t* this, char* test_category, char* source_c
     val_t res = val_none();
     if( vm_env_is_ready(&env) ) {
         res = vm_execute(&vm, &env, &ep, &program);
+        TEST_ASSERT_MSG(this,
+            vm.run.checked == false,
+            "'%s': the program did not pass the verifier.",
+                tc_name);
     }
 
     // TODO: FIX VALUE PRINTING AT SOME POINT!
@@ -861,6 +1156,9 @@ bool test_compile_and_run(test_case_t* this, char* test_category, char* source_c
         case VAL_NUMBER: {
             sprintf(result_as_text, "%f", val_into_number(res));
         } break;
+        case VAL_INT: {
+            sprintf(result_as_text, "%d", val_into_int(res));
+        } break;
         case VAL_CHAR: {
             sprintf(result_as_text, "%c", val_into_char(res));
         } break;
@@ -917,26 +1215,196 @@ void test_langtest(test_case_t* this) {
     "  return q;\n"
     "}\n";
 
-    bool accepted = test_compile_and_run(this,
-        "verify",
-        text, "75.0",
-        "initial: simple-main",
-        "builtin");
-    if( accepted == false )
-        return; 
+    // every program has to give the same result with both of
+    // the compiler backends, interpreted and as native code,
+    // with and without the optimizer
+    compiler_opts_t configs[] = {
+        { .backend = CO_BACKEND_STACK },
+        { .backend = CO_BACKEND_REGISTER },
+        { .backend = CO_BACKEND_STACK, .jit = true },
+        { .backend = CO_BACKEND_REGISTER, .jit = true },
+        { .backend = CO_BACKEND_STACK, .opt_level = 1 },
+        { .backend = CO_BACKEND_REGISTER, .opt_level = 1 },
+        { .backend = CO_BACKEND_STACK, .jit = true, .opt_level = 1 },
+        { .backend = CO_BACKEND_REGISTER, .jit = true, .opt_level = 1 },
+        // the ssa passes are only used with the stack backend
+        { .backend = CO_BACKEND_STACK, .opt_level = 2 },
+        { .backend = CO_BACKEND_STACK, .jit = true, .opt_level = 2 }
+    };
 
-    size_t tc_count = sizeof(langtest_testcases) / sizeof(langtest_testcases[0]);
-    for (size_t i = 0; i < tc_count; i++) {
-        ltc_t tc = langtest_testcases[i];
-        accepted = test_compile_and_run(this,
-            tc.category,
-            tc.code,
-            tc.expect,
-            tc.name,
-            tc.filepath);
+    for (size_t b = 0; b < sizeof(configs) / sizeof(configs[0]); b++) {
+        compiler_opts_t opts = configs[b];
+        if( opts.jit && VM_JIT == 0 )
+            continue;
+
+        bool accepted = test_compile_and_run(this,
+            "verify",
+            text, "75",
+            "initial: simple-main",
+            "builtin",
+            opts);
         if( accepted == false )
             return; 
+
+        size_t tc_count = sizeof(langtest_testcases) / sizeof(langtest_testcases[0]);
+        for (size_t i = 0; i < tc_count; i++) {
+            ltc_t tc = langtest_testcases[i];
+            accepted = test_compile_and_run(this,
+                tc.category,
+                tc.code,
+                tc.expect,
+                tc.name,
+                tc.filepath,
+                opts);
+            if( accepted == false )
+                return; 
+        }
+    }
+}
+
+void test_co_optimizer(test_case_t* this) {
+
+    char* src_01 = 
+    "int pick(int n) {\n"
+    "   if( 2 * 3 > 5 ) {\n"
+    "       int t = n * (4 - 2);\n"
+    "       return t;\n"
+    "   } else {\n"
+    "       return 0;\n"
+    "   }\n"
+    "}\n"
+    "int main(int n) {\n" 
+    "   return pick(n) + (10 % 4);\n"  
+    "}\n";
+
+    size_t sizes[2] = { 0 };
+    compiler_stats_t stats[2] = { 0 };
+
+    for(int level = 0; level < 2; level++) {
+        source_code_t code = program_source_from_memory(src_01, strlen(src_01));
+        program_t program = program_compile(&code, false, (compiler_opts_t) {
+            .opt_level = level,
+            .stats = &stats[level]
+        });
+        program_source_free(&code);
+
+        if( program_is_valid(&program) == false ) {
+            TEST_ASSERT_MSG(this,
+                false,
+                "#1.0 failed to compile test program (level %i)", level);
+            return;
+        }
+
+        entry_point_t ep = {0};
+        program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &ep);
+
+        vm_t vm = {0};
+        vm_create(&vm, 100);
+
+        vm_env_t env = {0};
+        vm_env_setup(&env, &program, NULL);
+
+        program_entry_point_set_arg(&ep, 0, val_int(5));
+        val_t result = vm_execute(&vm, &env, &ep, &program);
+        TEST_ASSERT_MSG(this,
+            result.type == VAL_INT && val_into_int(result) == 12
+                && vm.run.checked == false,
+            "#1.1 unexpected result (level %i)", level);
+
+        sizes[level] = program.inst.size;
+        vm_destroy(&vm);
+        vm_env_destroy(&env);
+        program_destroy(&program);
+    }
+
+    TEST_ASSERT_MSG(this,
+        stats[0].folded == 0 && stats[0].removed == 0,
+        "#2.1 optimized without an optimization level");
+
+    // 2 * 3, 6 > 5, 4 - 2 and 10 % 4
+    TEST_ASSERT_MSG(this,
+        stats[1].folded == 4,
+        "#2.2 expected 4 folded expressions but got %u", stats[1].folded);
+
+    // the constant branch, the store/load of t,
+    // the jump over the else block and the block
+    TEST_ASSERT_MSG(this,
+        stats[1].removed >= 5,
+        "#2.3 expected at least 5 removed instructions but got %u", stats[1].removed);
+
+    TEST_ASSERT_MSG(this,
+        sizes[1] < sizes[0],
+        "#2.4 the optimized program is not smaller (%zu >= %zu)", sizes[1], sizes[0]);
+}
+
+void test_co_ssa(test_case_t* this) {
+
+    char* src_01 = 
+    "int sum(array<int> xs, int k) {\n"
+    "   int total = 0;\n"
+    "   int i = 0;\n"
+    "   for(int x in xs) {\n"
+    "       total = total + (x * (k * 3)) + (i * 4);\n"
+    "       i = i + 1;\n"
+    "   }\n"
+    "   int unused = k * 5;\n"
+    "   return total + (k * 3);\n"
+    "}\n"
+    "int main(int n) {\n" 
+    "   return sum([1, 2, 3], n);\n"  
+    "}\n";
+
+    compiler_stats_t stats[3] = { 0 };
+
+    for(int level = 1; level <= 2; level++) {
+        source_code_t code = program_source_from_memory(src_01, strlen(src_01));
+        program_t program = program_compile(&code, false, (compiler_opts_t) {
+            .opt_level = level,
+            .stats = &stats[level]
+        });
+        program_source_free(&code);
+
+        if( program_is_valid(&program) == false ) {
+            TEST_ASSERT_MSG(this,
+                false,
+                "#1.0 failed to compile test program (level %i)", level);
+            return;
+        }
+
+        entry_point_t ep = {0};
+        program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &ep);
+
+        vm_t vm = {0};
+        vm_create(&vm, 100);
+
+        vm_env_t env = {0};
+        vm_env_setup(&env, &program, NULL);
+
+        program_entry_point_set_arg(&ep, 0, val_int(2));
+        val_t result = vm_execute(&vm, &env, &ep, &program);
+        TEST_ASSERT_MSG(this,
+            result.type == VAL_INT && val_into_int(result) == 54
+                && vm.run.checked == false,
+            "#1.1 unexpected result (level %i)", level);
+
+        vm_destroy(&vm);
+        vm_env_destroy(&env);
+        program_destroy(&program);
     }
+
+    TEST_ASSERT_MSG(this,
+        stats[1].ssa_functions == 0,
+        "#2.1 ssa form used below level 2");
+
+    TEST_ASSERT_MSG(this,
+        stats[2].ssa_functions == 2,
+        "#2.2 expected 2 functions in ssa form but got %u", stats[2].ssa_functions);
+
+    // the second k * 3, the unused k * 5 and i * 4 with i (its
+    // phi and i + 1), less the new induction variable for i * 4
+    TEST_ASSERT_MSG(this,
+        stats[2].eliminated >= 3,
+        "#2.3 expected at least 3 eliminated values but got %u", stats[2].eliminated);
 }
 
 void test_arena_alloc(test_case_t* this) {
@@ -1311,11 +1779,11 @@ void test_xu_classes(test_case_t* this) {
 val_t test_alloc(ffi_hndl_meta_t md, int argcount, val_t* args) {
     assert(argcount == 1);
     (void)(argcount);
-    int n = val_into_number(args[0]);
+    int n = val_into_int(args[0]);
     array_t a = heap_array_alloc(md.vm, n);
     val_t* ptr = array_get_ptr(md.vm, a, 0);
     for(int i = 0; i < n; i++) {
-        ptr[i] = val_number(i + 1);
+        ptr[i] = val_int(i + 1);
     }
     return val_array(a);
 }
@@ -1341,7 +1809,7 @@ void test_vm_full_heap(test_case_t* this) {
         }, ift_func_1(ift_list(ift_int()), ift_int()));
 
     source_code_t code = program_source_from_memory(str, strlen(str));
-    program_t program = program_compile(&code, false);
+    program_t program = program_compile(&code, false, (compiler_opts_t) { 0 });
     program_source_free(&code);
 
     if( program_is_valid(&program) == false ) {
@@ -1365,7 +1833,7 @@ void test_vm_full_heap(test_case_t* this) {
         return;
     }
 
-    program_entry_point_set_arg(&ep, 0, val_number(39));
+    program_entry_point_set_arg(&ep, 0, val_int(39));
 
     vm_t vm = (vm_t) {0};
     vm_create(&vm, 2*40);
@@ -1383,6 +1851,247 @@ void test_vm_full_heap(test_case_t* this) {
     program_destroy(&program);
 }
 
+val_t test_zero_first(ffi_hndl_meta_t md, int argcount, val_t* args) {
+    assert(argcount == 1);
+    (void)(argcount);
+    // the array may be a literal (constant)
+    array_t a = heap_array_unshare(md.vm, val_into_array(args[0]));
+    array_set(md.vm, a, 0, val_int(0));
+    return val_array(a);
+}
+
+void test_vm_literals(test_case_t* this) {
+
+    char* str = 
+    "import array<int> zero_first(array<int> xs);\n"
+    "int main(int n) {\n" 
+    "   int t = 0;\n"
+    "   for(int i in [1, 2, 3]) {\n"
+    "       for(array<int> ys in [[1, 2], [3]]) {\n"
+    "           for(int y in ys) {\n"
+    "               t = t + (y * n);\n"
+    "           }\n"
+    "       }\n"
+    "       array<char> s = \"abc\";\n"
+    "       for(char c in s) {\n"
+    "           t = t + 1;\n"
+    "       }\n"
+    "   }\n"
+    "   return t;\n"
+    "}\n"
+    "export int copies(int n) {\n" 
+    "   int t = 0;\n"
+    "   for(int i in [1, 2]) {\n"
+    "       array<int> xs = [5, 6];\n"
+    "       for(int x in zero_first(xs)) {\n"
+    "           t = t + x;\n"
+    "       }\n"
+    "       for(int x in xs) {\n"
+    "           t = t + (x * n);\n"
+    "       }\n"
+    "   }\n"
+    "   return t;\n"
+    "}\n";
+
+    ffi_t ffi = { 0 };
+    ffi_init(&ffi);
+
+    ffi_native_exports_define(&ffi.supplied,
+        sstr("zero_first"),
+        (ffi_handle_t) {
+            .local = NULL,
+            .tag = FFI_HNDL_HOST_FUNCTION,
+            .u.host_function = test_zero_first
+        }, ift_func_1(ift_list(ift_int()), ift_list(ift_int())));
+
+    for(int level = 0; level <= 2; level++) {
+        source_code_t code = program_source_from_memory(str, strlen(str));
+        program_t program = program_compile(&code, false, (compiler_opts_t) {
+            .opt_level = level
+        });
+        program_source_free(&code);
+
+        if( program_is_valid(&program) == false ) {
+            TEST_ASSERT_MSG(this,
+                false,
+                "#1.0 failed to compile test program (level %i)", level);
+            break;
+        }
+
+        entry_point_t main_ep = {0};
+        entry_point_t copies_ep = {0};
+        program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &main_ep);
+        program_entry_point_find(&program, "copies", ift_func_1(ift_int(), ift_int()), &copies_ep);
+
+        vm_t vm = {0};
+        vm_create(&vm, 100);
+
+        vm_env_t env = {0};
+        vm_env_setup(&env, &program, &ffi);
+
+        // the literals are never copied to the heap
+        program_entry_point_set_arg(&main_ep, 0, val_int(10));
+        val_t result = vm_execute(&vm, &env, &main_ep, &program);
+        TEST_ASSERT_MSG(this,
+            result.type == VAL_INT && val_into_int(result) == 189,
+            "#1.1 unexpected result (level %i)", level);
+        TEST_ASSERT_MSG(this,
+            heap_get_used(&vm) == 0,
+            "#1.2 literals allocated on the heap (level %i)", level);
+
+        // but a host that writes to one gets a copy
+        program_entry_point_set_arg(&copies_ep, 0, val_int(10));
+        result = vm_execute(&vm, &env, &copies_ep, &program);
+        TEST_ASSERT_MSG(this,
+            result.type == VAL_INT && val_into_int(result) == 232,
+            "#1.3 unexpected result (level %i)", level);
+
+        // the literals themselves are never written to
+        array_t literal = { 0 };
+        for(uint32_t i = 0; i < program.cons.count; i++) {
+            val_t value = program.cons.buffer[i];
+            if( value.type == VAL_ARRAY && ADDR_IS_CONST(value.u.address) ) {
+                literal = val_into_array(value);
+                break;
+            }
+        }
+        bool unchanged = false;
+        if( literal.length > 0 ) {
+            val_t first = array_get(&vm, literal, 0);
+            unchanged = array_set(&vm, literal, 0, val_int(77)) == false
+                && array_get(&vm, literal, 0).u.address == first.u.address;
+        }
+        TEST_ASSERT_MSG(this,
+            unchanged,
+            "#1.4 a constant array was written to (level %i)", level);
+
+        vm_destroy(&vm);
+        vm_env_destroy(&env);
+        program_destroy(&program);
+    }
+
+    ffi_destroy(&ffi);
+}
+
+void test_vm_packed(test_case_t* this) {
+
+    char* str = 
+    "export array<char> word(char c) {\n"
+    "   return [c, c, c, c, c, c, c, c, c];\n"
+    "}\n"
+    "int main(int n) {\n" 
+    "   int t = 0;\n"
+    "   array<int> xs = [n, n + 1, n + 2];\n"
+    "   for(int x in xs) {\n"
+    "       t = t + x;\n"
+    "   }\n"
+    "   array<bool> bs = [n > 5, n > 50, true];\n"
+    "   for(bool b in bs) {\n"
+    "       if(b) {\n"
+    "           t = t + 100;\n"
+    "       }\n"
+    "   }\n"
+    "   for(char c in \"abc\") {\n"
+    "       for(char d in word(c)) {\n"
+    "           t = t + 1;\n"
+    "       }\n"
+    "   }\n"
+    "   return t;\n"
+    "}\n";
+
+    ffi_t ffi = { 0 };
+    ffi_init(&ffi);
+
+    for(int level = 0; level <= 2; level++) {
+        source_code_t code = program_source_from_memory(str, strlen(str));
+        program_t program = program_compile(&code, false, (compiler_opts_t) {
+            .opt_level = level
+        });
+        program_source_free(&code);
+
+        if( program_is_valid(&program) == false ) {
+            TEST_ASSERT_MSG(this,
+                false,
+                "#1.0 failed to compile test program (level %i)", level);
+            break;
+        }
+
+        entry_point_t main_ep = {0};
+        entry_point_t word_ep = {0};
+        program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &main_ep);
+        program_entry_point_find(&program, "word", ift_func_1(ift_list(ift_char()), ift_char()), &word_ep);
+
+        vm_t vm = {0};
+        vm_create(&vm, 100);
+
+        vm_env_t env = {0};
+        vm_env_setup(&env, &program, &ffi);
+
+        program_entry_point_set_arg(&main_ep, 0, val_int(10));
+        val_t result = vm_execute(&vm, &env, &main_ep, &program);
+        TEST_ASSERT_MSG(this,
+            result.type == VAL_INT && val_into_int(result) == 260,
+            "#1.1 unexpected result (level %i)", level);
+
+        // nine chars fit in two values
+        heap_clear(&vm);
+        program_entry_point_set_arg(&word_ep, 0, val_char('a'));
+        result = vm_execute(&vm, &env, &word_ep, &program);
+        char word[16] = { 0 };
+        TEST_ASSERT_MSG(this,
+            result.type == VAL_ARRAY
+            && val_into_array(result).pack == VAL_CHAR
+            && heap_get_used(&vm) == 2 * (int) sizeof(val_t),
+            "#1.2 the string is not packed (level %i)", level);
+        vm_get_string(&vm, result, word, sizeof(word));
+        TEST_ASSERT_MSG(this,
+            strcmp(word, "aaaaaaaaa") == 0,
+            "#1.3 unexpected string '%s' (level %i)", word, level);
+
+        vm_destroy(&vm);
+        vm_env_destroy(&env);
+        program_destroy(&program);
+    }
+
+    ffi_destroy(&ffi);
+
+    // stradd copies the bytes of packed strings
+    char* str_02 = 
+    "import string stradd(string fst, string snd);\n"
+    "export string join(char c) {\n"
+    "   return stradd(stradd(\"abc\", [c, c]), \"de\");\n"
+    "}\n";
+
+    source_code_t code = program_source_from_memory(str_02, strlen(str_02));
+    program_t program = program_compile(&code, false, (compiler_opts_t) { 0 });
+    program_source_free(&code);
+
+    xu_setup_default_interface(&ffi);
+    vm_t vm = {0};
+    vm_create(&vm, 100);
+    vm_env_t env = {0};
+    entry_point_t join_ep = {0};
+    val_t result = val_none();
+    if( program_is_valid(&program) && vm_env_setup(&env, &program, &ffi)
+        && program_entry_point_find(&program, "join",
+            ift_func_1(ift_list(ift_char()), ift_char()), &join_ep) == PEP_OK ) {
+        program_entry_point_set_arg(&join_ep, 0, val_char('x'));
+        result = vm_execute(&vm, &env, &join_ep, &program);
+    }
+    char joined[16] = { 0 };
+    if( result.type == VAL_ARRAY ) {
+        vm_get_string(&vm, result, joined, sizeof(joined));
+    }
+    TEST_ASSERT_MSG(this,
+        result.type == VAL_ARRAY && val_into_array(result).pack == VAL_CHAR
+        && strcmp(joined, "abcxxde") == 0,
+        "#2.1 unexpected joined string '%s'", joined);
+
+    vm_destroy(&vm);
+    vm_env_destroy(&env);
+    program_destroy(&program);
+    ffi_destroy(&ffi);
+}
 
 void test_vm_cleanup(test_case_t* this) {
 
@@ -1400,7 +2109,7 @@ void test_vm_cleanup(test_case_t* this) {
     "}\n";
 
     source_code_t code = program_source_from_memory(src_01, strlen(src_01));
-    program_t program = program_compile(&code, false);
+    program_t program = program_compile(&code, false, (compiler_opts_t) { 0 });
     program_source_free(&code);
 
     if( program_is_valid(&program) == false ) {
@@ -1442,22 +2151,1148 @@ void test_vm_cleanup(test_case_t* this) {
 }
 
 
-test_results_t run_testcases(void) {
+void test_vm_call_depth(test_case_t* this) {
 
-    test_case_t test_cases[] = {
-        {
-            .name = "vm full heap",
-            .test = test_vm_full_heap,
-            .nfailed = 0
-        },
-        {
-            .name = "vm cleanup",
-            .test = test_vm_cleanup,
-            .nfailed = 0
-        },
-        {
-            .name = "ift types",
-            .test = test_ift_types,
+    char* src_01 = 
+    "int down(int n) {\n"
+    "   if( n < 1 ) {\n"
+    "       return 0;\n"
+    "   }\n"
+    "   int m = n - 1;\n"
+    "   return 1 + down(m);\n"
+    "}\n"
+    "int main(int n) {\n" 
+    "   return down(n);\n"  
+    "}\n";
+
+    source_code_t code = program_source_from_memory(src_01, strlen(src_01));
+    program_t program = program_compile(&code, false, (compiler_opts_t) { 0 });
+    program_source_free(&code);
+
+    if( program_is_valid(&program) == false ) {
+        TEST_ASSERT_MSG(this,
+            false,
+            "#1.0 failed to compile test program");
+        return;
+    }
+
+    entry_point_t ep = {0};
+    program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &ep);
+    if( program_entry_point_is_valid(ep) == false ) {
+        TEST_ASSERT_MSG(this,
+            false,
+            "#1.1 failed access entry point");
+        program_destroy(&program);
+        return;
+    }
+
+    vm_t vm = {0};
+    vm_create(&vm, 4000);
+
+    vm_env_t env = {0};
+    vm_env_setup(&env, &program, NULL);
+
+    // each call keeps 2 values on the stack (2000 available)
+    program_entry_point_set_arg(&ep, 0, val_int(900));
+    val_t result = vm_execute(&vm, &env, &ep, &program);
+    TEST_ASSERT_MSG(this,
+        result.type == VAL_INT && val_into_int(result) == 900,
+        "#1.2 deep recursion");
+
+    TEST_ASSERT_MSG(this,
+        vm.mem.stack.top == -1 && vm.mem.frames.top == -1,
+        "#1.3 stack and frames left behind");
+
+    vm_destroy(&vm);
+    vm_env_destroy(&env);
+    program_destroy(&program);
+}
+
+static void test_vm_resume_with(test_case_t* this, bool jit) {
+
+    char* src_01 = 
+    "int down(int n) {\n"
+    "   if( n < 1 ) {\n"
+    "       return 0;\n"
+    "   }\n"
+    "   int m = n - 1;\n"
+    "   return 1 + down(m);\n"
+    "}\n"
+    "int main(int n) {\n" 
+    "   return down(n);\n"  
+    "}\n";
+
+    source_code_t code = program_source_from_memory(src_01, strlen(src_01));
+    program_t program = program_compile(&code, false, (compiler_opts_t) { .jit = jit });
+    program_source_free(&code);
+
+    if( program_is_valid(&program) == false ) {
+        TEST_ASSERT_MSG(this,
+            false,
+            "#1.0 failed to compile test program");
+        return;
+    }
+
+    entry_point_t ep = {0};
+    program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &ep);
+    if( program_entry_point_is_valid(ep) == false ) {
+        TEST_ASSERT_MSG(this,
+            false,
+            "#1.1 failed access entry point");
+        program_destroy(&program);
+        return;
+    }
+
+    vm_t vm = {0};
+    vm_create(&vm, 4000);
+
+    vm_env_t env = {0};
+    vm_env_setup(&env, &program, NULL);
+
+    program_entry_point_set_arg(&ep, 0, val_int(500));
+
+    // reference run with the default budget
+    val_t result = vm_execute(&vm, &env, &ep, &program);
+    uint32_t full_cycles = vm.run.cycles;
+    TEST_ASSERT_MSG(this,
+        result.type == VAL_INT && val_into_int(result) == 500
+            && vm_is_suspended(&vm) == false,
+        "#1.2 full run");
+
+    vm_set_cycle_budget(&vm, 100);
+    result = vm_execute(&vm, &env, &ep, &program);
+    TEST_ASSERT_MSG(this,
+        vm_is_suspended(&vm) && vm.run.cycles == 100,
+        "#1.3 suspended on budget");
+
+    uint32_t total_cycles = vm.run.cycles;
+    int resumes = 0;
+    while( vm_is_suspended(&vm) && resumes < 1000 ) {
+        result = vm_resume(&vm);
+        total_cycles += vm.run.cycles;
+        resumes++;
+    }
+
+    TEST_ASSERT_MSG(this,
+        result.type == VAL_INT && val_into_int(result) == 500,
+        "#1.4 resumed result");
+
+    TEST_ASSERT_MSG(this,
+        total_cycles == full_cycles && resumes == (int)((full_cycles - 1) / 100),
+        "#1.5 resumed cycle count");
+
+    TEST_ASSERT_MSG(this,
+        vm.mem.stack.top == -1 && vm.mem.frames.top == -1,
+        "#1.6 stack and frames left behind");
+
+    result = vm_resume(&vm);
+    TEST_ASSERT_MSG(this,
+        result.type == VAL_NUMBER && val_into_number(result) == -1008,
+        "#1.7 resume without a suspended run");
+
+    vm_destroy(&vm);
+    vm_env_destroy(&env);
+    program_destroy(&program);
+}
+
+void test_vm_resume(test_case_t* this) {
+    test_vm_resume_with(this, false);
+    if( VM_JIT ) {
+        test_vm_resume_with(this, true);
+    }
+}
+
+void test_vm_verify(test_case_t* this) {
+
+    char* src_01 = 
+    "int sum(array<int> xs) {\n"
+    "   int total = 0;\n"
+    "   for(int x in xs) {\n"
+    "       total = total + x;\n"
+    "   }\n"
+    "   return total;\n"
+    "}\n"
+    "int main(int n) {\n" 
+    "   return sum([1, 2, 3]) + n;\n"  
+    "}\n";
+
+    source_code_t code = program_source_from_memory(src_01, strlen(src_01));
+    program_t program = program_compile(&code, false, (compiler_opts_t) { 0 });
+    program_source_free(&code);
+
+    if( program_is_valid(&program) == false ) {
+        TEST_ASSERT_MSG(this,
+            false,
+            "#1.0 failed to compile test program");
+        return;
+    }
+
+    entry_point_t ep = {0};
+    program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &ep);
+
+    vm_t vm = {0};
+    vm_create(&vm, 100);
+
+    vm_env_t env = {0};
+    vm_env_setup(&env, &program, NULL);
+
+    TEST_ASSERT_MSG(this,
+        env.verified != NULL,
+        "#1.1 program not verified");
+
+    program_entry_point_set_arg(&ep, 0, val_int(4));
+    val_t result = vm_execute(&vm, &env, &ep, &program);
+    TEST_ASSERT_MSG(this,
+        result.type == VAL_INT && val_into_int(result) == 10
+            && vm.run.checked == false,
+        "#1.2 verified run");
+
+    // args of the wrong type are validated at run time
+    program_entry_point_set_arg_unsafe(&ep, 0, val_number(4));
+    vm_execute(&vm, &env, &ep, &program);
+    TEST_ASSERT_MSG(this,
+        vm.run.checked,
+        "#1.3 unexpected unchecked run");
+
+    // a load from a slot outside of the frame is rejected
+    uint8_t* inst = program.inst.buffer;
+    uint32_t at = 0;
+    while( at < program.inst.size && inst[at] != OP_LOAD_LOCAL ) {
+        at += 1 + 4 * get_op_arg_count(inst[at]);
+    }
+    TEST_ASSERT_MSG(this,
+        at < program.inst.size,
+        "#2.0 no load-local in the program");
+    if( at < program.inst.size ) {
+        uint8_t slot = inst[at + 1];
+        inst[at + 1] = 200;
+        vm_verify_t* verified = vm_verify_program(&program);
+        TEST_ASSERT_MSG(this,
+            verified == NULL,
+            "#2.1 bad slot not rejected");
+        vm_verify_destroy(verified);
+        inst[at + 1] = slot;
+
+        // an opcode byte past the known ones stops a run that
+        // isn't validated (the env still has the verified exports)
+        uint8_t opcode = inst[at];
+        inst[at] = 0xFF;
+        program_entry_point_set_arg(&ep, 0, val_int(4));
+        result = vm_execute(&vm, &env, &ep, &program);
+        TEST_ASSERT_MSG(this,
+            vm.run.checked == false && result.type == VAL_NUMBER
+            && val_into_number(result) == -1003,
+            "#2.2 unknown opcode not stopped");
+        inst[at] = opcode;
+    }
+
+    vm_env_destroy(&env);
+    program_destroy(&program);
+
+    // nested arrays keep the type of their inner elements
+    char* src_02 = 
+    "int total(array<array<int>> rows) {\n"
+    "   int t = 0;\n"
+    "   for(array<int> r in rows) {\n"
+    "       for(int x in r) {\n"
+    "           t = t + x * x;\n"
+    "       }\n"
+    "   }\n"
+    "   return t;\n"
+    "}\n"
+    "int main(int n) {\n" 
+    "   return total([[1, 2], [n, 4]]) + total([[1], [2, 3]]);\n"  
+    "}\n";
+
+    code = program_source_from_memory(src_02, strlen(src_02));
+    program = program_compile(&code, false, (compiler_opts_t) { 0 });
+    program_source_free(&code);
+
+    if( program_is_valid(&program) == false ) {
+        TEST_ASSERT_MSG(this,
+            false,
+            "#3.0 failed to compile test program");
+        vm_destroy(&vm);
+        return;
+    }
+
+    program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &ep);
+    env = (vm_env_t) {0};
+    vm_env_setup(&env, &program, NULL);
+
+    TEST_ASSERT_MSG(this,
+        env.verified != NULL,
+        "#3.1 program with nested arrays not verified");
+
+    program_entry_point_set_arg(&ep, 0, val_int(3));
+    result = vm_execute(&vm, &env, &ep, &program);
+    TEST_ASSERT_MSG(this,
+        result.type == VAL_INT && val_into_int(result) == 44
+            && vm.run.checked == false,
+        "#3.2 verified run with nested arrays");
+
+    vm_destroy(&vm);
+    vm_env_destroy(&env);
+    program_destroy(&program);
+}
+
+void test_vm_prepared_call(test_case_t* this) {
+
+    char* src_01 = 
+    "int fib(int n) {\n"
+    "   if( n < 2 ) {\n"
+    "       return n;\n"
+    "   }\n"
+    "   return fib(n - 1) + fib(n - 2);\n"
+    "}\n"
+    "int main(int n) {\n" 
+    "   return fib(n);\n"  
+    "}\n";
+
+    source_code_t code = program_source_from_memory(src_01, strlen(src_01));
+    program_t program = program_compile(&code, false, (compiler_opts_t) { 0 });
+    program_source_free(&code);
+
+    if( program_is_valid(&program) == false ) {
+        TEST_ASSERT_MSG(this,
+            false,
+            "#1.0 failed to compile test program");
+        return;
+    }
+
+    entry_point_t ep = {0};
+    program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &ep);
+
+    vm_t vm = {0};
+    vm_create(&vm, 1000);
+
+    vm_env_t env = {0};
+    vm_env_setup(&env, &program, NULL);
+
+    vm_call_t call = vm_call_prepare(&vm, &env, &ep, &program);
+
+    int expected[] = { 0, 1, 1, 2, 3, 5, 8, 13, 21, 34, 55 };
+    bool all_ok = true;
+    for(int i = 0; i < 11; i++) {
+        val_t arg = val_int(i);
+        val_t result = vm_call(&call, &arg);
+        all_ok = all_ok && result.type == VAL_INT
+            && val_into_int(result) == expected[i];
+    }
+    TEST_ASSERT_MSG(this,
+        all_ok && vm.run.checked == false,
+        "#1.1 unexpected result of prepared call");
+
+    // the same as vm_execute
+    program_entry_point_set_arg(&ep, 0, val_int(12));
+    val_t executed = vm_execute(&vm, &env, &ep, &program);
+    val_t arg = val_int(12);
+    val_t called = vm_call(&call, &arg);
+    TEST_ASSERT_MSG(this,
+        val_into_int(executed) == 144 && val_into_int(called) == 144,
+        "#1.2 prepared call and execute differ");
+
+    // args of the wrong type are validated at run time
+    arg = val_bool(true);
+    vm_call(&call, &arg);
+    TEST_ASSERT_MSG(this,
+        vm.run.checked,
+        "#1.3 unexpected unchecked run");
+
+    vm_env_destroy(&env);
+    arg = val_int(3);
+    TEST_ASSERT_MSG(this,
+        val_into_number(vm_call(&call, &arg)) == -1099,
+        "#1.4 call on an env that is not set up");
+
+    // the export is resolved again for an env that was set up again
+    vm_env_setup(&env, &program, NULL);
+    called = vm_call(&call, &arg);
+    TEST_ASSERT_MSG(this,
+        val_into_int(called) == 2 && call.index >= 0 && vm.run.checked == false,
+        "#1.5 prepared call after the env was set up again");
+
+    vm_env_destroy(&env);
+    vm_destroy(&vm);
+    program_destroy(&program);
+}
+
+void test_xu_batch_call(test_case_t* this) {
+    char* src_class = 
+    "export int score(int n) {\n"
+    "   array<int> a = [n, n, n, n];\n"
+    "   int sum = 0;\n"
+    "   for(int v in a) {\n"
+    "       sum = sum + v;\n"
+    "   }\n"
+    "   return sum;\n"
+    "}\n"
+    "export array<int> pair(int n) {\n"
+    "   array<int> junk = [n, n, n, n, n, n];\n"
+    "   return [n, n + 1];\n"
+    "}\n";
+
+    xu_classlist_t list = {0};
+    source_code_t code = program_source_from_memory(src_class, strlen(src_class));
+    xu_class_t class = xu_class_create(&list, &code, 0xBA7C);
+    program_source_free(&code);
+
+    xu_caller_t score = xu_class_extract(class, "score", ift_func_1(ift_int(), ift_int()));
+    xu_caller_t pair = xu_class_extract(class, "pair", ift_func_1(ift_list(ift_int()), ift_int()));
+
+    TEST_ASSERT_MSG(this,
+        xu_class_caller_is_valid(score)
+        && xu_class_caller_is_valid(pair)
+        && xu_finalize_all(&list),
+        "#1.1 class setup");
+
+    vm_t vm = {0};
+    vm_create(&vm, 128);
+
+    #define BATCH_COUNT 1000
+    val_t args[BATCH_COUNT];
+    val_t results[BATCH_COUNT];
+    for(int i = 0; i < BATCH_COUNT; i++) {
+        args[i] = val_int(i);
+    }
+
+    int done = xu_call_batch(&vm, &score, args, BATCH_COUNT, results, false);
+    bool all_ok = done == BATCH_COUNT;
+    for(int i = 0; i < done; i++) {
+        all_ok = all_ok && val_into_int(results[i]) == 4 * i
+            && val_into_int(results[i]) == icalli(&vm, &score, i);
+    }
+    TEST_ASSERT_MSG(this,
+        all_ok,
+        "#2.1 unexpected batch results");
+
+    // the heap is the same after a batch that resets it
+    int used = heap_get_used(&vm);
+    done = xu_call_batch(&vm, &score, args, BATCH_COUNT, results, true);
+    TEST_ASSERT_MSG(this,
+        done == BATCH_COUNT && heap_get_used(&vm) == used
+        && val_into_int(results[BATCH_COUNT - 1]) == 4 * (BATCH_COUNT - 1),
+        "#2.2 unexpected batch with heap reset");
+
+    // the items allocate more than the trigger of the incremental
+    // marking, the reset drops their allocations from its count too
+    vm_set_gc_budget(&vm, 8);
+    heap_gc_collect(&vm);
+    used = heap_get_used(&vm);
+    done = xu_call_batch(&vm, &score, args, BATCH_COUNT, results, true);
+    TEST_ASSERT_MSG(this,
+        done == BATCH_COUNT && heap_get_used(&vm) == used
+        && vm.mem.heap.allocated == 0 && vm.mem.heap.gc_marking == false
+        && vm.mem.heap.dirty_first > vm.mem.heap.dirty_last,
+        "#2.3 incremental marking after a batch with heap reset");
+    vm_set_gc_budget(&vm, 0);
+
+    // array results are kept while later items collect garbage
+    vm_destroy(&vm);
+    vm_create(&vm, 64);
+    done = xu_call_batch(&vm, &pair, args, 8, results, false);
+    all_ok = done == 8;
+    for(int i = 0; i < done; i++) {
+        array_t array = val_into_array(results[i]);
+        all_ok = all_ok && val_into_int(array_get(&vm, array, 0)) == i
+            && val_into_int(array_get(&vm, array, 1)) == i + 1;
+    }
+    TEST_ASSERT_MSG(this,
+        all_ok,
+        "#3.1 array results were collected");
+    #undef BATCH_COUNT
+
+    vm_destroy(&vm);
+    xu_cleanup_all(&list);
+}
+
+typedef struct test_worker_t {
+    vm_env_t*       env;
+    program_t*      program;
+    entry_point_t*  fib;
+    entry_point_t*  sum;
+    int             nfailed;
+} test_worker_t;
+
+static void* test_vm_threads_worker(void* data) {
+    test_worker_t* w = (test_worker_t*) data;
+
+    vm_t vm = {0};
+    vm_create(&vm, 256);
+    vm_call_t fib = vm_call_prepare(&vm, w->env, w->fib, w->program);
+    vm_call_t sum = vm_call_prepare(&vm, w->env, w->sum, w->program);
+
+    int expected[] = { 0, 1, 1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144 };
+    val_t args[13];
+    val_t results[13];
+    for(int i = 0; i < 13; i++) {
+        args[i] = val_int(i);
+    }
+
+    for(int round = 0; round < 200; round++) {
+        int done = vm_call_batch(&fib, args, 13, results, round % 2 == 0);
+        for(int i = 0; i < 13; i++) {
+            if( i >= done || val_into_int(results[i]) != expected[i] ) {
+                w->nfailed++;
+            }
+        }
+        // allocates on the heap of this vm
+        val_t arg = val_int(round);
+        if( val_into_int(vm_call(&sum, &arg)) != 4 * round + 6 ) {
+            w->nfailed++;
+        }
+    }
+
+    vm_destroy(&vm);
+    return NULL;
+}
+
+void test_vm_threads(test_case_t* this) {
+
+    char* src_01 = 
+    "export int fib(int n) {\n"
+    "   if( n < 2 ) {\n"
+    "       return n;\n"
+    "   }\n"
+    "   return fib(n - 1) + fib(n - 2);\n"
+    "}\n"
+    "export int sum(int n) {\n"
+    "   array<int> a = [n, n + 1, n + 2, n + 3];\n"
+    "   int s = 0;\n"
+    "   for(int v in a) {\n"
+    "       s = s + v;\n"
+    "   }\n"
+    "   return s;\n"
+    "}\n";
+
+    source_code_t code = program_source_from_memory(src_01, strlen(src_01));
+    program_t program = program_compile(&code, false, (compiler_opts_t) { 0 });
+    program_source_free(&code);
+
+    if( program_is_valid(&program) == false ) {
+        TEST_ASSERT_MSG(this,
+            false,
+            "#1.0 failed to compile test program");
+        return;
+    }
+
+    entry_point_t fib = {0};
+    entry_point_t sum = {0};
+    program_entry_point_find(&program, "fib", ift_func_1(ift_int(), ift_int()), &fib);
+    program_entry_point_find(&program, "sum", ift_func_1(ift_int(), ift_int()), &sum);
+
+    // one program and env shared by the vms of all threads
+    vm_env_t env = {0};
+    vm_env_setup(&env, &program, NULL);
+
+    #define NTHREADS 8
+    pthread_t threads[NTHREADS];
+    test_worker_t workers[NTHREADS];
+    int nstarted = 0;
+    for(int i = 0; i < NTHREADS; i++) {
+        workers[i] = (test_worker_t) {
+            .env = &env,
+            .program = &program,
+            .fib = &fib,
+            .sum = &sum,
+            .nfailed = 0
+        };
+        if( pthread_create(&threads[i], NULL, test_vm_threads_worker, &workers[i]) != 0 ) {
+            break;
+        }
+        nstarted++;
+    }
+
+    int nfailed = 0;
+    for(int i = 0; i < nstarted; i++) {
+        pthread_join(threads[i], NULL);
+        nfailed += workers[i].nfailed;
+    }
+    #undef NTHREADS
+
+    TEST_ASSERT_MSG(this,
+        nstarted > 0 && nfailed == 0,
+        "#1.1 unexpected results from worker threads");
+
+    vm_env_destroy(&env);
+    program_destroy(&program);
+}
+
+typedef struct test_exec_data_t {
+    xu_executor_t*  executor;
+    _Atomic(xu_job_t*) followup; // submitted by a done callback
+    _Atomic(int)    ndone;
+    _Atomic(int)    ncompleted;
+} test_exec_data_t;
+
+static void test_exec_done(xu_job_t* job, int completed) {
+    test_exec_data_t* data = (test_exec_data_t*) job->user;
+    atomic_fetch_add(&data->ndone, 1);
+    atomic_fetch_add(&data->ncompleted, completed);
+    xu_job_t* next = atomic_exchange(&data->followup, NULL);
+    if( next != NULL ) {
+        xu_executor_submit(data->executor, next);
+    }
+}
+
+void test_xu_executor(test_case_t* this) {
+    char* src_class = 
+    "export int fib(int n) {\n"
+    "   if( n < 2 ) {\n"
+    "       return n;\n"
+    "   }\n"
+    "   return fib(n - 1) + fib(n - 2);\n"
+    "}\n";
+
+    xu_classlist_t list = {0};
+    source_code_t code = program_source_from_memory(src_class, strlen(src_class));
+    xu_class_t class = xu_class_create(&list, &code, 0xE7EC);
+    program_source_free(&code);
+
+    xu_caller_t fib = xu_class_extract(class, "fib", ift_func_1(ift_int(), ift_int()));
+    TEST_ASSERT_MSG(this,
+        xu_class_caller_is_valid(fib) && xu_finalize_all(&list),
+        "#1.1 class setup");
+
+    xu_executor_t* executor = xu_executor_create(4, 256);
+    TEST_ASSERT_MSG(this,
+        executor != NULL && xu_executor_thread_count(executor) == 4,
+        "#1.2 executor setup");
+    if( executor == NULL ) {
+        xu_cleanup_all(&list);
+        return;
+    }
+
+    #define NJOBS 256
+    #define NITEMS 8
+    static xu_job_t jobs[NJOBS + 2];
+    static val_t args[NJOBS][NITEMS];
+    static val_t results[NJOBS + 2][NITEMS];
+    int expected[] = { 0, 1, 1, 2, 3, 5, 8, 13, 21, 34, 55, 89, 144, 233, 377, 610 };
+
+    test_exec_data_t data = { .executor = executor };
+    atomic_init(&data.followup, &jobs[NJOBS]);
+    atomic_init(&data.ndone, 0);
+    atomic_init(&data.ncompleted, 0);
+
+    for(int j = 0; j < NJOBS; j++) {
+        for(int i = 0; i < NITEMS; i++) {
+            args[j][i] = val_int((j + i) % 16);
+        }
+        jobs[j] = (xu_job_t) {
+            .caller = &fib,
+            .args = args[j],
+            .results = results[j],
+            .count = NITEMS,
+            .reset_heap = (j % 2) == 0,
+            .done = test_exec_done,
+            .user = &data
+        };
+    }
+    // submitted from a worker, the last completed item
+    // is fib(15)
+    jobs[NJOBS] = jobs[0];
+    jobs[NJOBS].args = args[15 - NITEMS + 1];
+    jobs[NJOBS].results = results[NJOBS];
+
+    // fib(15) takes more than 100 instructions
+    val_t arg15 = val_int(15);
+    jobs[NJOBS + 1] = (xu_job_t) {
+        .caller = &fib,
+        .args = &arg15,
+        .results = results[NJOBS + 1],
+        .count = 1,
+        .budget = 100,
+        .done = test_exec_done,
+        .user = &data
+    };
+
+    bool submitted = true;
+    for(int j = 0; j < NJOBS; j++) {
+        submitted = submitted && xu_executor_submit(executor, &jobs[j]);
+    }
+    submitted = submitted && xu_executor_submit(executor, &jobs[NJOBS + 1]);
+    xu_executor_wait(executor);
+
+    bool all_ok = submitted
+        && atomic_load(&data.ndone) == NJOBS + 2
+        && atomic_load(&data.ncompleted) == (NJOBS + 1) * NITEMS;
+    for(int j = 0; j < NJOBS; j++) {
+        for(int i = 0; i < NITEMS; i++) {
+            all_ok = all_ok && val_into_int(results[j][i]) == expected[(j + i) % 16];
+        }
+    }
+    all_ok = all_ok && val_into_int(results[NJOBS][NITEMS - 1]) == 610;
+    TEST_ASSERT_MSG(this,
+        all_ok,
+        "#2.1 unexpected job results");
+
+    TEST_ASSERT_MSG(this,
+        val_into_number(results[NJOBS + 1][0]) == -1004,
+        "#2.2 job budget was not applied");
+    #undef NJOBS
+    #undef NITEMS
+
+    xu_executor_destroy(executor);
+    xu_cleanup_all(&list);
+}
+
+typedef struct test_async_call_t {
+    vm_t*       vm;
+    uint32_t    token;
+    int         key;
+} test_async_call_t;
+
+typedef struct test_async_host_t {
+    test_async_call_t   calls[64];
+    int                 count;
+} test_async_host_t;
+
+static void test_async_fetch(ffi_hndl_meta_t md, int argcount, val_t* args) {
+    assert(argcount == 1);
+    (void)(argcount);
+    test_async_host_t* host = (test_async_host_t*) md.local;
+    host->calls[host->count++] = (test_async_call_t) {
+        .vm = md.vm,
+        .token = vm_wait_token(md.vm),
+        .key = val_into_int(args[0])
+    };
+}
+
+void test_vm_async_ffi(test_case_t* this) {
+
+    char* src_01 = 
+    "import int fetch(int key);\n"
+    "import void flush(int key);\n"
+    "export int main(int n) {\n"
+    "   int a = fetch(n);\n"
+    "   flush(a);\n"
+    "   int b = fetch(a + 1);\n"
+    "   return a + b;\n"
+    "}\n";
+
+    test_async_host_t host = { 0 };
+
+    ffi_t ffi = { 0 };
+    ffi_init(&ffi);
+    ffi_native_exports_define(&ffi.supplied, sstr("fetch"),
+        xu_ffi_async(test_async_fetch, &host),
+        ift_func_1(ift_int(), ift_int()));
+    ffi_native_exports_define(&ffi.supplied, sstr("flush"),
+        xu_ffi_async(test_async_fetch, &host),
+        ift_func_1(ift_void(), ift_int()));
+
+    for(int variant = 0; variant < 2; variant++) {
+
+        source_code_t code = program_source_from_memory(src_01, strlen(src_01));
+        program_t program = program_compile(&code, false,
+            (compiler_opts_t) { .jit = variant == 1 });
+        program_source_free(&code);
+
+        entry_point_t ep = {0};
+        program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &ep);
+
+        vm_env_t env = {0};
+        if( program_is_valid(&program) == false
+            || vm_env_setup(&env, &program, &ffi) == false
+            || program_entry_point_is_valid(ep) == false ) {
+            TEST_ASSERT_MSG(this,
+                false,
+                "#1.0 failed to set up test program");
+            program_destroy(&program);
+            break;
+        }
+
+        // many runs in flight on one thread
+        #define NRUNS 16
+        vm_t vms[NRUNS];
+        bool all_ok = true;
+        host.count = 0;
+        for(int i = 0; i < NRUNS; i++) {
+            vm_create(&vms[i], 64);
+            program_entry_point_set_arg(&ep, 0, val_int(i));
+            val_t result = vm_execute(&vms[i], &env, &ep, &program);
+            all_ok = all_ok && val_into_number(result) == -1009
+                && vm_is_waiting(&vms[i]);
+        }
+        TEST_ASSERT_MSG(this,
+            all_ok && host.count == NRUNS,
+            "#1.1 runs did not wait for the async calls");
+
+        // completing a call with a stale token fails
+        TEST_ASSERT_MSG(this,
+            val_into_number(vm_complete(&vms[0], host.calls[0].token + 1, val_int(0))) == -1008
+            && val_into_number(vm_resume(&vms[0])) == -1008
+            && vm_is_waiting(&vms[0]),
+            "#1.2 unexpected completion");
+
+        // complete in reverse order: fetch(n) = 10 * n, flush
+        // and fetch(a + 1) wait again, then the runs return
+        int results[NRUNS] = { 0 };
+        int nfinished = 0;
+        while( host.count > 0 ) {
+            test_async_call_t call = host.calls[--host.count];
+            val_t result = vm_complete(call.vm, call.token, val_int(10 * call.key));
+            if( vm_is_waiting(call.vm) == false ) {
+                results[call.vm - vms] = val_into_int(result);
+                nfinished++;
+            }
+        }
+        all_ok = nfinished == NRUNS;
+        for(int i = 0; i < NRUNS; i++) {
+            all_ok = all_ok && results[i] == 10 * i + 10 * (10 * i + 1);
+            vm_destroy(&vms[i]);
+        }
+        TEST_ASSERT_MSG(this,
+            all_ok,
+            "#1.3 unexpected results of completed runs");
+        #undef NRUNS
+
+        vm_env_destroy(&env);
+        program_destroy(&program);
+    }
+
+    ffi_destroy(&ffi);
+}
+
+static float test_typed_noted = 0.0f;
+
+static float test_typed_lerp(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+static int32_t test_typed_add3(int32_t a, int32_t b, int32_t c) {
+    return a + b + c;
+}
+
+static bool test_typed_is_even(int32_t n) {
+    return (n % 2) == 0;
+}
+
+static void test_typed_note(float v) {
+    test_typed_noted += v;
+}
+
+static int32_t test_typed_seven(void) {
+    return 7;
+}
+
+static int32_t test_typed_mix(int32_t a, float b) {
+    return a + (int32_t) b;
+}
+
+void test_vm_typed_ffi(test_case_t* this) {
+
+    char* src_01 = 
+    "import float lerp(float a, float b, float t);\n"
+    "import int add3(int a, int b, int c);\n"
+    "import bool is_even(int n);\n"
+    "import void note(float v);\n"
+    "import int seven();\n"
+    "export int main(int n) {\n"
+    "   note(2.5);\n"
+    "   int s = add3(n, seven(), 1);\n"
+    "   if( is_even(s) ) {\n"
+    "       return s;\n"
+    "   }\n"
+    "   return 0 - s;\n"
+    "}\n"
+    "export float blend(float t) {\n"
+    "   return lerp(2.0, 10.0, t);\n"
+    "}\n";
+
+    ffi_t ffi = { 0 };
+    ffi_init(&ffi);
+    #define TYPED_HANDLE(F) (ffi_handle_t) {                \
+            .tag = FFI_HNDL_HOST_TYPED,                     \
+            .u.host_typed = (ffi_typedcall_t) (F)           \
+        }
+    ffi_native_exports_define(&ffi.supplied, sstr("lerp"), TYPED_HANDLE(test_typed_lerp),
+        ift_func_3(ift_float(), ift_float(), ift_float(), ift_float()));
+    ffi_native_exports_define(&ffi.supplied, sstr("add3"), TYPED_HANDLE(test_typed_add3),
+        ift_func_3(ift_int(), ift_int(), ift_int(), ift_int()));
+    ffi_native_exports_define(&ffi.supplied, sstr("is_even"), TYPED_HANDLE(test_typed_is_even),
+        ift_func_1(ift_bool(), ift_int()));
+    ffi_native_exports_define(&ffi.supplied, sstr("note"), TYPED_HANDLE(test_typed_note),
+        ift_func_1(ift_void(), ift_float()));
+    ffi_native_exports_define(&ffi.supplied, sstr("seven"), TYPED_HANDLE(test_typed_seven),
+        ift_func(ift_int()));
+
+    for(int variant = 0; variant < 4; variant++) {
+
+        source_code_t code = program_source_from_memory(src_01, strlen(src_01));
+        program_t program = program_compile(&code, false, (compiler_opts_t) {
+            .backend = (variant & 1) ? CO_BACKEND_REGISTER : CO_BACKEND_STACK,
+            .jit = (variant & 2) != 0
+        });
+        program_source_free(&code);
+
+        entry_point_t ep_main = {0};
+        entry_point_t ep_blend = {0};
+        program_entry_point_find(&program, "main", ift_func_1(ift_int(), ift_int()), &ep_main);
+        program_entry_point_find(&program, "blend", ift_func_1(ift_float(), ift_float()), &ep_blend);
+
+        vm_env_t env = {0};
+        if( program_is_valid(&program) == false
+            || vm_env_setup(&env, &program, &ffi) == false ) {
+            TEST_ASSERT_MSG(this,
+                false,
+                "#1.0 failed to set up test program");
+            program_destroy(&program);
+            break;
+        }
+
+        vm_t vm = {0};
+        vm_create(&vm, 128);
+
+        test_typed_noted = 0.0f;
+        program_entry_point_set_arg(&ep_main, 0, val_int(4));
+        val_t even = vm_execute(&vm, &env, &ep_main, &program);
+        program_entry_point_set_arg(&ep_main, 0, val_int(5));
+        val_t odd = vm_execute(&vm, &env, &ep_main, &program);
+        program_entry_point_set_arg(&ep_blend, 0, val_number(0.25f));
+        val_t blended = vm_execute(&vm, &env, &ep_blend, &program);
+
+        TEST_ASSERT_MSG(this,
+            val_into_int(even) == 12 && val_into_int(odd) == -13
+            && val_into_number(blended) == 4.0f
+            && test_typed_noted == 5.0f,
+            "#1.1 unexpected result of typed host calls");
+
+        vm_destroy(&vm);
+        vm_env_destroy(&env);
+        program_destroy(&program);
+    }
+
+    // mixed arg types are not supported
+    char* src_02 = 
+    "import int mix(int a, float b);\n"
+    "export int main() {\n"
+    "   return mix(1, 2.0);\n"
+    "}\n";
+
+    ffi_native_exports_define(&ffi.supplied, sstr("mix"), TYPED_HANDLE(test_typed_mix),
+        ift_func_2(ift_int(), ift_int(), ift_float()));
+    #undef TYPED_HANDLE
+
+    source_code_t code = program_source_from_memory(src_02, strlen(src_02));
+    program_t program = program_compile(&code, false, (compiler_opts_t) { 0 });
+    program_source_free(&code);
+    vm_env_t env = {0};
+    TEST_ASSERT_MSG(this,
+        program_is_valid(&program) && vm_env_setup(&env, &program, &ffi) == false,
+        "#2.1 unsupported typed signature was accepted");
+    vm_env_destroy(&env);
+    program_destroy(&program);
+
+    ffi_destroy(&ffi);
+}
+
+void test_c_translation(test_case_t* this) {
+
+    char* src_01 = 
+    "import void print(string msg);\n"
+    "int twice(int n) {\n"
+    "   return n + n;\n"
+    "}\n"
+    "export int add(int a, int b) {\n"
+    "   print(\"adding\");\n"
+    "   return twice(a) + b;\n"
+    "}\n"
+    "export bool flip(bool b) {\n"
+    "   return not b;\n"
+    "}\n";
+
+    source_code_t code = program_source_from_memory(src_01, strlen(src_01));
+    program_t program = program_compile(&code, false, (compiler_opts_t) { 0 });
+    program_source_free(&code);
+
+    if( program_is_valid(&program) == false ) {
+        TEST_ASSERT_MSG(this,
+            false,
+            "#1.0 failed to compile test program");
+        return;
+    }
+
+    char* source = NULL;
+    size_t source_size = 0;
+    FILE* out = open_memstream(&source, &source_size);
+    bool source_ok = program_translate_to_c(&program, "calc", out);
+    fclose(out);
+
+    char* header = NULL;
+    size_t header_size = 0;
+    out = open_memstream(&header, &header_size);
+    bool header_ok = program_translate_to_c_header(&program, "calc", out);
+    fclose(out);
+
+    TEST_ASSERT_MSG(this,
+        source_ok && header_ok,
+        "#1.1 translation failed");
+
+    TEST_ASSERT_MSG(this,
+        strstr(header, "bool calc_setup(vm_env_t* env, ffi_t* ffi);") != NULL,
+        "#1.2 setup function not declared");
+
+    TEST_ASSERT_MSG(this,
+        strstr(header, "val_t calc_add(vm_t* vm, vm_env_t* env, int32_t arg0, int32_t arg1);") != NULL
+        && strstr(header, "val_t calc_flip(vm_t* vm, vm_env_t* env, bool arg0);") != NULL,
+        "#1.3 exports not declared with typed signatures");
+
+    TEST_ASSERT_MSG(this,
+        strstr(source, "sstr(\"print\")") != NULL
+        && strstr(source, "AOT_CALL_NATIVE(0);") != NULL,
+        "#1.4 import not bound");
+
+    // the call to twice needs a return site
+    TEST_ASSERT_MSG(this,
+        strstr(source, "AOT_CALL(") != NULL
+        && strstr(source, "aot_return:") != NULL,
+        "#1.5 internal call not translated");
+
+    free(source);
+    free(header);
+    program_destroy(&program);
+
+    // deep recursion: the setup verifies the bytecode kept in the
+    // source, calls check the stack for room for the largest frame
+    char* src_02 = 
+    "export int down(int n) {\n"
+    "   int a = n;\n"
+    "   int b = n + 1;\n"
+    "   int c = n + 2;\n"
+    "   int d = n + 3;\n"
+    "   if( n <= 0 ) {\n"
+    "       return 0;\n"
+    "   }\n"
+    "   return down(n - 1) + (d - a) + (c - b);\n"
+    "}\n";
+
+    code = program_source_from_memory(src_02, strlen(src_02));
+    program = program_compile(&code, false, (compiler_opts_t) { 0 });
+    program_source_free(&code);
+
+    if( program_is_valid(&program) == false ) {
+        TEST_ASSERT_MSG(this,
+            false,
+            "#2.0 failed to compile test program");
+        return;
+    }
+
+    source = NULL;
+    out = open_memstream(&source, &source_size);
+    source_ok = program_translate_to_c(&program, "rec", out);
+    fclose(out);
+
+    TEST_ASSERT_MSG(this,
+        source_ok
+        && strstr(source, "static uint8_t rec_code[]") != NULL
+        && strstr(source, "ffi_definition_set_add(&program.exports, sstr(\"down\")") != NULL
+        && strstr(source, "aot_env_check(env)") != NULL,
+        "#2.1 bytecode and exports not kept for the setup");
+
+    TEST_ASSERT_MSG(this,
+        strstr(source, "AOT_CALL(") != NULL
+        && strstr(source, "val_t rec_down(vm_t* vm, vm_env_t* env, int32_t arg0) {") != NULL
+        && strstr(source, "    return rec_run(vm, env, ") != NULL,
+        "#2.2 recursive export not translated");
+
+    // the run of the interpreter the translated code matches
+    vm_t vm = {0};
+    vm_create(&vm, 1024);
+    vm_env_t env = {0};
+    vm_env_setup(&env, &program, NULL);
+    entry_point_t ep = {0};
+    program_entry_point_find(&program, "down", ift_func_1(ift_int(), ift_int()), &ep);
+    program_entry_point_set_arg(&ep, 0, val_int(5000));
+    val_t result = vm_execute(&vm, &env, &ep, &program);
+    TEST_ASSERT_MSG(this,
+        env.verified != NULL && env.verified->frame_extent > 4
+        && result.type == VAL_NUMBER && val_into_number(result) == -1006,
+        "#2.3 deep recursion was not stopped");
+
+    vm_env_destroy(&env);
+    vm_destroy(&vm);
+    free(source);
+    program_destroy(&program);
+}
+
+test_results_t run_testcases(void) {
+
+    test_case_t test_cases[] = {
+        {
+            .name = "vm full heap",
+            .test = test_vm_full_heap,
+            .nfailed = 0
+        },
+        {
+            .name = "vm literals",
+            .test = test_vm_literals,
+            .nfailed = 0
+        },
+        {
+            .name = "vm packed arrays",
+            .test = test_vm_packed,
+            .nfailed = 0
+        },
+        {
+            .name = "vm cleanup",
+            .test = test_vm_cleanup,
+            .nfailed = 0
+        },
+        {
+            .name = "vm call depth",
+            .test = test_vm_call_depth,
+            .nfailed = 0
+        },
+        {
+            .name = "vm resume",
+            .test = test_vm_resume,
+            .nfailed = 0
+        },
+        {
+            .name = "vm verify",
+            .test = test_vm_verify,
+            .nfailed = 0
+        },
+        {
+            .name = "vm prepared call",
+            .test = test_vm_prepared_call,
+            .nfailed = 0
+        },
+        {
+            .name = "xu batch call",
+            .test = test_xu_batch_call,
+            .nfailed = 0
+        },
+        {
+            .name = "vm threads",
+            .test = test_vm_threads,
+            .nfailed = 0
+        },
+        {
+            .name = "xu executor",
+            .test = test_xu_executor,
+            .nfailed = 0
+        },
+        {
+            .name = "vm async ffi",
+            .test = test_vm_async_ffi,
+            .nfailed = 0
+        },
+        {
+            .name = "vm typed ffi",
+            .test = test_vm_typed_ffi,
+            .nfailed = 0
+        },
+        {
+            .name = "c translation",
+            .test = test_c_translation,
+            .nfailed = 0
+        },
+        {
+            .name = "ift types",
+            .test = test_ift_types,
             .nfailed = 0
         },
         {
@@ -1470,6 +3305,26 @@ test_results_t run_testcases(void) {
             .test = test_heap_memory,
             .nfailed = 0
         },
+        {
+            .name = "heap allocator",
+            .test = test_heap_allocator,
+            .nfailed = 0
+        },
+        {
+            .name = "heap pools",
+            .test = test_heap_pools,
+            .nfailed = 0
+        },
+        {
+            .name = "heap compaction",
+            .test = test_heap_compaction,
+            .nfailed = 0
+        },
+        {
+            .name = "heap incremental gc",
+            .test = test_heap_incremental,
+            .nfailed = 0
+        },
         {
             .name = "virtual machine",
             .test = test_vm,
@@ -1505,6 +3360,16 @@ test_results_t run_testcases(void) {
             .test = test_langtest,
             .nfailed = 0
         },
+        {
+            .name = "co optimizer",
+            .test = test_co_optimizer,
+            .nfailed = 0
+        },
+        {
+            .name = "co ssa",
+            .test = test_co_ssa,
+            .nfailed = 0
+        },
         {
             .name = "xutils classes",
             .test = test_xu_classes,
@@ -1527,3 +3392,233 @@ test_results_t run_testcases(void) {
 
     return result;
 }
+
+
+void bench_printfn(ffi_hndl_meta_t md, int argcount, val_t* args) {
+    (void)(md);
+    (void)(argcount);
+    (void)(args);
+}
+
+bench_results_t run_benchmarks(int rounds, compiler_opts_t opts) {
+
+    bench_results_t result = { 0 };
+
+    ffi_t ffi = { 0 };
+    ffi_init(&ffi);
+    ffi_native_exports_define(&ffi.supplied,
+        sstr("print"), 
+        (ffi_handle_t) {
+            .local = 0,
+            .tag = FFI_HNDL_HOST_ACTION,
+            .u.host_action = bench_printfn,
+        },
+        ift_func_1(ift_void(),
+            ift_list(ift_char())));
+
+    vm_t vm = { 0 };
+    vm_create(&vm, 100);
+
+    size_t tc_count = sizeof(langtest_testcases) / sizeof(langtest_testcases[0]);
+    for (size_t i = 0; i < tc_count; i++) {
+        ltc_t tc = langtest_testcases[i];
+        if( strcmp(tc.category, "todo") == 0 )
+            continue;
+
+        source_code_t code = program_source_from_memory(tc.code, strlen(tc.code));
+        program_t program = program_compile(&code, false, opts);
+        program_source_free(&code);
+
+        if( program_is_valid(&program) == false ) {
+            sh_log_error("bench: failed to compile '%s'\n", tc.name);
+            continue;
+        }
+
+        vm_env_t env = { 0 };
+        entry_point_t ep = { 0 };
+        program_entry_point_find_any(&program, "main", &ep);
+        if( vm_env_setup(&env, &program, &ffi) == false
+            || program_entry_point_is_valid(ep) == false ) {
+            sh_log_error("bench: failed to set up '%s'\n", tc.name);
+            vm_env_destroy(&env);
+            program_destroy(&program);
+            continue;
+        }
+
+        unsigned long long instructions = 0;
+        clock_t start = clock();
+        for(int r = 0; r < rounds; r++) {
+            vm_execute(&vm, &env, &ep, &program);
+            instructions += vm.run.cycles;
+        }
+        clock_t end = clock();
+
+        double seconds = (double) (end - start) / CLOCKS_PER_SEC;
+        result.instructions += instructions;
+        result.seconds += seconds;
+        result.nprograms ++;
+
+        sh_log("  %-24s %10llu instr %8.3f s %8.2f Minstr/s\n",
+            tc.name,
+            instructions,
+            seconds,
+            seconds > 0.0 ? (instructions / seconds) / 1e6 : 0.0);
+
+        vm_env_destroy(&env);
+        program_destroy(&program);
+    }
+
+    vm_destroy(&vm);
+    ffi_destroy(&ffi);
+
+    return result;
+}
+
+static double bench_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void run_executor_benchmark(int njobs, int nitems) {
+
+    char* src_class = 
+    "export int fib(int n) {\n"
+    "   if( n < 2 ) {\n"
+    "       return n;\n"
+    "   }\n"
+    "   return fib(n - 1) + fib(n - 2);\n"
+    "}\n";
+
+    xu_classlist_t list = {0};
+    source_code_t code = program_source_from_memory(src_class, strlen(src_class));
+    xu_class_t class = xu_class_create(&list, &code, 0xBE7C);
+    program_source_free(&code);
+
+    xu_caller_t fib = xu_class_extract(class, "fib", ift_func_1(ift_int(), ift_int()));
+    if( xu_class_caller_is_valid(fib) == false || xu_finalize_all(&list) == false ) {
+        sh_log_error("bench: failed to set up the executor benchmark\n");
+        xu_cleanup_all(&list);
+        return;
+    }
+
+    xu_job_t* jobs = (xu_job_t*) malloc(njobs * sizeof(xu_job_t));
+    val_t* args = (val_t*) malloc(nitems * sizeof(val_t));
+    val_t* results = (val_t*) malloc(njobs * nitems * sizeof(val_t));
+    for(int i = 0; i < nitems; i++) {
+        args[i] = val_int(4 + i % 8);
+    }
+
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    double base = 0.0;
+    for(int nthreads = 1; nthreads <= ncpu; nthreads *= 2) {
+        xu_executor_t* executor = xu_executor_create(nthreads, 256);
+        if( executor == NULL ) {
+            break;
+        }
+        double start = bench_seconds();
+        for(int j = 0; j < njobs; j++) {
+            jobs[j] = (xu_job_t) {
+                .caller = &fib,
+                .args = args,
+                .results = results + j * nitems,
+                .count = nitems
+            };
+            xu_executor_submit(executor, &jobs[j]);
+        }
+        xu_executor_wait(executor);
+        double seconds = bench_seconds() - start;
+        xu_executor_destroy(executor);
+
+        double calls = (njobs * (double) nitems) / seconds;
+        if( nthreads == 1 ) {
+            base = calls;
+        }
+        sh_log("  %3i threads %12.0f calls/s %8.3f s  x%.2f\n",
+            nthreads, calls, seconds, base > 0.0 ? calls / base : 0.0);
+    }
+
+    free(jobs);
+    free(args);
+    free(results);
+    xu_cleanup_all(&list);
+}
+
+// arrays of 1 to 8 values (deterministic)
+static int bench_alloc_size(uint32_t* seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return 1 + (int) ((*seed >> 16) % 8);
+}
+
+void run_heap_benchmark(int heap_size, int rounds) {
+
+    int occupancies[] = { 10, 50, 90 };
+    int nmarks = HEAP_MARK_REGION_U64_COUNT(heap_size);
+    uint64_t* snapshot = (uint64_t*) malloc(nmarks * sizeof(uint64_t));
+    static uint32_t pools[HEAP_POOL_CLASSES * VM_HEAP_POOL_CAPACITY];
+    int pool_counts[HEAP_POOL_CLASSES];
+
+    for(int o = 0; o < 3; o++) {
+        vm_t vm = { 0 };
+        if( snapshot == NULL || vm_create(&vm, heap_size * 2) == false ) {
+            sh_log_error("bench: failed to set up the heap benchmark\n");
+            break;
+        }
+
+        // fill the heap with small arrays, drop some of them
+        // at random and collect, the free space is fragmented
+        uint32_t seed = 0xBE7C;
+        int stack_top = -1;
+        int filled = 0;
+        while( filled < (vm.mem.heap.size / 10) * 9 && stack_top + 1 < vm.mem.stack.size ) {
+            int size = bench_alloc_size(&seed);
+            array_t array = heap_array_alloc(&vm, size);
+            if( ADDR_IS_NULL(array.address) ) {
+                break;
+            }
+            vm.mem.stack.values[++stack_top] = val_array(array);
+            vm.mem.stack.top = stack_top;
+            filled += size;
+        }
+        for(int i = 0; i <= stack_top; i++) {
+            seed = seed * 1103515245u + 12345u;
+            if( (long) ((seed >> 16) % 100) * filled >= (long) occupancies[o] * vm.mem.heap.size ) {
+                vm.mem.stack.values[i] = val_none();
+            }
+        }
+        heap_gc_collect(&vm);
+        int used = heap_get_used(&vm) / (int) sizeof(val_t);
+        int budget = (vm.mem.heap.size - used) / 2;
+
+        // each round allocates half of the free space and
+        // then the heap is reset to the fragmented state
+        memcpy(snapshot, vm.mem.heap.gc_marks, nmarks * sizeof(uint64_t));
+        memcpy(pools, vm.mem.heap.pools, sizeof(pools));
+        memcpy(pool_counts, vm.mem.heap.pool_counts, sizeof(pool_counts));
+        int cursor = vm.mem.heap.cursor;
+        unsigned long long nallocs = 0;
+        double seconds = 0.0;
+        for(int r = 0; r < rounds; r++) {
+            int allocated = 0;
+            double start = bench_seconds();
+            while( allocated < budget ) {
+                int size = bench_alloc_size(&seed);
+                heap_array_alloc(&vm, size);
+                allocated += size;
+                nallocs++;
+            }
+            seconds += bench_seconds() - start;
+            memcpy(vm.mem.heap.gc_marks, snapshot, nmarks * sizeof(uint64_t));
+            memcpy(vm.mem.heap.pools, pools, sizeof(pools));
+            memcpy(vm.mem.heap.pool_counts, pool_counts, sizeof(pool_counts));
+            vm.mem.heap.cursor = cursor;
+        }
+
+        sh_log("  %3i%% used %12.0f allocs/s %8.3f s\n",
+            (100 * used) / vm.mem.heap.size,
+            seconds > 0.0 ? nallocs / seconds : 0.0, seconds);
+        vm_destroy(&vm);
+    }
+
+    free(snapshot);
+}
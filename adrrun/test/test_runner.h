@@ -1,11 +1,22 @@
 #ifndef TEST_RUNNER_H_
 #define TEST_RUNNER_H_
 
+#include <co_compiler.h>
+
 typedef struct test_results_t {
     int nfailed;
     int npassed;
 } test_results_t;
 
+typedef struct bench_results_t {
+    int nprograms;
+    unsigned long long instructions;
+    double seconds;
+} bench_results_t;
+
 test_results_t run_testcases(void);
+bench_results_t run_benchmarks(int rounds, compiler_opts_t opts);
+void run_executor_benchmark(int njobs, int nitems);
+void run_heap_benchmark(int heap_size, int rounds);
 
 #endif // TEST_RUNNER_H_
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <vm.h>
+#include <vm_env.h>
+#include <sh_ffi.h>
+#include <sh_log.h>
+#include <xu_lib.h>
+
+// translated at build time (adrrun -c), see CMakeLists.txt
+#include "basics.h"
+#include "export.h"
+#include "recurse.h"
+
+#define UNUSED_PARAM(X) (void)(X)
+
+// the output of the program, checked below
+static char output[4096];
+static int output_len = 0;
+
+void logfn(sh_log_tag_t _tag, const char* fmt, va_list args) {
+    UNUSED_PARAM(_tag);
+    va_list copy;
+    va_copy(copy, args);
+    vprintf(fmt, args);
+    int room = (int) sizeof(output) - output_len;
+    int n = vsnprintf(output + output_len, room, fmt, copy);
+    output_len += n < room ? n : room - 1;
+    va_end(copy);
+}
+
+int main(int argv, char** argc) {
+    UNUSED_PARAM(argv);
+    UNUSED_PARAM(argc);
+
+    sh_log_init(&logfn);
+
+    vm_t vm = { 0 };
+    ffi_t ffi = { 0 };
+    vm_env_t basics_env = { 0 };
+    vm_env_t export_env = { 0 };
+    vm_env_t recurse_env = { 0 };
+    int failed = 0;
+
+    if( vm_create(&vm, 1024) == false || xu_setup_default_interface(&ffi) == false ) {
+        printf("aot example: setup failed\n");
+        return 1;
+    }
+
+    if( basics_setup(&basics_env, &ffi) == false
+        || export_setup(&export_env, &ffi) == false
+        || recurse_setup(&recurse_env, &ffi) == false ) {
+        printf("aot example: env setup failed\n");
+        failed = 1;
+    } else {
+        basics_main(&vm, &basics_env);
+        if( strstr(output, "42: the best even number") == NULL
+            || strstr(output, "sum: 87") == NULL ) {
+            printf("aot example: unexpected output of basics_main\n");
+            failed = 1;
+        }
+        val_t sum = export_add(&vm, &export_env, 1.5f, 2.0f);
+        val_t diff = export_subtract(&vm, &export_env, 1.5f, 2.0f);
+        if( sum.type != VAL_NUMBER || val_into_number(sum) != 3.5f
+            || diff.type != VAL_NUMBER || val_into_number(diff) != -0.5f ) {
+            printf("aot example: add %f, subtract %f\n",
+                val_into_number(sum), val_into_number(diff));
+            failed = 1;
+        }
+        // too deep for the stack of the vm, the error is
+        // returned instead of an int
+        val_t shallow = recurse_down(&vm, &recurse_env, 10);
+        val_t deep = recurse_down(&vm, &recurse_env, 5000);
+        if( shallow.type != VAL_INT || val_into_int(shallow) != 160
+            || deep.type != VAL_NUMBER || val_into_number(deep) != -1006 ) {
+            printf("aot example: down(10) %i, down(5000) %f\n",
+                val_into_int(shallow), val_into_number(deep));
+            failed = 1;
+        }
+    }
+
+    printf("aot example: %s\n", failed ? "FAILED" : "OK");
+
+    vm_env_destroy(&basics_env);
+    vm_env_destroy(&export_env);
+    vm_env_destroy(&recurse_env);
+    vm_destroy(&vm);
+    ffi_destroy(&ffi);
+    return failed;
+}